@@ -1,10 +1,12 @@
 //
-// Created by denis on 22.01.23.
+// Created by denis on 17.10.26.
 //
 
 /*
- * Программа для измерения продолжительности нескольких операций POP
- * для централизованного стека Трейбера.
+ * Проверка централизованного стека Трейбера, в котором значения добавляют только процессы,
+ * отличные от HEAD_RANK. Предел пула узлов рассчитан ровно на все значения, но сначала
+ * выделен только один сегмент, поэтому остальные сегменты HEAD_RANK выделяет по запросам
+ * других процессов, и каждый PUSH должен получить узел.
  */
 
 #define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
@@ -29,24 +31,18 @@ int main(int argc, char *argv[])
 
     int rank{-1};
     MPI_Comm_rank(comm, &rank);
+    int procNum{0};
+    MPI_Comm_size(comm, &procNum);
 
     const auto minBackoffDelay = 1ns;
     const auto maxBackoffDelay = 100ns;
-    const auto elemsUpLimit{30000};
+    const int pushesNum{1000};
+    const size_t segmentCapacity{64};
+    const int elemsUpLimit = (procNum - 1) * pushesNum;
 
-    /*
-     * Сообщения, которые поступили подряд в течение 1 с,
-     * будут объединены в один лог с информацией об их
-     * количестве.
-     */
     auto duplicatingFilterSink = std::make_shared<spdlog::sinks::dup_filter_sink_mt>(
             1s
     );
-    /*
-     * default - лог отладки операций со стеком.
-     * benchmark - отдельный лог, в который поступает информация об измерениях.
-     */
-
     auto loggingDefaultFilename = getLoggingFilename(rank, "default");
     auto fileDefaultSink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(
             loggingDefaultFilename.data()
@@ -57,11 +53,6 @@ int main(int argc, char *argv[])
     spdlog::set_level(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
     spdlog::flush_on(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
 
-    auto loggingBenchmarkFilename = getLoggingFilename(rank, "benchmark");
-    auto fileBenchmarkSink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(
-            loggingBenchmarkFilename.data()
-    );
-
     try
     {
         auto rmaTreiberStack = rma_stack::RmaTreiberCentralStack<int>::create(
@@ -70,10 +61,14 @@ int main(int argc, char *argv[])
                 minBackoffDelay,
                 maxBackoffDelay,
                 elemsUpLimit,
-                duplicatingFilterSink
+                duplicatingFilterSink,
+                segmentCapacity
         );
-        runStackOnlyPopBenchmarkTask(rmaTreiberStack, comm, fileBenchmarkSink);
+        if (!runStackNonHeadPushTask(rmaTreiberStack, comm, pushesNum))
+            returnCode = EXIT_FAILURE;
+
         MPI_Barrier(comm);
+
         rmaTreiberStack.release();
     }
     catch (custom_mpi_extensions::MpiException& ex)
@@ -90,4 +85,4 @@ int main(int argc, char *argv[])
     MPI_Finalize();
     SPDLOG_INFO("finished program");
     return returnCode;
-}
\ No newline at end of file
+}
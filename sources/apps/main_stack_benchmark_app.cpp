@@ -0,0 +1,129 @@
+//
+// Created by denis on 17.10.26.
+//
+
+/*
+ * Программа для измерения производительности любого зарегистрированного варианта стека
+ * (см. registerStackBenchmark). Задача (см. BenchmarkTask) и параметры стека задаются в
+ * командной строке, см. getBenchmarkOptionsUsage.
+ */
+
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/basic_file_sink.h>
+#include <spdlog/sinks/dup_filter_sink.h>
+#include <spdlog/sinks/null_sink.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "include/benchmark_options.h"
+#include "include/stack_benchmark_registry.h"
+#include "include/logging.h"
+#include "MpiException.h"
+
+using namespace std::literals;
+
+int main(int argc, char *argv[])
+{
+    auto returnCode{EXIT_SUCCESS};
+
+    // Параметры разбираются до инициализации MPI, так как от задачи зависит требуемый уровень поддержки потоков.
+    BenchmarkOptions options;
+    std::string optionsError;
+    try
+    {
+        options = parseBenchmarkOptions(argc, argv);
+    }
+    catch (std::invalid_argument& ex)
+    {
+        optionsError = ex.what();
+    }
+
+    const bool threaded = optionsError.empty() && options.task == BenchmarkTask::ThreadedRandomOperation;
+    int threadSupport{MPI_THREAD_SINGLE};
+    if (threaded)
+        MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &threadSupport);
+    else
+        MPI_Init(&argc, &argv);
+    MPI_Comm comm = MPI_COMM_WORLD;
+    MPI_Info info = MPI_INFO_NULL;
+
+    int rank{-1};
+    MPI_Comm_rank(comm, &rank);
+
+    // Ошибки параметров выводятся до создания логов, чтобы не оставлять пустые файлы.
+    const StackBenchmarkRunner *pRunner{nullptr};
+    try
+    {
+        if (!optionsError.empty())
+            throw std::invalid_argument(optionsError);
+        pRunner = findStackBenchmark(options.stackName);
+        if (!pRunner)
+            throw std::invalid_argument("unknown stack variant: " + options.stackName);
+    }
+    catch (std::invalid_argument& ex)
+    {
+        if (rank == 0)
+        {
+            std::cerr << ex.what() << '\n' << getBenchmarkOptionsUsage() << "stack variants:";
+            for (const auto &name: getStackBenchmarkNames())
+                std::cerr << ' ' << name;
+            std::cerr << std::endl;
+        }
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    /*
+     * Сообщения, которые поступили подряд в течение 1 с,
+     * будут объединены в один лог с информацией об их
+     * количестве.
+     */
+    auto duplicatingFilterSink = std::make_shared<spdlog::sinks::dup_filter_sink_mt>(
+            1s
+    );
+    /*
+     * default - лог отладки операций со стеком.
+     * benchmark - отдельный лог, в который поступает информация об измерениях.
+     */
+
+    // Если результаты пишутся в файл, то остальные процессы не создают логи, иначе файлов будет по два на процесс.
+    const bool writeLogs = options.resultsPath.empty() || rank == 0;
+    std::shared_ptr<spdlog::sinks::sink> fileDefaultSink = std::make_shared<spdlog::sinks::null_sink_mt>();
+    if (writeLogs)
+        fileDefaultSink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(getLoggingFilename(rank, "default"));
+    duplicatingFilterSink->add_sink(fileDefaultSink);
+    auto pDefaultLogger = std::make_shared<spdlog::logger>(defaultLoggerName.data(), duplicatingFilterSink);
+    spdlog::set_default_logger(pDefaultLogger);
+    spdlog::set_level(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
+    spdlog::flush_on(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
+
+    std::shared_ptr<spdlog::sinks::sink> fileBenchmarkSink = std::make_shared<spdlog::sinks::null_sink_mt>();
+    if (writeLogs)
+        fileBenchmarkSink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(getLoggingFilename(rank, "benchmark"));
+
+    if (threaded && threadSupport < MPI_THREAD_MULTIPLE)
+    {
+        SPDLOG_WARN("MPI provides thread support level {} instead of 'MPI_THREAD_MULTIPLE'", threadSupport);
+    }
+
+    try
+    {
+        (*pRunner)(comm, info, options, duplicatingFilterSink, fileBenchmarkSink);
+    }
+    catch (custom_mpi_extensions::MpiException& ex)
+    {
+        SPDLOG_INFO("MPI exception"s + ex.what());
+        returnCode = EXIT_FAILURE;
+    }
+    catch (std::exception& ex)
+    {
+        SPDLOG_INFO("Unexpected exception: "s + ex.what());
+        returnCode = EXIT_FAILURE;
+    }
+
+    MPI_Finalize();
+    SPDLOG_INFO("finished program");
+    return returnCode;
+}
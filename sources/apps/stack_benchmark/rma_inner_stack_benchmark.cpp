@@ -0,0 +1,50 @@
+//
+// Created by denis on 17.10.26.
+//
+
+// Внутренний стек для программы stack_benchmark_app, выполняет только задачу callback-overhead.
+
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string>
+
+#include "inner/InnerStack.h"
+#include "include/stack_benchmark_registry.h"
+#include "include/stack_benchmark_runner.h"
+
+namespace
+{
+    const StackBenchmarkRegistrar registrar(
+            "inner",
+            [](MPI_Comm comm, MPI_Info info, const BenchmarkOptions &rOptions,
+               std::shared_ptr<spdlog::sinks::sink> loggerSink, std::shared_ptr<spdlog::sinks::sink> benchmarkSink) {
+                if (rOptions.task != BenchmarkTask::CallbackOverhead)
+                    throw std::invalid_argument("the task '" + std::string(getBenchmarkTaskName(rOptions.task))
+                                                + "' is not supported by the stack variant " + rOptions.stackName);
+
+                // Внутренний стек хранит только адреса данных, поэтому тип данных задачи не важен.
+                auto createStack = [&](auto) {
+                    auto pInnerStackLogger = std::make_shared<spdlog::logger>("InnerStack", loggerSink);
+                    pInnerStackLogger->set_level(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
+                    pInnerStackLogger->flush_on(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
+                    return rma_stack::ref_counting::InnerStack(
+                            comm,
+                            info,
+                            true,
+                            rOptions.elemsUpLimit,
+                            std::move(pInnerStackLogger),
+                            rma_stack::ref_counting::DefaultSegmentCapacity,
+                            rOptions.reclamationScheme,
+                            0,
+                            rOptions.shardSize,
+                            rOptions.epochMode,
+                            rOptions.requestPipelining
+                    );
+                };
+                runWithStack<void>(comm, rOptions, createStack, [&](auto &rStack, int repetitionIdx) {
+                    runInnerStackCallbackOverheadBenchmarkTask(rStack, comm, rOptions, repetitionIdx, benchmarkSink);
+                });
+            }
+    );
+}
@@ -0,0 +1,64 @@
+//
+// Created by denis on 17.10.26.
+//
+
+// Централизованный стек Трейбера для программы stack_benchmark_app.
+
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string>
+
+#include "outer/RmaTreiberCentralStack.h"
+#include "include/stack_benchmark_registry.h"
+#include "include/stack_benchmark_runner.h"
+
+namespace
+{
+    // Размер данных задаётся параметром шаблона, поэтому задача собрана для каждого из PayloadSizes.
+    template<typename CreateStack>
+    void runPayloadPlacementTask(MPI_Comm comm, const BenchmarkOptions &rOptions, const CreateStack &createStack,
+                                 const std::shared_ptr<spdlog::sinks::sink> &benchmarkSink)
+    {
+        auto runTask = [&](auto &rStack, int repetitionIdx) {
+            runStackPayloadPlacementBenchmarkTask(rStack, comm, rOptions, repetitionIdx, benchmarkSink);
+        };
+        if (rOptions.payloadSize == PayloadSizes[0])
+            runWithStack<SizedPayload<PayloadSizes[0]>>(comm, rOptions, createStack, runTask);
+        else if (rOptions.payloadSize == PayloadSizes[1])
+            runWithStack<SizedPayload<PayloadSizes[1]>>(comm, rOptions, createStack, runTask);
+        else if (rOptions.payloadSize == PayloadSizes[2])
+            runWithStack<SizedPayload<PayloadSizes[2]>>(comm, rOptions, createStack, runTask);
+        else
+            throw std::invalid_argument("unsupported payload size: " + std::to_string(rOptions.payloadSize));
+    }
+
+    const StackBenchmarkRegistrar registrar(
+            "central",
+            [](MPI_Comm comm, MPI_Info info, const BenchmarkOptions &rOptions,
+               std::shared_ptr<spdlog::sinks::sink> loggerSink, std::shared_ptr<spdlog::sinks::sink> benchmarkSink) {
+                auto createStack = [&](auto valueType) {
+                    return rma_stack::RmaTreiberCentralStack<typename decltype(valueType)::type>::create(
+                            comm,
+                            info,
+                            rOptions.backoffMinDelay,
+                            rOptions.backoffMaxDelay,
+                            rOptions.elemsUpLimit,
+                            loggerSink,
+                            rma_stack::ref_counting::DefaultSegmentCapacity,
+                            rOptions.reclamationScheme,
+                            rOptions.eliminationSlotsPerRank,
+                            rOptions.flatCombiningMode,
+                            rOptions.shardSize,
+                            rOptions.epochMode,
+                            rOptions.requestPipelining,
+                            rOptions.payloadPlacement
+                    );
+                };
+                if (rOptions.task == BenchmarkTask::PayloadPlacement)
+                    runPayloadPlacementTask(comm, rOptions, createStack, benchmarkSink);
+                else
+                    runStackBenchmarkTasks(comm, info, rOptions, createStack, loggerSink, benchmarkSink);
+            }
+    );
+}
@@ -0,0 +1,51 @@
+//
+// Created by denis on 17.10.26.
+//
+
+// Децентрализованный стек Трейбера для программы stack_benchmark_app.
+
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
+#include <spdlog/spdlog.h>
+#include <cmath>
+#include <stdexcept>
+
+#include "outer/RmaTreiberDecentralizedStack.h"
+#include "include/stack_benchmark_registry.h"
+#include "include/stack_benchmark_runner.h"
+
+namespace
+{
+    const StackBenchmarkRegistrar registrar(
+            "decentralized",
+            [](MPI_Comm comm, MPI_Info info, const BenchmarkOptions &rOptions,
+               std::shared_ptr<spdlog::sinks::sink> loggerSink, std::shared_ptr<spdlog::sinks::sink> benchmarkSink) {
+                // Размещение данных выбирается только у централизованного стека.
+                if (rOptions.payloadPlacement != rma_stack::PayloadPlacement::HeadRank)
+                    throw std::invalid_argument("the payload placement is supported by the central stack only");
+
+                int size{0};
+                MPI_Comm_size(comm, &size);
+                // Предел задан для всего стека, а узлы распределены между процессами поровну.
+                const int elemsUpLimit = std::ceil(static_cast<double>(rOptions.elemsUpLimit) / size);
+
+                auto createStack = [&](auto valueType) {
+                    return rma_stack::RmaTreiberDecentralizedStack<typename decltype(valueType)::type>::create(
+                            comm,
+                            info,
+                            rOptions.backoffMinDelay,
+                            rOptions.backoffMaxDelay,
+                            elemsUpLimit,
+                            loggerSink,
+                            rma_stack::ref_counting::DefaultSegmentCapacity,
+                            rOptions.reclamationScheme,
+                            rOptions.eliminationSlotsPerRank,
+                            rOptions.flatCombiningMode,
+                            rOptions.shardSize,
+                            rOptions.epochMode,
+                            rOptions.requestPipelining
+                    );
+                };
+                runStackBenchmarkTasks(comm, info, rOptions, createStack, loggerSink, benchmarkSink);
+            }
+    );
+}
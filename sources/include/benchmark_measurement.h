@@ -0,0 +1,302 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_BENCHMARK_MEASUREMENT_H
+#define SOURCES_BENCHMARK_MEASUREMENT_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <mpi.h>
+#include <spdlog/spdlog.h>
+
+#include "IStack.h"
+#include "benchmark_options.h"
+#include "benchmark_results.h"
+#include "latency_histogram.h"
+#include "inner/OperationCounters.h"
+
+// Реализация стека, к которой обращаются вспомогательные функции замеров.
+template<typename Stack>
+Stack& getStackImpl(Stack &rStack)
+{
+    return rStack;
+}
+
+template<typename StackImpl>
+StackImpl& getStackImpl(stack_interface::IStack<StackImpl> &stack)
+{
+    return static_cast<StackImpl&>(stack);
+}
+
+template<typename Stack, typename = void>
+struct HasServiceGrowRequests : std::false_type {};
+
+template<typename Stack>
+struct HasServiceGrowRequests<Stack, std::void_t<decltype(std::declval<Stack&>().serviceGrowRequests())>>
+        : std::true_type {};
+
+template<typename Stack, typename = void>
+struct HasOperationCounters : std::false_type {};
+
+template<typename Stack>
+struct HasOperationCounters<Stack, std::void_t<decltype(std::declval<Stack&>().resetOperationCounters())>>
+        : std::true_type {};
+
+// Счётчики исключённых и переданных внешнему стеку операций потокобезопасного фасада, см. ThreadSafeStack.
+template<typename Stack, typename = void>
+struct HasForwardingCounters : std::false_type {};
+
+template<typename Stack>
+struct HasForwardingCounters<Stack, std::void_t<decltype(std::declval<Stack&>().resetCounters())>>
+        : std::true_type {};
+
+/*
+ * Барьер задач. Узлы централизованного стека выделяются по запросам к HEAD_RANK (см. NodePool),
+ * поэтому пока барьер не завершён, стек обслуживает запросы роста пула узлов тех процессов,
+ * которые ещё выполняют операции.
+ */
+template<typename Stack>
+void stackBarrier(Stack &rStack, MPI_Comm comm)
+{
+    auto& rStackImpl = getStackImpl(rStack);
+    if constexpr (HasServiceGrowRequests<std::decay_t<decltype(rStackImpl)>>::value)
+    {
+        MPI_Request barrierRequest = MPI_REQUEST_NULL;
+        MPI_Ibarrier(comm, &barrierRequest);
+        for (int barrierCompleted{0}; !barrierCompleted;)
+        {
+            rStackImpl.serviceGrowRequests();
+            MPI_Test(&barrierRequest, &barrierCompleted, MPI_STATUS_IGNORE);
+        }
+    }
+    else
+    {
+        MPI_Barrier(comm);
+    }
+}
+
+// Параметры задачи, общие для всех её замеров, см. makeBenchmarkTaskContext.
+struct BenchmarkTaskContext
+{
+    MPI_Comm comm;
+    const BenchmarkOptions &rOptions;
+    int repetitionIdx{0};
+    int procNum{0};
+    int rank{-1};
+    // Кол-во операций процесса, см. getRankOpsNum.
+    int opsNum{0};
+    // Лог измерений.
+    std::shared_ptr<spdlog::logger> pLogger;
+};
+
+BenchmarkTaskContext makeBenchmarkTaskContext(MPI_Comm comm, const BenchmarkOptions &rOptions, int repetitionIdx,
+                                              std::shared_ptr<spdlog::sinks::sink> loggerSink);
+
+// Вид операции, которую выполнил шаг замера, см. measureStackOps.
+enum class MeasuredOp
+{
+    Push,
+    Pop,
+    // POP, который вернул значение по умолчанию, так как стек был пуст.
+    EmptyPop,
+    Query
+};
+
+// Один замер задачи.
+struct OpsPhase
+{
+    // Имя замера в логе и в записи результатов.
+    std::string_view name;
+    int opsNum{0};
+    // Кол-во потоков процесса, которые поровну делят его операции.
+    int threadsNum{1};
+};
+
+// Результаты замера текущего процесса.
+struct OpsMeasurement
+{
+    RankBenchmarkResult result;
+    // Наибольшее время замера среди процессов.
+    double maxElapsedSec{0};
+};
+
+// Замер без прогрева, см. measureStackOps.
+constexpr std::nullptr_t NoWarmUp = nullptr;
+
+namespace benchmark_measurement_detail
+{
+    // Измерения одного потока замера.
+    struct ThreadOps
+    {
+        LatencyHistogram pushHistogram;
+        LatencyHistogram popHistogram;
+        ThroughputSampler throughputSampler;
+        RankBenchmarkResult counts;
+    };
+
+    void logMeasurement(const BenchmarkTaskContext &rContext, const OpsPhase &rPhase,
+                        const RankBenchmarkResult &rResult, double maxElapsedSec, int warmUpNum);
+    /*
+     * Объединяет измерения всех процессов у процесса 0, который выводит их
+     * в лог и, если задан BenchmarkOptions::resultsPath, в файл результатов.
+     * Коллективная функция.
+     */
+    void reportMeasurement(const BenchmarkTaskContext &rContext, const OpsPhase &rPhase,
+                           const RankBenchmarkResult &rResult, ThreadOps &rOps, uint64_t warmUpSamplesNum,
+                           rma_stack::ref_counting::OperationCounters &rCounters, bool countersAvailable,
+                           rma_stack::ref_counting::PushPhaseTimes &rPushPhaseTimes,
+                           rma_stack::ref_counting::PopPhaseTimes &rPopPhaseTimes);
+}
+
+/*
+ * Общий замер задач. Процессы синхронизируются, затем выполняют warmUp(i)
+ * для ceil(rPhase.opsNum * warmUpRatio) шагов прогрева (если warmUp - не
+ * NoWarmUp) и снова синхронизируются. В измеряемом участке каждый процесс
+ * вызывает op(i) для i от 0 до rPhase.opsNum, op возвращает вид
+ * выполненной операции (MeasuredOp). После каждого шага выполняется
+ * эмуляция сторонней нагрузки BenchmarkOptions::workload, её время
+ * вычитается из результата. Если rPhase.threadsNum больше 1, то шаги
+ * делятся между потоками поровну, и op вызывается из них одновременно.
+ *
+ * Задержки шагов, отсчёты пропускной способности, счётчики операций стека
+ * и время этапов объединяются у процесса 0 и выводятся в лог и в файл
+ * результатов, см. writeBenchmarkRecord. Коллективная функция.
+ */
+template<typename Stack, typename WarmUp, typename Op>
+OpsMeasurement measureStackOps(Stack &rStack, const BenchmarkTaskContext &rContext, const OpsPhase &rPhase,
+                               WarmUp warmUp, Op op)
+{
+    using benchmark_measurement_detail::ThreadOps;
+
+    auto& rStackImpl = getStackImpl(rStack);
+    constexpr bool countersAvailable = HasOperationCounters<std::decay_t<decltype(rStackImpl)>>::value;
+    const auto &rOptions = rContext.rOptions;
+
+    const int threadsNum = std::max(rPhase.threadsNum, 1);
+    const int threadOpsNum = (rPhase.opsNum + threadsNum - 1) / threadsNum;
+
+    // Отсчёты синхронизированы между процессами с точностью до выхода из барьера.
+    ThroughputSampler throughputSampler(rOptions.throughputSampleInterval);
+    stackBarrier(rStack, rContext.comm);
+    throughputSampler.start();
+    std::vector<ThreadOps> threadOps(threadsNum, ThreadOps{{}, {}, throughputSampler, {}});
+    int warmUpNum{0};
+    if constexpr (!std::is_null_pointer_v<WarmUp>)
+    {
+        warmUpNum = static_cast<int>(std::ceil(rPhase.opsNum * rOptions.warmUpRatio));
+        for (int i = 0; i < warmUpNum; ++i)
+        {
+            warmUp(i);
+            throughputSampler.record(std::chrono::steady_clock::now());
+        }
+    }
+    stackBarrier(rStack, rContext.comm);
+    const auto warmUpSamplesNum = static_cast<uint64_t>(throughputSampler.getSamples().size());
+
+    if constexpr (countersAvailable)
+    {
+        rStackImpl.resetOperationCounters();
+        rStackImpl.resetPhaseTimes();
+        rStackImpl.setPhaseTimingEnabled(rOptions.phaseTiming);
+    }
+    if constexpr (HasForwardingCounters<std::decay_t<decltype(rStackImpl)>>::value)
+        rStackImpl.resetCounters();
+
+    const auto runOps = [&](int threadIdx) {
+        auto &rOps = threadOps[threadIdx];
+        const int endOpIdx = std::min(rPhase.opsNum, (threadIdx + 1) * threadOpsNum);
+        for (int i = threadIdx * threadOpsNum; i < endOpIdx; ++i)
+        {
+            const auto tOpBegin = std::chrono::steady_clock::now();
+            const MeasuredOp measuredOp = op(i);
+            const auto tOpEnd = std::chrono::steady_clock::now();
+            switch (measuredOp)
+            {
+                case MeasuredOp::Push:
+                    rOps.pushHistogram.record(tOpEnd - tOpBegin);
+                    ++rOps.counts.pushCount;
+                    break;
+                case MeasuredOp::EmptyPop:
+                    ++rOps.counts.emptyPopCount;
+                    [[fallthrough]];
+                case MeasuredOp::Pop:
+                    rOps.popHistogram.record(tOpEnd - tOpBegin);
+                    ++rOps.counts.popCount;
+                    break;
+                case MeasuredOp::Query:
+                    ++rOps.counts.queryCount;
+                    break;
+            }
+            rOps.throughputSampler.record(tOpEnd);
+            if (rOptions.workload.count() > 0)
+                std::this_thread::sleep_for(rOptions.workload);
+        }
+    };
+
+    const double tBeginSec = MPI_Wtime();
+    if (threadsNum == 1)
+    {
+        runOps(0);
+    }
+    else
+    {
+        std::vector<std::thread> threads;
+        threads.reserve(threadsNum);
+        for (int threadIdx = 0; threadIdx < threadsNum; ++threadIdx)
+            threads.emplace_back(runOps, threadIdx);
+        for (auto &thread: threads)
+            thread.join();
+    }
+    const double tEndSec = MPI_Wtime();
+
+    OpsMeasurement measurement;
+    rma_stack::ref_counting::OperationCounters counters;
+    rma_stack::ref_counting::PushPhaseTimes pushPhaseTimes;
+    rma_stack::ref_counting::PopPhaseTimes popPhaseTimes;
+    if constexpr (countersAvailable)
+    {
+        rStackImpl.setPhaseTimingEnabled(false);
+        counters = rStackImpl.getOperationCounters();
+        pushPhaseTimes = rStackImpl.getPushPhaseTimes();
+        popPhaseTimes = rStackImpl.getPopPhaseTimes();
+    }
+
+    // Потоки работают одновременно, поэтому вычитается нагрузка одного потока.
+    const double workloadSec = std::chrono::duration<double>(rOptions.workload).count();
+    auto &rOps = threadOps.front();
+    for (int threadIdx = 1; threadIdx < threadsNum; ++threadIdx)
+    {
+        const auto &rThreadOps = threadOps[threadIdx];
+        rOps.pushHistogram.merge(rThreadOps.pushHistogram);
+        rOps.popHistogram.merge(rThreadOps.popHistogram);
+        rOps.throughputSampler.merge(rThreadOps.throughputSampler);
+        rOps.counts.pushCount += rThreadOps.counts.pushCount;
+        rOps.counts.popCount += rThreadOps.counts.popCount;
+        rOps.counts.emptyPopCount += rThreadOps.counts.emptyPopCount;
+        rOps.counts.queryCount += rThreadOps.counts.queryCount;
+    }
+    rOps.throughputSampler.merge(throughputSampler);
+    measurement.result = rOps.counts;
+    measurement.result.elapsedSec = tEndSec - tBeginSec - threadOpsNum * workloadSec;
+
+    stackBarrier(rStack, rContext.comm);
+    MPI_Allreduce(&measurement.result.elapsedSec, &measurement.maxElapsedSec, 1, MPI_DOUBLE, MPI_MAX, rContext.comm);
+
+    benchmark_measurement_detail::logMeasurement(rContext, rPhase, measurement.result, measurement.maxElapsedSec,
+                                                 warmUpNum);
+    benchmark_measurement_detail::reportMeasurement(rContext, rPhase, measurement.result, rOps, warmUpSamplesNum,
+                                                    counters, countersAvailable, pushPhaseTimes, popPhaseTimes);
+    return measurement;
+}
+
+#endif //SOURCES_BENCHMARK_MEASUREMENT_H
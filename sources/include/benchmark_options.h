@@ -0,0 +1,131 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_BENCHMARK_OPTIONS_H
+#define SOURCES_BENCHMARK_OPTIONS_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "inner/NodeReclaimer.h"
+#include "inner/WinEpoch.h"
+#include "outer/FlatCombiner.h"
+#include "outer/PayloadPlacement.h"
+
+// Состав операций измеряемого участка теста.
+enum class OperationMix
+{
+    Random,
+    OnlyPush,
+    OnlyPop
+};
+
+std::string_view getOperationMixName(OperationMix mix);
+
+/*
+ * Задача, которую выполняет программа, см. stack_tasks.h. Operations -
+ * настраиваемый замер runStackBenchmarkTask, остальные задачи измеряют
+ * отдельные свойства стека. Все задачи выполняют замеры через
+ * measureStackOps, поэтому кол-во операций, прогрев, нагрузка, повторы и
+ * файл результатов задаются для них одинаково.
+ */
+enum class BenchmarkTask
+{
+    Operations,
+    PushFillLevel,
+    PopReclamation,
+    BulkBatchSize,
+    RelaxedLifo,
+    EpochMode,
+    RmaPipelining,
+    AsyncOverlap,
+    ThreadedRandomOperation,
+    Query,
+    PopWait,
+    VariablePayload,
+    PayloadPlacement,
+    CallbackOverhead
+};
+
+std::string_view getBenchmarkTaskName(BenchmarkTask task);
+
+/*
+ * Параметры настраиваемого теста производительности (см. runStackBenchmarkTasks).
+ * Значения по умолчанию совпадают с параметрами прежних отдельных программ
+ * для случайных операций.
+ */
+struct BenchmarkOptions
+{
+    // Имя варианта стека, см. registerStackBenchmark.
+    std::string stackName{"central"};
+    BenchmarkTask task{BenchmarkTask::Operations};
+    OperationMix operationMix{OperationMix::Random};
+    // Доля операций PUSH для OperationMix::Random.
+    double pushRatio{0.5};
+    /*
+     * Кол-во операций. Если weakScaling - false, то это кол-во операций
+     * всех процессов, которое делится между ними поровну, иначе - кол-во
+     * операций каждого процесса.
+     */
+    int opsNum{15'000};
+    bool weakScaling{false};
+    /*
+     * Доля операций процесса, которые выполняются для прогрева перед первым
+     * замером задачи. В задачах со случайными операциями прогрев заполняет
+     * стек операциями PUSH, в остальных - выполняет пары PUSH и POP, которые
+     * не меняют кол-во значений в стеке.
+     */
+    double warmUpRatio{0.1};
+    // Эмуляция сторонней нагрузки на приложение после каждой операции.
+    std::chrono::nanoseconds workload{std::chrono::microseconds(1)};
+    // Предел кол-ва элементов всего стека.
+    int elemsUpLimit{30'000};
+    std::chrono::nanoseconds backoffMinDelay{std::chrono::nanoseconds(1)};
+    std::chrono::nanoseconds backoffMaxDelay{std::chrono::nanoseconds(100)};
+    int repetitionsNum{1};
+    // Длина интервала, за который считается кол-во завершённых операций, см. ThroughputSampler.
+    std::chrono::nanoseconds throughputSampleInterval{std::chrono::milliseconds(10)};
+    // Кол-во ячеек массива исключения у каждого процесса, 0 - массив выключен, см. EliminationArray.
+    size_t eliminationSlotsPerRank{0};
+    rma_stack::FlatCombiningMode flatCombiningMode{rma_stack::FlatCombiningMode::Disabled};
+    rma_stack::ref_counting::ReclamationScheme reclamationScheme{rma_stack::ref_counting::ReclamationScheme::RefCounting};
+    rma_stack::ref_counting::EpochMode epochMode{rma_stack::ref_counting::EpochMode::Persistent};
+    // Конвейеризация операций RMA, см. InnerStack::isRequestPipeliningEnabled.
+    bool requestPipelining{true};
+    // Размер шарда ослабленного стека, 0 - строгий стек.
+    size_t shardSize{0};
+    // Только для централизованного стека.
+    rma_stack::PayloadPlacement payloadPlacement{rma_stack::PayloadPlacement::HeadRank};
+    // Размер данных задачи BenchmarkTask::PayloadPlacement, см. PayloadSizes.
+    size_t payloadSize{64};
+    // Размер пакета задачи BenchmarkTask::BulkBatchSize, 0 - одиночные операции.
+    size_t bulkSize{0};
+    // Ожидание значения через popWait вместо повторения POP в задаче BenchmarkTask::PopWait.
+    bool popWait{false};
+    // Кол-во потоков процесса в задаче BenchmarkTask::ThreadedRandomOperation.
+    int threadsNum{1};
+    // Замер времени этапов PUSH и POP, см. InnerStack::setPhaseTimingEnabled. Счётчики операций ведутся всегда.
+    bool phaseTiming{false};
+    /*
+     * Файл, в который процесс 0 дописывает результаты каждого замера, см.
+     * writeBenchmarkRecord. Если файл задан, то логи создаёт только процесс 0.
+     */
+    std::string resultsPath;
+};
+
+// Размеры данных, для которых собрана задача BenchmarkTask::PayloadPlacement.
+constexpr size_t PayloadSizes[] = {64, 1024, 16 * 1024};
+
+/*
+ * Разбор параметров вида --name=value. Неизвестный параметр или неверное
+ * значение - std::invalid_argument.
+ */
+BenchmarkOptions parseBenchmarkOptions(int argc, char *argv[]);
+std::string getBenchmarkOptionsUsage();
+// Кол-во операций одного процесса.
+int getRankOpsNum(const BenchmarkOptions &rOptions, int procNum);
+
+#endif //SOURCES_BENCHMARK_OPTIONS_H
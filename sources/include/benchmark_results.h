@@ -0,0 +1,52 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_BENCHMARK_RESULTS_H
+#define SOURCES_BENCHMARK_RESULTS_H
+
+#include <cstdint>
+#include <string_view>
+#include <mpi.h>
+
+#include "benchmark_options.h"
+#include "latency_histogram.h"
+#include "inner/OperationCounters.h"
+
+// Результаты одного процесса за один замер measureStackOps.
+struct RankBenchmarkResult
+{
+    double elapsedSec{0};
+    uint64_t pushCount{0};
+    uint64_t popCount{0};
+    // Операции POP, которые вернули значение по умолчанию, так как стек был пуст.
+    uint64_t emptyPopCount{0};
+    // Запросы, которые не меняют стек: top, size, isEmpty.
+    uint64_t queryCount{0};
+};
+
+// Гистограммы, отсчёты, счётчики и время этапов операций замера, объединённые у процесса 0.
+struct BenchmarkMeasurements
+{
+    const LatencyHistogram &rPushHistogram;
+    const LatencyHistogram &rPopHistogram;
+    const ThroughputSampler &rThroughputSampler;
+    uint64_t warmUpSamplesNum{0};
+    const rma_stack::ref_counting::OperationCounters &rCounters;
+    // Время этапов выводится, только если замер был включён, см. BenchmarkOptions::phaseTiming.
+    const rma_stack::ref_counting::PushPhaseTimes &rPushPhaseTimes;
+    const rma_stack::ref_counting::PopPhaseTimes &rPopPhaseTimes;
+};
+
+/*
+ * Собирает результаты всех процессов у процесса 0, который дописывает в
+ * файл rOptions.resultsPath одну строку JSON (формат JSON Lines): задачу и
+ * имя замера phaseName, параметры теста, окружение, результаты каждого процесса, сводные показатели,
+ * гистограммы задержек, отсчёты пропускной способности, счётчики операций
+ * стека и время этапов операций. Коллективная функция, файл открывается
+ * только процессом 0.
+ */
+void writeBenchmarkRecord(MPI_Comm comm, const BenchmarkOptions &rOptions, int repetitionIdx, std::string_view phaseName,
+                          const RankBenchmarkResult &rRankResult, const BenchmarkMeasurements &rMeasurements);
+
+#endif //SOURCES_BENCHMARK_RESULTS_H
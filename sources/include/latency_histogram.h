@@ -0,0 +1,87 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_LATENCY_HISTOGRAM_H
+#define SOURCES_LATENCY_HISTOGRAM_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <mpi.h>
+
+/*
+ * Гистограмма задержек с логарифмическими корзинами (по образцу HDR
+ * Histogram). Значения меньше SubBucketsNum нс хранятся точно, а каждый
+ * следующий диапазон [2^k, 2^(k+1)) делится на SubBucketsNum / 2 равных
+ * корзин, поэтому относительная погрешность не больше 2 / SubBucketsNum
+ * при постоянном объёме памяти на весь диапазон uint64_t.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr size_t SubBucketBitsNum = 6;
+    static constexpr size_t SubBucketsNum = size_t{1} << SubBucketBitsNum;
+
+    LatencyHistogram();
+
+    void record(std::chrono::nanoseconds latency);
+    void reset();
+    // Добавляет значения другой гистограммы текущего процесса, например гистограммы другого потока.
+    void merge(const LatencyHistogram &rOther);
+    /*
+     * Объединяет гистограммы всех процессов comm в гистограмме процесса
+     * root. Коллективная функция, гистограммы остальных процессов не меняются.
+     */
+    void reduce(MPI_Comm comm, int root);
+
+    /*
+     * Наименьшее значение, не меньше которого percentile процентов
+     * записанных значений, с точностью до корзины. 0, если значений нет.
+     */
+    [[nodiscard]] uint64_t getValueAtPercentile(double percentile) const;
+    [[nodiscard]] uint64_t getMaxValue() const;
+    [[nodiscard]] uint64_t getCount() const;
+    // Пары (наибольшее значение корзины, кол-во значений) непустых корзин по возрастанию значений.
+    [[nodiscard]] std::vector<std::pair<uint64_t, uint64_t>> getNonEmptyBuckets() const;
+
+private:
+    [[nodiscard]] static size_t getBucketIdx(uint64_t value);
+    // Наибольшее значение, которое попадает в корзину.
+    [[nodiscard]] static uint64_t getBucketUpperValue(size_t bucketIdx);
+
+private:
+    std::vector<uint64_t> m_counts;
+    uint64_t m_count{0};
+    uint64_t m_maxValue{0};
+};
+
+/*
+ * Кол-во операций, завершённых в каждом интервале длины interval от
+ * момента start, чтобы по ходу теста отличить прогрев от установившегося
+ * режима.
+ */
+class ThroughputSampler
+{
+public:
+    explicit ThroughputSampler(std::chrono::nanoseconds t_interval);
+
+    void start();
+    void record(std::chrono::steady_clock::time_point completionTime);
+    // Складывает отсчёты другого объекта текущего процесса с тем же началом и интервалом.
+    void merge(const ThroughputSampler &rOther);
+    // Складывает отсчёты всех процессов comm по интервалам в отсчётах процесса root. Коллективная функция.
+    void reduce(MPI_Comm comm, int root);
+
+    [[nodiscard]] std::chrono::nanoseconds getInterval() const;
+    [[nodiscard]] const std::vector<uint64_t>& getSamples() const;
+
+private:
+    std::chrono::nanoseconds m_interval;
+    std::chrono::steady_clock::time_point m_startTime;
+    std::vector<uint64_t> m_samples;
+};
+
+#endif //SOURCES_LATENCY_HISTOGRAM_H
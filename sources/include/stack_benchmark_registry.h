@@ -0,0 +1,47 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_STACK_BENCHMARK_REGISTRY_H
+#define SOURCES_STACK_BENCHMARK_REGISTRY_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mpi.h>
+#include <spdlog/spdlog.h>
+
+#include "benchmark_options.h"
+
+/*
+ * Запуск теста для одного варианта стека: создаёт стек, выполняет задачу
+ * rOptions.task (см. runStackBenchmarkTasks) и освобождает стек. loggerSink -
+ * лог отладки стека, benchmarkSink - лог измерений. Коллективная функция.
+ */
+using StackBenchmarkRunner = std::function<void(MPI_Comm comm, MPI_Info info, const BenchmarkOptions &rOptions,
+                                                std::shared_ptr<spdlog::sinks::sink> loggerSink,
+                                                std::shared_ptr<spdlog::sinks::sink> benchmarkSink)>;
+
+// Повторная регистрация имени - std::invalid_argument.
+void registerStackBenchmark(std::string name, StackBenchmarkRunner runner);
+// nullptr, если вариант с таким именем не зарегистрирован.
+[[nodiscard]] const StackBenchmarkRunner* findStackBenchmark(std::string_view name);
+[[nodiscard]] std::vector<std::string> getStackBenchmarkNames();
+
+/*
+ * Регистрация варианта стека при инициализации программы. Новый вариант
+ * добавляется файлом в apps/stack_benchmark с глобальным объектом:
+ *
+ * const StackBenchmarkRegistrar registrar("name", [](...) { ... });
+ */
+struct StackBenchmarkRegistrar
+{
+    StackBenchmarkRegistrar(std::string name, StackBenchmarkRunner runner)
+    {
+        registerStackBenchmark(std::move(name), std::move(runner));
+    }
+};
+
+#endif //SOURCES_STACK_BENCHMARK_REGISTRY_H
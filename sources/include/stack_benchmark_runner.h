@@ -0,0 +1,151 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_STACK_BENCHMARK_RUNNER_H
+#define SOURCES_STACK_BENCHMARK_RUNNER_H
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <mpi.h>
+#include <spdlog/spdlog.h>
+
+#include "benchmark_options.h"
+#include "stack_tasks.h"
+#include "inner/PayloadArena.h"
+#include "outer/PayloadStack.h"
+#include "outer/ThreadSafeStack.h"
+
+// Тип данных стека, который должна создать фабрика вариантов стека, см. runStackBenchmarkTasks.
+template<typename T>
+struct StackValueType
+{
+    using type = T;
+};
+
+/*
+ * Создаёт стек с данными типа T, выполняет с ним task(stack, repetitionIdx) rOptions.repetitionsNum
+ * раз и освобождает стек. Коллективная функция.
+ */
+template<typename T, typename CreateStack, typename Task>
+void runWithStack(MPI_Comm comm, const BenchmarkOptions &rOptions, const CreateStack &createStack, Task task)
+{
+    auto stack = createStack(StackValueType<T>{});
+    for (int repetitionIdx = 0; repetitionIdx < rOptions.repetitionsNum; ++repetitionIdx)
+        task(stack, repetitionIdx);
+
+    MPI_Barrier(comm);
+    stack.release();
+}
+
+/*
+ * Выполнение задачи rOptions.task (см. BenchmarkTask) для варианта стека. createStack(StackValueType<T>{})
+ * создаёт стек варианта с данными типа T по параметрам rOptions, тип данных выбирается по задаче.
+ * Каждая задача получает rOptions и номер повтора, см. runWithStack. BenchmarkTask::PayloadPlacement
+ * зависит от варианта стека, поэтому выполняется самим вариантом, а BenchmarkTask::CallbackOverhead
+ * выполняется только вариантом внутреннего стека, здесь - std::invalid_argument. Коллективная функция.
+ */
+template<typename CreateStack>
+void runStackBenchmarkTasks(MPI_Comm comm, MPI_Info info, const BenchmarkOptions &rOptions,
+                            const CreateStack &createStack,
+                            const std::shared_ptr<spdlog::sinks::sink> &loggerSink,
+                            const std::shared_ptr<spdlog::sinks::sink> &benchmarkSink)
+{
+    switch (rOptions.task)
+    {
+        case BenchmarkTask::Operations:
+            runWithStack<int>(comm, rOptions, createStack, [&](auto &rStack, int repetitionIdx) {
+                runStackBenchmarkTask(rStack, comm, rOptions, repetitionIdx, benchmarkSink);
+            });
+            break;
+        case BenchmarkTask::PushFillLevel:
+            runWithStack<int>(comm, rOptions, createStack, [&](auto &rStack, int repetitionIdx) {
+                runStackPushLatencyByFillLevelBenchmarkTask(rStack, comm, rOptions, repetitionIdx, benchmarkSink);
+            });
+            break;
+        case BenchmarkTask::PopReclamation:
+            runWithStack<int>(comm, rOptions, createStack, [&](auto &rStack, int repetitionIdx) {
+                runStackPopReclamationBenchmarkTask(rStack, comm, rOptions, repetitionIdx, benchmarkSink);
+            });
+            break;
+        case BenchmarkTask::BulkBatchSize:
+            runWithStack<int>(comm, rOptions, createStack, [&](auto &rStack, int repetitionIdx) {
+                runStackBulkBatchSizeBenchmarkTask(rStack, comm, rOptions, repetitionIdx, benchmarkSink);
+            });
+            break;
+        case BenchmarkTask::RelaxedLifo:
+            runWithStack<int>(comm, rOptions, createStack, [&](auto &rStack, int repetitionIdx) {
+                runStackRelaxedLifoBenchmarkTask(rStack, comm, rOptions, repetitionIdx, benchmarkSink);
+            });
+            break;
+        case BenchmarkTask::EpochMode:
+            runWithStack<int>(comm, rOptions, createStack, [&](auto &rStack, int repetitionIdx) {
+                runStackEpochModeBenchmarkTask(rStack, comm, rOptions, repetitionIdx, benchmarkSink);
+            });
+            break;
+        case BenchmarkTask::RmaPipelining:
+        {
+            // Задача сравнивает время этапов операций, поэтому замер этапов включается всегда.
+            auto pipeliningOptions = rOptions;
+            pipeliningOptions.phaseTiming = true;
+            runWithStack<OutOfNodePayload>(comm, rOptions, createStack, [&](auto &rStack, int repetitionIdx) {
+                runStackRmaPipeliningBenchmarkTask(rStack, comm, pipeliningOptions, repetitionIdx, benchmarkSink);
+            });
+            break;
+        }
+        case BenchmarkTask::AsyncOverlap:
+            runWithStack<int>(comm, rOptions, createStack, [&](auto &rStack, int repetitionIdx) {
+                runStackAsyncOverlapBenchmarkTask(rStack, comm, rOptions, repetitionIdx, benchmarkSink);
+            });
+            break;
+        case BenchmarkTask::ThreadedRandomOperation:
+            runWithStack<int>(comm, rOptions, createStack, [&](auto &rStack, int repetitionIdx) {
+                rma_stack::ThreadSafeStack<std::decay_t<decltype(rStack)>> threadSafeStack(rStack, loggerSink);
+                runStackThreadedRandomOperationBenchmarkTask(threadSafeStack, comm, rOptions, repetitionIdx,
+                                                             benchmarkSink);
+            });
+            break;
+        case BenchmarkTask::Query:
+        {
+            // Запросы измеряются подряд, без эмуляции нагрузки приложения.
+            auto queryOptions = rOptions;
+            queryOptions.workload = std::chrono::nanoseconds(0);
+            runWithStack<int>(comm, rOptions, createStack, [&](auto &rStack, int repetitionIdx) {
+                runStackQueryBenchmarkTask(rStack, comm, queryOptions, repetitionIdx, benchmarkSink);
+            });
+            break;
+        }
+        case BenchmarkTask::PopWait:
+            runWithStack<int>(comm, rOptions, createStack, [&](auto &rStack, int repetitionIdx) {
+                runStackPopWaitBenchmarkTask(rStack, comm, rOptions, repetitionIdx, benchmarkSink);
+            });
+            break;
+        case BenchmarkTask::VariablePayload:
+            // Узлы стека хранят ссылки на данные, а сами данные находятся в арене процесса, который их положил.
+            runWithStack<rma_stack::ref_counting::PayloadRef>(comm, rOptions, createStack,
+                                                              [&](auto &rStack, int repetitionIdx) {
+                rma_stack::PayloadStack<std::vector<std::byte>, std::decay_t<decltype(rStack)>> payloadStack(
+                        comm,
+                        info,
+                        rStack,
+                        loggerSink
+                );
+                runStackVariablePayloadBenchmarkTask(payloadStack, comm, rOptions, repetitionIdx, benchmarkSink);
+
+                MPI_Barrier(comm);
+                payloadStack.release();
+            });
+            break;
+        case BenchmarkTask::PayloadPlacement:
+        case BenchmarkTask::CallbackOverhead:
+            throw std::invalid_argument("the task '" + std::string(getBenchmarkTaskName(rOptions.task))
+                                        + "' is not supported by the stack variant " + rOptions.stackName);
+    }
+}
+
+#endif //SOURCES_STACK_BENCHMARK_RUNNER_H
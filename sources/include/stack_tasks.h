@@ -8,13 +8,51 @@
 #include <spdlog/spdlog.h>
 #include <ctime>
 #include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <cmath>
+#include <cstddef>
+#include <sstream>
 
 #include "IStack.h"
+#include "benchmark_options.h"
+#include "benchmark_measurement.h"
 #include "inner/InnerStack.h"
+#include "outer/AsyncOperationEngine.h"
+#include "outer/PayloadStack.h"
+#include "outer/ThreadSafeStack.h"
 #include "logging.h"
 using namespace std::literals::chrono_literals;
 
 void runInnerStackSimplePushPopTask(rma_stack::ref_counting::InnerStack &stack, MPI_Comm comm);
+/*
+ * Задача для оценки накладных расходов на вызов колбэков внутреннего стека. Одни и те же
+ * лямбда-функции передаются стеку напрямую и обёрнутыми в std::function, как до перехода
+ * на колбэки-параметры шаблона. Для каждого способа измеряются задержка и процессорное
+ * время на операцию. Определена в stack_benchmark_tasks.cpp, который собирается только
+ * в stack_benchmark_app.
+ */
+void runInnerStackCallbackOverheadBenchmarkTask(rma_stack::ref_counting::InnerStack &stack, MPI_Comm comm,
+                                                const BenchmarkOptions &rOptions, int repetitionIdx,
+                                                std::shared_ptr<spdlog::sinks::sink> loggerSink);
+
+/*
+ * Прогрев парами PUSH и POP (см. measureStackOps) для задач, в которых важно заполнение стека:
+ * пара не меняет кол-во значений в стеке.
+ */
+template<typename Stack, typename T>
+auto makePushPopWarmUp(Stack &rStack, T value, T defaultValue)
+{
+    return [&rStack, value = std::move(value), defaultValue = std::move(defaultValue)](int) {
+        auto poppedValue = defaultValue;
+        rStack.push(value);
+        rStack.pop(poppedValue, defaultValue);
+    };
+}
 
 template<typename StackImpl>
 using EnableIfValueTypeIsInt = std::enable_if_t<std::is_same_v<typename StackImpl::ValueType, int>>;
@@ -57,172 +95,1143 @@ void runStackSimpleIntPushPopTask(stack_interface::IStack<StackImpl> &stack, MPI
 }
 
 /*
- * Задача для измерения продолжительности случайных равновероятных операций PUSH и POP внешнего стека,
- * предназначена только для данных типа 'int'. workload - эмуляция сторонней нагрузки на приложение.
+ * Проверка централизованного стека, в котором узлы выделяют только процессы, отличные от
+ * HEAD_RANK, предназначена только для данных типа 'int'. Каждый такой процесс выполняет
+ * pushesNum операций PUSH, а HEAD_RANK в это время обслуживает их запросы роста пула узлов
+ * (см. NodePool). Затем все процессы снимают значения, пока стек не опустеет. Возвращает
+ * true у всех процессов, если сняты все добавленные значения.
  */
 template<typename StackImpl,
         typename = EnableIfValueTypeIsInt<StackImpl>>
-void runStackRandomOperationBenchmarkTask(stack_interface::IStack<StackImpl> &stack, MPI_Comm comm,
-                                          std::shared_ptr<spdlog::sinks::sink> loggerSink)
+bool runStackNonHeadPushTask(stack_interface::IStack<StackImpl> &stack, MPI_Comm comm, int pushesNum)
 {
-    SPDLOG_INFO("started 'runStackRandomOperationBenchmarkTask'");
+    SPDLOG_INFO("started 'runStackNonHeadPushTask'");
 
-    auto pLogger = std::make_shared<spdlog::logger>(producerConsumerBenchmarkLoggerName.data(), loggerSink);
-    pLogger->set_level(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
-    pLogger->flush_on(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
-
-    const auto workload{1us};
-    const auto totalOpsNum{15'000};
+    int rank{-1};
+    MPI_Comm_rank(comm, &rank);
 
-    auto procNum{0};
+    int procNum{0};
     MPI_Comm_size(comm, &procNum);
-    const int opsNum = std::ceil(((double)totalOpsNum) / procNum);
 
-    int rank{-1};
-    MPI_Comm_rank(comm, &rank);
+    if (rank != rma_stack::ref_counting::InnerStack::HEAD_RANK)
+    {
+        for (int i = 0; i < pushesNum; ++i)
+            stack.push(i);
+    }
 
-    const auto warmUp = std::ceil(opsNum * 0.1);
+    // Барьер завершается, когда все процессы закончили PUSH, а до тех пор HEAD_RANK растит пул.
+    stackBarrier(stack, comm);
 
-    for (int i = 0; i < warmUp; ++i)
+    // Значения неотрицательны, поэтому -1 обозначает пустой стек.
+    const int defaultElem{-1};
+    uint64_t counts[] = {0, 0}; // Кол-во снятых значений и их сумма.
+    for (;;)
     {
-        stack.push(1);
+        int elem{defaultElem};
+        stack.pop(elem, defaultElem);
+        if (elem == defaultElem)
+            break;
+        ++counts[0];
+        counts[1] += static_cast<uint64_t>(elem);
     }
-    MPI_Barrier(comm);
+    MPI_Allreduce(MPI_IN_PLACE, counts, 2, MPI_UINT64_T, MPI_SUM, comm);
+
+    const auto pushersNum = static_cast<uint64_t>(procNum - 1);
+    const auto expectedPopsNum = pushersNum * static_cast<uint64_t>(pushesNum);
+    const auto expectedSum = pushersNum * static_cast<uint64_t>(pushesNum) * static_cast<uint64_t>(pushesNum - 1) / 2;
+    const bool passed = counts[0] == expectedPopsNum && counts[1] == expectedSum;
+    if (!passed)
+        SPDLOG_ERROR("popped {} values with sum {}, expected {} values with sum {}",
+                     counts[0], counts[1], expectedPopsNum, expectedSum);
+
+    SPDLOG_INFO("finished 'runStackNonHeadPushTask'");
+    return passed;
+}
+
+/*
+ * Настраиваемая задача для измерения продолжительности операций PUSH и POP внешнего стека,
+ * предназначена только для данных типа 'int'. Состав операций, их кол-во, заполнение стека перед
+ * замером и эмуляция сторонней нагрузки задаются rOptions, см. BenchmarkOptions. После замера
+ * стек опустошается, чтобы следующий повтор repetitionIdx начинался с того же состояния.
+ * Задержки, пропускная способность и счётчики операций выводятся measureStackOps.
+ */
+template<typename StackImpl,
+        typename = EnableIfValueTypeIsInt<StackImpl>>
+void runStackBenchmarkTask(stack_interface::IStack<StackImpl> &stack, MPI_Comm comm, const BenchmarkOptions &rOptions,
+                           int repetitionIdx, std::shared_ptr<spdlog::sinks::sink> loggerSink)
+{
+    SPDLOG_INFO("started 'runStackBenchmarkTask'");
+
+    const auto context = makeBenchmarkTaskContext(comm, rOptions, repetitionIdx, std::move(loggerSink));
+
     std::random_device rd;
     std::mt19937 mt(rd());
-    std::uniform_int_distribution<int> dist(0, 50);
+    std::uniform_real_distribution<double> operationDist(0, 1);
+    std::uniform_int_distribution<int> valueDist(0, 50);
 
-    size_t pushCnt{0};
-    size_t popCnt{0};
+    const int defaultValue = -1;
+    measureStackOps(
+            stack,
+            context,
+            OpsPhase{getOperationMixName(rOptions.operationMix), context.opsNum},
+            [&stack](int) {
+                stack.push(1);
+            },
+            [&](int i) {
+                const bool push = rOptions.operationMix == OperationMix::OnlyPush
+                        || (rOptions.operationMix == OperationMix::Random && operationDist(mt) < rOptions.pushRatio);
+                if (push)
+                {
+                    stack.push(rOptions.operationMix == OperationMix::OnlyPush ? i : valueDist(mt));
+                    return MeasuredOp::Push;
+                }
+                int e{defaultValue};
+                stack.pop(e, defaultValue);
+                return e == defaultValue ? MeasuredOp::EmptyPop : MeasuredOp::Pop;
+            }
+    );
+    SPDLOG_LOGGER_INFO(context.pLogger, "mix {}, push ratio {}", getOperationMixName(rOptions.operationMix),
+                       rOptions.pushRatio);
 
-    const double tBeginSec = MPI_Wtime();
-    for (int i = 0; i < opsNum; ++i)
     {
-        int e = dist(mt);
-        if (e > 25)
+        int e{-1};
+        stackBarrier(stack, comm);
+        do
+        {
+            stack.pop(e, defaultValue);
+        }
+        while (e != defaultValue);
+        stackBarrier(stack, comm);
+    }
+
+    SPDLOG_INFO("finished 'runStackBenchmarkTask'");
+}
+
+/*
+ * Многопоточный вариант runStackBenchmarkTask со случайными операциями: операции каждого процесса
+ * выполняют rOptions.threadsNum потоков через потокобезопасный фасад, общее кол-во операций то же.
+ * Дополнительно логируется, сколько операций исключено внутри процесса и сколько передано
+ * внешнему стеку.
+ */
+template<typename StackImpl,
+        typename = EnableIfValueTypeIsInt<StackImpl>>
+void runStackThreadedRandomOperationBenchmarkTask(rma_stack::ThreadSafeStack<StackImpl> &stack, MPI_Comm comm,
+                                                  const BenchmarkOptions &rOptions, int repetitionIdx,
+                                                  std::shared_ptr<spdlog::sinks::sink> loggerSink)
+{
+    SPDLOG_INFO("started 'runStackThreadedRandomOperationBenchmarkTask'");
+
+    const auto context = makeBenchmarkTaskContext(comm, rOptions, repetitionIdx, std::move(loggerSink));
+
+    measureStackOps(
+            stack,
+            context,
+            OpsPhase{getOperationMixName(OperationMix::Random), context.opsNum, rOptions.threadsNum},
+            [&stack](int) {
+                stack.push(1);
+            },
+            [&](int) {
+                // Операции выполняются из нескольких потоков, поэтому у каждого потока свой генератор.
+                thread_local std::mt19937 mt(std::random_device{}());
+                std::uniform_real_distribution<double> operationDist(0, 1);
+                std::uniform_int_distribution<int> valueDist(0, 50);
+                if (operationDist(mt) < rOptions.pushRatio)
+                {
+                    stack.push(valueDist(mt));
+                    return MeasuredOp::Push;
+                }
+                int e{-1};
+                int defaultValue = -1;
+                stack.pop(e, defaultValue);
+                return e == defaultValue ? MeasuredOp::EmptyPop : MeasuredOp::Pop;
+            }
+    );
+    SPDLOG_LOGGER_INFO(context.pLogger, "eliminated ops {}, forwarded ops {}, combining rounds {}",
+                       stack.getEliminatedOpsNum(), stack.getForwardedOpsNum(), stack.getCombiningRoundsNum());
+
+    SPDLOG_INFO("finished 'runStackThreadedRandomOperationBenchmarkTask'");
+}
+
+/*
+ * Задача для измерения задержки операции PUSH внешнего стека в зависимости от заполненности
+ * пула узлов, предназначена только для данных типа 'int'. Пул заполняется ступенями, на каждой
+ * из которых операции PUSH измеряются отдельным замером. Пул заполняется полностью, когда каждый
+ * процесс положит свою долю rOptions.elemsUpLimit, поэтому кол-во операций задачи не зависит от
+ * rOptions.opsNum. После замеров стек опустошается.
+ */
+template<typename StackImpl,
+        typename = EnableIfValueTypeIsInt<StackImpl>>
+void runStackPushLatencyByFillLevelBenchmarkTask(stack_interface::IStack<StackImpl> &stack, MPI_Comm comm,
+                                                 const BenchmarkOptions &rOptions, int repetitionIdx,
+                                                 std::shared_ptr<spdlog::sinks::sink> loggerSink)
+{
+    SPDLOG_INFO("started 'runStackPushLatencyByFillLevelBenchmarkTask'");
+
+    const auto context = makeBenchmarkTaskContext(comm, rOptions, repetitionIdx, std::move(loggerSink));
+
+    const int fillStepsNum{10};
+    const int pushesToFillPool = rOptions.elemsUpLimit / context.procNum;
+    const int opsNum = pushesToFillPool / fillStepsNum;
+
+    const int defaultValue = -1;
+    for (int step = 0; step < fillStepsNum; ++step)
+    {
+        const int fillLevelPercent = step * 100 / fillStepsNum;
+        const auto phaseName = "fill level " + std::to_string(fillLevelPercent) + "%";
+        const auto pushOp = [&stack](int i) {
+            stack.push(i);
+            return MeasuredOp::Push;
+        };
+        const auto measurement = step == 0
+                ? measureStackOps(stack, context, OpsPhase{phaseName, opsNum},
+                                  makePushPopWarmUp(stack, 1, defaultValue), pushOp)
+                : measureStackOps(stack, context, OpsPhase{phaseName, opsNum}, NoWarmUp, pushOp);
+
+        const double tLatencyUs = measurement.result.elapsedSec / std::max(opsNum, 1) * 1'000'000.0;
+        const double tMaxLatencyUs = measurement.maxElapsedSec / std::max(opsNum, 1) * 1'000'000.0;
+        SPDLOG_LOGGER_INFO(context.pLogger, "procs {}, rank {}, fill level (%) {}, push latency (us) {}, max (us) {}",
+                           context.procNum, context.rank, fillLevelPercent, tLatencyUs, tMaxLatencyUs);
+    }
+    SPDLOG_LOGGER_INFO(context.pLogger, "pushes to fill pool {}, ops per step {}", pushesToFillPool, opsNum);
+
+    // Заполненный пул не переходит в следующий повтор.
+    {
+        int e{-1};
+        stackBarrier(stack, comm);
+        do
         {
-            stack.push(e);
-            ++pushCnt;
+            stack.pop(e, defaultValue);
         }
+        while (e != defaultValue);
+        stackBarrier(stack, comm);
+    }
+
+    SPDLOG_INFO("finished 'runStackPushLatencyByFillLevelBenchmarkTask'");
+}
+
+/*
+ * Задача для сравнения схем освобождения памяти узлов по пропускной способности операции POP
+ * и объёму памяти, который занят отложенными узлами, предназначена только для данных типа 'int'.
+ * Стек несколько раз заполняется и опустошается, после каждого раунда процессы проходят
+ * коллективную точку освобождения памяти.
+ */
+template<typename StackImpl,
+        typename = EnableIfValueTypeIsInt<StackImpl>>
+void runStackPopReclamationBenchmarkTask(stack_interface::IStack<StackImpl> &stack, MPI_Comm comm,
+                                         const BenchmarkOptions &rOptions, int repetitionIdx,
+                                         std::shared_ptr<spdlog::sinks::sink> loggerSink)
+{
+    SPDLOG_INFO("started 'runStackPopReclamationBenchmarkTask'");
+
+    const auto context = makeBenchmarkTaskContext(comm, rOptions, repetitionIdx, std::move(loggerSink));
+    const auto reclamationSchemeName = rma_stack::ref_counting::getReclamationSchemeName(rOptions.reclamationScheme);
+
+    auto& rStackImpl = static_cast<StackImpl&>(stack);
+
+    const auto roundsNum{3};
+    const int opsNum = context.opsNum;
+
+    const int defaultValue = -1;
+    const auto pushOp = [&stack](int i) {
+        stack.push(i);
+        return MeasuredOp::Push;
+    };
+    for (int round = 0; round < roundsNum; ++round)
+    {
+        const auto pushPhaseName = "push round " + std::to_string(round);
+        if (round == 0)
+            measureStackOps(stack, context, OpsPhase{pushPhaseName, opsNum},
+                            makePushPopWarmUp(stack, 1, defaultValue), pushOp);
         else
+            measureStackOps(stack, context, OpsPhase{pushPhaseName, opsNum}, NoWarmUp, pushOp);
+
+        size_t peakOverheadBytes{0};
+        const auto measurement = measureStackOps(
+                stack,
+                context,
+                OpsPhase{"pop round " + std::to_string(round), opsNum},
+                NoWarmUp,
+                [&](int) {
+                    int e{defaultValue};
+                    stack.pop(e, defaultValue);
+                    peakOverheadBytes = std::max(peakOverheadBytes, rStackImpl.getReclamationMemoryOverhead());
+                    return e == defaultValue ? MeasuredOp::EmptyPop : MeasuredOp::Pop;
+                }
+        );
+        const double throughput = opsNum / std::max(measurement.result.elapsedSec, 1e-9);
+
+        rStackImpl.reclaimRetiredNodes();
+        const auto overheadAfterReclaimBytes = rStackImpl.getReclamationMemoryOverhead();
+
+        SPDLOG_LOGGER_INFO(context.pLogger, "procs {}, rank {}, scheme {}, round {}, pop throughput (ops/sec) {}, "
+                                            "elapsed (sec) {}, total (sec) {}",
+                           context.procNum, context.rank, reclamationSchemeName, round, throughput,
+                           measurement.result.elapsedSec, measurement.maxElapsedSec);
+        SPDLOG_LOGGER_INFO(context.pLogger, "peak overhead (bytes) {}, overhead after reclaim (bytes) {}",
+                           peakOverheadBytes, overheadAfterReclaimBytes);
+    }
+
+    SPDLOG_INFO("finished 'runStackPopReclamationBenchmarkTask'");
+}
+
+/*
+ * Задача для измерения пропускной способности пакетных операций PUSH и POP внешнего стека
+ * с размером пакета rOptions.bulkSize, предназначена только для данных типа 'int'. Размер пакета 0
+ * обозначает одиночные операции push/pop для сравнения. Кол-во значений на процесс не зависит
+ * от размера пакета, задержка в замере - задержка одного пакета.
+ */
+template<typename StackImpl,
+        typename = EnableIfValueTypeIsInt<StackImpl>>
+void runStackBulkBatchSizeBenchmarkTask(stack_interface::IStack<StackImpl> &stack, MPI_Comm comm,
+                                        const BenchmarkOptions &rOptions, int repetitionIdx,
+                                        std::shared_ptr<spdlog::sinks::sink> loggerSink)
+{
+    SPDLOG_INFO("started 'runStackBulkBatchSizeBenchmarkTask'");
+
+    const auto context = makeBenchmarkTaskContext(comm, rOptions, repetitionIdx, std::move(loggerSink));
+
+    const size_t batchSize = rOptions.bulkSize;
+    const int opsNum = context.opsNum;
+    const int batchValuesNum = batchSize == 0 ? 1 : static_cast<int>(std::min<size_t>(batchSize, opsNum));
+    const int batchesNum = (opsNum + batchValuesNum - 1) / batchValuesNum;
+
+    std::vector<int> values(opsNum);
+    for (int i = 0; i < opsNum; ++i)
+        values[i] = i;
+    std::vector<int> poppedValues(opsNum);
+
+    const int defaultValue = -1;
+    int pushedNum{0};
+    const auto pushMeasurement = measureStackOps(
+            stack,
+            context,
+            OpsPhase{"push", batchesNum},
+            makePushPopWarmUp(stack, 1, defaultValue),
+            [&](int batchIdx) {
+                const int valueIdx = batchIdx * batchValuesNum;
+                if (batchSize == 0)
+                {
+                    stack.push(values[valueIdx]);
+                    ++pushedNum;
+                }
+                else
+                {
+                    pushedNum += static_cast<int>(stack.pushBulk(values.data() + valueIdx,
+                                                                 std::min(batchValuesNum, opsNum - valueIdx)));
+                }
+                return MeasuredOp::Push;
+            }
+    );
+
+    int poppedNum{0};
+    const auto popMeasurement = measureStackOps(
+            stack,
+            context,
+            OpsPhase{"pop", batchesNum},
+            NoWarmUp,
+            [&](int batchIdx) {
+                const int valueIdx = batchIdx * batchValuesNum;
+                size_t batchPoppedNum{0};
+                if (batchSize == 0)
+                {
+                    stack.pop(poppedValues[valueIdx], defaultValue);
+                    batchPoppedNum = poppedValues[valueIdx] != defaultValue ? 1 : 0;
+                }
+                else
+                {
+                    batchPoppedNum = stack.popBulk(std::min(batchValuesNum, opsNum - valueIdx),
+                                                   poppedValues.data() + valueIdx);
+                }
+                poppedNum += static_cast<int>(batchPoppedNum);
+                return batchPoppedNum == 0 ? MeasuredOp::EmptyPop : MeasuredOp::Pop;
+            }
+    );
+
+    const double pushThroughput = pushedNum / std::max(pushMeasurement.result.elapsedSec, 1e-9);
+    const double popThroughput = poppedNum / std::max(popMeasurement.result.elapsedSec, 1e-9);
+    SPDLOG_LOGGER_INFO(context.pLogger, "procs {}, rank {}, batch size {}, push throughput (values/sec) {}, "
+                                        "pop throughput (values/sec) {}",
+                       context.procNum, context.rank, batchSize, pushThroughput, popThroughput);
+    SPDLOG_LOGGER_INFO(context.pLogger, "pushed {}, popped {}, push total (sec) {}, pop total (sec) {}",
+                       pushedNum, poppedNum, pushMeasurement.maxElapsedSec, popMeasurement.maxElapsedSec);
+
+    // Значения, которые не удалось снять из-за чужих операций, не переходят в следующий повтор.
+    {
+        int e{-1};
+        stackBarrier(stack, comm);
+        do
+        {
+            stack.pop(e, defaultValue);
+        }
+        while (e != defaultValue);
+        stackBarrier(stack, comm);
+    }
+
+    SPDLOG_INFO("finished 'runStackBulkBatchSizeBenchmarkTask'");
+}
+
+/*
+ * Задача для сравнения строгого и ослабленного режимов внешнего стека (см. rOptions.shardSize)
+ * по пропускной способности и отклонению от порядка LIFO, предназначена только для данных типа 'int'.
+ *
+ * Пропускная способность измеряется на случайной смеси операций PUSH и POP. Отклонение измеряется
+ * так: процессы добавляют значения, равные глобальному номеру операции PUSH, затем после барьера
+ * снимают их, получая глобальный номер каждой операции POP. В строгом стеке j-я операция POP должна
+ * снять значение pushedNum - 1 - j, отклонение - модуль разности между снятым и этим значением.
+ * Номера выдаются счётчиками у процесса 0, поэтому даже строгий стек даёт небольшое отклонение
+ * порядка кол-ва процессов.
+ */
+template<typename StackImpl,
+        typename = EnableIfValueTypeIsInt<StackImpl>>
+void runStackRelaxedLifoBenchmarkTask(stack_interface::IStack<StackImpl> &stack, MPI_Comm comm,
+                                      const BenchmarkOptions &rOptions, int repetitionIdx,
+                                      std::shared_ptr<spdlog::sinks::sink> loggerSink)
+{
+    SPDLOG_INFO("started 'runStackRelaxedLifoBenchmarkTask'");
+
+    const auto context = makeBenchmarkTaskContext(comm, rOptions, repetitionIdx, std::move(loggerSink));
+    const auto modeName = rOptions.shardSize == 0
+            ? std::string("strict")
+            : "relaxed, shard size " + std::to_string(rOptions.shardSize);
+
+    auto& rStackImpl = static_cast<StackImpl&>(stack);
+
+    const auto procNum = context.procNum;
+    const auto rank = context.rank;
+
+    std::random_device rd;
+    std::mt19937 mt(rd());
+    std::uniform_real_distribution<double> operationDist(0, 1);
+
+    const int defaultValue = -1;
+    const auto measurement = measureStackOps(
+            stack,
+            context,
+            OpsPhase{getOperationMixName(OperationMix::Random), context.opsNum},
+            [&stack](int) {
+                stack.push(1);
+            },
+            [&](int i) {
+                if (operationDist(mt) < rOptions.pushRatio)
+                {
+                    stack.push(i);
+                    return MeasuredOp::Push;
+                }
+                int e{defaultValue};
+                stack.pop(e, defaultValue);
+                return e == defaultValue ? MeasuredOp::EmptyPop : MeasuredOp::Pop;
+            }
+    );
+    const double throughput = context.opsNum / std::max(measurement.result.elapsedSec, 1e-9);
+
+    {
+        int e{-1};
+        stackBarrier(stack, comm);
+        do
+        {
+            stack.pop(e, defaultValue);
+        }
+        while (e != defaultValue);
+        stackBarrier(stack, comm);
+    }
+
+    // Все значения второй фазы должны одновременно поместиться в первый сегмент пула узлов.
+    const int deviationOpsNum = std::min(context.opsNum, 4'000 / procNum);
+
+    // Счётчики операций PUSH и POP.
+    MPI_Win counterWin{MPI_WIN_NULL};
+    int* pCounters{nullptr};
+    MPI_Win_allocate(rank == 0 ? 2 * sizeof(int) : 0, sizeof(int), MPI_INFO_NULL, comm, &pCounters, &counterWin);
+    if (rank == 0)
+        std::fill_n(pCounters, 2, 0);
+    stackBarrier(stack, comm);
+    const auto fetchAndIncrement = [counterWin](int counterIdx) {
+        const int one{1};
+        int res{0};
+        MPI_Fetch_and_op(&one, &res, MPI_INT, 0, counterIdx, MPI_SUM, counterWin);
+        MPI_Win_flush(0, counterWin);
+        return res;
+    };
+
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, counterWin);
+    for (int i = 0; i < deviationOpsNum; ++i)
+        stack.push(fetchAndIncrement(0));
+    stackBarrier(stack, comm);
+
+    const int pushedNum = deviationOpsNum * procNum;
+    double deviationSum{0};
+    long long maxDeviation{0};
+    int poppedNum{0};
+    for (int i = 0; i < deviationOpsNum; ++i)
+    {
+        int e{defaultValue};
+        stack.pop(e, defaultValue);
+        const int popIdx = fetchAndIncrement(1);
+        if (e == defaultValue)
+            continue;
+
+        const long long deviation = std::llabs(static_cast<long long>(e) - (pushedNum - 1 - popIdx));
+        deviationSum += static_cast<double>(deviation);
+        maxDeviation = std::max(maxDeviation, deviation);
+        ++poppedNum;
+    }
+    MPI_Win_unlock_all(counterWin);
+    stackBarrier(stack, comm);
+    MPI_Win_free(&counterWin);
+
+    double totalDeviationSum{0};
+    int totalPoppedNum{0};
+    long long totalMaxDeviation{0};
+    MPI_Allreduce(&deviationSum, &totalDeviationSum, 1, MPI_DOUBLE, MPI_SUM, comm);
+    MPI_Allreduce(&poppedNum, &totalPoppedNum, 1, MPI_INT, MPI_SUM, comm);
+    MPI_Allreduce(&maxDeviation, &totalMaxDeviation, 1, MPI_LONG_LONG, MPI_MAX, comm);
+    const double meanDeviation = totalDeviationSum / std::max(totalPoppedNum, 1);
+
+    SPDLOG_LOGGER_INFO(context.pLogger, "procs {}, rank {}, mode {}, throughput (ops/sec) {}, elapsed (sec) {}, "
+                                        "total (sec) {}",
+                       procNum, rank, modeName, throughput, measurement.result.elapsedSec, measurement.maxElapsedSec);
+    SPDLOG_LOGGER_INFO(context.pLogger, "lifo deviation mean {}, max {}, popped {}, stolen {}, deviation ops {}",
+                       meanDeviation, totalMaxDeviation, totalPoppedNum, rStackImpl.getStolenOpsNum(),
+                       deviationOpsNum);
+
+    SPDLOG_INFO("finished 'runStackRelaxedLifoBenchmarkTask'");
+}
+
+/*
+ * Задача для сравнения способов открытия эпох доступа к окнам стека (rOptions.epochMode, см.
+ * ref_counting::EpochMode) по средней задержке и пропускной способности операций PUSH и POP,
+ * предназначена только для данных типа 'int'.
+ */
+template<typename StackImpl,
+        typename = EnableIfValueTypeIsInt<StackImpl>>
+void runStackEpochModeBenchmarkTask(stack_interface::IStack<StackImpl> &stack, MPI_Comm comm,
+                                    const BenchmarkOptions &rOptions, int repetitionIdx,
+                                    std::shared_ptr<spdlog::sinks::sink> loggerSink)
+{
+    SPDLOG_INFO("started 'runStackEpochModeBenchmarkTask'");
+
+    const auto context = makeBenchmarkTaskContext(comm, rOptions, repetitionIdx, std::move(loggerSink));
+    const auto modeName = rma_stack::ref_counting::getEpochModeName(rOptions.epochMode);
+    const int opsNum = context.opsNum;
+
+    const int defaultValue = -1;
+    const auto pushMeasurement = measureStackOps(
+            stack,
+            context,
+            OpsPhase{"push", opsNum},
+            makePushPopWarmUp(stack, 1, defaultValue),
+            [&stack](int i) {
+                stack.push(i);
+                return MeasuredOp::Push;
+            }
+    );
+
+    int poppedNum{0};
+    const auto popMeasurement = measureStackOps(
+            stack,
+            context,
+            OpsPhase{"pop", opsNum},
+            NoWarmUp,
+            [&](int) {
+                int e{defaultValue};
+                stack.pop(e, defaultValue);
+                poppedNum += e != defaultValue ? 1 : 0;
+                return e == defaultValue ? MeasuredOp::EmptyPop : MeasuredOp::Pop;
+            }
+    );
+
+    const double tPushElapsedSec = pushMeasurement.result.elapsedSec;
+    const double tPopElapsedSec = popMeasurement.result.elapsedSec;
+    SPDLOG_LOGGER_INFO(context.pLogger, "procs {}, rank {}, epoch mode {}, push latency (usec) {}, "
+                                        "pop latency (usec) {}",
+                       context.procNum, context.rank, modeName, tPushElapsedSec / opsNum * 1e6,
+                       tPopElapsedSec / opsNum * 1e6);
+    SPDLOG_LOGGER_INFO(context.pLogger, "push throughput (ops/sec) {}, pop throughput (ops/sec) {}, popped {}",
+                       opsNum / std::max(tPushElapsedSec, 1e-9), opsNum / std::max(tPopElapsedSec, 1e-9), poppedNum);
+    SPDLOG_LOGGER_INFO(context.pLogger, "push total (sec) {}, pop total (sec) {}",
+                       pushMeasurement.maxElapsedSec, popMeasurement.maxElapsedSec);
+
+    // Значения, которые не удалось снять из-за чужих операций, не переходят в следующий повтор.
+    {
+        int e{-1};
+        stackBarrier(stack, comm);
+        do
         {
-            int defaultValue = -1;
             stack.pop(e, defaultValue);
-            ++popCnt;
         }
-        std::this_thread::sleep_for(workload);
+        while (e != defaultValue);
+        stackBarrier(stack, comm);
     }
-    const double tEndSec = MPI_Wtime();
 
-    const double workloadSec = std::chrono::duration_cast<std::chrono::microseconds>(workload).count() / 1'000'000.0f;
-    const double tElapsedSec = tEndSec - tBeginSec - (opsNum * workloadSec);
+    SPDLOG_INFO("finished 'runStackEpochModeBenchmarkTask'");
+}
+
+/*
+ * Данные, которые не помещаются в узел стека и хранятся в окне данных пользователя, поэтому
+ * PUSH и POP обращаются к двум окнам.
+ */
+struct OutOfNodePayload
+{
+    int value{-1};
+    int padding[2 * rma_stack::ref_counting::MaxInlinePayloadSize / sizeof(int)]{};
+};
+
+template<typename StackImpl>
+using EnableIfValueTypeIsOutOfNodePayload = std::enable_if_t<std::is_same_v<typename StackImpl::ValueType, OutOfNodePayload>>;
+
+/*
+ * Задача для сравнения стека с конвейеризацией операций RMA и без неё (rOptions.requestPipelining,
+ * см. InnerStack::isRequestPipeliningEnabled). Кроме средней задержки PUSH и POP measureStackOps
+ * выводит среднее время каждого этапа операций, по которому видно, какие ожидания были совмещены,
+ * поэтому rOptions.phaseTiming должен быть включён.
+ */
+template<typename StackImpl,
+        typename = EnableIfValueTypeIsOutOfNodePayload<StackImpl>>
+void runStackRmaPipeliningBenchmarkTask(stack_interface::IStack<StackImpl> &stack, MPI_Comm comm,
+                                        const BenchmarkOptions &rOptions, int repetitionIdx,
+                                        std::shared_ptr<spdlog::sinks::sink> loggerSink)
+{
+    SPDLOG_INFO("started 'runStackRmaPipeliningBenchmarkTask'");
+
+    const auto context = makeBenchmarkTaskContext(comm, rOptions, repetitionIdx, std::move(loggerSink));
+    const std::string_view modeName = rOptions.requestPipelining ? "pipelined" : "serialized";
+
+    // Все значения должны одновременно поместиться в первый сегмент пула узлов.
+    const int opsNum = std::min(context.opsNum, 4'000 / context.procNum);
 
-    double tTotalElapsedSec{0};
-    MPI_Allreduce(&tElapsedSec, &tTotalElapsedSec, 1, MPI_DOUBLE, MPI_MAX, comm);
+    const OutOfNodePayload defaultPayload;
+    const auto pushMeasurement = measureStackOps(
+            stack,
+            context,
+            OpsPhase{"push", opsNum},
+            makePushPopWarmUp(stack, OutOfNodePayload{}, defaultPayload),
+            [&stack](int i) {
+                OutOfNodePayload payload;
+                payload.value = i;
+                stack.push(payload);
+                return MeasuredOp::Push;
+            }
+    );
 
-    SPDLOG_LOGGER_INFO(pLogger, "procs {}, rank {}, elapsed (sec) {}, total (sec) {}", procNum, rank, tElapsedSec, tTotalElapsedSec);
-    SPDLOG_LOGGER_INFO(pLogger, "total ops {}, ops {}", totalOpsNum, opsNum);
-    SPDLOG_LOGGER_INFO(pLogger, "push count {}, pop count {}, warm up {}", pushCnt, popCnt, warmUp);
+    int poppedNum{0};
+    const auto popMeasurement = measureStackOps(
+            stack,
+            context,
+            OpsPhase{"pop", opsNum},
+            NoWarmUp,
+            [&](int) {
+                OutOfNodePayload payload;
+                stack.pop(payload, defaultPayload);
+                const bool popped = payload.value != defaultPayload.value;
+                poppedNum += popped ? 1 : 0;
+                return popped ? MeasuredOp::Pop : MeasuredOp::EmptyPop;
+            }
+    );
+
+    SPDLOG_LOGGER_INFO(context.pLogger, "procs {}, rank {}, mode {}, push latency (usec) {}, pop latency (usec) {}",
+                       context.procNum, context.rank, modeName, pushMeasurement.result.elapsedSec / opsNum * 1e6,
+                       popMeasurement.result.elapsedSec / opsNum * 1e6);
+    SPDLOG_LOGGER_INFO(context.pLogger, "push total (sec) {}, pop total (sec) {}, popped {}",
+                       pushMeasurement.maxElapsedSec, popMeasurement.maxElapsedSec, poppedNum);
+
+    // Значения, которые не удалось снять из-за чужих операций, не переходят в следующий повтор.
+    {
+        OutOfNodePayload payload;
+        stackBarrier(stack, comm);
+        do
+        {
+            stack.pop(payload, defaultPayload);
+        }
+        while (payload.value != defaultPayload.value);
+        stackBarrier(stack, comm);
+    }
 
-    SPDLOG_INFO("finished 'runStackRandomOperationBenchmarkTask'");
+    SPDLOG_INFO("finished 'runStackRmaPipeliningBenchmarkTask'");
 }
 
 /*
- * Задача для измерения продолжительности нескольких операций PUSH внешнего стека,
- * предназначена только для данных типа 'int'. workload - эмуляция сторонней нагрузки на приложение.
+ * Задача для оценки совмещения асинхронных операций PUSH и POP с вычислениями, предназначена только
+ * для данных типа 'int'. Каждый процесс выполняет случайные операции, после которых measureStackOps
+ * выполняет эмуляцию сторонней нагрузки rOptions.workload. При maxOpsInFlight = 0 операции блокирующие,
+ * иначе у процесса может быть до maxOpsInFlight незавершённых операций, которые продвигаются перед
+ * каждой следующей операцией, а последняя операция замера дожидается завершения всех. Время замера -
+ * время, не скрытое нагрузкой.
  */
 template<typename StackImpl,
         typename = EnableIfValueTypeIsInt<StackImpl>>
-void runStackOnlyPushBenchmarkTask(stack_interface::IStack<StackImpl> &stack, MPI_Comm comm,
-                                          std::shared_ptr<spdlog::sinks::sink> loggerSink)
+void runStackAsyncOverlapBenchmarkTask(stack_interface::IStack<StackImpl> &stack, MPI_Comm comm,
+                                       const BenchmarkOptions &rOptions, int repetitionIdx,
+                                       std::shared_ptr<spdlog::sinks::sink> loggerSink)
 {
-    SPDLOG_INFO("started 'runStackOnlyPushBenchmarkTask'");
+    SPDLOG_INFO("started 'runStackAsyncOverlapBenchmarkTask'");
 
-    auto pLogger = std::make_shared<spdlog::logger>(producerConsumerBenchmarkLoggerName.data(), loggerSink);
-    pLogger->set_level(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
-    pLogger->flush_on(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
+    const auto context = makeBenchmarkTaskContext(comm, rOptions, repetitionIdx, std::move(loggerSink));
 
-    const auto workload{1us};
-    const auto totalOpsNum{15'000};
+    auto& rStackImpl = static_cast<StackImpl&>(stack);
 
-    auto procNum{0};
-    MPI_Comm_size(comm, &procNum);
-    const auto opsNum{totalOpsNum / procNum};
+    const int opsNum = context.opsNum;
+    const int defaultValue = -1;
+    const size_t maxOpsInFlightValues[] = {0, 1, 4, 16};
+    for (auto maxOpsInFlight: maxOpsInFlightValues)
+    {
+        std::mt19937 mt(context.rank);
+        std::uniform_real_distribution<double> operationDist(0, 1);
+        std::uniform_int_distribution<int> valueDist(0, 50);
 
-    int rank{-1};
-    MPI_Comm_rank(comm, &rank);
+        // Значения операций хранятся до их завершения, ячейка операции освобождается по кругу.
+        size_t poppedNum{0};
+        std::vector<int> values(std::max<size_t>(maxOpsInFlight, 1), defaultValue);
+        std::vector<rma_stack::AsyncOperation> operations(values.size());
+        std::vector<char> popSlots(values.size(), 0);
+        const auto waitSlot = [&operations, &popSlots, &poppedNum](size_t slotIdx) {
+            operations[slotIdx].wait();
+            poppedNum += popSlots[slotIdx] && operations[slotIdx].isSucceeded() ? 1 : 0;
+        };
 
-    const double tBeginSec = MPI_Wtime();
-    for (int i = 0; i < opsNum; ++i)
+        const auto asyncOp = [&](int i) {
+            const bool push = operationDist(mt) < rOptions.pushRatio;
+            MeasuredOp measuredOp{MeasuredOp::Push};
+            if (maxOpsInFlight == 0)
+            {
+                if (push)
+                {
+                    stack.push(valueDist(mt));
+                }
+                else
+                {
+                    int value{defaultValue};
+                    stack.pop(value, defaultValue);
+                    poppedNum += value != defaultValue ? 1 : 0;
+                    measuredOp = value == defaultValue ? MeasuredOp::EmptyPop : MeasuredOp::Pop;
+                }
+                return measuredOp;
+            }
+
+            rStackImpl.progressAsync();
+            const auto slotIdx = i % maxOpsInFlight;
+            waitSlot(slotIdx);
+            popSlots[slotIdx] = !push;
+            if (push)
+            {
+                values[slotIdx] = valueDist(mt);
+                operations[slotIdx] = rStackImpl.pushAsync(values[slotIdx]);
+            }
+            else
+            {
+                operations[slotIdx] = rStackImpl.popAsync(values[slotIdx], defaultValue);
+                measuredOp = MeasuredOp::Pop;
+            }
+            if (i + 1 == opsNum)
+            {
+                for (size_t idx = 0; idx < operations.size(); ++idx)
+                    waitSlot(idx);
+            }
+            return measuredOp;
+        };
+        const auto phaseName = "ops in flight " + std::to_string(maxOpsInFlight);
+        const auto measurement = maxOpsInFlight == 0
+                ? measureStackOps(stack, context, OpsPhase{phaseName, opsNum},
+                                  [&stack](int) {
+                                      stack.push(1);
+                                  },
+                                  asyncOp)
+                : measureStackOps(stack, context, OpsPhase{phaseName, opsNum}, NoWarmUp, asyncOp);
+
+        const double tExposedSec = measurement.result.elapsedSec;
+        SPDLOG_LOGGER_INFO(context.pLogger, "procs {}, rank {}, ops in flight {}, exposed (sec) {}, "
+                                            "exposed per op (usec) {}, total (sec) {}",
+                           context.procNum, context.rank, maxOpsInFlight, tExposedSec, tExposedSec / opsNum * 1e6,
+                           measurement.maxElapsedSec);
+        SPDLOG_LOGGER_INFO(context.pLogger, "popped {}", poppedNum);
+
+        // Значения, которые остались в стеке, не переходят в следующий замер.
+        int value{defaultValue};
+        stackBarrier(stack, comm);
+        do
+        {
+            stack.pop(value, defaultValue);
+        }
+        while (value != defaultValue);
+        stackBarrier(stack, comm);
+    }
+
+    SPDLOG_INFO("finished 'runStackAsyncOverlapBenchmarkTask'");
+}
+
+/*
+ * Микробенчмарк запросов к стеку без его изменения: top, size и isEmpty. Для сравнения
+ * измеряется просмотр вершины через POP и обратный PUSH, которым приходилось пользоваться
+ * до появления top. Стек заполняется заранее, все процессы выполняют запросы одновременно,
+ * каждый вид запроса - отдельный замер из context.opsNum запросов без эмуляции нагрузки.
+ */
+template<typename StackImpl,
+        typename = EnableIfValueTypeIsInt<StackImpl>>
+void runStackQueryBenchmarkTask(stack_interface::IStack<StackImpl> &stack, MPI_Comm comm,
+                                const BenchmarkOptions &rOptions, int repetitionIdx,
+                                std::shared_ptr<spdlog::sinks::sink> loggerSink)
+{
+    SPDLOG_INFO("started 'runStackQueryBenchmarkTask'");
+
+    const auto context = makeBenchmarkTaskContext(comm, rOptions, repetitionIdx, std::move(loggerSink));
+
+    const auto fillNum{100};
+    const auto procNum = context.procNum;
+    const auto rank = context.rank;
+    const int callsNum = context.opsNum;
+
+    for (int i = 0; i < fillNum; ++i)
     {
-        stack.push(i);
-        std::this_thread::sleep_for(workload);
+        stack.push(rank * fillNum + i);
     }
-    const double tEndSec = MPI_Wtime();
+    stackBarrier(stack, comm);
+    SPDLOG_LOGGER_INFO(context.pLogger, "procs {}, rank {}, size {}, expected size {}, is empty {}",
+                       procNum, rank, stack.size(), procNum * fillNum, stack.isEmpty());
+
+    const int defaultValue = -1;
+    bool warmedUp{false};
+    const auto measure = [&](std::string_view callName, auto &&call) {
+        const auto queryOp = [&call](int) {
+            call();
+            return MeasuredOp::Query;
+        };
+        const auto measurement = warmedUp
+                ? measureStackOps(stack, context, OpsPhase{callName, callsNum}, NoWarmUp, queryOp)
+                : measureStackOps(stack, context, OpsPhase{callName, callsNum},
+                                  makePushPopWarmUp(stack, 1, defaultValue), queryOp);
+        warmedUp = true;
+
+        const double tElapsedSec = measurement.result.elapsedSec;
+        double tSumElapsedSec{0};
+        MPI_Allreduce(&tElapsedSec, &tSumElapsedSec, 1, MPI_DOUBLE, MPI_SUM, comm);
 
-    const double workloadSec = std::chrono::duration_cast<std::chrono::microseconds>(workload).count() / 1'000'000.0f;
-    const double tElapsedSec = tEndSec - tBeginSec - (opsNum * workloadSec);
+        SPDLOG_LOGGER_INFO(context.pLogger, "procs {}, rank {}, call {}, calls {}, latency (usec) {}, "
+                                            "mean latency (usec) {}, max latency (usec) {}",
+                           procNum, rank, callName, callsNum, tElapsedSec / callsNum * 1e6,
+                           tSumElapsedSec / procNum / callsNum * 1e6, measurement.maxElapsedSec / callsNum * 1e6);
+    };
 
-    double tTotalElapsedSec{0};
-    MPI_Allreduce(&tElapsedSec, &tTotalElapsedSec, 1, MPI_DOUBLE, MPI_MAX, comm);
+    size_t checksum{0};
+    measure("top", [&]() {
+        checksum += stack.top();
+    });
+    measure("size", [&]() {
+        checksum += stack.size();
+    });
+    measure("isEmpty", [&]() {
+        checksum += stack.isEmpty();
+    });
+    measure("pop+push", [&]() {
+        int value{defaultValue};
+        stack.pop(value, defaultValue);
+        if (value != defaultValue)
+        {
+            stack.push(value);
+            checksum += value;
+        }
+    });
+    SPDLOG_LOGGER_DEBUG(context.pLogger, "checksum {}", checksum);
 
-    SPDLOG_LOGGER_INFO(pLogger, "procs {}, rank {}, elapsed (sec) {}, total (sec) {}", procNum, rank, tElapsedSec, tTotalElapsedSec);
-    SPDLOG_LOGGER_INFO(pLogger, "total ops {}, ops {}", totalOpsNum, opsNum);
+    int value{defaultValue};
+    stackBarrier(stack, comm);
+    do
+    {
+        stack.pop(value, defaultValue);
+    }
+    while (value != defaultValue);
+    stackBarrier(stack, comm);
 
-    SPDLOG_INFO("finished 'runStackOnlyPushBenchmarkTask'");
+    SPDLOG_INFO("finished 'runStackQueryBenchmarkTask'");
 }
 
 /*
- * Задача для измерения продолжительности нескольких операций POP внешнего стека,
- * предназначена только для данных типа 'int'. workload - эмуляция сторонней нагрузки на приложение.
+ * Задача для оценки ожидания значения в пустом стеке, предназначена только для данных типа 'int'.
+ * Последний процесс кладёт значения, остальные процессы снимают по context.opsNum значений, после
+ * каждой операции measureStackOps выполняет эмуляцию сторонней нагрузки rOptions.workload. Если
+ * rOptions.popWait - false, то потребитель повторяет POP, пока стек пуст, и каждая попытка обращается
+ * к голове, иначе - ждёт уведомления от PUSH.
  */
 template<typename StackImpl,
         typename = EnableIfValueTypeIsInt<StackImpl>>
-void runStackOnlyPopBenchmarkTask(stack_interface::IStack<StackImpl> &stack, MPI_Comm comm,
-                                          std::shared_ptr<spdlog::sinks::sink> loggerSink)
+void runStackPopWaitBenchmarkTask(stack_interface::IStack<StackImpl> &stack, MPI_Comm comm,
+                                  const BenchmarkOptions &rOptions, int repetitionIdx,
+                                  std::shared_ptr<spdlog::sinks::sink> loggerSink)
 {
-    SPDLOG_INFO("started 'runStackOnlyPopBenchmarkTask'");
+    SPDLOG_INFO("started 'runStackPopWaitBenchmarkTask'");
 
-    auto pLogger = std::make_shared<spdlog::logger>(producerConsumerBenchmarkLoggerName.data(), loggerSink);
-    pLogger->set_level(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
-    pLogger->flush_on(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
+    const auto context = makeBenchmarkTaskContext(comm, rOptions, repetitionIdx, std::move(loggerSink));
 
-    const auto workload{1us};
-    const auto totalOpsNum{15'000};
+    auto& rStackImpl = static_cast<StackImpl&>(stack);
 
-    auto procNum{0};
-    MPI_Comm_size(comm, &procNum);
-    const auto opsNum{totalOpsNum / procNum};
+    const auto waitTimeout{10ms};
+    const auto procNum = context.procNum;
+    const auto rank = context.rank;
+    const bool popWait = rOptions.popWait;
 
-    int rank{-1};
-    MPI_Comm_rank(comm, &rank);
+    if (procNum < 2)
+    {
+        SPDLOG_LOGGER_WARN(context.pLogger, "pop wait benchmark requires at least 2 processes");
+        return;
+    }
+    const int producerRank      = procNum - 1;
+    const int valuesPerConsumer = context.opsNum;
+    const int valuesNum         = valuesPerConsumer * (procNum - 1);
+
+    const int defaultValue = -1;
+    const std::string_view mode = popWait ? "popWait" : "polling";
+    // Кол-во попыток POP у потребителя.
+    size_t callsNum{0};
+    size_t timeoutsNum{0};
+    size_t checksum{0};
+
+    const auto measurement = measureStackOps(
+            stack,
+            context,
+            OpsPhase{mode, rank == producerRank ? valuesNum : valuesPerConsumer},
+            makePushPopWarmUp(stack, 1, defaultValue),
+            [&](int i) {
+                if (rank == producerRank)
+                {
+                    stack.push(i);
+                    return MeasuredOp::Push;
+                }
 
-    const auto warmUp = std::ceil(opsNum * 0.1);
+                int value{defaultValue};
+                if (!popWait)
+                {
+                    do
+                    {
+                        stack.pop(value, defaultValue);
+                        ++callsNum;
+                    }
+                    while (value == defaultValue);
+                }
+                else
+                {
+                    for (;; ++timeoutsNum)
+                    {
+                        ++callsNum;
+                        if (rStackImpl.popWait(value, waitTimeout))
+                            break;
+                    }
+                }
+                checksum += value;
+                return MeasuredOp::Pop;
+            }
+    );
 
-    for (int i = 0; i < warmUp; ++i)
+    if (rank == producerRank)
     {
-        stack.push(1);
+        SPDLOG_LOGGER_INFO(context.pLogger, "procs {}, rank {}, mode {}, producer, values {}, elapsed (sec) {}",
+                           procNum, rank, mode, valuesNum, measurement.result.elapsedSec);
     }
-    MPI_Barrier(comm);
+    else
+    {
+        SPDLOG_LOGGER_INFO(context.pLogger, "procs {}, rank {}, mode {}, consumer, values {}, calls {}, "
+                                            "calls per value {}, timeouts {}, elapsed (sec) {}",
+                           procNum, rank, mode, valuesPerConsumer, callsNum,
+                           static_cast<double>(callsNum) / valuesPerConsumer, timeoutsNum,
+                           measurement.result.elapsedSec);
+    }
+    SPDLOG_LOGGER_DEBUG(context.pLogger, "checksum {}", checksum);
 
-    const double tBeginSec = MPI_Wtime();
-    for (int i = 0; i < opsNum; ++i)
+    SPDLOG_INFO("finished 'runStackPopWaitBenchmarkTask'");
+}
+
+template<typename StackImpl>
+using EnableIfValueTypeIsBytes = std::enable_if_t<std::is_same_v<typename StackImpl::ValueType, std::vector<std::byte>>>;
+
+/*
+ * Задача для оценки стека с данными переменной длины (PayloadStack), предназначена только для данных
+ * типа 'std::vector<std::byte>'. Каждый процесс выполняет случайные операции PUSH и POP со значениями
+ * размером от minPayloadSize до maxPayloadSize байт, размер выбирается равномерно по логарифмической
+ * шкале. Выводятся пропускная способность и объём памяти арены данных в сравнении с долей процесса
+ * в объёме, который заняли бы rOptions.elemsUpLimit элементов стека наибольшего размера.
+ */
+template<typename StackImpl,
+        typename = EnableIfValueTypeIsBytes<StackImpl>>
+void runStackVariablePayloadBenchmarkTask(stack_interface::IStack<StackImpl> &stack, MPI_Comm comm,
+                                          const BenchmarkOptions &rOptions, int repetitionIdx,
+                                          std::shared_ptr<spdlog::sinks::sink> loggerSink)
+{
+    SPDLOG_INFO("started 'runStackVariablePayloadBenchmarkTask'");
+
+    const auto context = makeBenchmarkTaskContext(comm, rOptions, repetitionIdx, std::move(loggerSink));
+
+    auto& rStackImpl = static_cast<StackImpl&>(stack);
+
+    const size_t minPayloadSize{64};
+    const size_t maxPayloadSize{64 * 1024};
+    const int opsNum = context.opsNum;
+
+    std::mt19937 mt(context.rank);
+    std::uniform_real_distribution<double> sizeExponentDist(std::log2(minPayloadSize), std::log2(maxPayloadSize));
+    std::uniform_real_distribution<double> operationDist(0, 1);
+
+    size_t pushedBytesNum{0};
+    size_t poppedBytesNum{0};
+    size_t checksum{0};
+    std::vector<std::byte> value;
+    const std::vector<std::byte> defaultValue;
+    const std::vector<std::byte> warmUpValue(minPayloadSize);
+
+    const auto measurement = measureStackOps(
+            stack,
+            context,
+            OpsPhase{getOperationMixName(OperationMix::Random), opsNum},
+            [&stack, &warmUpValue](int) {
+                stack.push(warmUpValue);
+            },
+            [&](int i) {
+                if (operationDist(mt) < rOptions.pushRatio)
+                {
+                    value.assign(static_cast<size_t>(std::exp2(sizeExponentDist(mt))), static_cast<std::byte>(i));
+                    stack.push(value);
+                    pushedBytesNum += value.size();
+                    return MeasuredOp::Push;
+                }
+                stack.pop(value, defaultValue);
+                poppedBytesNum += value.size();
+                if (value.empty())
+                    return MeasuredOp::EmptyPop;
+                checksum += static_cast<size_t>(value.front());
+                return MeasuredOp::Pop;
+            }
+    );
+
+    const double tElapsedSec = measurement.result.elapsedSec;
+    const size_t memorySize = rStackImpl.getPayloadMemorySize();
+    SPDLOG_LOGGER_INFO(context.pLogger, "procs {}, rank {}, ops {}, elapsed (sec) {}, max elapsed (sec) {}, "
+                                        "pushed (MB) {}, popped (MB) {}, throughput (MB/s) {}, payload memory (MB) {}, "
+                                        "max size payload memory (MB) {}",
+                       context.procNum, context.rank, opsNum, tElapsedSec, measurement.maxElapsedSec,
+                       pushedBytesNum / 1e6, poppedBytesNum / 1e6,
+                       (pushedBytesNum + poppedBytesNum) / 1e6 / std::max(tElapsedSec, 1e-9), memorySize / 1e6,
+                       static_cast<double>(rOptions.elemsUpLimit) * maxPayloadSize / context.procNum / 1e6);
+    SPDLOG_LOGGER_DEBUG(context.pLogger, "checksum {}", checksum);
+
+    stackBarrier(stack, comm);
+    do
     {
-        int e{-1};
-        int defaultValue = -1;
-        stack.pop(e, defaultValue);
-        std::this_thread::sleep_for(workload);
+        stack.pop(value, defaultValue);
     }
-    const double tEndSec = MPI_Wtime();
+    while (!value.empty());
+    stackBarrier(stack, comm);
+
+    SPDLOG_INFO("finished 'runStackVariablePayloadBenchmarkTask'");
+}
 
-    const double workloadSec = std::chrono::duration_cast<std::chrono::microseconds>(workload).count() / 1'000'000.0f;
-    const double tElapsedSec = tEndSec - tBeginSec - (opsNum * workloadSec);
+/*
+ * Данные заданного размера, которые не помещаются в узел стека, для сравнения способов размещения
+ * данных, см. rma_stack::PayloadPlacement.
+ */
+template<size_t PayloadSize>
+struct SizedPayload
+{
+    static_assert(PayloadSize > rma_stack::ref_counting::MaxInlinePayloadSize, "the payload must not fit into a node");
 
-    double tTotalElapsedSec{0};
-    MPI_Allreduce(&tElapsedSec, &tTotalElapsedSec, 1, MPI_DOUBLE, MPI_MAX, comm);
+    int value{-1};
+    std::byte padding[PayloadSize - sizeof(int)]{};
+};
 
-    SPDLOG_LOGGER_INFO(pLogger, "procs {}, rank {}, elapsed (sec) {}, total (sec) {}", procNum, rank, tElapsedSec, tTotalElapsedSec);
-    SPDLOG_LOGGER_INFO(pLogger, "total ops {}, ops {}", totalOpsNum, opsNum);
+template<typename StackImpl>
+using EnableIfValueTypeIsSizedPayload = std::enable_if_t<
+        std::is_same_v<typename StackImpl::ValueType, SizedPayload<sizeof(typename StackImpl::ValueType)>>>;
 
-    SPDLOG_INFO("finished 'runStackOnlyPopBenchmarkTask'");
-}
\ No newline at end of file
+/*
+ * Задача для сравнения размещения данных у HEAD_RANK и у процесса, выполнившего PUSH (rOptions.payloadPlacement,
+ * см. rma_stack::PayloadPlacement), по средней задержке и пропускной способности операций PUSH и POP.
+ * Сумма снятых значений сверяется с суммой добавленных.
+ */
+template<typename StackImpl,
+        typename = EnableIfValueTypeIsSizedPayload<StackImpl>>
+void runStackPayloadPlacementBenchmarkTask(stack_interface::IStack<StackImpl> &stack, MPI_Comm comm,
+                                           const BenchmarkOptions &rOptions, int repetitionIdx,
+                                           std::shared_ptr<spdlog::sinks::sink> loggerSink)
+{
+    SPDLOG_INFO("started 'runStackPayloadPlacementBenchmarkTask'");
+
+    using Payload = typename StackImpl::ValueType;
+
+    const auto context = makeBenchmarkTaskContext(comm, rOptions, repetitionIdx, std::move(loggerSink));
+    const auto placementName = rma_stack::getPayloadPlacementName(rOptions.payloadPlacement);
+
+    auto& rStackImpl = static_cast<StackImpl&>(stack);
+
+    const auto procNum = context.procNum;
+    const auto rank = context.rank;
+    // Все значения должны одновременно поместиться в первый сегмент пула узлов.
+    const int opsNum = std::min(context.opsNum, 4'000 / procNum);
+
+    const Payload defaultPayload{};
+    long long pushedSum{0};
+    const auto pushMeasurement = measureStackOps(
+            stack,
+            context,
+            OpsPhase{"push", opsNum},
+            makePushPopWarmUp(stack, Payload{}, defaultPayload),
+            [&](int i) {
+                Payload payload;
+                payload.value = rank * opsNum + i;
+                stack.push(payload);
+                pushedSum += payload.value;
+                return MeasuredOp::Push;
+            }
+    );
+
+    long long poppedSum{0};
+    int poppedNum{0};
+    const auto popMeasurement = measureStackOps(
+            stack,
+            context,
+            OpsPhase{"pop", opsNum},
+            NoWarmUp,
+            [&](int) {
+                Payload payload;
+                stack.pop(payload, defaultPayload);
+                if (payload.value == defaultPayload.value)
+                    return MeasuredOp::EmptyPop;
+                poppedSum += payload.value;
+                ++poppedNum;
+                return MeasuredOp::Pop;
+            }
+    );
+
+    // Значения, которые не удалось снять из-за чужих операций, снимаются до сверки сумм.
+    stackBarrier(stack, comm);
+    for (;;)
+    {
+        Payload payload;
+        stack.pop(payload, defaultPayload);
+        if (payload.value == defaultPayload.value)
+            break;
+        poppedSum += payload.value;
+    }
+    stackBarrier(stack, comm);
+
+    long long pushedTotalSum{0};
+    long long poppedTotalSum{0};
+    MPI_Reduce(&pushedSum, &pushedTotalSum, 1, MPI_LONG_LONG, MPI_SUM, 0, comm);
+    MPI_Reduce(&poppedSum, &poppedTotalSum, 1, MPI_LONG_LONG, MPI_SUM, 0, comm);
+
+    const double tPushElapsedSec = pushMeasurement.result.elapsedSec;
+    const double tPopElapsedSec = popMeasurement.result.elapsedSec;
+    SPDLOG_LOGGER_INFO(context.pLogger, "procs {}, rank {}, payload placement {}, payload size {}, "
+                                        "push latency (usec) {}, pop latency (usec) {}",
+                       procNum, rank, placementName, sizeof(Payload), tPushElapsedSec / opsNum * 1e6,
+                       tPopElapsedSec / opsNum * 1e6);
+    SPDLOG_LOGGER_INFO(context.pLogger, "push throughput (ops/sec) {}, pop throughput (ops/sec) {}, popped {}, "
+                                        "producer payload memory (bytes) {}",
+                       opsNum / std::max(tPushElapsedSec, 1e-9), opsNum / std::max(tPopElapsedSec, 1e-9), poppedNum,
+                       rStackImpl.getProducerPayloadMemorySize());
+    SPDLOG_LOGGER_INFO(context.pLogger, "push total (sec) {}, pop total (sec) {}",
+                       pushMeasurement.maxElapsedSec, popMeasurement.maxElapsedSec);
+    if (rank == 0)
+    {
+        SPDLOG_LOGGER_INFO(context.pLogger, "pushed sum {}, popped sum {}, sums match {}",
+                           pushedTotalSum, poppedTotalSum, pushedTotalSum == poppedTotalSum);
+        if (pushedTotalSum != poppedTotalSum)
+            SPDLOG_LOGGER_WARN(context.pLogger, "popped values do not match pushed values");
+    }
+
+    SPDLOG_INFO("finished 'runStackPayloadPlacementBenchmarkTask'");
+}
@@ -11,10 +11,16 @@
 
 namespace rma_stack::ref_counting
 {
-    class CountedNodePtr
+    /*
+     * Глобальный указатель на узел вместе с внешним счётчиком ссылок.
+     * Методы set* и incExternalCounter возвращают false и не изменяют
+     * поле, если значение не помещается в его разрядность.
+     */
+    template<typename Layout>
+    class BasicCountedNodePtr
     {
     public:
-        CountedNodePtr();
+        BasicCountedNodePtr();
 
         [[nodiscard]] uint64_t getExternalCounter() const;
         bool setExternalCounter(uint64_t t_externalCounter);
@@ -25,14 +31,98 @@ namespace rma_stack::ref_counting
         bool incExternalCounter();
         [[nodiscard]] bool isDummy() const;
 
-        friend bool operator==(CountedNodePtr& lhs, CountedNodePtr& rhs);
-        friend bool operator!=(CountedNodePtr& lhs, CountedNodePtr& rhs);
+        friend bool operator==(BasicCountedNodePtr& lhs, BasicCountedNodePtr& rhs)
+        {
+            return
+            lhs.m_rank == rhs.m_rank
+            && lhs.m_offset == rhs.m_offset
+            && lhs.m_externalCounter == rhs.m_externalCounter;
+        }
+        friend bool operator!=(BasicCountedNodePtr& lhs, BasicCountedNodePtr& rhs)
+        {
+            return !(lhs == rhs);
+        }
     private:
-        uint64_t m_offset               : OffsetBitsLimit;
-        uint64_t m_rank                 : RankBitsLimit;
-        uint64_t m_externalCounter      : ExternalCounterBitsLimit; // Внутренний счётчик ссылок на узел.
+        uint64_t m_offset               : Layout::OffsetBits;
+        uint64_t m_rank                 : Layout::RankBits;
+        uint64_t m_externalCounter      : Layout::ExternalCounterBits; // Внешний счётчик ссылок на узел.
     };
 
+    using CountedNodePtr = BasicCountedNodePtr<DefaultBitLayout>;
+    static_assert(sizeof(CountedNodePtr) == sizeof(uint64_t), "CountedNodePtr is accessed as MPI_UINT64_T");
+
+    template<typename Layout>
+    BasicCountedNodePtr<Layout>::BasicCountedNodePtr():
+    m_offset(0),
+    m_rank(Layout::DummyRank),
+    m_externalCounter(0)
+    {
+
+    }
+
+    template<typename Layout>
+    uint64_t BasicCountedNodePtr<Layout>::getExternalCounter() const
+    {
+        return m_externalCounter;
+    }
+
+    template<typename Layout>
+    bool BasicCountedNodePtr<Layout>::setExternalCounter(uint64_t t_externalCounter)
+    {
+        if (t_externalCounter > Layout::MaxExternalCounter)
+            return false;
+
+        m_externalCounter = t_externalCounter;
+        return true;
+    }
+
+    template<typename Layout>
+    uint64_t BasicCountedNodePtr<Layout>::getOffset() const
+    {
+        return m_offset;
+    }
+
+    template<typename Layout>
+    bool BasicCountedNodePtr<Layout>::setOffset(uint64_t t_offset)
+    {
+        if (t_offset > Layout::MaxOffset)
+            return false;
+
+        m_offset = t_offset;
+        return true;
+    }
+
+    template<typename Layout>
+    bool BasicCountedNodePtr<Layout>::setRank(uint64_t t_rank)
+    {
+        if (t_rank >= Layout::DummyRank)
+            return false;
+
+        m_rank = t_rank;
+        return true;
+    }
+
+    template<typename Layout>
+    uint64_t BasicCountedNodePtr<Layout>::getRank() const
+    {
+        return m_rank;
+    }
+
+    template<typename Layout>
+    bool BasicCountedNodePtr<Layout>::incExternalCounter()
+    {
+        if (m_externalCounter >= Layout::MaxExternalCounter)
+            return false;
+
+        ++m_externalCounter;
+        return true;
+    }
+
+    template<typename Layout>
+    bool BasicCountedNodePtr<Layout>::isDummy() const
+    {
+        return m_rank >= Layout::DummyRank;
+    }
 } // rma_stack
 
 #endif //SOURCES_COUNTEDNODEPTR_H
@@ -7,52 +7,1229 @@
 
 #include <utility>
 #include <cstddef>
+#include <cstring>
 #include <mpi.h>
 #include <spdlog/spdlog.h>
 #include <functional>
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 #include "CountedNodePtr.h"
 #include "Node.h"
+#include "NodePool.h"
+#include "NodeReclaimer.h"
+#include "OperationCounters.h"
+#include "RmaOperations.h"
+#include "WaiterTable.h"
+#include "WinEpoch.h"
+
+namespace rma_stack
+{
+    class AsyncOperationEngine;
+}
 
 namespace rma_stack::ref_counting
 {
+        // Вместо колбэка данных передаётся nullptr, если данные хранятся в самом узле.
+        template<typename Callback>
+        constexpr bool IsNoDataCallback = std::is_null_pointer_v<std::decay_t<Callback>>;
+        /*
+         * Колбэк данных с последним параметром MPI_Request& не ждёт
+         * завершения передачи, а запускает её запросом (MPI_Rget) и
+         * возвращает этот запрос. Завершения запроса ждёт сам стек.
+         */
+        template<typename Callback, typename... Args>
+        constexpr bool IsRequestDataCallback = std::is_invocable_v<Callback&, Args..., MPI_Request&>;
+
         class InnerStack
         {
         public:
-            static const int HEAD_RANK = 0;
+            static constexpr int HEAD_RANK = 0;
+            // Разбиение глобальных указателей, для которого собрана библиотека.
+            using Layout = DefaultBitLayout;
 
             InnerStack(MPI_Comm comm, MPI_Info info, bool t_centralized, size_t t_elemsUpLimit,
-                       std::shared_ptr<spdlog::logger> t_logger);
-            void push(const std::function<void(GlobalAddress)> &putDataCallback,
-                      const std::function<void()> &backoffCallback);
-            void pop(const std::function<void(GlobalAddress)> &getDataCallback,
-                     const std::function<void()> &backoffCallback);
+                       std::shared_ptr<spdlog::logger> t_logger, size_t t_segmentCapacity = DefaultSegmentCapacity,
+                       ReclamationScheme t_reclamationScheme = ReclamationScheme::RefCounting,
+                       size_t t_inlinePayloadSize = 0, size_t t_shardSize = 0,
+                       EpochMode t_epochMode = EpochMode::Persistent, bool t_requestPipelining = true);
+            /*
+             * backoffCallback вызывается после неудачной операции CAS над
+             * головой. Если он возвращает true, то операция считается
+             * выполненной без участия стека (например, PUSH и POP
+             * исключили друг друга), и push/pop завершаются: узел,
+             * выделенный для PUSH, возвращается в пул, а POP не вызывает
+             * getDataCallback.
+             *
+             * push возвращает false, если в пуле не осталось свободных узлов.
+             *
+             * Колбэки передаются параметрами шаблона, а не через
+             * std::function, поэтому компилятор может встроить передачу
+             * данных внешнего стека в сам алгоритм.
+             *
+             * pop возвращает true, если значение снято со стека. Колбэк
+             * getDataCallback(GlobalAddress) вызывается после снятия узла,
+             * а при пустом стеке - с пустым адресом. Колбэк
+             * getDataCallback(GlobalAddress, MPI_Request&) вызывается только
+             * для узлов стека. При конвейеризации (t_requestPipelining) он
+             * вызывается до CAS вместе с чтением ссылки на следующий узел:
+             * узел защищён от освобождения, поэтому данные можно читать
+             * заранее, но при неудачной CAS колбэк будет вызван ещё раз для
+             * новой вершины, и его данные нужно считать действительными,
+             * только если pop вернул true.
+             */
+            template<typename PutDataCallback, typename BackoffCallback>
+            bool push(PutDataCallback &&putDataCallback, BackoffCallback &&backoffCallback, size_t headIdx = 0);
+            template<typename GetDataCallback, typename BackoffCallback>
+            bool pop(GetDataCallback &&getDataCallback, BackoffCallback &&backoffCallback, size_t headIdx = 0);
+            /*
+             * Операции над данными, которые хранятся в самом узле. Размер
+             * данных равен t_inlinePayloadSize. Данные записываются вместе
+             * с первой ссылкой на следующий узел и читаются вместе с ней,
+             * поэтому отдельная эпоха доступа к окну данных не нужна.
+             * popInline возвращает false, если стек пуст.
+             */
+            template<typename BackoffCallback>
+            bool pushInline(const void *pPayload, BackoffCallback &&backoffCallback, size_t headIdx = 0);
+            template<typename BackoffCallback>
+            bool popInline(void *pPayload, BackoffCallback &&backoffCallback, size_t headIdx = 0);
+            /*
+             * Пакетные операции. pushBulk связывает valuesNum узлов в
+             * цепочку без обращения к голове и присоединяет её к стеку
+             * одной операцией CAS: вершиной становится последнее значение,
+             * как после valuesNum последовательных PUSH. popBulk проходит
+             * по списку от вершины и отсоединяет до valuesNum узлов одной
+             * операцией CAS, данные узлов читаются уже после неё.
+             *
+             * Колбэки получают порядковый номер значения и адрес узла.
+             * Обе функции возвращают кол-во добавленных/снятых значений:
+             * pushBulk - меньше valuesNum, если в пуле не хватило узлов,
+             * popBulk - если в стеке было меньше значений.
+             */
+            template<typename PutDataCallback, typename BackoffCallback>
+            size_t pushBulk(size_t valuesNum, PutDataCallback &&putDataCallback, BackoffCallback &&backoffCallback,
+                            size_t headIdx = 0);
+            template<typename GetDataCallback, typename BackoffCallback>
+            size_t popBulk(size_t valuesNum, GetDataCallback &&getDataCallback, BackoffCallback &&backoffCallback,
+                           size_t headIdx = 0);
+            // Пакетные операции над данными, которые хранятся в узлах, данные расположены подряд.
+            template<typename BackoffCallback>
+            size_t pushBulkInline(const void *pPayloads, size_t payloadsNum, BackoffCallback &&backoffCallback,
+                                  size_t headIdx = 0);
+            template<typename BackoffCallback>
+            size_t popBulkInline(void *pPayloads, size_t payloadsNum, BackoffCallback &&backoffCallback,
+                                 size_t headIdx = 0);
+            /*
+             * Ослабленный режим (t_shardSize > 0): процессы разбиты на
+             * группы по t_shardSize, и у первого процесса каждой группы
+             * хранится своя голова. Все узлы при этом находятся в общем
+             * пуле. Операции выполняются над головой с номером headIdx,
+             * порядок LIFO соблюдается только в пределах одной головы.
+             * При t_shardSize = 0 голова единственная и хранится у HEAD_RANK.
+             */
+            [[nodiscard]] size_t getHeadsNum() const;
+            // Голова группы, в которую входит текущий процесс.
+            [[nodiscard]] size_t getLocalHeadIdx() const;
+            /*
+             * Чтение вершины без увеличения счётчика ссылок. Голова и
+             * номер публикации узла вершины (см. Node) читаются до и после
+             * чтения данных вершины, и данные возвращаются, только если
+             * вершина за это время не сменилась и не была опубликована
+             * заново, иначе чтение повторяется. Колбэк
+             * getDataCallback(GlobalAddress) может быть вызван несколько
+             * раз, его данные действительны, только если top вернул true.
+             * Возвращает false, если стек пуст.
+             *
+             * Если pNodeStamp не NULL, то topInline возвращает в нём узел
+             * вершины и номер его публикации: совпадение отметок двух
+             * чтений означает, что между ними вершина не менялась.
+             */
+            template<typename GetDataCallback>
+            bool top(GetDataCallback &&getDataCallback, size_t headIdx = 0);
+            bool topInline(void *pPayload, size_t headIdx = 0, NodeStamp *pNodeStamp = nullptr);
+            /*
+             * Приблизительное кол-во значений под головой. Счётчик хранится
+             * рядом с головой и изменяется операцией MPI_Accumulate после
+             * каждой удачной CAS над головой, поэтому он может отставать
+             * от головы на операции, которые выполняются в этот момент.
+             */
+            [[nodiscard]] size_t getApproximateSize(size_t headIdx = 0);
+            // Одно атомарное чтение головы.
+            [[nodiscard]] bool isEmpty(size_t headIdx = 0);
+            /*
+             * Таблица процессов, которые ждут значение в пустом стеке, см.
+             * WaiterTable. PUSH и pushBulk, заменившие пустую голову,
+             * уведомляют ожидающие её процессы.
+             */
+            [[nodiscard]] WaiterTable& getWaiterTable();
+            /*
+             * Коллективная функция, освобождает узлы, отложенные схемой
+             * освобождения памяти. Вызывается в точке, где ни один процесс
+             * не выполняет операции со стеком, например у барьера.
+             */
+            void reclaimRetiredNodes();
             void release();
             [[nodiscard]] size_t getElemsUpLimit() const;
+            [[nodiscard]] ReclamationScheme getReclamationScheme() const;
+            [[nodiscard]] EpochMode getEpochMode() const;
+            /*
+             * Конвейеризация: независимые операции RMA запускаются
+             * запросами (MPI_Rget, MPI_Rget_accumulate) и завершаются одним
+             * ожиданием. PUSH читает голову одновременно с записью данных,
+             * POP читает данные вместе со ссылкой на следующий узел, а
+             * пакетный POP читает данные всех снятых узлов одним ожиданием.
+             */
+            [[nodiscard]] bool isRequestPipeliningEnabled() const;
+            // Замер времени этапов PUSH и POP, по умолчанию выключен.
+            void setPhaseTimingEnabled(bool phaseTimingEnabled);
+            [[nodiscard]] const PopPhaseTimes& getPopPhaseTimes() const;
+            [[nodiscard]] const PushPhaseTimes& getPushPhaseTimes() const;
+            void resetPhaseTimes();
+            /*
+             * Счётчики операций текущего процесса, см. OperationCounters.
+             * Операции RMA учитываются для окон головы и узлов, внешний
+             * стек может присоединить к счётчикам и свои окна.
+             */
+            [[nodiscard]] OperationCounters& getOperationCounters();
+            [[nodiscard]] const OperationCounters& getOperationCounters() const;
+            void resetOperationCounters();
+            // Объём памяти текущего процесса, который занят схемой освобождения памяти, в байтах.
+            [[nodiscard]] size_t getReclamationMemoryOverhead() const;
+            [[nodiscard]] size_t getRetiredNodesNum() const;
+            [[nodiscard]] size_t getSegmentCapacity() const;
+            // Функция вызывается при выделении нового сегмента узлов текущего процесса.
+            void setSegmentGrowthCallback(std::function<void(size_t)> segmentGrowthCallback);
+            // Рост централизованного пула узлов по запросам других процессов, см. NodePool::serviceGrowRequests.
+            bool serviceGrowRequests();
 
-            void printStack(); // функция не потокобезопасная
+            void printStack(size_t headIdx = 0); // функция не потокобезопасная
         private:
-            void initRemoteAccessMemory(MPI_Comm comm, MPI_Info info);
-            void increaseHeadCount(CountedNodePtr& oldHeadCountedNodePtr);
-            [[nodiscard]] GlobalAddress acquireNode(int rank) const;
+            // Движок асинхронных операций выполняет шаги push и pop над окнами стека.
+            friend class rma_stack::AsyncOperationEngine;
 
-            void releaseNode(GlobalAddress nodeAddress) const;
+            // Голова списка: процесс, у которого она хранится, и её адрес в окне головы.
+            struct Head
+            {
+                int rank;
+                MPI_Aint address;
+                // Адрес счётчика значений, см. getApproximateSize.
+                MPI_Aint sizeAddress;
+            };
+            // Память головы в окне: указатель на вершину и счётчик значений под ней.
+            struct HeadCell
+            {
+                CountedNodePtr countedNodePtr;
+                int64_t size{0};
+            };
+
+            void initRemoteAccessMemory(MPI_Comm comm, MPI_Info info);
+            [[nodiscard]] bool isHeadOwner(int rank) const;
+            /*
+             * Открытие и закрытие эпохи доступа к голове для POP. Ячейки
+             * указателей опасности хранятся у HEAD_RANK, поэтому для схемы
+             * HazardPointers открывается и эпоха доступа к HEAD_RANK.
+             */
+            void lockHead(const Head &rHead);
+            void unlockHead(const Head &rHead);
+            void increaseHeadCount(const Head &rHead, CountedNodePtr& oldHeadCountedNodePtr);
+            // Запуск чтения головы запросом, эпоха доступа к голове должна быть открыта.
+            [[nodiscard]] MPI_Request startHeadFetch(const Head &rHead, CountedNodePtr &rHeadCountedNodePtr);
+            // Начало отсчёта этапов POP и прибавление времени, прошедшего с прошлой отметки, к этапу pPhase.
+            void startPopPhases();
+            void markPopPhase(double PopPhaseTimes::*pPhase);
+            void finishPopPhases();
+            void startPushPhases();
+            void markPushPhase(double PushPhaseTimes::*pPhase);
+            void finishPushPhases();
+            // Вызов колбэка после неудачной операции CAS с учётом в счётчиках.
+            template<typename BackoffCallback>
+            bool runBackoff(BackoffCallback &backoffCallback);
+            // Учёт операции CAS над головой, неудачной считается CAS, которая вернула не ожидаемую голову.
+            void countHeadCas(uint64_t OperationCounters::*pAttempts, uint64_t OperationCounters::*pFailures,
+                              CountedNodePtr oldHeadCountedNodePtr,
+                              CountedNodePtr resHeadCountedNodePtr);
+            // Чтение данных снятого узла после CAS. При конвейеризации данные колбэка с запросом уже прочитаны.
+            template<typename GetDataCallback>
+            void readPoppedData(GetDataCallback &getDataCallback, GlobalAddress nodeAddress);
+            template<typename PutDataCallback, typename BackoffCallback>
+            bool pushNode(PutDataCallback &&putDataCallback, const void *pInlinePayload,
+                          BackoffCallback &&backoffCallback, size_t headIdx);
+            template<typename GetDataCallback, typename BackoffCallback>
+            bool popNode(GetDataCallback &&getDataCallback, void *pInlinePayload, BackoffCallback &&backoffCallback,
+                         size_t headIdx);
+            template<typename GetDataCallback, typename BackoffCallback>
+            bool popWithRefCounting(GetDataCallback &&getDataCallback, void *pInlinePayload,
+                                    BackoffCallback &&backoffCallback, const Head &rHead);
+            template<typename GetDataCallback, typename BackoffCallback>
+            bool popWithReclaimer(GetDataCallback &&getDataCallback, void *pInlinePayload,
+                                  BackoffCallback &&backoffCallback, const Head &rHead);
+            template<typename PutDataCallback, typename BackoffCallback>
+            size_t pushChain(size_t valuesNum, PutDataCallback &&putDataCallback, const void *pInlinePayloads,
+                             BackoffCallback &&backoffCallback, size_t headIdx);
+            template<typename GetDataCallback, typename BackoffCallback>
+            size_t popChain(size_t valuesNum, GetDataCallback &&getDataCallback, void *pInlinePayloads,
+                            BackoffCallback &&backoffCallback, size_t headIdx);
+            [[nodiscard]] CountedNodePtr fetchHead(const Head &rHead);
+            // Изменение счётчика значений головы, эпоха доступа к голове должна быть открыта.
+            void addHeadSize(const Head &rHead, int64_t sizeIncrease);
+            template<typename GetDataCallback>
+            bool peekNode(GetDataCallback &&getDataCallback, void *pInlinePayload, size_t headIdx,
+                          NodeStamp *pNodeStamp);
+            /*
+             * Увеличение номера публикации узла без ожидания завершения и
+             * чтение этого номера. Эпоха доступа к владельцу узла должна
+             * быть открыта.
+             */
+            void startNodeVersionIncrease(GlobalAddress nodeAddress);
+            [[nodiscard]] uint32_t fetchNodeVersion(GlobalAddress nodeAddress);
+            /*
+             * Прибавление countIncrease к внутреннему счётчику узла. Узел
+             * возвращается в пул, если счётчик обнулился. Эпоха доступа
+             * к владельцу узла должна быть открыта.
+             */
+            void addNodeInternalCount(GlobalAddress nodeAddress, MPI_Aint nodeOffset, int32_t countIncrease);
+            /*
+             * Чтение ссылки на следующий узел. Если pInlinePayloadWords не
+             * NULL, то той же операцией читаются данные, которые хранятся
+             * в узле. Если rDataRequest - запущенный запрос чтения данных,
+             * то он завершается тем же ожиданием, что и чтение ссылки.
+             * Эпоха доступа к владельцу узла должна быть открыта.
+             */
+            void fetchCountedNodePtrNext(GlobalAddress nodeAddress, MPI_Aint countedNodePtrNextOffset,
+                                         CountedNodePtr &rCountedNodePtrNext, uint64_t *pInlinePayloadWords,
+                                         MPI_Request &rDataRequest);
         private:
-            size_t m_elemsUpLimit{0};
             int m_rank{-1};
             bool m_centralized;
 
+            size_t m_shardSize{0};
+            EpochMode m_epochMode{EpochMode::Persistent};
+            bool m_requestPipelining{true};
+
+            bool m_phaseTimingEnabled{false};
+            double m_popPhaseBeginSec{0};
+            PopPhaseTimes m_popPhaseTimes;
+            double m_pushPhaseBeginSec{0};
+            PushPhaseTimes m_pushPhaseTimes;
+            // На счётчики ссылаются NodePool и другие компоненты стека, поэтому их адрес не должен меняться.
+            std::unique_ptr<OperationCounters> m_pCounters;
+
             MPI_Win m_headWin{MPI_WIN_NULL};
-            CountedNodePtr* m_pHeadCountedNodePtr{nullptr};
-            MPI_Aint m_headAddress{(MPI_Aint)MPI_BOTTOM};
-            MPI_Win m_nodesWin{MPI_WIN_NULL};
-            Node* m_pNodesArr{nullptr};
-            std::unique_ptr<MPI_Aint[]> m_pBaseNodeArrAddresses;
+            HeadCell* m_pHeadCell{nullptr};
+            std::vector<Head> m_heads;
+            size_t m_localHeadIdx{0};
+            NodePool m_nodePool;
+            std::unique_ptr<NodeReclaimer> m_pNodeReclaimer;
+            std::unique_ptr<WaiterTable> m_pWaiterTable;
 
             std::shared_ptr<spdlog::logger> m_logger;
         };
 
+    template<typename PutDataCallback, typename BackoffCallback>
+    bool InnerStack::push(PutDataCallback &&putDataCallback, BackoffCallback &&backoffCallback, size_t headIdx)
+    {
+        return pushNode(putDataCallback, nullptr, backoffCallback, headIdx);
+    }
+
+    template<typename BackoffCallback>
+    bool InnerStack::pushInline(const void *pPayload, BackoffCallback &&backoffCallback, size_t headIdx)
+    {
+        return pushNode(nullptr, pPayload, backoffCallback, headIdx);
+    }
+
+    template<typename PutDataCallback, typename BackoffCallback>
+    bool InnerStack::pushNode(PutDataCallback &&putDataCallback, const void *pInlinePayload,
+                              BackoffCallback &&backoffCallback, size_t headIdx)
+    {
+        m_logger->trace("started 'push'");
+        startPushPhases();
+        const auto &rHead = m_heads.at(headIdx);
+
+        auto nodeAddress = m_nodePool.acquireNode(m_centralized ? HEAD_RANK : m_rank);
+        if (isGlobalAddressDummy(nodeAddress))
+        {
+            m_logger->trace("failed to find free node in 'push'");
+            // Неудачная попытка тоже учитывается, иначе отсчёт этапов остался бы незавершённым.
+            markPushPhase(&PushPhaseTimes::nodeAcquire);
+            finishPushPhases();
+            return false;
+        }
+        markPushPhase(&PushPhaseTimes::nodeAcquire);
+        {
+            const auto r = nodeAddress.rank;
+            const auto o = nodeAddress.offset;
+            m_logger->trace("acquired free node (rank - {}, offset - {}) in 'push'", r, o);
+        }
+
+        CountedNodePtr resHeadCountedNodePtr;
+
+        // Получение текущей головы списка, при конвейеризации - одновременно с записью данных.
+        lockWinTarget(rHead.rank, m_headWin, m_epochMode);
+        MPI_Request headRequest = m_requestPipelining ? startHeadFetch(rHead, resHeadCountedNodePtr) : MPI_REQUEST_NULL;
+
+        if constexpr (!IsNoDataCallback<PutDataCallback>)
+        {
+            putDataCallback(nodeAddress);
+            m_logger->trace("put data in 'push'");
+        }
+
+        if (m_requestPipelining)
+            MPI_Wait(&headRequest, MPI_STATUS_IGNORE);
+        else
+            resHeadCountedNodePtr = fetchHead(rHead);
+
+        m_logger->trace("fetched head (rank - {}, offset - {})", resHeadCountedNodePtr.getRank(), resHeadCountedNodePtr.getOffset());
+        markPushPhase(&PushPhaseTimes::dataPut);
+
+        m_logger->trace("started new head pushing in 'push'");
+
+        CountedNodePtr newCountedNodePtr;
+        newCountedNodePtr.setRank(nodeAddress.rank);
+        newCountedNodePtr.setOffset(nodeAddress.offset);
+        newCountedNodePtr.incExternalCounter();
+
+        CountedNodePtr oldHeadCountedNodePtr;
+        CountedNodePtr countedNodePtrNext;
+
+        const auto nodesWin                     = m_nodePool.getWin();
+        const MPI_Aint countedNodePtrNextOffset = MPI_Aint_add(m_nodePool.getNodeAddress(nodeAddress), 8);
+
+        // Данные, которые хранятся в узле, записываются вместе с первой ссылкой на следующий узел.
+        uint64_t nodeTail[1 + MaxInlinePayloadWordsNum]{};
+        int nodeTailWordsNum{1};
+        if (pInlinePayload)
+        {
+            std::memcpy(nodeTail + 1, pInlinePayload, m_nodePool.getInlinePayloadSize());
+            nodeTailWordsNum += static_cast<int>(getInlinePayloadWordsNum(m_nodePool.getInlinePayloadSize()));
+        }
+
+        /*
+         * Пока не удастся заменить текущую голову списка операцией на новый узел
+         * операцией CAS, перезаписывать глобальный указатель на следующий узел
+         * нового узла текущей головой списка.
+         */
+        bool completedByBackoff{false};
+        bool versionIncreased{false};
+        lockWinTarget(nodeAddress.rank, nodesWin, m_epochMode);
+        do
+        {
+            countedNodePtrNext = resHeadCountedNodePtr;
+            std::memcpy(nodeTail, &countedNodePtrNext, sizeof(CountedNodePtr));
+            rmaPut(nodeTail,
+                   nodeTailWordsNum,
+                   MPI_UINT64_T,
+                   nodeAddress.rank,
+                   countedNodePtrNextOffset,
+                   nodesWin,
+                   m_pCounters.get()
+            );
+            rmaFlush(nodeAddress.rank, nodesWin, m_pCounters.get());
+            nodeTailWordsNum = 1;
+
+            // Номер публикации увеличивается только после записи всех данных узла, см. top.
+            if (!versionIncreased)
+            {
+                startNodeVersionIncrease(nodeAddress);
+                rmaFlush(nodeAddress.rank, nodesWin, m_pCounters.get());
+                versionIncreased = true;
+            }
+
+            oldHeadCountedNodePtr = resHeadCountedNodePtr;
+
+            rmaCompareAndSwap(&newCountedNodePtr,
+                              &oldHeadCountedNodePtr,
+                              &resHeadCountedNodePtr,
+                              MPI_UINT64_T,
+                              rHead.rank,
+                              rHead.address,
+                              m_headWin,
+                              m_pCounters.get()
+            );
+            rmaFlush(rHead.rank, m_headWin, m_pCounters.get());
+            countHeadCas(&OperationCounters::pushCasAttempts, &OperationCounters::pushCasFailures,
+                         oldHeadCountedNodePtr, resHeadCountedNodePtr);
+            markPushPhase(&PushPhaseTimes::linkCas);
+
+            if (resHeadCountedNodePtr != oldHeadCountedNodePtr)
+            {
+                m_logger->trace("started to execute backoff callback");
+                completedByBackoff = runBackoff(backoffCallback);
+                m_logger->trace("executed backoff callback");
+                markPushPhase(&PushPhaseTimes::backoff);
+            }
+        }
+        while (resHeadCountedNodePtr != oldHeadCountedNodePtr && !completedByBackoff);
+
+        if (!completedByBackoff)
+            addHeadSize(rHead, 1);
+        unlockWinTargetLocal(rHead.rank, m_headWin, m_epochMode, m_pCounters.get());
+        // Узел не был опубликован, поэтому его можно сразу вернуть в пул.
+        if (completedByBackoff)
+            m_nodePool.releaseNode(nodeAddress);
+        unlockWinTarget(nodeAddress.rank, nodesWin, m_epochMode, m_pCounters.get());
+        if (!completedByBackoff && oldHeadCountedNodePtr.isDummy())
+            m_pWaiterTable->notifyWaiters(headIdx);
+        markPushPhase(&PushPhaseTimes::finish);
+        finishPushPhases();
+
+        m_logger->trace("finished 'push'");
+        return true;
+    }
+
+    template<typename GetDataCallback, typename BackoffCallback>
+    bool InnerStack::pop(GetDataCallback &&getDataCallback, BackoffCallback &&backoffCallback, size_t headIdx)
+    {
+        return popNode(getDataCallback, nullptr, backoffCallback, headIdx);
+    }
+
+    template<typename BackoffCallback>
+    bool InnerStack::popInline(void *pPayload, BackoffCallback &&backoffCallback, size_t headIdx)
+    {
+        return popNode([](GlobalAddress) {}, pPayload, backoffCallback, headIdx);
+    }
+
+    template<typename PutDataCallback, typename BackoffCallback>
+    size_t InnerStack::pushBulk(size_t valuesNum, PutDataCallback &&putDataCallback, BackoffCallback &&backoffCallback,
+                                size_t headIdx)
+    {
+        return pushChain(valuesNum, putDataCallback, nullptr, backoffCallback, headIdx);
+    }
+
+    template<typename BackoffCallback>
+    size_t InnerStack::pushBulkInline(const void *pPayloads, size_t payloadsNum, BackoffCallback &&backoffCallback,
+                                      size_t headIdx)
+    {
+        return pushChain(payloadsNum, nullptr, pPayloads, backoffCallback, headIdx);
+    }
+
+    template<typename PutDataCallback, typename BackoffCallback>
+    size_t InnerStack::pushChain(size_t valuesNum, PutDataCallback &&putDataCallback, const void *pInlinePayloads,
+                                 BackoffCallback &&backoffCallback, size_t headIdx)
+    {
+        m_logger->trace("started 'pushBulk' of {} values", valuesNum);
+        const auto &rHead = m_heads.at(headIdx);
+
+        std::vector<GlobalAddress> nodeAddresses;
+        nodeAddresses.reserve(valuesNum);
+        for (size_t i = 0; i < valuesNum; ++i)
+        {
+            const auto nodeAddress = m_nodePool.acquireNode(m_centralized ? HEAD_RANK : m_rank);
+            if (isGlobalAddressDummy(nodeAddress))
+            {
+                m_logger->trace("failed to find free node in 'pushBulk'");
+                break;
+            }
+            nodeAddresses.push_back(nodeAddress);
+        }
+        const auto nodesNum = nodeAddresses.size();
+        if (nodesNum == 0)
+            return 0;
+
+        // При конвейеризации голова читается одновременно с записью данных и цепочки.
+        CountedNodePtr resHeadCountedNodePtr;
+        lockWinTarget(rHead.rank, m_headWin, m_epochMode);
+        MPI_Request headRequest = m_requestPipelining ? startHeadFetch(rHead, resHeadCountedNodePtr) : MPI_REQUEST_NULL;
+
+        if constexpr (!IsNoDataCallback<PutDataCallback>)
+        {
+            for (size_t i = 0; i < nodesNum; ++i)
+                putDataCallback(i, nodeAddresses[i]);
+            m_logger->trace("put data in 'pushBulk'");
+        }
+
+        /*
+         * Узел i хранит i-е значение и ссылается на узел i - 1. Узел 0
+         * ссылается на текущую голову, а последний узел становится новой
+         * головой. Все узлы выделены из пула одного процесса.
+         */
+        const auto inlinePayloadSize = pInlinePayloads ? m_nodePool.getInlinePayloadSize() : 0;
+        const auto nodeTailWordsNum  = 1 + getInlinePayloadWordsNum(inlinePayloadSize);
+        const auto nodesRank         = nodeAddresses.front().rank;
+        std::vector<uint64_t> nodeTails(nodesNum * nodeTailWordsNum, 0);
+        std::vector<MPI_Aint> countedNodePtrNextOffsets(nodesNum);
+        for (size_t i = 0; i < nodesNum; ++i)
+        {
+            countedNodePtrNextOffsets[i] = MPI_Aint_add(m_nodePool.getNodeAddress(nodeAddresses[i]),
+                                                        sizeof(CountedNodePtr));
+            if (pInlinePayloads)
+                std::memcpy(nodeTails.data() + i * nodeTailWordsNum + 1,
+                            static_cast<const std::byte*>(pInlinePayloads) + i * inlinePayloadSize,
+                            inlinePayloadSize);
+            if (i == 0)
+                continue;
+
+            CountedNodePtr countedNodePtrNext;
+            countedNodePtrNext.setRank(nodeAddresses[i - 1].rank);
+            countedNodePtrNext.setOffset(nodeAddresses[i - 1].offset);
+            countedNodePtrNext.incExternalCounter();
+            std::memcpy(nodeTails.data() + i * nodeTailWordsNum, &countedNodePtrNext, sizeof(CountedNodePtr));
+        }
+
+        CountedNodePtr newCountedNodePtr;
+        newCountedNodePtr.setRank(nodeAddresses.back().rank);
+        newCountedNodePtr.setOffset(nodeAddresses.back().offset);
+        newCountedNodePtr.incExternalCounter();
+
+        const auto nodesWin = m_nodePool.getWin();
+
+        // Цепочка, кроме ссылки узла 0, записывается один раз и сбрасывается вместе с первой записью узла 0.
+        lockWinTarget(nodesRank, nodesWin, m_epochMode);
+        for (size_t i = 1; i < nodesNum; ++i)
+        {
+            rmaPut(nodeTails.data() + i * nodeTailWordsNum,
+                   static_cast<int>(nodeTailWordsNum),
+                   MPI_UINT64_T,
+                   nodesRank,
+                   countedNodePtrNextOffsets[i],
+                   nodesWin,
+                   m_pCounters.get()
+            );
+        }
+
+        if (m_requestPipelining)
+            MPI_Wait(&headRequest, MPI_STATUS_IGNORE);
+        else
+            resHeadCountedNodePtr = fetchHead(rHead);
+
+        CountedNodePtr oldHeadCountedNodePtr;
+        auto firstNodeTailWordsNum = static_cast<int>(nodeTailWordsNum);
+        bool versionsIncreased{false};
+        do
+        {
+            std::memcpy(nodeTails.data(), &resHeadCountedNodePtr, sizeof(CountedNodePtr));
+            rmaPut(nodeTails.data(),
+                   firstNodeTailWordsNum,
+                   MPI_UINT64_T,
+                   nodesRank,
+                   countedNodePtrNextOffsets.front(),
+                   nodesWin,
+                   m_pCounters.get()
+            );
+            rmaFlush(nodesRank, nodesWin, m_pCounters.get());
+            firstNodeTailWordsNum = 1;
+
+            // Каждый узел цепочки после pop-ов может стать вершиной, поэтому номер публикации растёт у всех.
+            if (!versionsIncreased)
+            {
+                for (const auto &rNodeAddress: nodeAddresses)
+                    startNodeVersionIncrease(rNodeAddress);
+                rmaFlush(nodesRank, nodesWin, m_pCounters.get());
+                versionsIncreased = true;
+            }
+
+            oldHeadCountedNodePtr = resHeadCountedNodePtr;
+            rmaCompareAndSwap(&newCountedNodePtr,
+                              &oldHeadCountedNodePtr,
+                              &resHeadCountedNodePtr,
+                              MPI_UINT64_T,
+                              rHead.rank,
+                              rHead.address,
+                              m_headWin,
+                              m_pCounters.get()
+            );
+            rmaFlush(rHead.rank, m_headWin, m_pCounters.get());
+            countHeadCas(&OperationCounters::pushCasAttempts, &OperationCounters::pushCasFailures,
+                         oldHeadCountedNodePtr, resHeadCountedNodePtr);
+
+            if (resHeadCountedNodePtr != oldHeadCountedNodePtr)
+                runBackoff(backoffCallback);
+        }
+        while (resHeadCountedNodePtr != oldHeadCountedNodePtr);
+        addHeadSize(rHead, static_cast<int64_t>(nodesNum));
+        unlockWinTargetLocal(nodesRank, nodesWin, m_epochMode, m_pCounters.get());
+        unlockWinTargetLocal(rHead.rank, m_headWin, m_epochMode, m_pCounters.get());
+        if (oldHeadCountedNodePtr.isDummy())
+            m_pWaiterTable->notifyWaiters(headIdx);
+
+        m_logger->trace("finished 'pushBulk' of {} values", nodesNum);
+        return nodesNum;
+    }
+
+    template<typename GetDataCallback, typename BackoffCallback>
+    size_t InnerStack::popBulk(size_t valuesNum, GetDataCallback &&getDataCallback, BackoffCallback &&backoffCallback,
+                               size_t headIdx)
+    {
+        return popChain(valuesNum, getDataCallback, nullptr, backoffCallback, headIdx);
+    }
+
+    template<typename BackoffCallback>
+    size_t InnerStack::popBulkInline(void *pPayloads, size_t payloadsNum, BackoffCallback &&backoffCallback,
+                                     size_t headIdx)
+    {
+        return popChain(payloadsNum, nullptr, pPayloads, backoffCallback, headIdx);
+    }
+
+    /*
+     * Проход по списку до CAS безопасен: вершина защищена внешним
+     * счётчиком, указателем опасности или эпохой и не может вернуться
+     * в стек, пока операция не завершена. Поэтому если CAS удался, то
+     * вершина не снималась, и прочитанная за ней цепочка не менялась.
+     * Если CAS не удался, то прочитанные ссылки отбрасываются.
+     */
+    template<typename GetDataCallback, typename BackoffCallback>
+    size_t InnerStack::popChain(size_t valuesNum, GetDataCallback &&getDataCallback, void *pInlinePayloads,
+                                BackoffCallback &&backoffCallback, size_t headIdx)
+    {
+        m_logger->trace("started 'popBulk' of {} values", valuesNum);
+        const auto &rHead = m_heads.at(headIdx);
+        if (valuesNum == 0)
+            return 0;
+
+        const auto scheme                = m_pNodeReclaimer->getScheme();
+        const auto inlinePayloadSize     = pInlinePayloads ? m_nodePool.getInlinePayloadSize() : 0;
+        const auto inlinePayloadWordsNum = getInlinePayloadWordsNum(inlinePayloadSize);
+        const auto nodesWin              = m_nodePool.getWin();
+
+        // Указатели, по которым были достигнуты узлы цепочки, нужны для счётчиков ссылок.
+        std::vector<CountedNodePtr> countedNodePtrs;
+        std::vector<uint64_t> inlinePayloadsWords;
+        CountedNodePtr countedNodePtrNext;
+
+        lockHead(rHead);
+        CountedNodePtr oldHeadCountedNodePtr = fetchHead(rHead);
+        for (;;)
+        {
+            // Пустой стек не требует внешней ссылки, и счётчик указателя на NULL не растёт.
+            if (oldHeadCountedNodePtr.isDummy())
+            {
+                countedNodePtrs.clear();
+                break;
+            }
+            if (scheme == ReclamationScheme::RefCounting)
+                increaseHeadCount(rHead, oldHeadCountedNodePtr);
+
+            const GlobalAddress headAddress = {
+                    oldHeadCountedNodePtr.getOffset(),
+                    oldHeadCountedNodePtr.getRank(),
+                    0
+            };
+            if (isGlobalAddressDummy(headAddress))
+            {
+                countedNodePtrs.clear();
+                break;
+            }
+
+            if (scheme == ReclamationScheme::HazardPointers)
+            {
+                m_pNodeReclaimer->protect(headAddress);
+                auto resHeadCountedNodePtr = fetchHead(rHead);
+                if (resHeadCountedNodePtr != oldHeadCountedNodePtr)
+                {
+                    oldHeadCountedNodePtr = resHeadCountedNodePtr;
+                    continue;
+                }
+            }
+
+            countedNodePtrs.assign(1, oldHeadCountedNodePtr);
+            inlinePayloadsWords.assign(valuesNum * inlinePayloadWordsNum, 0);
+            for (;;)
+            {
+                const auto &rCountedNodePtr = countedNodePtrs.back();
+                const GlobalAddress nodeAddress = {rCountedNodePtr.getOffset(), rCountedNodePtr.getRank(), 0};
+                const auto countedNodePtrNextOffset = MPI_Aint_add(m_nodePool.getNodeAddress(nodeAddress),
+                                                                   sizeof(CountedNodePtr));
+                auto pInlinePayloadWords = pInlinePayloads
+                        ? inlinePayloadsWords.data() + (countedNodePtrs.size() - 1) * inlinePayloadWordsNum
+                        : nullptr;
+
+                MPI_Request dataRequest = MPI_REQUEST_NULL;
+                lockWinTarget(nodeAddress.rank, nodesWin, m_epochMode);
+                fetchCountedNodePtrNext(nodeAddress, countedNodePtrNextOffset, countedNodePtrNext, pInlinePayloadWords,
+                                        dataRequest);
+                unlockWinTargetLocal(nodeAddress.rank, nodesWin, m_epochMode, m_pCounters.get());
+
+                if (countedNodePtrs.size() == valuesNum || countedNodePtrNext.getRank() >= DummyRank)
+                    break;
+                countedNodePtrs.push_back(countedNodePtrNext);
+            }
+
+            /*
+             * Если другие процессы лишь увеличили внешний счётчик вершины,
+             * то вершина не снималась, и CAS повторяется с новым значением
+             * без повторного прохода: ссылка текущего процесса уже учтена
+             * в этом счётчике.
+             */
+            CountedNodePtr resHeadCountedNodePtr;
+            for (;;)
+            {
+                rmaCompareAndSwap(&countedNodePtrNext,
+                                  &oldHeadCountedNodePtr,
+                                  &resHeadCountedNodePtr,
+                                  MPI_UINT64_T,
+                                  rHead.rank,
+                                  rHead.address,
+                                  m_headWin,
+                                  m_pCounters.get()
+                );
+                rmaFlush(rHead.rank, m_headWin, m_pCounters.get());
+                countHeadCas(&OperationCounters::popCasAttempts, &OperationCounters::popCasFailures,
+                             oldHeadCountedNodePtr, resHeadCountedNodePtr);
+                if (resHeadCountedNodePtr == oldHeadCountedNodePtr
+                    || scheme != ReclamationScheme::RefCounting
+                    || resHeadCountedNodePtr.getRank() != oldHeadCountedNodePtr.getRank()
+                    || resHeadCountedNodePtr.getOffset() != oldHeadCountedNodePtr.getOffset())
+                    break;
+                oldHeadCountedNodePtr = resHeadCountedNodePtr;
+            }
+            if (resHeadCountedNodePtr == oldHeadCountedNodePtr)
+            {
+                countedNodePtrs.front() = oldHeadCountedNodePtr;
+                break;
+            }
+
+            if (scheme == ReclamationScheme::RefCounting)
+            {
+                const auto nodeOffset = m_nodePool.getNodeAddress(headAddress);
+                lockWinTarget(headAddress.rank, nodesWin, m_epochMode);
+                addNodeInternalCount(headAddress, nodeOffset, -1);
+                unlockWinTarget(headAddress.rank, nodesWin, m_epochMode, m_pCounters.get());
+            }
+            oldHeadCountedNodePtr = resHeadCountedNodePtr;
+
+            m_logger->trace("started to execute backoff callback");
+            runBackoff(backoffCallback);
+            m_logger->trace("executed backoff callback");
+        }
+
+        // Цепочка отсоединена, и данные узлов читаются вне конкуренции за голову.
+        const auto nodesNum = countedNodePtrs.size();
+        if (nodesNum > 0)
+            addHeadSize(rHead, -static_cast<int64_t>(nodesNum));
+        if (pInlinePayloads)
+        {
+            for (size_t i = 0; i < nodesNum; ++i)
+                std::memcpy(static_cast<std::byte*>(pInlinePayloads) + i * inlinePayloadSize,
+                            inlinePayloadsWords.data() + i * inlinePayloadWordsNum,
+                            inlinePayloadSize);
+        }
+        /*
+         * Данные узлов читаются до того, как узлы освобождаются. Запросы
+         * колбэка при конвейеризации завершаются одним ожиданием.
+         */
+        if constexpr (IsRequestDataCallback<GetDataCallback, size_t, GlobalAddress>)
+        {
+            std::vector<MPI_Request> dataRequests(nodesNum, MPI_REQUEST_NULL);
+            for (size_t i = 0; i < nodesNum; ++i)
+            {
+                getDataCallback(i, GlobalAddress{countedNodePtrs[i].getOffset(), countedNodePtrs[i].getRank(), 0},
+                                dataRequests[i]);
+                if (!m_requestPipelining)
+                    MPI_Wait(&dataRequests[i], MPI_STATUS_IGNORE);
+            }
+            MPI_Waitall(static_cast<int>(nodesNum), dataRequests.data(), MPI_STATUSES_IGNORE);
+        }
+        if (scheme == ReclamationScheme::HazardPointers)
+            m_pNodeReclaimer->clear();
+
+        for (size_t i = 0; i < nodesNum; ++i)
+        {
+            const GlobalAddress nodeAddress = {countedNodePtrs[i].getOffset(), countedNodePtrs[i].getRank(), 0};
+            if constexpr (!IsNoDataCallback<GetDataCallback>
+                          && !IsRequestDataCallback<GetDataCallback, size_t, GlobalAddress>)
+                getDataCallback(i, nodeAddress);
+
+            if (scheme != ReclamationScheme::RefCounting)
+            {
+                m_pNodeReclaimer->retire(nodeAddress, m_nodePool);
+                continue;
+            }
+
+            /*
+             * Внешний счётчик вершины включает ссылку текущего процесса,
+             * а внешние счётчики остальных узлов - только ссылку из
+             * предыдущего узла.
+             */
+            const auto externalCount = static_cast<int32_t>(countedNodePtrs[i].getExternalCounter());
+            const auto nodeOffset = m_nodePool.getNodeAddress(nodeAddress);
+            lockWinTarget(nodeAddress.rank, nodesWin, m_epochMode);
+            addNodeInternalCount(nodeAddress, nodeOffset, externalCount - (i == 0 ? 2 : 1));
+            unlockWinTarget(nodeAddress.rank, nodesWin, m_epochMode, m_pCounters.get());
+        }
+        // Эпоха доступа к голове нужна схеме освобождения памяти.
+        unlockHead(rHead);
+
+        m_logger->trace("finished 'popBulk' of {} values", nodesNum);
+        return nodesNum;
+    }
+
+    template<typename GetDataCallback>
+    bool InnerStack::top(GetDataCallback &&getDataCallback, size_t headIdx)
+    {
+        return peekNode(getDataCallback, nullptr, headIdx, nullptr);
+    }
+
+    template<typename GetDataCallback>
+    bool InnerStack::peekNode(GetDataCallback &&getDataCallback, void *pInlinePayload, size_t headIdx,
+                              NodeStamp *pNodeStamp)
+    {
+        m_logger->trace("started 'top'");
+        const auto &rHead   = m_heads.at(headIdx);
+        const auto nodesWin = m_nodePool.getWin();
+
+        lockWinTarget(rHead.rank, m_headWin, m_epochMode);
+        CountedNodePtr headCountedNodePtr = fetchHead(rHead);
+        bool found{false};
+        while (!headCountedNodePtr.isDummy())
+        {
+            const GlobalAddress nodeAddress = {headCountedNodePtr.getOffset(), headCountedNodePtr.getRank(), 0};
+            if (isGlobalAddressDummy(nodeAddress))
+                break;
+
+            /*
+             * Узел не защищён от освобождения: пока читаются его данные,
+             * его могут снять, вернуть в пул и опубликовать заново с
+             * другими данными, которые прочитаются частично. Поэтому
+             * номер публикации читается до данных, а после них - ещё
+             * раз вместе с головой.
+             */
+            uint64_t inlinePayloadWords[MaxInlinePayloadWordsNum]{};
+            lockWinTarget(nodeAddress.rank, nodesWin, m_epochMode);
+            const auto nodeVersion = fetchNodeVersion(nodeAddress);
+            if (pInlinePayload)
+            {
+                CountedNodePtr countedNodePtrNext;
+                MPI_Request dataRequest = MPI_REQUEST_NULL;
+                const auto countedNodePtrNextOffset = MPI_Aint_add(m_nodePool.getNodeAddress(nodeAddress),
+                                                                   sizeof(CountedNodePtr));
+                fetchCountedNodePtrNext(nodeAddress, countedNodePtrNextOffset, countedNodePtrNext, inlinePayloadWords,
+                                        dataRequest);
+            }
+            unlockWinTargetLocal(nodeAddress.rank, nodesWin, m_epochMode, m_pCounters.get());
+            if constexpr (!IsNoDataCallback<GetDataCallback>)
+                getDataCallback(nodeAddress);
+
+            /*
+             * Сравниваются только адреса: рост внешнего счётчика означает,
+             * что вершину читают другие POP, но не что она снята. Снятие и
+             * повторную публикацию того же узла показывает номер публикации:
+             * PUSH увеличивает его после записи данных и до CAS, поэтому,
+             * если после чтения данных номер не изменился, то данные
+             * принадлежат публикации, которая была вершиной при чтении головы.
+             */
+            const CountedNodePtr resHeadCountedNodePtr = fetchHead(rHead);
+            if (resHeadCountedNodePtr.getRank() == headCountedNodePtr.getRank()
+                && resHeadCountedNodePtr.getOffset() == headCountedNodePtr.getOffset())
+            {
+                lockWinTarget(nodeAddress.rank, nodesWin, m_epochMode);
+                const auto resNodeVersion = fetchNodeVersion(nodeAddress);
+                unlockWinTargetLocal(nodeAddress.rank, nodesWin, m_epochMode, m_pCounters.get());
+                if (resNodeVersion == nodeVersion)
+                {
+                    if (pInlinePayload)
+                        std::memcpy(pInlinePayload, inlinePayloadWords, m_nodePool.getInlinePayloadSize());
+                    if (pNodeStamp)
+                        *pNodeStamp = NodeStamp{nodeAddress, nodeVersion};
+                    found = true;
+                    break;
+                }
+                m_logger->trace("node (rank - {}, offset - {}) was published again in 'top'",
+                                nodeAddress.rank, nodeAddress.offset);
+            }
+            headCountedNodePtr = resHeadCountedNodePtr;
+        }
+        unlockWinTargetLocal(rHead.rank, m_headWin, m_epochMode, m_pCounters.get());
+
+        m_logger->trace("finished 'top'");
+        return found;
+    }
+
+    template<typename BackoffCallback>
+    bool InnerStack::runBackoff(BackoffCallback &backoffCallback)
+    {
+        const double tBeginSec = MPI_Wtime();
+        bool completedByBackoff{false};
+        if constexpr (std::is_void_v<std::invoke_result_t<BackoffCallback&>>)
+            backoffCallback();
+        else
+            completedByBackoff = backoffCallback();
+        ++m_pCounters->backoffCalls;
+        m_pCounters->backoffSec += MPI_Wtime() - tBeginSec;
+        return completedByBackoff;
+    }
+
+    template<typename GetDataCallback, typename BackoffCallback>
+    bool InnerStack::popNode(GetDataCallback &&getDataCallback, void *pInlinePayload, BackoffCallback &&backoffCallback,
+                             size_t headIdx)
+    {
+        m_logger->trace("started 'pop'");
+        startPopPhases();
+
+        const auto &rHead = m_heads.at(headIdx);
+        const bool popped = m_pNodeReclaimer->getScheme() == ReclamationScheme::RefCounting
+                ? popWithRefCounting(getDataCallback, pInlinePayload, backoffCallback, rHead)
+                : popWithReclaimer(getDataCallback, pInlinePayload, backoffCallback, rHead);
+
+        finishPopPhases();
+        m_logger->trace("finished 'pop'");
+        return popped;
+    }
+
+    template<typename GetDataCallback>
+    void InnerStack::readPoppedData(GetDataCallback &getDataCallback, GlobalAddress nodeAddress)
+    {
+        if constexpr (IsRequestDataCallback<GetDataCallback, GlobalAddress>)
+        {
+            if (m_requestPipelining)
+                return;
+
+            MPI_Request dataRequest = MPI_REQUEST_NULL;
+            getDataCallback(nodeAddress, dataRequest);
+            MPI_Wait(&dataRequest, MPI_STATUS_IGNORE);
+        }
+        else
+        {
+            getDataCallback(nodeAddress);
+        }
+        markPopPhase(&PopPhaseTimes::dataRead);
+    }
+
+    template<typename GetDataCallback, typename BackoffCallback>
+    bool InnerStack::popWithRefCounting(GetDataCallback &&getDataCallback, void *pInlinePayload,
+                                        BackoffCallback &&backoffCallback, const Head &rHead)
+    {
+        constexpr bool requestDataCallback = IsRequestDataCallback<GetDataCallback, GlobalAddress>;
+        CountedNodePtr oldHeadCountedNodePtr;
+
+        // Чтение текущей головы односвязного списка.
+        lockHead(rHead);
+        oldHeadCountedNodePtr = fetchHead(rHead);
+
+        {
+            const auto r = oldHeadCountedNodePtr.getRank();
+            const auto o = oldHeadCountedNodePtr.getOffset();
+            const auto e = oldHeadCountedNodePtr.getExternalCounter();
+            m_logger->trace("fetched head (rank - {}, offset - {}, ext_cnt - {}) before loop in 'pop'", r, o, e);
+        }
+        bool popped{false};
+        for (;;)
+        {
+            // Пустой стек не требует внешней ссылки, и счётчик указателя на NULL не растёт.
+            if (oldHeadCountedNodePtr.isDummy())
+            {
+                if constexpr (!requestDataCallback)
+                    getDataCallback({oldHeadCountedNodePtr.getOffset(), oldHeadCountedNodePtr.getRank(), 0});
+                break;
+            }
+            // Увеличение кол-во внешних ссылок на голову на 1.
+            increaseHeadCount(rHead, oldHeadCountedNodePtr);
+            markPopPhase(&PopPhaseTimes::headRead);
+            {
+                const auto r = oldHeadCountedNodePtr.getRank();
+                const auto o = oldHeadCountedNodePtr.getOffset();
+                const auto e = oldHeadCountedNodePtr.getExternalCounter();
+                m_logger->trace("head (rank - {}, offset - {}, ext_cnt - {})) after increaseHeadCount in 'pop'", r, o, e);
+            }
+            GlobalAddress nodeAddress = {
+                    oldHeadCountedNodePtr.getOffset(),
+                    oldHeadCountedNodePtr.getRank(),
+                    0
+            };
+            if (isGlobalAddressDummy(nodeAddress))
+            {
+                /*
+                 * Если глобальный указатель указывает на NULL, то стек пуст,
+                 * и нужно сообщить об этом пользователю, а затем завершить POP.
+                 */
+                if constexpr (!requestDataCallback)
+                    getDataCallback(nodeAddress);
+                break;
+            }
+
+            /*
+             * Получение указателя на следующий за головой списка узел
+             * с последующей заменой головы на этот узел операцией CAS.
+             */
+            CountedNodePtr countedNodePtrNext;
+
+            const auto nodesWin                     = m_nodePool.getWin();
+            const MPI_Aint nodeOffset               = m_nodePool.getNodeAddress(nodeAddress);
+            const MPI_Aint countedNodePtrNextOffset = MPI_Aint_add(nodeOffset, sizeof(CountedNodePtr));
+
+            uint64_t inlinePayloadWords[MaxInlinePayloadWordsNum]{};
+
+            // Узел защищён внешним счётчиком, поэтому его данные можно читать до CAS вместе со ссылкой.
+            MPI_Request dataRequest = MPI_REQUEST_NULL;
+            if constexpr (requestDataCallback)
+            {
+                if (m_requestPipelining)
+                    getDataCallback(nodeAddress, dataRequest);
+            }
+
+            lockWinTarget(nodeAddress.rank, nodesWin, m_epochMode);
+            fetchCountedNodePtrNext(nodeAddress, countedNodePtrNextOffset, countedNodePtrNext,
+                                    pInlinePayload ? inlinePayloadWords : nullptr, dataRequest);
+            markPopPhase(&PopPhaseTimes::nextRead);
+
+            {
+                const auto r = countedNodePtrNext.getRank();
+                const auto o = countedNodePtrNext.getOffset();
+                const auto e = countedNodePtrNext.getExternalCounter();
+                m_logger->trace("ptr->next (rank - {}, offset - {}, ext_cnt - {})) in 'pop'", r, o, e);
+            }
+
+            CountedNodePtr resHeadCountedNodePtr;
+
+            rmaCompareAndSwap(&countedNodePtrNext,
+                              &oldHeadCountedNodePtr,
+                              &resHeadCountedNodePtr,
+                              MPI_UINT64_T,
+                              rHead.rank,
+                              rHead.address,
+                              m_headWin,
+                              m_pCounters.get()
+            );
+            rmaFlush(rHead.rank, m_headWin, m_pCounters.get());
+            countHeadCas(&OperationCounters::popCasAttempts, &OperationCounters::popCasFailures,
+                         oldHeadCountedNodePtr, resHeadCountedNodePtr);
+            markPopPhase(&PopPhaseTimes::headCas);
+
+            if (resHeadCountedNodePtr == oldHeadCountedNodePtr)
+            {
+                addHeadSize(rHead, -1);
+                if (pInlinePayload)
+                    std::memcpy(pInlinePayload, inlinePayloadWords, m_nodePool.getInlinePayloadSize());
+                readPoppedData(getDataCallback, nodeAddress);
+
+                // Атомарное уменьшение внутреннего счётчика на кол-во внешних ссылок минус 2.
+                const auto externalCount = static_cast<int32_t>(oldHeadCountedNodePtr.getExternalCounter());
+                addNodeInternalCount(nodeAddress, nodeOffset, externalCount - 2);
+
+                popped = true;
+            }
+            else
+            {
+                // Атомарное уменьшение внутреннего счётчика на 1.
+                addNodeInternalCount(nodeAddress, nodeOffset, -1);
+            }
+            unlockWinTarget(nodeAddress.rank, nodesWin, m_epochMode, m_pCounters.get());
+            markPopPhase(&PopPhaseTimes::nodeRelease);
+
+            if (popped)
+                break;
+
+            m_logger->trace("started to execute backoff callback");
+            const bool completedByBackoff = runBackoff(backoffCallback);
+            m_logger->trace("executed backoff callback");
+            markPopPhase(&PopPhaseTimes::backoff);
+            if (completedByBackoff)
+                break;
+        }
+        unlockHead(rHead);
+        return popped;
+    }
+
+    /*
+     * Снятие вершины без счётчиков ссылок. Узел не может быть
+     * переиспользован, пока он защищён указателем опасности или
+     * не наступила коллективная точка освобождения, поэтому
+     * голова заменяется единственной операцией CAS, а при неудаче
+     * её результат сразу становится новой ожидаемой головой.
+     */
+    template<typename GetDataCallback, typename BackoffCallback>
+    bool InnerStack::popWithReclaimer(GetDataCallback &&getDataCallback, void *pInlinePayload,
+                                      BackoffCallback &&backoffCallback, const Head &rHead)
+    {
+        constexpr bool requestDataCallback = IsRequestDataCallback<GetDataCallback, GlobalAddress>;
+        const bool hazardPointers = m_pNodeReclaimer->getScheme() == ReclamationScheme::HazardPointers;
+
+        lockHead(rHead);
+        CountedNodePtr oldHeadCountedNodePtr = fetchHead(rHead);
+
+        bool popped{false};
+        for (;;)
+        {
+            GlobalAddress nodeAddress = {
+                    oldHeadCountedNodePtr.getOffset(),
+                    oldHeadCountedNodePtr.getRank(),
+                    0
+            };
+            if (isGlobalAddressDummy(nodeAddress))
+            {
+                if constexpr (!requestDataCallback)
+                    getDataCallback(nodeAddress);
+                break;
+            }
+
+            if (hazardPointers)
+            {
+                // Голова перечитывается, чтобы убедиться, что узел не был снят до публикации указателя опасности.
+                m_pNodeReclaimer->protect(nodeAddress);
+
+                auto resHeadCountedNodePtr = fetchHead(rHead);
+                if (resHeadCountedNodePtr != oldHeadCountedNodePtr)
+                {
+                    oldHeadCountedNodePtr = resHeadCountedNodePtr;
+                    continue;
+                }
+            }
+            markPopPhase(&PopPhaseTimes::headRead);
+
+            CountedNodePtr countedNodePtrNext;
+
+            const auto nodesWin                     = m_nodePool.getWin();
+            const MPI_Aint countedNodePtrNextOffset = MPI_Aint_add(m_nodePool.getNodeAddress(nodeAddress),
+                                                                   sizeof(CountedNodePtr));
+
+            uint64_t inlinePayloadWords[MaxInlinePayloadWordsNum]{};
+
+            MPI_Request dataRequest = MPI_REQUEST_NULL;
+            if constexpr (requestDataCallback)
+            {
+                if (m_requestPipelining)
+                    getDataCallback(nodeAddress, dataRequest);
+            }
+
+            lockWinTarget(nodeAddress.rank, nodesWin, m_epochMode);
+            fetchCountedNodePtrNext(nodeAddress, countedNodePtrNextOffset, countedNodePtrNext,
+                                    pInlinePayload ? inlinePayloadWords : nullptr, dataRequest);
+            markPopPhase(&PopPhaseTimes::nextRead);
+
+            CountedNodePtr resHeadCountedNodePtr;
+            rmaCompareAndSwap(&countedNodePtrNext,
+                              &oldHeadCountedNodePtr,
+                              &resHeadCountedNodePtr,
+                              MPI_UINT64_T,
+                              rHead.rank,
+                              rHead.address,
+                              m_headWin,
+                              m_pCounters.get()
+            );
+            rmaFlush(rHead.rank, m_headWin, m_pCounters.get());
+            countHeadCas(&OperationCounters::popCasAttempts, &OperationCounters::popCasFailures,
+                         oldHeadCountedNodePtr, resHeadCountedNodePtr);
+            markPopPhase(&PopPhaseTimes::headCas);
+
+            if (resHeadCountedNodePtr == oldHeadCountedNodePtr)
+            {
+                addHeadSize(rHead, -1);
+                if (pInlinePayload)
+                    std::memcpy(pInlinePayload, inlinePayloadWords, m_nodePool.getInlinePayloadSize());
+                readPoppedData(getDataCallback, nodeAddress);
+                unlockWinTargetLocal(nodeAddress.rank, nodesWin, m_epochMode, m_pCounters.get());
+
+                m_pNodeReclaimer->clear();
+                m_pNodeReclaimer->retire(nodeAddress, m_nodePool);
+                markPopPhase(&PopPhaseTimes::nodeRelease);
+                popped = true;
+                break;
+            }
+            unlockWinTargetLocal(nodeAddress.rank, nodesWin, m_epochMode, m_pCounters.get());
+            oldHeadCountedNodePtr = resHeadCountedNodePtr;
+
+            m_logger->trace("started to execute backoff callback");
+            const bool completedByBackoff = runBackoff(backoffCallback);
+            m_logger->trace("executed backoff callback");
+            markPopPhase(&PopPhaseTimes::backoff);
+            if (completedByBackoff)
+            {
+                m_pNodeReclaimer->clear();
+                break;
+            }
+        }
+        unlockHead(rHead);
+        return popped;
+    }
     } // ref_counting
 
 #endif //SOURCES_INNERSTACK_H
@@ -8,6 +8,7 @@
 #include "ref_counting.h"
 #include "CountedNodePtr.h"
 
+#include <cstddef>
 #include <cstdint>
 
 namespace rma_stack::ref_counting
@@ -25,6 +26,18 @@ namespace rma_stack::ref_counting
      * а обыкновенной записью в ячейку памяти с приведением типа.
      * Чаще всего модифицируются эти поля операциями односторонней
      * коммуникации.
+     *
+     * Небольшие данные пользователя могут храниться в самом узле:
+     * тогда пул выделяет узлы с шагом sizeof(Node) + размер данных,
+     * округлённый до 8 байт, и данные располагаются сразу за
+     * m_countedNodePtrNext. Это позволяет записать данные и ссылку
+     * на следующий узел одной операцией MPI_Put, а прочитать одной
+     * операцией MPI_Get_accumulate.
+     *
+     * Номер публикации узла увеличивается каждым PUSH после записи
+     * данных и до CAS над головой, поэтому по нему чтение вершины
+     * без счётчиков ссылок (InnerStack::top) узнаёт, что узел за время
+     * чтения был снят, переиспользован и опубликован заново.
      */
     class Node
     {
@@ -35,13 +48,34 @@ namespace rma_stack::ref_counting
 
     private:
         // Первые 8 байт.
-        uint32_t m_acquired : 1; // 0 - узел свободен, 1 - узел занят.
-        uint32_t m_reserved : 32 - 1; // Выравнивание данных.
+        uint32_t m_version; // Номер публикации узла.
         int32_t m_internalCounter; // Внутренний счётчик ссылок
 
         // Вторые 8 байт.
         CountedNodePtr m_countedNodePtrNext;
     };
+
+    // Узел вершины и номер его публикации, которые прочитал InnerStack::top.
+    struct NodeStamp
+    {
+        GlobalAddress address{0, DummyRank, 0};
+        uint32_t version{0};
+    };
+
+    inline bool operator==(const NodeStamp &rLhs, const NodeStamp &rRhs)
+    {
+        return rLhs.address.rank == rRhs.address.rank && rLhs.address.offset == rRhs.address.offset
+               && rLhs.version == rRhs.version;
+    }
+
+    // Наибольший размер данных пользователя, которые могут храниться в узле.
+    constexpr size_t MaxInlinePayloadSize = 16;
+    constexpr size_t MaxInlinePayloadWordsNum = MaxInlinePayloadSize / sizeof(uint64_t);
+
+    constexpr size_t getInlinePayloadWordsNum(size_t inlinePayloadSize)
+    {
+        return (inlinePayloadSize + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    }
 } // rma_stack
 
 #endif //SOURCES_NODE_H
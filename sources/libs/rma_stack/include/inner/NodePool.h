@@ -0,0 +1,225 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_NODEPOOL_H
+#define SOURCES_NODEPOOL_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mpi.h>
+#include <spdlog/spdlog.h>
+
+#include "ref_counting.h"
+#include "Node.h"
+#include "OperationCounters.h"
+#include "SegmentedArena.h"
+#include "WinEpoch.h"
+
+namespace rma_stack::ref_counting
+{
+    // Смещение, обозначающее конец списка свободных узлов.
+    constexpr uint64_t DummyOffset = DefaultBitLayout::MaxOffset;
+
+    /*
+     * Голова списка свободных узлов. Каждое успешное изменение
+     * головы увеличивает метку, чтобы операция CAS не приняла
+     * узел, который был выдан и возвращён обратно между чтением
+     * головы и CAS (проблема ABA).
+     */
+    struct FreeNodeListHead
+    {
+        uint64_t offset : OffsetBitsLimit;
+        uint64_t tag    : 64 - OffsetBitsLimit;
+    };
+
+    /*
+     * Служебные данные пула узлов, которые хранятся у владельца
+     * пула в том же окне, что и массив узлов. В централизованном
+     * режиме сразу за заголовком располагается битовая карта
+     * занятости узлов (1 бит на узел, 1 - узел занят), в
+     * децентрализованном - кольцо удалённо освобождённых узлов.
+     */
+    struct NodePoolHeader
+    {
+        FreeNodeListHead freeNodeListHead;
+        // Поля ниже используются только в централизованном режиме и читаются одной операцией.
+        int64_t freeNodesCount;
+        int64_t growRequestsCount; // Запросы роста пула от процессов, которые не нашли свободный узел.
+        int64_t nodesNum; // Кол-во узлов в уже выделенных сегментах.
+    };
+
+    constexpr size_t OccupancyWordBitsNum = 64;
+    // Кол-во ячеек кольца удалённо освобождённых узлов.
+    constexpr size_t RemoteFreeRingSlotsNum = 256;
+    // Кол-во ячеек кольца, которые проверяются перед прямым освобождением узла.
+    constexpr size_t RemoteFreeRingProbesNum = 4;
+    // Кол-во повторных попыток выделения узла после запроса роста централизованного пула и задержки между ними.
+    constexpr size_t GrowRequestRetriesNum = 1000;
+    constexpr std::chrono::microseconds GrowRequestMinDelay{1};
+    constexpr std::chrono::microseconds GrowRequestMaxDelay{1000};
+
+    /*
+     * Пул узлов односвязного списка.
+     *
+     * В децентрализованном режиме свободные узлы каждого процесса
+     * образуют неблокирующий стек индексов. Ссылка на следующий
+     * свободный узел хранится в поле m_countedNodePtrNext свободного
+     * узла, поэтому выделение и освобождение узла требуют O(1)
+     * операций односторонней коммуникации независимо от
+     * заполненности пула.
+     *
+     * Узлы, которые освобождаются не их владельцем, сначала попадают
+     * в кольцо владельца: процесс записывает offset + 1 в пустую ячейку
+     * одной операцией CAS, начиная со своей позиции в кольце. Владелец
+     * забирает все узлы из кольца одной цепочкой, когда его стек
+     * свободных узлов пуст. Если кольцо заполнено, то узел
+     * освобождается напрямую.
+     *
+     * В централизованном режиме все процессы выделяют узлы у
+     * HEAD_RANK, и единственная голова стека свободных узлов стала бы
+     * ещё одной точкой конкуренции. Поэтому там используется битовая
+     * карта занятости: узел захватывается одной операцией MPI_BOR над
+     * 64-битным словом карты, а каждый процесс начинает поиск со
+     * своего слова. Счётчик свободных узлов позволяет за O(1)
+     * определить, что пул заполнен.
+     *
+     * Узлы хранятся в сегментированном массиве (SegmentedArena).
+     * Сначала выделяется один сегмент, следующие выделяются владельцем
+     * пула, когда он не находит свободный узел, пока не будет
+     * достигнут предел elemsUpLimit. В централизованном режиме узлы
+     * выделяют все процессы, а сегменты может присоединить к окну
+     * только HEAD_RANK. Поэтому процесс, который не нашёл свободный
+     * узел, увеличивает счётчик запросов роста в заголовке пула и
+     * повторяет выделение с растущей задержкой. HEAD_RANK проверяет
+     * запросы при каждом своём выделении узла и в serviceGrowRequests:
+     * он выделяет следующий сегмент, публикует его в таблице сегментов
+     * и только затем освобождает биты его узлов в карте. Если HEAD_RANK
+     * не обслужил запрос за GrowRequestRetriesNum попыток, то
+     * acquireNode возвращает пустой адрес.
+     *
+     * Если t_inlinePayloadSize больше нуля, то за каждым узлом
+     * резервируется место под данные пользователя, см. Node.
+     *
+     * Пробы выделения и вызовы releaseNode учитываются в t_rCounters,
+     * см. OperationCounters.
+     */
+    class NodePool
+    {
+    public:
+        NodePool(MPI_Comm comm, MPI_Info info, bool t_centralized, int t_headRank, size_t t_elemsUpLimit,
+                 size_t t_segmentCapacity, size_t t_inlinePayloadSize, EpochMode t_epochMode,
+                 OperationCounters &t_rCounters, std::shared_ptr<spdlog::logger> t_logger);
+
+        /*
+         * Функции выделения и освобождения узла используют окно узлов,
+         * поэтому для releaseNode эпоха доступа к процессу-владельцу
+         * узла должна быть уже открыта.
+         */
+        [[nodiscard]] GlobalAddress acquireNode(int rank);
+        void releaseNode(GlobalAddress nodeAddress);
+        /*
+         * Рост централизованного пула по запросам других процессов.
+         * Выполняется только HEAD_RANK, на остальных процессах и в
+         * децентрализованном режиме ничего не делает. Возвращает true,
+         * если пул вырос.
+         */
+        bool serviceGrowRequests();
+
+        [[nodiscard]] MPI_Aint getNodeAddress(GlobalAddress nodeAddress) const;
+        // Размер узла вместе с данными пользователя, которые хранятся в нём.
+        [[nodiscard]] size_t getNodeSize() const;
+        [[nodiscard]] size_t getInlinePayloadSize() const;
+        [[nodiscard]] MPI_Win getWin() const;
+        // Режим эпох доступа к окну узлов, постоянная эпоха открыта с момента создания окна.
+        [[nodiscard]] EpochMode getEpochMode() const;
+        [[nodiscard]] size_t getElemsUpLimit() const;
+        [[nodiscard]] size_t getSegmentCapacity() const;
+
+        /*
+         * Функция вызывается после выделения нового сегмента узлов,
+         * но до того, как его узлы станут доступны другим процессам.
+         * Используется для выделения соответствующего сегмента данных
+         * пользователя. В централизованном режиме функция вызывается
+         * только у HEAD_RANK.
+         */
+        void setSegmentGrowthCallback(std::function<void(size_t)> t_segmentGrowthCallback);
+        void release();
+
+    private:
+        bool grow();
+        void initSegmentNodes(std::byte* pSegment, size_t segmentIdx);
+        void publishSegmentToFreeList(size_t segmentIdx);
+        void publishSegmentToBitmap(size_t segmentIdx);
+        /*
+         * Запрос роста централизованного пула после неудачного выделения.
+         * Возвращает false, если пул достиг предела и не вырос с прошлой проверки.
+         */
+        bool requestGrowth(int rank);
+        [[nodiscard]] GlobalAddress acquireNodeWithGrowRequests(int rank);
+        // Поля заголовка централизованного пула, которые читаются одной операцией.
+        struct HeaderCounters
+        {
+            int64_t freeNodesCount;
+            int64_t growRequestsCount;
+            int64_t nodesNum;
+        };
+        [[nodiscard]] HeaderCounters fetchHeaderCounters(int rank);
+
+        [[nodiscard]] GlobalAddress acquireNodeFromFreeList(int rank);
+        [[nodiscard]] GlobalAddress acquireNodeFromBitmap(int rank);
+        void releaseNodeToFreeList(GlobalAddress nodeAddress);
+        [[nodiscard]] bool releaseNodeToRemoteFreeRing(GlobalAddress nodeAddress);
+        // Возвращает false, если кольцо текущего процесса пусто.
+        bool drainRemoteFreeRing();
+        void pushChainToFreeList(int rank, uint64_t firstOffset, uint64_t lastOffset);
+        void releaseNodeToBitmap(GlobalAddress nodeAddress);
+
+        void initRemoteAccessMemory(MPI_Comm comm, MPI_Info info);
+        [[nodiscard]] int getOwnerIdx(int rank) const;
+        [[nodiscard]] MPI_Aint getFreeNodeListHeadAddress(int rank) const;
+        [[nodiscard]] MPI_Aint getFreeNodesCountAddress(int rank) const;
+        [[nodiscard]] MPI_Aint getGrowRequestsCountAddress(int rank) const;
+        [[nodiscard]] MPI_Aint getOccupancyWordAddress(int rank, size_t wordIdx) const;
+        [[nodiscard]] MPI_Aint getRemoteFreeSlotAddress(int rank, size_t slotIdx) const;
+        [[nodiscard]] size_t getOccupancyWordsNum() const;
+        // Кол-во слов карты, которые покрывают узлы известных текущему процессу сегментов.
+        [[nodiscard]] size_t getKnownOccupancyWordsNum() const;
+        void updateKnownNodesNum(size_t nodesNum);
+        [[nodiscard]] bool isOwner() const;
+
+    private:
+        size_t m_elemsUpLimit{0};
+        size_t m_segmentCapacity{0};
+        size_t m_inlinePayloadSize{0};
+        size_t m_nodeSize{sizeof(Node)};
+        int m_rank{-1};
+        int m_headRank{0};
+        bool m_centralized;
+        EpochMode m_epochMode{EpochMode::Persistent};
+
+        MPI_Win m_nodesWin{MPI_WIN_NULL};
+        std::unique_ptr<SegmentedArena> m_pNodesArena;
+        NodePoolHeader* m_pHeader{nullptr};
+        std::unique_ptr<MPI_Aint[]> m_pHeaderAddresses;
+        std::function<void(size_t)> m_segmentGrowthCallback;
+
+        // Слово битовой карты, с которого начинается поиск, и его последнее известное значение.
+        size_t m_occupancyHintWordIdx{0};
+        uint64_t m_cachedOccupancyWord{0};
+        // Последнее известное кол-во узлов централизованного пула.
+        size_t m_knownNodesNum{0};
+        // Позиции текущего процесса в кольцах других процессов.
+        std::unique_ptr<size_t[]> m_pRemoteFreeRingCursors;
+        // Буферы для чтения кольца текущего процесса и связывания забранных из него узлов.
+        std::unique_ptr<uint64_t[]> m_pRemoteFreeSlots;
+        std::unique_ptr<CountedNodePtr[]> m_pRemoteFreeLinks;
+
+        OperationCounters &m_rCounters;
+        std::shared_ptr<spdlog::logger> m_logger;
+    };
+} // ref_counting
+
+#endif //SOURCES_NODEPOOL_H
@@ -0,0 +1,99 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_NODERECLAIMER_H
+#define SOURCES_NODERECLAIMER_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include <mpi.h>
+#include <spdlog/spdlog.h>
+
+#include "ref_counting.h"
+#include "NodePool.h"
+#include "OperationCounters.h"
+
+namespace rma_stack::ref_counting
+{
+    /*
+     * Схема освобождения памяти узлов, снятых со стека.
+     *
+     * RefCounting - раздельный подсчёт ссылок: внешний счётчик в голове
+     * и внутренний счётчик в узле. Узел освобождается сразу, но каждая
+     * операция POP увеличивает внешний счётчик головы операцией CAS.
+     *
+     * HazardPointers - указатели опасности. Перед чтением узла процесс
+     * публикует его адрес в своей ячейке у HEAD_RANK. Снятый узел
+     * откладывается и освобождается, когда его нет ни в одной ячейке.
+     *
+     * Epochs - освобождение в состоянии покоя. Снятые узлы копятся до
+     * коллективной точки (reclaim), в которой ни один процесс не
+     * выполняет операции со стеком, и освобождаются все сразу.
+     */
+    enum class ReclamationScheme
+    {
+        RefCounting,
+        HazardPointers,
+        Epochs
+    };
+
+    std::string_view getReclamationSchemeName(ReclamationScheme scheme);
+
+    // Отложенные узлы сканируются, когда их больше, чем HazardScanFactor * кол-во процессов.
+    constexpr size_t HazardScanFactor = 2;
+
+    /*
+     * Отложенное освобождение узлов для схем HazardPointers и Epochs.
+     * Ячейки указателей опасности всех процессов хранятся у HEAD_RANK
+     * в окне головы, поэтому protect, clear и retire вызываются при
+     * открытой эпохе доступа к HEAD_RANK в этом окне, а эпоха доступа
+     * к окну узлов при этом должна быть закрыта.
+     */
+    class NodeReclaimer
+    {
+    public:
+        NodeReclaimer(MPI_Comm comm, MPI_Win t_headWin, int t_headRank, ReclamationScheme t_scheme,
+                      OperationCounters &t_rCounters, std::shared_ptr<spdlog::logger> t_logger);
+
+        void protect(GlobalAddress nodeAddress);
+        void clear();
+        void retire(GlobalAddress nodeAddress, NodePool& rNodePool);
+        /*
+         * Коллективная функция. Освобождает все отложенные узлы, поэтому
+         * вызывается, когда ни один процесс не выполняет операции со стеком.
+         */
+        void reclaim(NodePool& rNodePool);
+
+        [[nodiscard]] ReclamationScheme getScheme() const;
+        [[nodiscard]] size_t getRetiredNodesNum() const;
+        // Объём служебных данных схемы у текущего процесса в байтах, не считая отложенных узлов.
+        [[nodiscard]] size_t getMetadataSize() const;
+        void release();
+
+    private:
+        void scanHazards(NodePool& rNodePool);
+        void releaseNodes(const std::vector<GlobalAddress>& rNodeAddresses, NodePool& rNodePool);
+        [[nodiscard]] MPI_Aint getHazardAddress(int rank) const;
+
+    private:
+        MPI_Comm m_comm{MPI_COMM_NULL};
+        MPI_Win m_headWin{MPI_WIN_NULL};
+        int m_rank{-1};
+        int m_procNum{0};
+        int m_headRank{0};
+        ReclamationScheme m_scheme;
+
+        GlobalAddress* m_pHazards{nullptr};
+        MPI_Aint m_hazardsAddress{(MPI_Aint)MPI_BOTTOM};
+        std::unique_ptr<GlobalAddress[]> m_pHazardsSnapshot;
+        std::vector<GlobalAddress> m_retiredNodes;
+
+        OperationCounters &m_rCounters;
+        std::shared_ptr<spdlog::logger> m_logger;
+    };
+} // ref_counting
+
+#endif //SOURCES_NODERECLAIMER_H
@@ -0,0 +1,124 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_OPERATIONCOUNTERS_H
+#define SOURCES_OPERATIONCOUNTERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <mpi.h>
+
+namespace rma_stack::ref_counting
+{
+    /*
+     * Суммарное время этапов операций POP в секундах, см.
+     * InnerStack::setPhaseTimingEnabled. Этапы, которые при
+     * конвейеризации выполняются вместе, учитываются в первом из них.
+     */
+    struct PopPhaseTimes
+    {
+        double headRead{0};    // чтение головы и увеличение её внешнего счётчика
+        double nextRead{0};    // чтение ссылки на следующий узел, при конвейеризации - вместе с данными
+        double headCas{0};     // замена головы операцией CAS
+        double dataRead{0};    // чтение данных снятого узла
+        double nodeRelease{0}; // уменьшение внутреннего счётчика или отложенное освобождение узла
+        double backoff{0};     // колбэк после неудачной операции CAS
+        size_t popsNum{0};
+    };
+
+    // Суммарное время этапов операций PUSH в секундах, см. PopPhaseTimes.
+    struct PushPhaseTimes
+    {
+        double nodeAcquire{0}; // выделение узла из пула
+        double dataPut{0};     // запись данных, при конвейеризации - вместе с чтением головы
+        double linkCas{0};     // запись ссылки на следующий узел и замена головы операцией CAS
+        double backoff{0};     // колбэк после неудачной операции CAS
+        double finish{0};      // счётчик значений, возврат неопубликованного узла и уведомление ожидающих
+        size_t pushesNum{0};
+    };
+
+    // Операции RMA текущего процесса над одним процессом окна.
+    struct RmaTargetCounters
+    {
+        uint64_t opsNum{0};
+        // Объём данных, переданных в обе стороны, в байтах.
+        uint64_t bytesNum{0};
+        // Завершения операций: MPI_Win_flush, MPI_Win_flush_local и MPI_Win_unlock.
+        uint64_t flushesNum{0};
+    };
+
+    /*
+     * Счётчики операций стека у текущего процесса. Счётчики ведутся
+     * всегда, их стоимость - несколько инкрементов на операцию.
+     *
+     * Операции CAS над головой считаются отдельно для PUSH, POP и
+     * увеличения внешнего счётчика головы (increaseHeadCount), неудачной
+     * считается CAS, которая вернула не ожидаемую голову. Пробы выделения
+     * узла - операции, которые пытаются захватить узел (MPI_BOR над словом
+     * битовой карты или CAS над головой списка свободных узлов), и чтения
+     * при последовательном просмотре (следующее слово карты или ссылка на
+     * следующий свободный узел).
+     *
+     * Операции RMA считаются по номеру целевого процесса обёртками из
+     * RmaOperations.h, а завершения операций - ими же и функциями
+     * закрытия эпох доступа из WinEpoch.h, поэтому каждый вызов MPI
+     * учитывается один раз и так, как он был выполнен. Учитываются
+     * операции над окнами головы и узлов (InnerStack, NodePool,
+     * NodeReclaimer, WaiterTable, AsyncOperationEngine), над окнами
+     * данных внешних стеков и над ареной PayloadArena, если ей переданы
+     * счётчики. Служебные операции таблицы сегментов (SegmentedArena) не
+     * учитываются.
+     * rmaTargets имеет размер коммуникатора стека с его создания.
+     */
+    struct OperationCounters
+    {
+        uint64_t pushCasAttempts{0};
+        uint64_t pushCasFailures{0};
+        uint64_t popCasAttempts{0};
+        uint64_t popCasFailures{0};
+        uint64_t headCountCasAttempts{0};
+        uint64_t headCountCasFailures{0};
+        uint64_t acquireClaimProbes{0};
+        uint64_t acquireScanProbes{0};
+        uint64_t releaseNodeCalls{0};
+        uint64_t backoffCalls{0};
+        double backoffSec{0};
+        std::vector<RmaTargetCounters> rmaTargets;
+
+        void reset();
+        /*
+         * Складывает счётчики всех процессов comm в счётчиках процесса
+         * root. Счётчики RMA складываются по целевому процессу, поэтому у
+         * root они показывают нагрузку на каждый процесс. Коллективная
+         * функция, счётчики остальных процессов не меняются.
+         */
+        void reduce(MPI_Comm comm, int root);
+        [[nodiscard]] RmaTargetCounters getRmaTotal() const;
+    };
+
+    // Складывают время этапов всех процессов comm у процесса root. Коллективные функции.
+    void reducePhaseTimes(PopPhaseTimes &rPhaseTimes, MPI_Comm comm, int root);
+    void reducePhaseTimes(PushPhaseTimes &rPhaseTimes, MPI_Comm comm, int root);
+
+    /*
+     * Учёт операции RMA над процессом rank. bytesNum - объём данных,
+     * переданных в обе стороны: у CAS это новое, ожидаемое и прежнее
+     * значения, у MPI_Fetch_and_op с MPI_NO_OP - только прочитанное.
+     */
+    inline void countRmaOp(OperationCounters &rCounters, int rank, size_t bytesNum)
+    {
+        auto &rTargetCounters = rCounters.rmaTargets[rank];
+        ++rTargetCounters.opsNum;
+        rTargetCounters.bytesNum += bytesNum;
+    }
+
+    // Учёт завершения операций с процессом rank: MPI_Win_flush, MPI_Win_flush_local или MPI_Win_unlock.
+    inline void countRmaFlush(OperationCounters &rCounters, int rank)
+    {
+        ++rCounters.rmaTargets[rank].flushesNum;
+    }
+} // ref_counting
+
+#endif //SOURCES_OPERATIONCOUNTERS_H
@@ -0,0 +1,120 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_PAYLOADARENA_H
+#define SOURCES_PAYLOADARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+#include <mpi.h>
+#include <spdlog/spdlog.h>
+
+#include "OperationCounters.h"
+#include "WinEpoch.h"
+
+namespace rma_stack::ref_counting
+{
+    // Размер блока наименьшего класса.
+    constexpr size_t MinPayloadBlockSize = 64;
+    // Размер первого фрагмента памяти класса, каждый следующий фрагмент класса вдвое больше.
+    constexpr size_t PayloadChunkSize = 64 * 1024;
+    constexpr size_t PayloadChunkSizeUpLimit = 4 * 1024 * 1024;
+    // Наибольший размер данных по умолчанию.
+    constexpr size_t DefaultMaxPayloadSize = 64 * 1024;
+
+    /*
+     * Ссылка на блок данных переменной длины. Ссылка тривиально
+     * копируема и помещается в узел, поэтому стек передаёт её так же,
+     * как небольшие данные (см. InnerStack::pushInline). Нулевой адрес
+     * обозначает пустую ссылку.
+     */
+    struct PayloadRef
+    {
+        uint64_t address{0};
+        uint32_t rank{0};
+        uint32_t size{0};
+    };
+
+    [[nodiscard]] inline bool isPayloadRefEmpty(const PayloadRef &rPayloadRef)
+    {
+        return rPayloadRef.address == 0;
+    }
+
+    /*
+     * Память данных переменной длины, которая разбита на классы блоков
+     * размера MinPayloadBlockSize * 2^k. Каждый процесс выделяет блоки
+     * только в своей памяти: данные записываются в блок локально, а
+     * другие процессы читают их одной операцией MPI_Get. Фрагменты
+     * памяти класса выделяются и присоединяются к окну по мере
+     * необходимости, поэтому объём памяти определяется размерами
+     * хранимых данных, а не пределом кол-ва элементов стека.
+     *
+     * Свободные блоки своего процесса хранятся в локальных списках.
+     * Блок, который освобождает другой процесс, добавляется в список
+     * удалённо освобождённых блоков его класса у владельца: ссылка на
+     * следующий блок записывается в сам блок, а голова списка заменяется
+     * операцией CAS. Владелец забирает весь список одной атомарной
+     * заменой головы, когда локальный список класса пуст. Так как из
+     * списка блоки только забираются целиком, проблемы ABA нет.
+     */
+    class PayloadArena
+    {
+    public:
+        // Операции RMA учитываются в t_pCounters, если он задан.
+        PayloadArena(MPI_Comm comm, MPI_Info info, size_t t_maxPayloadSize, EpochMode t_epochMode,
+                     std::shared_ptr<spdlog::logger> t_logger, OperationCounters *t_pCounters = nullptr);
+
+        // Выделяет блок текущего процесса, std::overflow_error - если size больше наибольшего размера.
+        [[nodiscard]] PayloadRef allocate(size_t size);
+        // Адрес блока текущего процесса в его памяти.
+        [[nodiscard]] std::byte* getLocalBlock(const PayloadRef &rPayloadRef) const;
+        /*
+         * Делает записанные в блоки текущего процесса данные видимыми для
+         * операций RMA других процессов. Вызывается до публикации ссылок.
+         */
+        void publishLocalBlocks();
+        // Чтение данных блока в pBuffer, данные своего процесса копируются без MPI.
+        void read(const PayloadRef &rPayloadRef, std::byte *pBuffer);
+        void deallocate(const PayloadRef &rPayloadRef);
+
+        [[nodiscard]] size_t getMaxPayloadSize() const;
+        // Объём памяти фрагментов текущего процесса в байтах.
+        [[nodiscard]] size_t getAllocatedSize() const;
+        [[nodiscard]] MPI_Win getWin() const;
+        void release();
+
+    private:
+        [[nodiscard]] size_t getSizeClassIdx(size_t size) const;
+        [[nodiscard]] static size_t getBlockSize(size_t sizeClassIdx);
+        [[nodiscard]] MPI_Aint getRemoteFreeListHeadAddress(int rank, size_t sizeClassIdx) const;
+        // Возвращает false, если список удалённо освобождённых блоков класса пуст.
+        bool drainRemoteFreeList(size_t sizeClassIdx);
+        void grow(size_t sizeClassIdx);
+
+    private:
+        MPI_Win m_win{MPI_WIN_NULL};
+        EpochMode m_epochMode{EpochMode::Persistent};
+        int m_rank{-1};
+        size_t m_maxPayloadSize{0};
+        size_t m_sizeClassesNum{0};
+
+        // Головы списков удалённо освобождённых блоков по классам.
+        uint64_t* m_pRemoteFreeListHeads{nullptr};
+        std::unique_ptr<MPI_Aint[]> m_pRemoteFreeListHeadsAddresses;
+
+        std::vector<std::vector<MPI_Aint>> m_freeBlocks;
+        std::vector<size_t> m_chunksNums;
+        // Фрагменты текущего процесса по их адресу в окне.
+        std::map<MPI_Aint, std::byte*> m_chunks;
+        size_t m_allocatedSize{0};
+
+        OperationCounters* m_pCounters{nullptr};
+        std::shared_ptr<spdlog::logger> m_logger;
+    };
+} // ref_counting
+
+#endif //SOURCES_PAYLOADARENA_H
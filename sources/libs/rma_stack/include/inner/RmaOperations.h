@@ -0,0 +1,122 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_RMAOPERATIONS_H
+#define SOURCES_RMAOPERATIONS_H
+
+#include <cstddef>
+#include <mpi.h>
+
+#include "OperationCounters.h"
+
+namespace rma_stack::ref_counting
+{
+    /*
+     * Обёртки над операциями RMA, которые учитывают выполненную
+     * операцию в pCounters по номеру целевого процесса, см.
+     * OperationCounters. Если pCounters - nullptr, то операция не
+     * учитывается.
+     *
+     * Кол-во и тип элементов у вызывающего и у целевого процесса
+     * совпадают. Объём данных - то, что операция передаёт в обе
+     * стороны: у MPI_Put и MPI_Accumulate - записанные данные, у
+     * MPI_Get и операций с MPI_NO_OP - прочитанные, у остальных
+     * MPI_Get_accumulate и MPI_Fetch_and_op - и те и другие, у CAS -
+     * новое, ожидаемое и прежнее значения.
+     */
+
+    // Учёт операции, которая передала transfersNum раз по count элементов типа datatype.
+    inline void countRmaTransfer(OperationCounters *pCounters, int rank, int count, MPI_Datatype datatype,
+                                 size_t transfersNum = 1)
+    {
+        if (!pCounters)
+            return;
+
+        int typeSize{0};
+        MPI_Type_size(datatype, &typeSize);
+        countRmaOp(*pCounters, rank, transfersNum * static_cast<size_t>(count) * typeSize);
+    }
+
+    // Операция с MPI_NO_OP только читает данные, остальные ещё и передают свои.
+    inline size_t getFetchTransfersNum(MPI_Op op)
+    {
+        return op == MPI_NO_OP ? 1 : 2;
+    }
+
+    inline void rmaPut(const void *pOrigin, int count, MPI_Datatype datatype, int rank, MPI_Aint targetDisp,
+                       MPI_Win win, OperationCounters *pCounters)
+    {
+        MPI_Put(pOrigin, count, datatype, rank, targetDisp, count, datatype, win);
+        countRmaTransfer(pCounters, rank, count, datatype);
+    }
+
+    inline void rmaGet(void *pResult, int count, MPI_Datatype datatype, int rank, MPI_Aint targetDisp,
+                       MPI_Win win, OperationCounters *pCounters)
+    {
+        MPI_Get(pResult, count, datatype, rank, targetDisp, count, datatype, win);
+        countRmaTransfer(pCounters, rank, count, datatype);
+    }
+
+    inline void rmaRget(void *pResult, int count, MPI_Datatype datatype, int rank, MPI_Aint targetDisp,
+                        MPI_Win win, MPI_Request *pRequest, OperationCounters *pCounters)
+    {
+        MPI_Rget(pResult, count, datatype, rank, targetDisp, count, datatype, win, pRequest);
+        countRmaTransfer(pCounters, rank, count, datatype);
+    }
+
+    inline void rmaAccumulate(const void *pOrigin, int count, MPI_Datatype datatype, int rank, MPI_Aint targetDisp,
+                              MPI_Op op, MPI_Win win, OperationCounters *pCounters)
+    {
+        MPI_Accumulate(pOrigin, count, datatype, rank, targetDisp, count, datatype, op, win);
+        countRmaTransfer(pCounters, rank, count, datatype);
+    }
+
+    // При MPI_NO_OP pOrigin не используется.
+    inline void rmaGetAccumulate(const void *pOrigin, void *pResult, int count, MPI_Datatype datatype, int rank,
+                                 MPI_Aint targetDisp, MPI_Op op, MPI_Win win, OperationCounters *pCounters)
+    {
+        MPI_Get_accumulate(pOrigin, count, datatype, pResult, count, datatype, rank, targetDisp, count, datatype,
+                           op, win);
+        countRmaTransfer(pCounters, rank, count, datatype, getFetchTransfersNum(op));
+    }
+
+    inline void rmaRgetAccumulate(const void *pOrigin, void *pResult, int count, MPI_Datatype datatype, int rank,
+                                  MPI_Aint targetDisp, MPI_Op op, MPI_Win win, MPI_Request *pRequest,
+                                  OperationCounters *pCounters)
+    {
+        MPI_Rget_accumulate(pOrigin, count, datatype, pResult, count, datatype, rank, targetDisp, count, datatype,
+                            op, win, pRequest);
+        countRmaTransfer(pCounters, rank, count, datatype, getFetchTransfersNum(op));
+    }
+
+    inline void rmaFetchAndOp(const void *pOrigin, void *pResult, MPI_Datatype datatype, int rank,
+                              MPI_Aint targetDisp, MPI_Op op, MPI_Win win, OperationCounters *pCounters)
+    {
+        MPI_Fetch_and_op(pOrigin, pResult, datatype, rank, targetDisp, op, win);
+        countRmaTransfer(pCounters, rank, 1, datatype, getFetchTransfersNum(op));
+    }
+
+    inline void rmaCompareAndSwap(const void *pOrigin, const void *pCompare, void *pResult, MPI_Datatype datatype,
+                                  int rank, MPI_Aint targetDisp, MPI_Win win, OperationCounters *pCounters)
+    {
+        MPI_Compare_and_swap(pOrigin, pCompare, pResult, datatype, rank, targetDisp, win);
+        countRmaTransfer(pCounters, rank, 1, datatype, 3);
+    }
+
+    inline void rmaFlush(int rank, MPI_Win win, OperationCounters *pCounters)
+    {
+        MPI_Win_flush(rank, win);
+        if (pCounters)
+            countRmaFlush(*pCounters, rank);
+    }
+
+    inline void rmaFlushLocal(int rank, MPI_Win win, OperationCounters *pCounters)
+    {
+        MPI_Win_flush_local(rank, win);
+        if (pCounters)
+            countRmaFlush(*pCounters, rank);
+    }
+} // ref_counting
+
+#endif //SOURCES_RMAOPERATIONS_H
@@ -0,0 +1,89 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_SEGMENTEDARENA_H
+#define SOURCES_SEGMENTEDARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <mpi.h>
+#include <spdlog/spdlog.h>
+
+#include "ref_counting.h"
+#include "WinEpoch.h"
+
+namespace rma_stack::ref_counting
+{
+    // Кол-во элементов в одном сегменте по умолчанию.
+    constexpr size_t DefaultSegmentCapacity = 4096;
+
+    /*
+     * Массив элементов фиксированного размера в динамическом окне,
+     * который растёт сегментами. Элемент с индексом i находится в
+     * сегменте i / segmentCapacity, поэтому индексы уже выданных
+     * элементов при росте не меняются.
+     *
+     * Сегменты выделяются и присоединяются к окну только процессом-
+     * владельцем (HEAD_RANK в централизованном режиме, каждый процесс в
+     * децентрализованном). Базовые адреса сегментов публикуются в
+     * таблице, которая хранится у владельца в том же окне. Остальные
+     * процессы читают адрес сегмента из таблицы при первом обращении к
+     * нему и затем берут его из локального кэша. Элемент нового
+     * сегмента становится доступен другим процессам только после
+     * публикации адреса, поэтому кэш никогда не устаревает.
+     */
+    class SegmentedArena
+    {
+    public:
+        // t_epochMode - режим эпох доступа к окну t_win, который задал его владелец.
+        SegmentedArena(MPI_Comm comm, MPI_Win t_win, EpochMode t_epochMode, bool t_centralized, int t_headRank,
+                       size_t t_elemSize, size_t t_segmentCapacity, size_t t_elemsUpLimit,
+                       std::shared_ptr<spdlog::logger> t_logger);
+
+        /*
+         * Выделяет, присоединяет к окну и публикует следующий сегмент
+         * текущего процесса. Возвращает указатель на его начало или
+         * nullptr, если достигнут предел кол-ва элементов.
+         */
+        std::byte* grow();
+
+        /*
+         * Если адрес сегмента ещё не известен, то он читается у владельца,
+         * поэтому в режиме EpochMode::PerOperation эпоха доступа к окну
+         * для этого процесса не должна быть открыта.
+         */
+        [[nodiscard]] MPI_Aint getElemAddress(GlobalAddress elemAddress) const;
+        [[nodiscard]] std::byte* getLocalSegment(size_t segmentIdx) const;
+
+        [[nodiscard]] size_t getSegmentsNum() const;
+        [[nodiscard]] size_t getSegmentCapacity() const;
+        [[nodiscard]] size_t getMaxSegmentsNum() const;
+        [[nodiscard]] size_t getSegmentElemsNum(size_t segmentIdx) const;
+        void release();
+
+    private:
+        [[nodiscard]] int getOwnerIdx(int rank) const;
+
+    private:
+        MPI_Win m_win{MPI_WIN_NULL};
+        EpochMode m_epochMode{EpochMode::Persistent};
+        int m_rank{-1};
+        int m_headRank{0};
+        bool m_centralized;
+        size_t m_elemSize{0};
+        size_t m_segmentCapacity{0};
+        size_t m_elemsUpLimit{0};
+        size_t m_maxSegmentsNum{0};
+
+        size_t m_segmentsNum{0};
+        std::unique_ptr<std::byte*[]> m_pLocalSegments;
+        MPI_Aint* m_pSegmentTable{nullptr};
+        std::unique_ptr<MPI_Aint[]> m_pSegmentTableAddresses;
+        std::unique_ptr<MPI_Aint[]> m_pSegmentBaseCache;
+
+        std::shared_ptr<spdlog::logger> m_logger;
+    };
+} // ref_counting
+
+#endif //SOURCES_SEGMENTEDARENA_H
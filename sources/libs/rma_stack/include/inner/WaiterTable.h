@@ -0,0 +1,82 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_WAITERTABLE_H
+#define SOURCES_WAITERTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <mpi.h>
+#include <spdlog/spdlog.h>
+
+#include "OperationCounters.h"
+#include "WinEpoch.h"
+
+namespace rma_stack::ref_counting
+{
+    /*
+     * Таблица процессов, которые ждут значение в пустом стеке. У
+     * владельца каждой головы в окне головы хранится битовая маска
+     * ожидающих процессов, а у каждого процесса - флаг уведомления.
+     *
+     * Ожидающий процесс сбрасывает свой флаг, устанавливает свой бит в
+     * масках всех голов и, если стек всё ещё пуст, проверяет только свой
+     * флаг, не обращаясь к голове. PUSH, который положил значение в пустой
+     * стек, читает маску своей головы и устанавливает флаги отмеченных в
+     * ней процессов. Процесс регистрируется до повторной проверки стека,
+     * а PUSH читает маску после CAS, поэтому значение, положенное после
+     * проверки, не может остаться незамеченным.
+     *
+     * Уведомляются все ожидающие процессы: стек мог опустеть снова, и
+     * процесс, который не успел снять значение, регистрируется заново.
+     */
+    class WaiterTable
+    {
+    public:
+        WaiterTable(MPI_Comm comm, MPI_Win t_headWin, EpochMode t_epochMode, std::vector<int> t_headRanks,
+                    OperationCounters &t_rCounters, std::shared_ptr<spdlog::logger> t_logger);
+
+        // Регистрация завершается у владельцев голов до возврата из функции.
+        void registerWaiter();
+        void unregisterWaiter();
+        void resetNotification();
+        // Чтение собственного флага, которое не обращается к другим процессам.
+        [[nodiscard]] bool isNotified();
+        /*
+         * Вызывается PUSH, который заменил пустую голову headIdx.
+         * Возвращает кол-во уведомлённых процессов.
+         */
+        size_t notifyWaiters(size_t headIdx);
+
+        [[nodiscard]] size_t getSentNotificationsNum() const;
+        void resetCounters();
+        void release();
+
+    private:
+        [[nodiscard]] MPI_Aint getWaitersWordAddress(int headRank, size_t wordIdx) const;
+        void updateWaiterBit(MPI_Op op);
+
+    private:
+        MPI_Win m_headWin{MPI_WIN_NULL};
+        EpochMode m_epochMode{EpochMode::Persistent};
+        int m_rank{-1};
+        int m_procNum{0};
+        std::vector<int> m_headRanks;
+        // Кол-во слов битовой маски ожидающих процессов.
+        size_t m_waitersWordsNum{0};
+
+        // Флаг уведомления, за которым у владельцев голов следует маска.
+        uint64_t* m_pMemory{nullptr};
+        std::unique_ptr<MPI_Aint[]> m_pMemoryAddresses;
+        std::vector<uint64_t> m_waitersSnapshot;
+        size_t m_sentNotificationsNum{0};
+
+        OperationCounters &m_rCounters;
+        std::shared_ptr<spdlog::logger> m_logger;
+    };
+} // ref_counting
+
+#endif //SOURCES_WAITERTABLE_H
@@ -0,0 +1,71 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_WINEPOCH_H
+#define SOURCES_WINEPOCH_H
+
+#include <string_view>
+#include <mpi.h>
+
+#include "OperationCounters.h"
+
+namespace rma_stack::ref_counting
+{
+    /*
+     * Способ открытия эпох доступа пассивной синхронизации к окнам стека.
+     *
+     * PerOperation - каждое обращение к процессу открывает и закрывает
+     * эпоху доступа к нему (MPI_Win_lock/MPI_Win_unlock).
+     *
+     * Persistent - после создания окна для него открывается одна эпоха
+     * доступа ко всем процессам (MPI_Win_lock_all), которая закрывается
+     * перед освобождением окна. Обращения к процессам завершаются только
+     * операциями MPI_Win_flush и MPI_Win_flush_local. Режим по умолчанию
+     * и у InnerStack, и у create() внешних стеков.
+     */
+    enum class EpochMode
+    {
+        PerOperation,
+        Persistent
+    };
+
+    std::string_view getEpochModeName(EpochMode mode);
+
+    /*
+     * Функции ниже получают режим эпох окна от его владельца, который
+     * хранит режим с момента создания окна, поэтому режим не приходится
+     * выяснять у самого окна при каждом обращении. Постоянная эпоха
+     * открывается сразу после создания окна, до первых обращений к нему.
+     *
+     * Функции закрытия учитывают в pCounters то завершение операций,
+     * которое действительно выполнили (MPI_Win_unlock, MPI_Win_flush
+     * или MPI_Win_flush_local), см. OperationCounters. Если pCounters -
+     * nullptr, то завершение не учитывается.
+     */
+
+    // Открывает постоянную эпоху доступа к окну, если mode - Persistent.
+    void beginWinEpoch(MPI_Win win, EpochMode mode);
+    // Закрывает постоянную эпоху доступа к окну, если mode - Persistent.
+    void endWinEpoch(MPI_Win win, EpochMode mode);
+
+    // Открывает эпоху доступа к процессу, если у окна нет постоянной эпохи.
+    void lockWinTarget(int rank, MPI_Win win, EpochMode mode);
+    // Закрывает эпоху доступа к процессу или завершает операции с ним на обеих сторонах.
+    void unlockWinTarget(int rank, MPI_Win win, EpochMode mode, OperationCounters *pCounters = nullptr);
+    /*
+     * То же, что unlockWinTarget, но при постоянной эпохе операции
+     * завершаются только у вызывающего процесса. Подходит, если все
+     * записи уже завершены MPI_Win_flush, а остальные операции - чтения.
+     */
+    void unlockWinTargetLocal(int rank, MPI_Win win, EpochMode mode, OperationCounters *pCounters = nullptr);
+    /*
+     * Для операций, запущенных запросами (MPI_Rget и др.): закрывает
+     * эпоху доступа к процессу, если у окна нет постоянной эпохи. При
+     * постоянной эпохе операции не завершаются - их завершает ожидание
+     * запросов.
+     */
+    void unlockWinTargetDeferred(int rank, MPI_Win win, EpochMode mode, OperationCounters *pCounters = nullptr);
+} // ref_counting
+
+#endif //SOURCES_WINEPOCH_H
@@ -7,25 +7,73 @@
 
 #include <cstdint>
 
+// Разрядность полей по умолчанию задаётся при сборке, см. CMakeLists.txt библиотеки.
+#ifndef RMA_STACK_RANK_BITS
+#define RMA_STACK_RANK_BITS 13
+#endif
+
+#ifndef RMA_STACK_EXTERNAL_COUNTER_BITS
+#define RMA_STACK_EXTERNAL_COUNTER_BITS RMA_STACK_RANK_BITS
+#endif
+
 namespace rma_stack::ref_counting
 {
-    constexpr uint64_t RankBitsLimit            = 13; // Кол-во бит под счётчик количества процессов.
-    constexpr uint64_t ExternalCounterBitsLimit = RankBitsLimit; // Кол-во бит под внешний счётчик ссылок.
+    /*
+     * Описание разбиения 64-битного глобального указателя на поля.
+     * t_rankBits - кол-во бит под номер процесса, t_externalCounterBits -
+     * кол-во бит под внешний счётчик ссылок. Оставшиеся биты отводятся
+     * под адресацию памяти внутри вычислительного узла. Максимальное
+     * значение каждого поля зарезервировано: номер процесса DummyRank
+     * обозначает NULL, смещение MaxOffset - конец списка свободных узлов.
+     */
+    template<uint64_t t_rankBits, uint64_t t_externalCounterBits>
+    struct BitLayout
+    {
+        static_assert(t_rankBits > 0 && t_externalCounterBits > 0, "each field of the layout must have at least one bit");
+        // Внутренний счётчик ссылок узла 32-битный и должен вмещать значение внешнего.
+        static_assert(t_externalCounterBits < 32, "the external counter must fit in the 32-bit internal counter");
+        static_assert(t_rankBits + t_externalCounterBits < 64, "the layout must leave bits for the offset");
+
+        static constexpr uint64_t RankBits            = t_rankBits;
+        static constexpr uint64_t ExternalCounterBits = t_externalCounterBits;
+        static constexpr uint64_t OffsetBits          = 64 - RankBits - ExternalCounterBits;
+
+        static constexpr uint64_t DummyRank          = (1ul << RankBits) - 1;
+        static constexpr uint64_t MaxExternalCounter = (1ul << ExternalCounterBits) - 1;
+        static constexpr uint64_t MaxOffset          = (1ul << OffsetBits) - 1;
+    };
+
+    using DefaultBitLayout = BitLayout<RMA_STACK_RANK_BITS, RMA_STACK_EXTERNAL_COUNTER_BITS>;
+
+    constexpr uint64_t RankBitsLimit            = DefaultBitLayout::RankBits; // Кол-во бит под счётчик количества процессов.
+    constexpr uint64_t ExternalCounterBitsLimit = DefaultBitLayout::ExternalCounterBits; // Кол-во бит под внешний счётчик ссылок.
 
     // Оставшееся кол-во бит отводится под адресацию памяти внутри вычислительного узла.
-    constexpr uint64_t OffsetBitsLimit          = 64 - RankBitsLimit * 2;
-    constexpr uint64_t InternalCounterBitsLimit = RankBitsLimit;
+    constexpr uint64_t OffsetBitsLimit          = DefaultBitLayout::OffsetBits;
+    constexpr uint64_t InternalCounterBitsLimit = ExternalCounterBitsLimit;
     // Необходимо для обозначения глобального указателя на NULL - (DummyRank, любое смещение).
-    constexpr uint64_t DummyRank                = (1 << RankBitsLimit) - 1;
+    constexpr uint64_t DummyRank                = DefaultBitLayout::DummyRank;
 
-    struct GlobalAddress
+    template<typename Layout>
+    struct BasicGlobalAddress
     {
-        uint64_t offset   : OffsetBitsLimit;
-        uint64_t rank     : RankBitsLimit;
-        uint64_t reserved   : 64 - OffsetBitsLimit - RankBitsLimit;
+        uint64_t offset   : Layout::OffsetBits;
+        uint64_t rank     : Layout::RankBits;
+        uint64_t reserved   : 64 - Layout::OffsetBits - Layout::RankBits;
     };
 
-    bool isGlobalAddressDummy(GlobalAddress globalAddress);
-    bool isValidRank(uint64_t rank);
+    using GlobalAddress = BasicGlobalAddress<DefaultBitLayout>;
+
+    template<typename Layout>
+    bool isGlobalAddressDummy(BasicGlobalAddress<Layout> globalAddress)
+    {
+        return globalAddress.rank == Layout::DummyRank;
+    }
+
+    template<typename Layout = DefaultBitLayout>
+    bool isValidRank(uint64_t rank)
+    {
+        return rank < Layout::DummyRank;
+    }
 }
 #endif //SOURCES_REF_COUNTING_H
@@ -0,0 +1,176 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_ASYNCOPERATIONENGINE_H
+#define SOURCES_ASYNCOPERATIONENGINE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <mpi.h>
+#include <spdlog/spdlog.h>
+
+#include "inner/InnerStack.h"
+
+namespace rma_stack
+{
+    class AsyncOperationEngine;
+
+    // Результат асинхронной операции, общий для движка и дескриптора операции.
+    struct AsyncOperationResult
+    {
+        bool completed{false};
+        // PUSH - узел добавлен в стек, POP - значение снято со стека.
+        bool succeeded{false};
+    };
+
+    // Функции политики задержки внешнего стека, одной на все операции движка.
+    struct AsyncBackoffCallbacks
+    {
+        // Очередная задержка без ожидания, см. BackoffPolicies.h.
+        std::function<std::chrono::nanoseconds()> nextDelay;
+        // Учёт завершённой операции с её кол-вом неудачных CAS.
+        std::function<void(size_t)> onOperationCompleted;
+    };
+
+    /*
+     * Дескриптор асинхронной операции PUSH или POP. Операция выполняется
+     * движком независимо от дескриптора, дескриптор только позволяет
+     * узнать, завершена ли она.
+     */
+    class AsyncOperation
+    {
+    public:
+        AsyncOperation() = default;
+
+        // Продвигает все операции движка и возвращает true, если эта операция завершена.
+        [[nodiscard]] bool test();
+        // Продвигает операции движка, пока эта операция не завершится.
+        void wait();
+        [[nodiscard]] bool isCompleted() const;
+        [[nodiscard]] bool isSucceeded() const;
+
+    private:
+        friend class AsyncOperationEngine;
+        AsyncOperation(AsyncOperationEngine *t_pEngine, std::shared_ptr<AsyncOperationResult> t_pResult);
+
+    private:
+        AsyncOperationEngine *m_pEngine{nullptr};
+        std::shared_ptr<AsyncOperationResult> m_pResult;
+    };
+
+    /*
+     * Движок асинхронных операций над головой внутреннего стека. Каждая
+     * операция - конечный автомат, шаги которого соответствуют шагам
+     * InnerStack::push и InnerStack::pop для схемы RefCounting: выделение
+     * узла, чтение головы, запись ссылки (связывание), CAS над головой и
+     * обновление внутреннего счётчика снятого узла. Чтения и записи
+     * запускаются запросами (MPI_Rget_accumulate), и progress переводит
+     * операцию на следующий шаг, только когда её запрос завершился, поэтому
+     * у процесса может быть много операций в полёте, пока он вычисляет.
+     *
+     * Запрос MPI_Rget_accumulate завершается, когда результат операции
+     * получен от владельца памяти, то есть когда сама операция уже
+     * выполнена у него. Поэтому запись ссылки, завершённая запросом, видна
+     * остальным процессам до CAS, которая её публикует. Для CAS в MPI нет
+     * операции с запросом, поэтому CAS завершается MPI_Win_flush_local -
+     * это единственный шаг, который ждёт ответа.
+     *
+     * Вместо задержки после неудачной CAS операция откладывается до
+     * истечения задержки и не задерживает остальные операции. Задержки
+     * всех операций даёт политика задержки внешнего стека. Массив
+     * исключения и комбинирование не используются.
+     *
+     * Требования: схема RefCounting, постоянные эпохи доступа
+     * (EpochMode::Persistent), данные хранятся в узлах. Движок работает
+     * с головой группы текущего процесса.
+     */
+    class AsyncOperationEngine
+    {
+    public:
+        AsyncOperationEngine(ref_counting::InnerStack &t_rInnerStack, AsyncBackoffCallbacks t_backoffCallbacks,
+                             std::shared_ptr<spdlog::logger> t_logger);
+
+        // Данные копируются при запуске операции.
+        AsyncOperation startPush(const void *pPayload);
+        /*
+         * Данные записываются в pPayload при завершении операции, поэтому
+         * память должна быть доступна до её завершения. Если стек пуст,
+         * в pPayload копируется pDefaultPayload.
+         */
+        AsyncOperation startPop(void *pPayload, const void *pDefaultPayload);
+        // Выполняет все шаги, запросы которых завершились, и возвращает кол-во незавершённых операций.
+        size_t progress();
+        void waitAll();
+        [[nodiscard]] size_t getPendingOperationsNum() const;
+
+    private:
+        enum class Step
+        {
+            PushFetchHead,
+            PushLink,
+            PushIncreaseNodeVersion,
+            PushSwapHead,
+            PopFetchHead,
+            PopIncreaseHeadCount,
+            PopSwapHead,
+            PopReleaseNode
+        };
+
+        struct Operation
+        {
+            Step step{Step::PushFetchHead};
+            MPI_Request request{MPI_REQUEST_NULL};
+            std::chrono::steady_clock::time_point resumeTime;
+            size_t casFailuresNum{0};
+            std::shared_ptr<AsyncOperationResult> pResult{std::make_shared<AsyncOperationResult>()};
+
+            ref_counting::GlobalAddress nodeAddress{0, ref_counting::DummyRank, 0};
+            ref_counting::CountedNodePtr newHeadCountedNodePtr;
+            ref_counting::CountedNodePtr oldHeadCountedNodePtr;
+            ref_counting::CountedNodePtr resHeadCountedNodePtr;
+            // Ссылка на следующий узел и данные, которые хранятся в узле.
+            uint64_t nodeTail[1 + ref_counting::MaxInlinePayloadWordsNum]{};
+            uint64_t resNodeTail[1 + ref_counting::MaxInlinePayloadWordsNum]{};
+            int nodeTailWordsNum{1};
+            int32_t countIncrease{0};
+            int32_t resInternalCount{0};
+            // Номер публикации узла увеличивается один раз, после первой записи данных, см. InnerStack::top.
+            uint32_t versionIncrease{1};
+            uint32_t resNodeVersion{0};
+            bool nodeVersionIncreased{false};
+            bool popped{false};
+            void *pPayload{nullptr};
+            uint64_t defaultPayloadWords[ref_counting::MaxInlinePayloadWordsNum]{};
+        };
+
+        // Возвращает true, если операция завершена.
+        bool advance(Operation &rOperation);
+        bool advancePush(Operation &rOperation);
+        bool advancePop(Operation &rOperation);
+        void complete(Operation &rOperation, bool succeeded);
+        void postpone(Operation &rOperation);
+        // CAS над головой, результат записывается в rOperation.resHeadCountedNodePtr.
+        void swapHead(Operation &rOperation, ref_counting::CountedNodePtr &rNewCountedNodePtr);
+        void startNodeTailFetch(Operation &rOperation);
+        MPI_Aint getCountedNodePtrNextOffset(ref_counting::GlobalAddress nodeAddress) const;
+
+    private:
+        ref_counting::InnerStack &m_rInnerStack;
+        const ref_counting::InnerStack::Head &m_rHead;
+        MPI_Win m_nodesWin{MPI_WIN_NULL};
+        size_t m_inlinePayloadSize{0};
+        ref_counting::OperationCounters &m_rCounters;
+
+        AsyncBackoffCallbacks m_backoffCallbacks;
+
+        std::vector<std::unique_ptr<Operation>> m_operations;
+        std::shared_ptr<spdlog::logger> m_logger;
+    };
+} // rma_stack
+
+#endif //SOURCES_ASYNCOPERATIONENGINE_H
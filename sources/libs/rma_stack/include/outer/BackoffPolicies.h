@@ -0,0 +1,110 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_BACKOFFPOLICIES_H
+#define SOURCES_BACKOFFPOLICIES_H
+
+#include <chrono>
+#include <cstddef>
+#include <random>
+
+namespace rma_stack
+{
+    /*
+     * Политики задержки после неудачной операции CAS над головой стека.
+     * Политика - параметр шаблона внешнего стека, её объект живёт столько
+     * же, сколько стек, поэтому состояние (окно задержки, генератор
+     * случайных чисел) сохраняется между операциями. Интерфейс политики:
+     *
+     * Policy(minDelay, maxDelay);
+     * void backoff();                                      // задержка после неудачной CAS
+     * std::chrono::nanoseconds nextDelay();                // очередная задержка без ожидания
+     * void onOperationCompleted(size_t casFailuresNum);    // учёт завершённой операции
+     *
+     * ExponentialBackoff также удовлетворяет этому интерфейсу. Ни одна
+     * политика не засыпает, см. spinFor.
+     */
+
+    // Задержки не больше порога SpinYieldBackoff выполняются активным ожиданием.
+    constexpr std::chrono::nanoseconds SpinYieldThreshold{1'000};
+    // Среднее кол-во неудачных CAS на операцию, выше которого AdaptiveBackoff удваивает окно.
+    constexpr double AdaptiveBackoffHighFailureRate = 1.0;
+    // Среднее кол-во неудачных CAS на операцию, ниже которого AdaptiveBackoff уменьшает окно вдвое.
+    constexpr double AdaptiveBackoffLowFailureRate = 0.25;
+    // Вес последней операции в скользящем среднем кол-ва неудачных CAS.
+    constexpr double AdaptiveBackoffSmoothingFactor = 0.125;
+
+    /*
+     * Активное ожидание в течение delay. Длительность одной итерации
+     * ожидания измеряется один раз при первом вызове, поэтому задержки в
+     * десятки наносекунд выполняются с точностью до итерации, в отличие
+     * от std::this_thread::sleep_for, который засыпает на десятки микросекунд.
+     */
+    void spinFor(const std::chrono::nanoseconds &delay);
+
+    /*
+     * Экспоненциальная задержка активным ожиданием. Окно удваивается
+     * после каждой неудачной CAS, а после завершения операции уменьшается
+     * вдвое, поэтому следующая операция начинает с окна, близкого к
+     * текущей конкуренции.
+     */
+    class SpinBackoff
+    {
+    public:
+        SpinBackoff(const std::chrono::nanoseconds &t_rMinDelayNs, const std::chrono::nanoseconds &t_rMaxDelayNs);
+
+        void backoff();
+        std::chrono::nanoseconds nextDelay();
+        void onOperationCompleted(size_t casFailuresNum);
+
+    protected:
+        std::chrono::nanoseconds m_minDelayNs;
+        std::chrono::nanoseconds m_maxDelayNs;
+        std::chrono::nanoseconds m_limitDelayNs;
+
+        std::mt19937 m_randomEngine;
+    };
+
+    /*
+     * Экспоненциальная задержка, которая активно ждёт до SpinYieldThreshold,
+     * а дальше уступает процессор другим потокам. Подходит для больших
+     * задержек и для режима, когда процессов больше, чем ядер.
+     */
+    class SpinYieldBackoff : public SpinBackoff
+    {
+    public:
+        SpinYieldBackoff(const std::chrono::nanoseconds &t_rMinDelayNs, const std::chrono::nanoseconds &t_rMaxDelayNs);
+
+        void backoff();
+    };
+
+    /*
+     * Адаптивная задержка активным ожиданием. Окно не растёт внутри
+     * операции, а задаётся скользящим средним кол-ва неудачных CAS на
+     * операцию: при высокой доле неудач окно удваивается, при низкой -
+     * уменьшается вдвое.
+     */
+    class AdaptiveBackoff
+    {
+    public:
+        AdaptiveBackoff(const std::chrono::nanoseconds &t_rMinDelayNs, const std::chrono::nanoseconds &t_rMaxDelayNs);
+
+        void backoff();
+        std::chrono::nanoseconds nextDelay();
+        void onOperationCompleted(size_t casFailuresNum);
+
+        [[nodiscard]] double getCasFailureRate() const;
+        [[nodiscard]] std::chrono::nanoseconds getWindow() const;
+
+    private:
+        std::chrono::nanoseconds m_minDelayNs;
+        std::chrono::nanoseconds m_maxDelayNs;
+        std::chrono::nanoseconds m_windowNs;
+        double m_casFailureRate{0};
+
+        std::mt19937 m_randomEngine;
+    };
+} // rma_stack
+
+#endif //SOURCES_BACKOFFPOLICIES_H
@@ -0,0 +1,103 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_ELIMINATIONARRAY_H
+#define SOURCES_ELIMINATIONARRAY_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <mpi.h>
+#include <spdlog/spdlog.h>
+
+#include "inner/WinEpoch.h"
+
+namespace rma_stack
+{
+    // Кол-во ячеек массива исключения у каждого процесса по умолчанию: массив выключен.
+    constexpr size_t DefaultEliminationSlotsPerRank = 0;
+
+    /*
+     * Состояние ячейки массива исключения. Метка увеличивается каждый
+     * раз, когда ячейка освобождается, чтобы операция CAS не приняла
+     * новое предложение за старое.
+     */
+    struct EliminationSlotState
+    {
+        uint64_t state : 2;
+        uint64_t stamp : 64 - 2;
+    };
+    static_assert(sizeof(EliminationSlotState) == sizeof(uint64_t), "EliminationSlotState is accessed as MPI_UINT64_T");
+
+    /*
+     * Массив исключения (elimination backoff array). Ячейки распределены
+     * по процессам и хранятся в отдельном окне. Используется вместо
+     * задержки после неудачной операции CAS над головой стека: PUSH и
+     * POP, которые встретились в одной ячейке, исключают друг друга и
+     * завершаются, не обращаясь к голове.
+     *
+     * Предложение делает только PUSH: процесс захватывает пустую ячейку
+     * (Empty -> Busy), записывает в неё данные, публикует предложение
+     * (Busy -> Waiting) и ждёт в течение задержки. Затем он пытается
+     * отозвать предложение (Waiting -> Empty). Если это не удалось, то
+     * данные забрал POP. POP проверяет одну случайную ячейку: если в ней
+     * есть предложение, то он захватывает его (Waiting -> Taken), читает
+     * данные и освобождает ячейку (Taken -> Empty).
+     */
+    class EliminationArray
+    {
+    public:
+        EliminationArray(MPI_Comm comm, MPI_Info info, size_t t_payloadSize, size_t t_slotsPerRank,
+                         ref_counting::EpochMode t_epochMode, std::shared_ptr<spdlog::logger> t_logger);
+
+        /*
+         * Возвращает true, если данные забрал POP за время ожидания delay.
+         * Процесс ждёт активно (spinFor), задержку даёт политика задержки стека.
+         */
+        bool tryPush(const void *pPayload, const std::chrono::nanoseconds &delay);
+        // Возвращает true, если удалось забрать данные PUSH.
+        bool tryPop(void *pPayload);
+
+        [[nodiscard]] bool isEnabled() const;
+        // Кол-во операций текущего процесса, завершённых исключением.
+        [[nodiscard]] size_t getEliminatedOpsNum() const;
+        void release();
+
+    private:
+        enum SlotState : uint64_t
+        {
+            Empty,
+            Busy,
+            Waiting,
+            Taken
+        };
+
+        void initRemoteAccessMemory(MPI_Comm comm, MPI_Info info);
+        void chooseSlot(int &rRank, MPI_Aint &rSlotAddress);
+        [[nodiscard]] EliminationSlotState fetchSlotState(int rank, MPI_Aint slotAddress);
+        [[nodiscard]] bool compareAndSwapSlotState(int rank, MPI_Aint slotAddress, EliminationSlotState oldState,
+                                                   EliminationSlotState newState);
+        void replaceSlotState(int rank, MPI_Aint slotAddress, EliminationSlotState newState);
+
+    private:
+        size_t m_payloadSize{0};
+        size_t m_slotsPerRank{0};
+        size_t m_slotSize{0};
+        int m_rank{-1};
+        int m_procNum{0};
+        size_t m_eliminatedOpsNum{0};
+
+        MPI_Win m_win{MPI_WIN_NULL};
+        ref_counting::EpochMode m_epochMode{ref_counting::EpochMode::Persistent};
+        uint64_t* m_pSlots{nullptr};
+        std::unique_ptr<MPI_Aint[]> m_pSlotsAddresses;
+        std::mt19937 m_randomEngine;
+
+        std::shared_ptr<spdlog::logger> m_logger;
+    };
+} // rma_stack
+
+#endif //SOURCES_ELIMINATIONARRAY_H
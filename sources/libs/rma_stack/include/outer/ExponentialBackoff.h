@@ -10,15 +10,25 @@
 
 namespace rma_stack
 {
+    /*
+     * Экспоненциальная задержка, окно которой возвращается к минимальному
+     * после каждой операции. Задержка выполняется активным ожиданием
+     * (spinFor), как у SpinBackoff.
+     */
     class ExponentialBackoff
     {
     public:
         ExponentialBackoff(const std::chrono::nanoseconds &t_rMinDelayNs, const std::chrono::nanoseconds &t_rMaxDelayNs);
 
         void backoff();
+        // Возвращает очередную задержку без ожидания, например для ожидания в массиве исключения.
+        std::chrono::nanoseconds nextDelay();
+        // Окно возвращается к минимальной задержке, как у нового объекта, см. BackoffPolicies.h.
+        void onOperationCompleted(size_t casFailuresNum);
 
     private:
-        const std::chrono::nanoseconds m_maxDelayNs;
+        std::chrono::nanoseconds m_minDelayNs;
+        std::chrono::nanoseconds m_maxDelayNs;
         int  m_limitDelayInt;
 
         std::mt19937 m_randomEngine;
@@ -0,0 +1,128 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_FLATCOMBINER_H
+#define SOURCES_FLATCOMBINER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include <mpi.h>
+#include <spdlog/spdlog.h>
+
+#include "inner/WinEpoch.h"
+
+namespace rma_stack
+{
+    /*
+     * Disabled - операции всегда выполняются напрямую над головой стека.
+     * Always - операции всегда передаются комбинирующему процессу.
+     * Adaptive - операции передаются комбинирующему процессу, пока
+     * среднее кол-во неудачных операций CAS над головой на одну
+     * операцию не опустится ниже порога.
+     */
+    enum class FlatCombiningMode
+    {
+        Disabled,
+        Adaptive,
+        Always
+    };
+
+    std::string_view getFlatCombiningModeName(FlatCombiningMode mode);
+
+    // Среднее кол-во неудачных CAS на операцию, при котором включается комбинирование.
+    constexpr double FlatCombiningCasFailuresThreshold = 1.0;
+    // В режиме комбинирования каждая такая по счёту операция выполняется напрямую для оценки конкуренции.
+    constexpr size_t FlatCombiningProbePeriod = 64;
+
+    // Функции, которыми комбинирующий процесс выполняет операции напрямую.
+    struct FlatCombiningCallbacks
+    {
+        // Возвращает false, если в пуле не осталось свободных узлов.
+        std::function<bool(const void*)> push;
+        // Возвращает false, если стек пуст.
+        std::function<bool(void*)> pop;
+        // Задержка между проверками своего запроса, политикой задержки стека.
+        std::function<void()> backoff;
+    };
+
+    /*
+     * Плоское комбинирование (flat combining). У HEAD_RANK хранятся
+     * блокировка комбинирующего процесса и по одной ячейке запроса на
+     * каждый процесс: состояние запроса и данные пользователя.
+     *
+     * Процесс публикует запрос в своей ячейке и пытается захватить
+     * блокировку одной операцией CAS. Захвативший её процесс читает все
+     * ячейки, исключает пары PUSH и POP внутри пакета, выполняет
+     * оставшиеся запросы напрямую и записывает результаты. Остальные
+     * процессы ждут результата в своей ячейке.
+     */
+    class FlatCombiner
+    {
+    public:
+        FlatCombiner(MPI_Comm comm, MPI_Info info, int t_headRank, size_t t_payloadSize, FlatCombiningMode t_mode,
+                     ref_counting::EpochMode t_epochMode, std::shared_ptr<spdlog::logger> t_logger);
+
+        // Нужно ли передать очередную операцию комбинирующему процессу.
+        [[nodiscard]] bool shouldCombine();
+        // Учитывает неудачные CAS операции, выполненной напрямую.
+        void registerCasFailures(size_t casFailuresNum);
+
+        bool push(const void *pPayload, const FlatCombiningCallbacks &rCallbacks);
+        bool pop(void *pPayload, const FlatCombiningCallbacks &rCallbacks);
+
+        [[nodiscard]] FlatCombiningMode getMode() const;
+        // Кол-во операций текущего процесса, выполненных через комбинирующий процесс.
+        [[nodiscard]] size_t getCombinedOpsNum() const;
+        void release();
+
+    private:
+        enum RequestState : uint64_t
+        {
+            Empty,
+            PendingPush,
+            PendingPop,
+            Done,
+            Failed // Пул узлов исчерпан или стек пуст.
+        };
+
+        bool execute(RequestState request, void *pPayload, const FlatCombiningCallbacks &rCallbacks);
+        bool tryCombine(const FlatCombiningCallbacks &rCallbacks);
+        void combine(const FlatCombiningCallbacks &rCallbacks);
+        [[nodiscard]] uint64_t fetchRequestState();
+
+        void initRemoteAccessMemory(MPI_Comm comm, MPI_Info info);
+        [[nodiscard]] MPI_Aint getRequestStateAddress(int rank) const;
+        [[nodiscard]] MPI_Aint getPayloadAddress(int rank) const;
+
+    private:
+        int m_rank{-1};
+        int m_procNum{0};
+        int m_headRank{0};
+        size_t m_payloadSize{0};
+        size_t m_payloadWordsNum{0};
+        FlatCombiningMode m_mode;
+
+        double m_casFailuresRate{0.0};
+        bool m_combining{false};
+        size_t m_opsSinceProbe{0};
+        size_t m_combinedOpsNum{0};
+
+        MPI_Win m_win{MPI_WIN_NULL};
+        ref_counting::EpochMode m_epochMode{ref_counting::EpochMode::Persistent};
+        uint64_t* m_pCombinerMemory{nullptr};
+        MPI_Aint m_combinerMemoryAddress{(MPI_Aint)MPI_BOTTOM};
+        std::vector<uint64_t> m_requestPayload;
+        // Буферы комбинирующего процесса.
+        std::vector<uint64_t> m_requestStates;
+        std::vector<uint64_t> m_payloads;
+
+        std::shared_ptr<spdlog::logger> m_logger;
+    };
+} // rma_stack
+
+#endif //SOURCES_FLATCOMBINER_H
@@ -0,0 +1,38 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_PAYLOADPLACEMENT_H
+#define SOURCES_PAYLOADPLACEMENT_H
+
+#include <string_view>
+
+namespace rma_stack
+{
+    /*
+     * Размещение данных, которые не помещаются в узел. HeadRank - в окне
+     * данных у HEAD_RANK рядом с узлами. Producer - в арене данных
+     * процесса, выполнившего PUSH (см. PayloadArena): данные записываются
+     * локально, в узле хранится только ссылка на них, а POP читает их у
+     * этого процесса. Тогда обмен с HEAD_RANK не зависит от размера данных.
+     */
+    enum class PayloadPlacement
+    {
+        HeadRank,
+        Producer
+    };
+
+    inline std::string_view getPayloadPlacementName(PayloadPlacement placement)
+    {
+        switch (placement)
+        {
+            case PayloadPlacement::HeadRank:
+                return "head rank";
+            case PayloadPlacement::Producer:
+                return "producer";
+        }
+        return "unknown";
+    }
+} // rma_stack
+
+#endif //SOURCES_PAYLOADPLACEMENT_H
@@ -0,0 +1,289 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_PAYLOADSTACK_H
+#define SOURCES_PAYLOADSTACK_H
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <mpi.h>
+#include <spdlog/spdlog.h>
+
+#include "IStack.h"
+#include "inner/PayloadArena.h"
+#include "outer/PayloadTraits.h"
+
+namespace rma_stack
+{
+    template<typename T, typename StackImpl>
+    class PayloadStack;
+}
+
+namespace stack_interface
+{
+    template<typename T, typename StackImpl>
+    struct IStack_traits<rma_stack::PayloadStack<T, StackImpl>>;
+}
+
+namespace rma_stack
+{
+    /*
+     * Фасад внешнего стека для данных переменной длины и данных, которые
+     * нельзя копировать побайтно. Значение сериализуется (PayloadTraits)
+     * в блок арены данных текущего процесса (PayloadArena) локальным
+     * копированием, а через внешний стек передаётся только ссылка на блок,
+     * которая хранится в узле. POP читает блок у процесса, который положил
+     * значение, одной операцией MPI_Get и освобождает его.
+     *
+     * POP выполняется внешним стеком как для небольших данных, в том
+     * числе через комбинирование. PUSH выполняется операцией pushBulk из
+     * одного значения, которая сообщает, добавлено ли оно: если пул узлов
+     * исчерпан, блок сразу освобождается.
+     *
+     * StackImpl - внешний стек с типом значений ref_counting::PayloadRef.
+     * Конструктор и release - коллективные функции.
+     */
+    template<typename T, typename StackImpl>
+    class PayloadStack : public stack_interface::IStack<PayloadStack<T, StackImpl>>
+    {
+        friend class stack_interface::IStack_traits<PayloadStack<T, StackImpl>>;
+    public:
+        typedef T ValueType;
+        using Traits = PayloadTraits<T>;
+
+        PayloadStack(MPI_Comm comm, MPI_Info info, stack_interface::IStack<StackImpl> &t_rStack,
+                     std::shared_ptr<spdlog::sinks::sink> loggerSink,
+                     size_t t_maxPayloadSize = ref_counting::DefaultMaxPayloadSize,
+                     ref_counting::EpochMode t_epochMode = ref_counting::EpochMode::Persistent);
+
+        PayloadStack(PayloadStack&) = delete;
+        PayloadStack(PayloadStack&&) = delete;
+        PayloadStack& operator=(PayloadStack&) = delete;
+        PayloadStack& operator=(PayloadStack&&) = delete;
+        ~PayloadStack() = default;
+
+        void release();
+        // Объём памяти арены данных текущего процесса в байтах.
+        [[nodiscard]] size_t getPayloadMemorySize() const;
+        // Передаёт внешнему стеку обслуживание запросов роста пула узлов, если он его поддерживает.
+        template<typename Impl = StackImpl>
+        auto serviceGrowRequests() -> decltype(std::declval<Impl&>().serviceGrowRequests());
+
+    private:
+        // public stack interface begin
+        void pushImpl(const T &rValue);
+        void popImpl(T &rValue, const T &rDefaultValue);
+        size_t pushBulkImpl(const T *pValues, size_t valuesNum);
+        size_t popBulkImpl(size_t valuesNum, T *pValues);
+        T& topImpl();
+        size_t sizeImpl();
+        bool isEmptyImpl();
+        // public stack interface end
+
+        [[nodiscard]] ref_counting::PayloadRef store(const T &rValue);
+        void load(const ref_counting::PayloadRef &rPayloadRef, T &rValue);
+        // Освобождает блок после чтения.
+        void take(const ref_counting::PayloadRef &rPayloadRef, T &rValue);
+
+    private:
+        stack_interface::IStack<StackImpl> &m_rStack;
+        int m_rank{-1};
+        std::unique_ptr<ref_counting::PayloadArena> m_pPayloadArena;
+        std::vector<std::byte> m_buffer;
+        std::vector<ref_counting::PayloadRef> m_payloadRefs;
+        // Копия вершины, на которую ссылается результат top.
+        T m_topValue{};
+
+        std::shared_ptr<spdlog::logger> m_logger;
+    };
+
+    template<typename T, typename StackImpl>
+    PayloadStack<T, StackImpl>::PayloadStack(MPI_Comm comm, MPI_Info info, stack_interface::IStack<StackImpl> &t_rStack,
+                                             std::shared_ptr<spdlog::sinks::sink> loggerSink, size_t t_maxPayloadSize,
+                                             ref_counting::EpochMode t_epochMode)
+    :
+    m_rStack(t_rStack),
+    m_logger(std::make_shared<spdlog::logger>("PayloadStack", std::move(loggerSink)))
+    {
+        static_assert(std::is_same_v<typename StackImpl::ValueType, ref_counting::PayloadRef>,
+                      "the underlying stack must store payload references");
+
+        m_logger->set_level(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
+        m_logger->flush_on(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
+        MPI_Comm_rank(comm, &m_rank);
+        m_pPayloadArena = std::make_unique<ref_counting::PayloadArena>(comm, info, t_maxPayloadSize, t_epochMode, m_logger);
+    }
+
+    template<typename T, typename StackImpl>
+    void PayloadStack<T, StackImpl>::release()
+    {
+        m_pPayloadArena->release();
+    }
+
+    template<typename T, typename StackImpl>
+    size_t PayloadStack<T, StackImpl>::getPayloadMemorySize() const
+    {
+        return m_pPayloadArena->getAllocatedSize();
+    }
+
+    template<typename T, typename StackImpl>
+    template<typename Impl>
+    auto PayloadStack<T, StackImpl>::serviceGrowRequests() -> decltype(std::declval<Impl&>().serviceGrowRequests())
+    {
+        return static_cast<Impl&>(m_rStack).serviceGrowRequests();
+    }
+
+    template<typename T, typename StackImpl>
+    ref_counting::PayloadRef PayloadStack<T, StackImpl>::store(const T &rValue)
+    {
+        const auto payloadRef = m_pPayloadArena->allocate(Traits::getSize(rValue));
+        Traits::serialize(rValue, m_pPayloadArena->getLocalBlock(payloadRef));
+        return payloadRef;
+    }
+
+    template<typename T, typename StackImpl>
+    void PayloadStack<T, StackImpl>::load(const ref_counting::PayloadRef &rPayloadRef, T &rValue)
+    {
+        // Данные своего процесса десериализуются прямо из блока.
+        if (static_cast<int>(rPayloadRef.rank) == m_rank)
+        {
+            Traits::deserialize(m_pPayloadArena->getLocalBlock(rPayloadRef), rPayloadRef.size, rValue);
+            return;
+        }
+        m_buffer.resize(rPayloadRef.size);
+        m_pPayloadArena->read(rPayloadRef, m_buffer.data());
+        Traits::deserialize(m_buffer.data(), rPayloadRef.size, rValue);
+    }
+
+    template<typename T, typename StackImpl>
+    void PayloadStack<T, StackImpl>::take(const ref_counting::PayloadRef &rPayloadRef, T &rValue)
+    {
+        load(rPayloadRef, rValue);
+        m_pPayloadArena->deallocate(rPayloadRef);
+    }
+
+    template<typename T, typename StackImpl>
+    void PayloadStack<T, StackImpl>::pushImpl(const T &rValue)
+    {
+        pushBulkImpl(&rValue, 1);
+    }
+
+    template<typename T, typename StackImpl>
+    void PayloadStack<T, StackImpl>::popImpl(T &rValue, const T &rDefaultValue)
+    {
+        ref_counting::PayloadRef payloadRef;
+        m_rStack.pop(payloadRef, ref_counting::PayloadRef{});
+        if (ref_counting::isPayloadRefEmpty(payloadRef))
+        {
+            rValue = rDefaultValue;
+            return;
+        }
+        take(payloadRef, rValue);
+    }
+
+    template<typename T, typename StackImpl>
+    size_t PayloadStack<T, StackImpl>::pushBulkImpl(const T *pValues, size_t valuesNum)
+    {
+        m_payloadRefs.clear();
+        for (size_t i = 0; i < valuesNum; ++i)
+            m_payloadRefs.push_back(store(pValues[i]));
+        m_pPayloadArena->publishLocalBlocks();
+
+        const auto pushedNum = m_rStack.pushBulk(m_payloadRefs.data(), valuesNum);
+        if (pushedNum < valuesNum)
+            m_logger->warn("failed to push {} values: node pool is exhausted", valuesNum - pushedNum);
+        for (size_t i = pushedNum; i < valuesNum; ++i)
+            m_pPayloadArena->deallocate(m_payloadRefs[i]);
+        return pushedNum;
+    }
+
+    template<typename T, typename StackImpl>
+    size_t PayloadStack<T, StackImpl>::popBulkImpl(size_t valuesNum, T *pValues)
+    {
+        m_payloadRefs.resize(valuesNum);
+        const auto poppedNum = m_rStack.popBulk(valuesNum, m_payloadRefs.data());
+        for (size_t i = 0; i < poppedNum; ++i)
+            take(m_payloadRefs[i], pValues[i]);
+        return poppedNum;
+    }
+
+    /*
+     * Блок вершины не защищён от освобождения, поэтому после чтения
+     * данных вершина перечитывается, и чтение повторяется, если она
+     * сменилась.
+     */
+    template<typename T, typename StackImpl>
+    T& PayloadStack<T, StackImpl>::topImpl()
+    {
+        auto payloadRef = m_rStack.top();
+        while (!ref_counting::isPayloadRefEmpty(payloadRef))
+        {
+            load(payloadRef, m_topValue);
+            const auto resPayloadRef = m_rStack.top();
+            if (resPayloadRef.address == payloadRef.address && resPayloadRef.rank == payloadRef.rank)
+                return m_topValue;
+            payloadRef = resPayloadRef;
+        }
+        m_topValue = T{};
+        return m_topValue;
+    }
+
+    template<typename T, typename StackImpl>
+    size_t PayloadStack<T, StackImpl>::sizeImpl()
+    {
+        return m_rStack.size();
+    }
+
+    template<typename T, typename StackImpl>
+    bool PayloadStack<T, StackImpl>::isEmptyImpl()
+    {
+        return m_rStack.isEmpty();
+    }
+} // rma_stack
+
+namespace stack_interface
+{
+    template<typename T, typename StackImpl>
+    struct IStack_traits<rma_stack::PayloadStack<T, StackImpl>>
+    {
+        friend class IStack<rma_stack::PayloadStack<T, StackImpl>>;
+        friend class rma_stack::PayloadStack<T, StackImpl>;
+        typedef T ValueType;
+
+    private:
+        static void pushImpl(rma_stack::PayloadStack<T, StackImpl>& stack, const ValueType &value)
+        {
+            stack.pushImpl(value);
+        }
+        static void popImpl(rma_stack::PayloadStack<T, StackImpl>& stack, ValueType &rValue, const ValueType &rDefaultValue)
+        {
+            stack.popImpl(rValue, rDefaultValue);
+        }
+        static size_t pushBulkImpl(rma_stack::PayloadStack<T, StackImpl>& stack, const ValueType *pValues, size_t valuesNum)
+        {
+            return stack.pushBulkImpl(pValues, valuesNum);
+        }
+        static size_t popBulkImpl(rma_stack::PayloadStack<T, StackImpl>& stack, size_t valuesNum, ValueType *pValues)
+        {
+            return stack.popBulkImpl(valuesNum, pValues);
+        }
+        static ValueType& topImpl(rma_stack::PayloadStack<T, StackImpl>& stack)
+        {
+            return stack.topImpl();
+        }
+        static size_t sizeImpl(rma_stack::PayloadStack<T, StackImpl>& stack)
+        {
+            return stack.sizeImpl();
+        }
+        static bool isEmptyImpl(rma_stack::PayloadStack<T, StackImpl>& stack)
+        {
+            return stack.isEmptyImpl();
+        }
+    };
+}
+
+#endif //SOURCES_PAYLOADSTACK_H
@@ -0,0 +1,84 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_PAYLOADTRAITS_H
+#define SOURCES_PAYLOADTRAITS_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace rma_stack
+{
+    /*
+     * Сериализация значения в блок данных переменной длины, см.
+     * PayloadStack. Для своего типа нужно определить специализацию:
+     *
+     * static size_t getSize(const T &rValue);                                  // размер данных в байтах
+     * static void serialize(const T &rValue, std::byte *pBuffer);              // запись getSize(rValue) байт
+     * static void deserialize(const std::byte *pBuffer, size_t size, T &rValue);
+     */
+    template<typename T, typename Enable = void>
+    struct PayloadTraits;
+
+    template<typename T>
+    struct PayloadTraits<T, std::enable_if_t<std::is_trivially_copyable_v<T>>>
+    {
+        static size_t getSize(const T &)
+        {
+            return sizeof(T);
+        }
+        static void serialize(const T &rValue, std::byte *pBuffer)
+        {
+            std::memcpy(pBuffer, &rValue, sizeof(T));
+        }
+        static void deserialize(const std::byte *pBuffer, size_t, T &rValue)
+        {
+            std::memcpy(&rValue, pBuffer, sizeof(T));
+        }
+    };
+
+    // Данные вектора хранятся без размера: он восстанавливается по размеру блока.
+    template<typename U, typename Allocator>
+    struct PayloadTraits<std::vector<U, Allocator>, std::enable_if_t<std::is_trivially_copyable_v<U>>>
+    {
+        static size_t getSize(const std::vector<U, Allocator> &rValue)
+        {
+            return rValue.size() * sizeof(U);
+        }
+        static void serialize(const std::vector<U, Allocator> &rValue, std::byte *pBuffer)
+        {
+            if (!rValue.empty())
+                std::memcpy(pBuffer, rValue.data(), rValue.size() * sizeof(U));
+        }
+        static void deserialize(const std::byte *pBuffer, size_t size, std::vector<U, Allocator> &rValue)
+        {
+            rValue.resize(size / sizeof(U));
+            if (!rValue.empty())
+                std::memcpy(rValue.data(), pBuffer, rValue.size() * sizeof(U));
+        }
+    };
+
+    template<typename Char, typename CharTraits, typename Allocator>
+    struct PayloadTraits<std::basic_string<Char, CharTraits, Allocator>>
+    {
+        static size_t getSize(const std::basic_string<Char, CharTraits, Allocator> &rValue)
+        {
+            return rValue.size() * sizeof(Char);
+        }
+        static void serialize(const std::basic_string<Char, CharTraits, Allocator> &rValue, std::byte *pBuffer)
+        {
+            std::memcpy(pBuffer, rValue.data(), rValue.size() * sizeof(Char));
+        }
+        static void deserialize(const std::byte *pBuffer, size_t size, std::basic_string<Char, CharTraits, Allocator> &rValue)
+        {
+            rValue.resize(size / sizeof(Char));
+            std::memcpy(rValue.data(), pBuffer, rValue.size() * sizeof(Char));
+        }
+    };
+} // rma_stack
+
+#endif //SOURCES_PAYLOADTRAITS_H
@@ -6,237 +6,947 @@
 #define SOURCES_RMATREIBERCENTRALSTACK_H
 
 #include <mpi.h>
+#include <cstring>
 #include <memory>
 #include <optional>
+#include <random>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "IStack.h"
 
-#include "outer/ExponentialBackoff.h"
+#include "outer/AsyncOperationEngine.h"
+#include "outer/BackoffPolicies.h"
+#include "outer/EliminationArray.h"
+#include "outer/FlatCombiner.h"
+#include "outer/PayloadPlacement.h"
 #include "inner/InnerStack.h"
+#include "inner/PayloadArena.h"
+#include "inner/RmaOperations.h"
 #include "MpiException.h"
 
 namespace rma_stack
 {
     namespace custom_mpi = custom_mpi_extensions;
 
-    template<typename T>
-    class RmaTreiberCentralStack: public stack_interface::IStack<RmaTreiberCentralStack<T>>
+    // BackoffPolicy - политика задержки после неудачной операции CAS над головой, см. BackoffPolicies.h.
+    template<typename T, typename BackoffPolicy = SpinBackoff>
+    class RmaTreiberCentralStack: public stack_interface::IStack<RmaTreiberCentralStack<T, BackoffPolicy>>
     {
-        friend class stack_interface::IStack_traits<rma_stack::RmaTreiberCentralStack<T>>;
+        friend class stack_interface::IStack_traits<rma_stack::RmaTreiberCentralStack<T, BackoffPolicy>>;
     public:
         typedef typename stack_interface::IStack_traits<RmaTreiberCentralStack>::ValueType ValueType;
+        /*
+         * Небольшие тривиально копируемые данные хранятся в самих узлах,
+         * и окно данных пользователя не создаётся, см. InnerStack::pushInline.
+         */
+        static constexpr bool IsPayloadInline = std::is_trivially_copyable_v<T>
+                                                && sizeof(T) <= ref_counting::MaxInlinePayloadSize;
 
         explicit RmaTreiberCentralStack(MPI_Comm comm, MPI_Info info,
                                         const std::chrono::nanoseconds &t_rBackoffMinDelay,
                                         const std::chrono::nanoseconds &t_rBackoffMaxDelay,
                                         ref_counting::InnerStack &&t_innerStack,
+                                        size_t t_eliminationSlotsPerRank,
+                                        FlatCombiningMode t_flatCombiningMode,
+                                        PayloadPlacement t_payloadPlacement,
                                         std::shared_ptr<spdlog::logger> t_logger);
-        static RmaTreiberCentralStack <T> create(
+        static RmaTreiberCentralStack<T, BackoffPolicy> create(
                 MPI_Comm comm,
                 MPI_Info info,
                 const std::chrono::nanoseconds &t_rBackoffMinDelay,
                 const std::chrono::nanoseconds &t_rBackoffMaxDelay,
                 int elemsUpLimit,
-                std::shared_ptr<spdlog::sinks::sink> loggerSink
+                std::shared_ptr<spdlog::sinks::sink> loggerSink,
+                size_t segmentCapacity = ref_counting::DefaultSegmentCapacity,
+                ref_counting::ReclamationScheme reclamationScheme = ref_counting::ReclamationScheme::RefCounting,
+                size_t eliminationSlotsPerRank = DefaultEliminationSlotsPerRank,
+                FlatCombiningMode flatCombiningMode = FlatCombiningMode::Disabled,
+                size_t shardSize = 0,
+                ref_counting::EpochMode epochMode = ref_counting::EpochMode::Persistent,
+                bool requestPipelining = true,
+                PayloadPlacement payloadPlacement = PayloadPlacement::HeadRank
         );
 
         RmaTreiberCentralStack(RmaTreiberCentralStack&) = delete;
-        RmaTreiberCentralStack(RmaTreiberCentralStack&&)  noexcept = default;
+        /*
+         * Движок асинхронных операций ссылается на внутренний стек и
+         * политику задержки, поэтому он не переносится, а создаётся
+         * заново при следующей асинхронной операции. Стек с
+         * незавершёнными асинхронными операциями переместить нельзя -
+         * std::logic_error. Пул узлов ссылается на свои счётчики, поэтому
+         * стек не присваивается перемещением.
+         */
+        RmaTreiberCentralStack(RmaTreiberCentralStack&& rOther);
         RmaTreiberCentralStack& operator=(RmaTreiberCentralStack&) = delete;
-        RmaTreiberCentralStack& operator=(RmaTreiberCentralStack&&)  noexcept = default;
+        RmaTreiberCentralStack& operator=(RmaTreiberCentralStack&&) = delete;
         ~RmaTreiberCentralStack() = default;
 
         void release();
+        // Коллективная функция, см. InnerStack::reclaimRetiredNodes.
+        void reclaimRetiredNodes();
+        // Объём памяти текущего процесса, который занят схемой освобождения памяти, в байтах.
+        [[nodiscard]] size_t getReclamationMemoryOverhead() const;
+        // Кол-во операций текущего процесса, завершённых в массиве исключения.
+        [[nodiscard]] size_t getEliminatedOpsNum() const;
+        // Кол-во операций текущего процесса, выполненных через комбинирующий процесс.
+        [[nodiscard]] size_t getCombinedOpsNum() const;
+        // Кол-во операций POP текущего процесса, которые сняли значение с чужой головы.
+        [[nodiscard]] size_t getStolenOpsNum() const;
+        // Объём памяти арены данных текущего процесса в режиме PayloadPlacement::Producer в байтах.
+        [[nodiscard]] size_t getProducerPayloadMemorySize() const;
+        // Замер времени этапов PUSH и POP внутреннего стека, см. InnerStack::setPhaseTimingEnabled.
+        void setPhaseTimingEnabled(bool phaseTimingEnabled);
+        [[nodiscard]] ref_counting::PopPhaseTimes getPopPhaseTimes() const;
+        [[nodiscard]] ref_counting::PushPhaseTimes getPushPhaseTimes() const;
+        void resetPhaseTimes();
+        /*
+         * Счётчики операций текущего процесса, см. OperationCounters.
+         * Операции RMA учитываются для окон головы, узлов и данных.
+         */
+        [[nodiscard]] const ref_counting::OperationCounters& getOperationCounters() const;
+        void resetOperationCounters();
+        /*
+         * Асинхронные операции, см. AsyncOperationEngine. Доступны, если
+         * данные хранятся в узлах. popAsync записывает значение в rValue
+         * при завершении операции, поэтому rValue должно быть доступно до
+         * её завершения. Стек нельзя перемещать, пока есть незавершённые
+         * асинхронные операции.
+         */
+        AsyncOperation pushAsync(const T &rValue);
+        AsyncOperation popAsync(T &rValue, const T &rDefaultValue);
+        // Продвигает асинхронные операции текущего процесса и возвращает кол-во незавершённых.
+        size_t progressAsync();
+        /*
+         * Рост пула узлов по запросам процессов, которые не нашли
+         * свободный узел, см. NodePool. HEAD_RANK проверяет запросы при
+         * каждом своём PUSH, а в остальное время, пока другие процессы
+         * могут добавлять значения, должен вызывать эту функцию.
+         */
+        void serviceGrowRequests();
+        /*
+         * Копия вершины без снятия её со стека, см. InnerStack::top.
+         * Возвращает false, если стек пуст. В ослабленном режиме
+         * сначала читается голова группы текущего процесса.
+         */
+        bool tryTop(T &rValue);
+        /*
+         * POP, который при пустом стеке ждёт значение не дольше timeout.
+         * Процесс регистрируется в таблице ожидающих процессов (см.
+         * WaiterTable) и до уведомления от PUSH проверяет только свой
+         * флаг, не обращаясь к голове. Возвращает false, если значение
+         * так и не появилось.
+         */
+        bool popWait(T &rValue, const std::chrono::nanoseconds &timeout);
 
     private:
         // public stack interface begin
         void pushImpl(const T &rValue);
         void  popImpl(T &rValue, const T &rDefaultValue);
+        size_t pushBulkImpl(const T *pValues, size_t valuesNum);
+        size_t popBulkImpl(size_t valuesNum, T *pValues);
         T& topImpl();
         size_t sizeImpl();
         bool isEmptyImpl();
         // public stack interface end
 
-        void initRemoteAccessMemory(MPI_Comm comm, MPI_Info info);
+        // Операции непосредственно над головой стека. Возвращают false, если пул исчерпан или стек пуст.
+        bool pushDirect(const T &rValue);
+        bool popDirect(T &rValue);
+        // POP напрямую или через комбинирующий процесс. Возвращает false, если стек пуст.
+        bool tryPop(T &rValue);
+        FlatCombiningCallbacks getFlatCombiningCallbacks();
+        // Движок асинхронных операций создаётся при первой из них.
+        AsyncOperationEngine& getAsyncOperationEngine();
+        // Возвращает rStack, если у него нет незавершённых асинхронных операций, иначе - std::logic_error.
+        static RmaTreiberCentralStack& checkNoPendingAsyncOperations(RmaTreiberCentralStack &rStack);
+        /*
+         * Ослабленный режим: popFromHead вызывается сначала для головы
+         * группы текущего процесса, а затем для остальных голов, начиная
+         * со случайной, пока не вернёт true.
+         */
+        template<typename PopFromHead>
+        bool popWithStealing(PopFromHead &&popFromHead);
+
+        // Данные у процесса, выполнившего PUSH, см. PayloadPlacement::Producer.
+        [[nodiscard]] ref_counting::PayloadRef storeAtProducer(const T &rValue);
+        // Читает данные и освобождает блок.
+        void takeFromProducer(const ref_counting::PayloadRef &rPayloadRef, T &rValue);
+
+        void initRemoteAccessMemory(MPI_Comm comm, MPI_Info info, PayloadPlacement payloadPlacement);
+        static void initUserDataSegment(ref_counting::SegmentedArena& rUserDataArena, size_t segmentIdx);
 
     private:
-        std::chrono::nanoseconds m_backoffMinDelay;
-        std::chrono::nanoseconds m_backoffMaxDelay;
+        // Состояние политики задержки сохраняется между операциями, см. BackoffPolicies.h.
+        BackoffPolicy m_backoff;
 
         ref_counting::InnerStack m_innerStack;
         int m_rank{-1};
         MPI_Win m_userDataWin{MPI_WIN_NULL};
-        T* m_pUserDataArr{nullptr};
-        MPI_Aint m_userDataBaseAddress{(MPI_Aint)MPI_BOTTOM};
+        std::unique_ptr<ref_counting::SegmentedArena> m_pUserDataArena;
+        // Создаётся только в режиме PayloadPlacement::Producer, окно данных у HEAD_RANK тогда не создаётся.
+        std::unique_ptr<ref_counting::PayloadArena> m_pProducerPayloadArena;
+        std::vector<ref_counting::PayloadRef> m_payloadRefs;
+        std::unique_ptr<EliminationArray> m_pEliminationArray;
+        std::unique_ptr<FlatCombiner> m_pFlatCombiner;
+        std::unique_ptr<AsyncOperationEngine> m_pAsyncOperationEngine;
+        std::mt19937 m_randomEngine;
+        size_t m_stolenOpsNum{0};
+        // Копия вершины, на которую ссылается результат top.
+        T m_topValue{};
         std::shared_ptr<spdlog::logger> m_logger;
     };
 
-    template<typename T>
-    void RmaTreiberCentralStack<T>::release()
+    template<typename T, typename BackoffPolicy>
+    void RmaTreiberCentralStack<T, BackoffPolicy>::release()
     {
+        if (m_pAsyncOperationEngine)
+            m_pAsyncOperationEngine->waitAll();
+        m_pFlatCombiner->release();
+        m_pEliminationArray->release();
         m_innerStack.release();
+        if constexpr (IsPayloadInline)
+            return;
+        if (m_pProducerPayloadArena)
+        {
+            m_pProducerPayloadArena->release();
+            return;
+        }
 
-        MPI_Free_mem(m_pUserDataArr);
-        m_pUserDataArr = nullptr;
+        ref_counting::endWinEpoch(m_userDataWin, m_innerStack.getEpochMode());
+        m_pUserDataArena->release();
         m_logger->trace("freed up data arr RMA memory");
 
         MPI_Win_free(&m_userDataWin);
         m_logger->trace("freed up data win RMA memory");
     }
 
-    template<typename T>
-    RmaTreiberCentralStack<T>::RmaTreiberCentralStack(MPI_Comm comm, MPI_Info info,
+    template<typename T, typename BackoffPolicy>
+    void RmaTreiberCentralStack<T, BackoffPolicy>::reclaimRetiredNodes()
+    {
+        m_innerStack.reclaimRetiredNodes();
+    }
+
+    template<typename T, typename BackoffPolicy>
+    size_t RmaTreiberCentralStack<T, BackoffPolicy>::getReclamationMemoryOverhead() const
+    {
+        // Данные пользователя отложенного узла также не могут быть переиспользованы.
+        // Блок данных у процесса, выполнившего PUSH, освобождается сразу после POP.
+        const size_t retiredUserDataSize = IsPayloadInline || m_pProducerPayloadArena
+                ? 0
+                : m_innerStack.getRetiredNodesNum() * sizeof(T);
+        return m_innerStack.getReclamationMemoryOverhead() + retiredUserDataSize;
+    }
+
+    template<typename T, typename BackoffPolicy>
+    size_t RmaTreiberCentralStack<T, BackoffPolicy>::getEliminatedOpsNum() const
+    {
+        return m_pEliminationArray->getEliminatedOpsNum();
+    }
+
+    template<typename T, typename BackoffPolicy>
+    size_t RmaTreiberCentralStack<T, BackoffPolicy>::getCombinedOpsNum() const
+    {
+        return m_pFlatCombiner->getCombinedOpsNum();
+    }
+
+    template<typename T, typename BackoffPolicy>
+    size_t RmaTreiberCentralStack<T, BackoffPolicy>::getStolenOpsNum() const
+    {
+        return m_stolenOpsNum;
+    }
+
+    template<typename T, typename BackoffPolicy>
+    size_t RmaTreiberCentralStack<T, BackoffPolicy>::getProducerPayloadMemorySize() const
+    {
+        return m_pProducerPayloadArena ? m_pProducerPayloadArena->getAllocatedSize() : 0;
+    }
+
+    template<typename T, typename BackoffPolicy>
+    ref_counting::PayloadRef RmaTreiberCentralStack<T, BackoffPolicy>::storeAtProducer(const T &rValue)
+    {
+        const auto payloadRef = m_pProducerPayloadArena->allocate(sizeof(T));
+        std::memcpy(m_pProducerPayloadArena->getLocalBlock(payloadRef), &rValue, sizeof(T));
+        return payloadRef;
+    }
+
+    template<typename T, typename BackoffPolicy>
+    void RmaTreiberCentralStack<T, BackoffPolicy>::takeFromProducer(const ref_counting::PayloadRef &rPayloadRef, T &rValue)
+    {
+        m_pProducerPayloadArena->read(rPayloadRef, reinterpret_cast<std::byte*>(&rValue));
+        m_pProducerPayloadArena->deallocate(rPayloadRef);
+    }
+
+    template<typename T, typename BackoffPolicy>
+    void RmaTreiberCentralStack<T, BackoffPolicy>::setPhaseTimingEnabled(bool phaseTimingEnabled)
+    {
+        m_innerStack.setPhaseTimingEnabled(phaseTimingEnabled);
+    }
+
+    template<typename T, typename BackoffPolicy>
+    ref_counting::PopPhaseTimes RmaTreiberCentralStack<T, BackoffPolicy>::getPopPhaseTimes() const
+    {
+        return m_innerStack.getPopPhaseTimes();
+    }
+
+    template<typename T, typename BackoffPolicy>
+    ref_counting::PushPhaseTimes RmaTreiberCentralStack<T, BackoffPolicy>::getPushPhaseTimes() const
+    {
+        return m_innerStack.getPushPhaseTimes();
+    }
+
+    template<typename T, typename BackoffPolicy>
+    void RmaTreiberCentralStack<T, BackoffPolicy>::resetPhaseTimes()
+    {
+        m_innerStack.resetPhaseTimes();
+    }
+
+    template<typename T, typename BackoffPolicy>
+    const ref_counting::OperationCounters& RmaTreiberCentralStack<T, BackoffPolicy>::getOperationCounters() const
+    {
+        return m_innerStack.getOperationCounters();
+    }
+
+    template<typename T, typename BackoffPolicy>
+    void RmaTreiberCentralStack<T, BackoffPolicy>::resetOperationCounters()
+    {
+        m_innerStack.resetOperationCounters();
+    }
+
+    template<typename T, typename BackoffPolicy>
+    AsyncOperation RmaTreiberCentralStack<T, BackoffPolicy>::pushAsync(const T &rValue)
+    {
+        static_assert(IsPayloadInline, "asynchronous operations require the payload stored in the nodes");
+        return getAsyncOperationEngine().startPush(&rValue);
+    }
+
+    template<typename T, typename BackoffPolicy>
+    AsyncOperation RmaTreiberCentralStack<T, BackoffPolicy>::popAsync(T &rValue, const T &rDefaultValue)
+    {
+        static_assert(IsPayloadInline, "asynchronous operations require the payload stored in the nodes");
+        return getAsyncOperationEngine().startPop(&rValue, &rDefaultValue);
+    }
+
+    template<typename T, typename BackoffPolicy>
+    size_t RmaTreiberCentralStack<T, BackoffPolicy>::progressAsync()
+    {
+        return m_pAsyncOperationEngine ? m_pAsyncOperationEngine->progress() : 0;
+    }
+
+    template<typename T, typename BackoffPolicy>
+    void RmaTreiberCentralStack<T, BackoffPolicy>::serviceGrowRequests()
+    {
+        m_innerStack.serviceGrowRequests();
+    }
+
+    template<typename T, typename BackoffPolicy>
+    AsyncOperationEngine &RmaTreiberCentralStack<T, BackoffPolicy>::getAsyncOperationEngine()
+    {
+        if (!m_pAsyncOperationEngine)
+        {
+            // Как и на m_innerStack, движок ссылается на политику задержки стека, общую с синхронными операциями.
+            AsyncBackoffCallbacks backoffCallbacks{
+                [&backoff = m_backoff] () {
+                    return backoff.nextDelay();
+                },
+                [&backoff = m_backoff] (size_t casFailuresNum) {
+                    backoff.onOperationCompleted(casFailuresNum);
+                }
+            };
+            m_pAsyncOperationEngine = std::make_unique<AsyncOperationEngine>(m_innerStack, std::move(backoffCallbacks),
+                                                                             m_logger);
+        }
+        return *m_pAsyncOperationEngine;
+    }
+
+    template<typename T, typename BackoffPolicy>
+    RmaTreiberCentralStack<T, BackoffPolicy>::RmaTreiberCentralStack(RmaTreiberCentralStack &&rOther)
+    :
+    m_backoff(std::move(checkNoPendingAsyncOperations(rOther).m_backoff)),
+    m_innerStack(std::move(rOther.m_innerStack)),
+    m_rank(rOther.m_rank),
+    m_userDataWin(rOther.m_userDataWin),
+    m_pUserDataArena(std::move(rOther.m_pUserDataArena)),
+    m_pProducerPayloadArena(std::move(rOther.m_pProducerPayloadArena)),
+    m_payloadRefs(std::move(rOther.m_payloadRefs)),
+    m_pEliminationArray(std::move(rOther.m_pEliminationArray)),
+    m_pFlatCombiner(std::move(rOther.m_pFlatCombiner)),
+    m_randomEngine(std::move(rOther.m_randomEngine)),
+    m_stolenOpsNum(rOther.m_stolenOpsNum),
+    m_topValue(std::move(rOther.m_topValue)),
+    m_logger(std::move(rOther.m_logger))
+    {
+        rOther.m_pAsyncOperationEngine.reset();
+    }
+
+    template<typename T, typename BackoffPolicy>
+    RmaTreiberCentralStack<T, BackoffPolicy> &RmaTreiberCentralStack<T, BackoffPolicy>::checkNoPendingAsyncOperations(
+                                                                                                                      RmaTreiberCentralStack &rStack)
+    {
+        if (rStack.m_pAsyncOperationEngine && rStack.m_pAsyncOperationEngine->getPendingOperationsNum() > 0)
+            throw std::logic_error("the stack cannot be moved while asynchronous operations are pending");
+        return rStack;
+    }
+
+    template<typename T, typename BackoffPolicy>
+    RmaTreiberCentralStack<T, BackoffPolicy>::RmaTreiberCentralStack(MPI_Comm comm, MPI_Info info,
                                                       const std::chrono::nanoseconds &t_rBackoffMinDelay,
                                                       const std::chrono::nanoseconds &t_rBackoffMaxDelay,
                                                       ref_counting::InnerStack &&t_innerStack,
+                                                      size_t t_eliminationSlotsPerRank,
+                                                      FlatCombiningMode t_flatCombiningMode,
+                                                      PayloadPlacement t_payloadPlacement,
                                                       std::shared_ptr<spdlog::logger> t_logger)
     :
-    m_backoffMinDelay(t_rBackoffMinDelay),
-    m_backoffMaxDelay(t_rBackoffMaxDelay),
+    m_backoff(t_rBackoffMinDelay, t_rBackoffMaxDelay),
     m_innerStack(std::move(t_innerStack)),
     m_logger(std::move(t_logger))
     {
         MPI_Comm_rank(comm, &m_rank);
 
-        initRemoteAccessMemory(comm, info);
+        initRemoteAccessMemory(comm, info, t_payloadPlacement);
+        m_pEliminationArray = std::make_unique<EliminationArray>(comm, info, sizeof(T), t_eliminationSlotsPerRank,
+                                                                 m_innerStack.getEpochMode(), m_logger);
+        // Комбинирующий процесс работает только с головой у HEAD_RANK, поэтому в ослабленном режиме он не используется.
+        const auto flatCombiningMode = m_innerStack.getHeadsNum() > 1 ? FlatCombiningMode::Disabled : t_flatCombiningMode;
+        m_pFlatCombiner = std::make_unique<FlatCombiner>(comm, info, ref_counting::InnerStack::HEAD_RANK, sizeof(T),
+                                                         flatCombiningMode, m_innerStack.getEpochMode(), m_logger);
+        m_randomEngine.seed(std::chrono::steady_clock::now().time_since_epoch().count() + m_rank);
     }
 
-    template<typename T>
-    void RmaTreiberCentralStack<T>::pushImpl(const T &rValue)
+    template<typename T, typename BackoffPolicy>
+    bool RmaTreiberCentralStack<T, BackoffPolicy>::pushDirect(const T &rValue)
     {
-        ExponentialBackoff backoff(m_backoffMinDelay, m_backoffMaxDelay);
-        m_innerStack.push([&rValue, &win = m_userDataWin, &dataBaseAddress = m_userDataBaseAddress](
-                const ref_counting::GlobalAddress &dataAddress) {
-                if (ref_counting::isGlobalAddressDummy(dataAddress))
-                    return;
+        auto &backoff = m_backoff;
+        size_t casFailuresNum{0};
+        // Вместо задержки PUSH ждёт встречный POP в массиве исключения.
+        const auto backoffCallback = [&rValue, &backoff, &casFailuresNum, &rEliminationArray = *m_pEliminationArray] () {
+            ++casFailuresNum;
+            if (!rEliminationArray.isEnabled())
+            {
+                backoff.backoff();
+                return false;
+            }
+            return rEliminationArray.tryPush(&rValue, backoff.nextDelay());
+        };
+        bool pushed{false};
+        if constexpr (IsPayloadInline)
+        {
+            pushed = m_innerStack.pushInline(&rValue, backoffCallback, m_innerStack.getLocalHeadIdx());
+        }
+        else if (m_pProducerPayloadArena)
+        {
+            const auto payloadRef = storeAtProducer(rValue);
+            m_pProducerPayloadArena->publishLocalBlocks();
+            bool eliminated{false};
+            pushed = m_innerStack.pushInline(&payloadRef, [&backoffCallback, &eliminated] () {
+                    eliminated = backoffCallback();
+                    return eliminated;
+                },
+                m_innerStack.getLocalHeadIdx()
+            );
+            // Значение передано встречному POP напрямую, и блок не понадобился.
+            if (!pushed || eliminated)
+                m_pProducerPayloadArena->deallocate(payloadRef);
+        }
+        else
+        {
+            pushed = m_innerStack.push([&rValue, &win = m_userDataWin, &rUserDataArena = *m_pUserDataArena,
+                                                 &rCounters = m_innerStack.getOperationCounters(),
+                                                 epochMode = m_innerStack.getEpochMode()](
+                    const ref_counting::GlobalAddress &dataAddress) {
+                    if (ref_counting::isGlobalAddressDummy(dataAddress))
+                        return;
 
-                constexpr auto valueSize = sizeof(rValue);
-                const auto displacement = dataAddress.offset * valueSize;
-                const auto offset = MPI_Aint_add(dataBaseAddress, displacement);
+                    constexpr auto valueSize = sizeof(rValue);
+                    const auto offset = rUserDataArena.getElemAddress(dataAddress);
 
-                MPI_Win_lock(MPI_LOCK_SHARED, dataAddress.rank, MPI_MODE_NOCHECK, win);
-                MPI_Put(&rValue,
-                        valueSize,
-                        MPI_UNSIGNED_CHAR,
-                        dataAddress.rank,
-                        offset,
-                        valueSize,
-                        MPI_UNSIGNED_CHAR,
-                        win
-                );
-                MPI_Win_flush(dataAddress.rank, win);
-                MPI_Win_unlock(dataAddress.rank, win);
-            },
-             [&backoff] () {
-                 backoff.backoff();
-             }
-        );
+                    ref_counting::lockWinTarget(dataAddress.rank, win, epochMode);
+                    ref_counting::rmaPut(&rValue,
+                                         valueSize,
+                                         MPI_UNSIGNED_CHAR,
+                                         dataAddress.rank,
+                                         offset,
+                                         win,
+                                         &rCounters
+                    );
+                    ref_counting::unlockWinTarget(dataAddress.rank, win, epochMode, &rCounters);
+                },
+                backoffCallback,
+                m_innerStack.getLocalHeadIdx()
+            );
+        }
+        m_pFlatCombiner->registerCasFailures(casFailuresNum);
+        m_backoff.onOperationCompleted(casFailuresNum);
+        return pushed;
+    }
+
+    template<typename T, typename BackoffPolicy>
+    void RmaTreiberCentralStack<T, BackoffPolicy>::pushImpl(const T &rValue)
+    {
+        const bool pushed = m_pFlatCombiner->shouldCombine()
+                ? m_pFlatCombiner->push(&rValue, getFlatCombiningCallbacks())
+                : pushDirect(rValue);
+        if (!pushed)
+            m_logger->warn("failed to push: node pool is exhausted");
 
         m_logger->trace("finished 'push'",m_rank);
     }
 
-    template<typename T>
-    void RmaTreiberCentralStack<T>::popImpl(T &rValue, const T &rDefaultValue)
+    template<typename T, typename BackoffPolicy>
+    bool RmaTreiberCentralStack<T, BackoffPolicy>::popDirect(T &rValue)
+    {
+        auto &backoff = m_backoff;
+        size_t casFailuresNum{0};
+        // Перед задержкой POP пробует забрать данные встречного PUSH из массива исключения.
+        bool eliminated{false};
+        const auto backoffCallback = [&rValue, &backoff, &casFailuresNum, &eliminated,
+                                      &rEliminationArray = *m_pEliminationArray] () {
+            ++casFailuresNum;
+            eliminated = rEliminationArray.isEnabled() && rEliminationArray.tryPop(&rValue);
+            if (!eliminated)
+                backoff.backoff();
+            return eliminated;
+        };
+        const auto popFromHead = [this, &rValue, &eliminated, &backoffCallback] (size_t headIdx) {
+            bool popped{false};
+            if constexpr (IsPayloadInline)
+            {
+                popped = m_innerStack.popInline(&rValue, backoffCallback, headIdx);
+            }
+            else if (m_pProducerPayloadArena)
+            {
+                ref_counting::PayloadRef payloadRef;
+                popped = m_innerStack.popInline(&payloadRef, backoffCallback, headIdx);
+                if (popped && !eliminated)
+                    takeFromProducer(payloadRef, rValue);
+            }
+            else
+            {
+                // Значение может быть прочитано до снятия узла, поэтому оно действительно, только если pop вернул true.
+                popped = m_innerStack.pop([&rValue, &win = m_userDataWin, &rUserDataArena = *m_pUserDataArena,
+                                                    &rCounters = m_innerStack.getOperationCounters(),
+                                                    epochMode = m_innerStack.getEpochMode()](
+                        const ref_counting::GlobalAddress &dataAddress, MPI_Request &rDataRequest) {
+                        constexpr auto valueSize = sizeof(rValue);
+                        const auto displacement = rUserDataArena.getElemAddress(dataAddress);
+                        ref_counting::lockWinTarget(dataAddress.rank, win, epochMode);
+                        ref_counting::rmaRget(&rValue,
+                                              valueSize,
+                                              MPI_UNSIGNED_CHAR,
+                                              dataAddress.rank,
+                                              displacement,
+                                              win,
+                                              &rDataRequest,
+                                              &rCounters
+                        );
+                        ref_counting::unlockWinTargetDeferred(dataAddress.rank, win, epochMode, &rCounters);
+                    },
+                    backoffCallback,
+                    headIdx
+                );
+            }
+            return popped || eliminated;
+        };
+        const bool popped = popWithStealing(popFromHead);
+
+        m_pFlatCombiner->registerCasFailures(casFailuresNum);
+        m_backoff.onOperationCompleted(casFailuresNum);
+        return popped;
+    }
+
+    template<typename T, typename BackoffPolicy>
+    bool RmaTreiberCentralStack<T, BackoffPolicy>::tryPop(T &rValue)
+    {
+        return m_pFlatCombiner->shouldCombine()
+                ? m_pFlatCombiner->pop(&rValue, getFlatCombiningCallbacks())
+                : popDirect(rValue);
+    }
+
+    template<typename T, typename BackoffPolicy>
+    void RmaTreiberCentralStack<T, BackoffPolicy>::popImpl(T &rValue, const T &rDefaultValue)
+    {
+        if (!tryPop(rValue))
+            rValue = rDefaultValue;
+        m_logger->trace("finished 'popImpl'",m_rank);
+    }
+
+    template<typename T, typename BackoffPolicy>
+    bool RmaTreiberCentralStack<T, BackoffPolicy>::popWait(T &rValue, const std::chrono::nanoseconds &timeout)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        auto &rWaiterTable  = m_innerStack.getWaiterTable();
+        for (;;)
+        {
+            if (tryPop(rValue))
+                return true;
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+
+            // Стек проверяется повторно после регистрации, иначе PUSH между проверкой и регистрацией будет пропущен.
+            rWaiterTable.resetNotification();
+            rWaiterTable.registerWaiter();
+            const bool popped = tryPop(rValue);
+            while (!popped && !rWaiterTable.isNotified() && std::chrono::steady_clock::now() < deadline)
+            {
+                std::this_thread::yield();
+            }
+            rWaiterTable.unregisterWaiter();
+            if (popped)
+                return true;
+            m_logger->trace("woke up in 'popWait'");
+        }
+    }
+
+    /*
+     * Пакетные операции всегда выполняются напрямую над головой стека:
+     * весь пакет и так присоединяется или отсоединяется одной операцией
+     * CAS, поэтому массив исключения и комбинирование не используются.
+     */
+    template<typename T, typename BackoffPolicy>
+    size_t RmaTreiberCentralStack<T, BackoffPolicy>::pushBulkImpl(const T *pValues, size_t valuesNum)
+    {
+        size_t casFailuresNum{0};
+        const auto backoffCallback = [&backoff = m_backoff, &casFailuresNum] () {
+            ++casFailuresNum;
+            backoff.backoff();
+        };
+        size_t pushedNum{0};
+        if constexpr (IsPayloadInline)
+        {
+            pushedNum = m_innerStack.pushBulkInline(pValues, valuesNum, backoffCallback, m_innerStack.getLocalHeadIdx());
+        }
+        else if (m_pProducerPayloadArena)
+        {
+            m_payloadRefs.clear();
+            for (size_t i = 0; i < valuesNum; ++i)
+                m_payloadRefs.push_back(storeAtProducer(pValues[i]));
+            m_pProducerPayloadArena->publishLocalBlocks();
+
+            pushedNum = m_innerStack.pushBulkInline(m_payloadRefs.data(), valuesNum, backoffCallback,
+                                                    m_innerStack.getLocalHeadIdx());
+            for (size_t i = pushedNum; i < valuesNum; ++i)
+                m_pProducerPayloadArena->deallocate(m_payloadRefs[i]);
+        }
+        else
+        {
+            pushedNum = m_innerStack.pushBulk(valuesNum, [pValues, &win = m_userDataWin, &rUserDataArena = *m_pUserDataArena,
+                                                                   &rCounters = m_innerStack.getOperationCounters(),
+                                                                   epochMode = m_innerStack.getEpochMode()](
+                    size_t valueIdx, const ref_counting::GlobalAddress &dataAddress) {
+                    constexpr auto valueSize = sizeof(T);
+                    const auto offset = rUserDataArena.getElemAddress(dataAddress);
+
+                    ref_counting::lockWinTarget(dataAddress.rank, win, epochMode);
+                    ref_counting::rmaPut(pValues + valueIdx,
+                                         valueSize,
+                                         MPI_UNSIGNED_CHAR,
+                                         dataAddress.rank,
+                                         offset,
+                                         win,
+                                         &rCounters
+                    );
+                    ref_counting::unlockWinTarget(dataAddress.rank, win, epochMode, &rCounters);
+                },
+                backoffCallback,
+                m_innerStack.getLocalHeadIdx()
+            );
+        }
+        if (pushedNum < valuesNum)
+            m_logger->warn("pushed {} of {} values: node pool is exhausted", pushedNum, valuesNum);
+
+        m_backoff.onOperationCompleted(casFailuresNum);
+        m_logger->trace("finished 'pushBulkImpl'");
+        return pushedNum;
+    }
+
+    template<typename T, typename BackoffPolicy>
+    size_t RmaTreiberCentralStack<T, BackoffPolicy>::popBulkImpl(size_t valuesNum, T *pValues)
+    {
+        size_t casFailuresNum{0};
+        const auto backoffCallback = [&backoff = m_backoff, &casFailuresNum] () {
+            ++casFailuresNum;
+            backoff.backoff();
+        };
+        size_t poppedNum{0};
+        if constexpr (!IsPayloadInline)
+        {
+            if (m_pProducerPayloadArena)
+                m_payloadRefs.resize(valuesNum);
+        }
+        // Недостающие значения снимаются с остальных голов.
+        popWithStealing([this, pValues, valuesNum, &poppedNum, &backoffCallback] (size_t headIdx) {
+            auto pHeadValues = pValues + poppedNum;
+            if constexpr (IsPayloadInline)
+            {
+                poppedNum += m_innerStack.popBulkInline(pHeadValues, valuesNum - poppedNum, backoffCallback, headIdx);
+            }
+            else if (m_pProducerPayloadArena)
+            {
+                poppedNum += m_innerStack.popBulkInline(m_payloadRefs.data() + poppedNum, valuesNum - poppedNum,
+                                                        backoffCallback, headIdx);
+            }
+            else
+            {
+                poppedNum += m_innerStack.popBulk(valuesNum - poppedNum, [pHeadValues, &win = m_userDataWin, &rUserDataArena = *m_pUserDataArena,
+                                                                                       &rCounters = m_innerStack.getOperationCounters(),
+                                                                                       epochMode = m_innerStack.getEpochMode()](
+                        size_t valueIdx, const ref_counting::GlobalAddress &dataAddress, MPI_Request &rDataRequest) {
+                        constexpr auto valueSize = sizeof(T);
+                        const auto displacement = rUserDataArena.getElemAddress(dataAddress);
+
+                        ref_counting::lockWinTarget(dataAddress.rank, win, epochMode);
+                        ref_counting::rmaRget(pHeadValues + valueIdx,
+                                              valueSize,
+                                              MPI_UNSIGNED_CHAR,
+                                              dataAddress.rank,
+                                              displacement,
+                                              win,
+                                              &rDataRequest,
+                                              &rCounters
+                        );
+                        ref_counting::unlockWinTargetDeferred(dataAddress.rank, win, epochMode, &rCounters);
+                    },
+                    backoffCallback,
+                    headIdx
+                );
+            }
+            return poppedNum == valuesNum;
+        });
+        // Данные читаются у процессов, выполнивших PUSH, уже после снятия всех узлов.
+        if constexpr (!IsPayloadInline)
+        {
+            if (m_pProducerPayloadArena)
+            {
+                for (size_t i = 0; i < poppedNum; ++i)
+                    takeFromProducer(m_payloadRefs[i], pValues[i]);
+            }
+        }
+
+        m_backoff.onOperationCompleted(casFailuresNum);
+        m_logger->trace("finished 'popBulkImpl'");
+        return poppedNum;
+    }
+
+    template<typename T, typename BackoffPolicy>
+    template<typename PopFromHead>
+    bool RmaTreiberCentralStack<T, BackoffPolicy>::popWithStealing(PopFromHead &&popFromHead)
+    {
+        const auto headsNum     = m_innerStack.getHeadsNum();
+        const auto localHeadIdx = m_innerStack.getLocalHeadIdx();
+        if (popFromHead(localHeadIdx))
+            return true;
+        if (headsNum == 1)
+            return false;
+
+        const auto firstVictimIdx = std::uniform_int_distribution<size_t>(0, headsNum - 2)(m_randomEngine);
+        for (size_t i = 0; i < headsNum - 1; ++i)
+        {
+            const auto headIdx = (localHeadIdx + 1 + (firstVictimIdx + i) % (headsNum - 1)) % headsNum;
+            if (popFromHead(headIdx))
+            {
+                ++m_stolenOpsNum;
+                m_logger->trace("stole value from head {}", headIdx);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template<typename T, typename BackoffPolicy>
+    FlatCombiningCallbacks RmaTreiberCentralStack<T, BackoffPolicy>::getFlatCombiningCallbacks()
+    {
+        return FlatCombiningCallbacks{
+            [this](const void *pPayload) {
+                return pushDirect(*static_cast<const T*>(pPayload));
+            },
+            [this](void *pPayload) {
+                return popDirect(*static_cast<T*>(pPayload));
+            },
+            [this] () {
+                m_backoff.backoff();
+            }
+        };
+    }
+
+    template<typename T, typename BackoffPolicy>
+    bool RmaTreiberCentralStack<T, BackoffPolicy>::tryTop(T &rValue)
     {
-        ExponentialBackoff backoff(m_backoffMinDelay, m_backoffMaxDelay);
-        m_innerStack.pop([&rValue, &rDefaultValue, &win = m_userDataWin, &dataBaseAddress = m_userDataBaseAddress](
-                const ref_counting::GlobalAddress &dataAddress) {
-                if (ref_counting::isGlobalAddressDummy(dataAddress))
+        const auto headsNum     = m_innerStack.getHeadsNum();
+        const auto localHeadIdx = m_innerStack.getLocalHeadIdx();
+        for (size_t i = 0; i < headsNum; ++i)
+        {
+            const auto headIdx = (localHeadIdx + i) % headsNum;
+            // Значение читается во временную переменную, так как чтение может повториться для новой вершины.
+            T value{};
+            bool found{false};
+            if constexpr (IsPayloadInline)
+            {
+                found = m_innerStack.topInline(&value, headIdx);
+            }
+            else if (m_pProducerPayloadArena)
+            {
+                /*
+                 * Блок вершины не защищён от освобождения: его могут
+                 * освободить и выделить заново под другое значение по тому
+                 * же адресу. Поэтому после чтения данных вершина
+                 * перечитывается, и чтение повторяется, если сменился
+                 * узел вершины или номер его публикации. Блок освобождается
+                 * только после снятия узла, поэтому, пока та же публикация
+                 * остаётся вершиной, блок не переиспользуется.
+                 */
+                ref_counting::PayloadRef payloadRef;
+                ref_counting::NodeStamp nodeStamp;
+                found = m_innerStack.topInline(&payloadRef, headIdx, &nodeStamp);
+                while (found)
                 {
-                    rValue = rDefaultValue;
-                    return;
+                    m_pProducerPayloadArena->read(payloadRef, reinterpret_cast<std::byte*>(&value));
+                    ref_counting::PayloadRef resPayloadRef;
+                    ref_counting::NodeStamp resNodeStamp;
+                    found = m_innerStack.topInline(&resPayloadRef, headIdx, &resNodeStamp);
+                    if (resNodeStamp == nodeStamp)
+                        break;
+                    payloadRef = resPayloadRef;
+                    nodeStamp  = resNodeStamp;
                 }
+            }
+            else
+            {
+                found = m_innerStack.top([&value, &win = m_userDataWin, &rUserDataArena = *m_pUserDataArena,
+                                                  &rCounters = m_innerStack.getOperationCounters(),
+                                                  epochMode = m_innerStack.getEpochMode()](
+                        const ref_counting::GlobalAddress &dataAddress) {
+                        constexpr auto valueSize = sizeof(T);
+                        const auto displacement = rUserDataArena.getElemAddress(dataAddress);
 
-                constexpr auto valueSize = sizeof(rValue);
-                const auto offset = dataAddress.offset * valueSize;
-                const auto displacement = MPI_Aint_add(dataBaseAddress, offset);
-                MPI_Win_lock(MPI_LOCK_SHARED, dataAddress.rank, MPI_MODE_NOCHECK, win);
-                MPI_Get(&rValue,
-                        valueSize,
-                        MPI_UNSIGNED_CHAR,
-                        dataAddress.rank,
-                        displacement,
-                        valueSize,
-                        MPI_UNSIGNED_CHAR,
-                        win
+                        ref_counting::lockWinTarget(dataAddress.rank, win, epochMode);
+                        ref_counting::rmaGet(&value,
+                                             valueSize,
+                                             MPI_UNSIGNED_CHAR,
+                                             dataAddress.rank,
+                                             displacement,
+                                             win,
+                                             &rCounters
+                        );
+                        ref_counting::unlockWinTarget(dataAddress.rank, win, epochMode, &rCounters);
+                    },
+                    headIdx
                 );
-                MPI_Win_flush(dataAddress.rank, win);
-                MPI_Win_unlock(dataAddress.rank, win);
-            },
-            [&backoff] () {
-                backoff.backoff();
             }
-        );
-        m_logger->trace("finished 'popImpl'",m_rank);
+            if (found)
+            {
+                rValue = value;
+                return true;
+            }
+        }
+        return false;
     }
 
-    template<typename T>
-    T &rma_stack::RmaTreiberCentralStack<T>::topImpl() {
-        T v{};
-        return v;
+    /*
+     * Результат ссылается на копию вершины, которая хранится в стеке до
+     * следующего вызова top. Если стек пуст, то копия равна T{}.
+     */
+    template<typename T, typename BackoffPolicy>
+    T &RmaTreiberCentralStack<T, BackoffPolicy>::topImpl()
+    {
+        if (!tryTop(m_topValue))
+            m_topValue = T{};
+        return m_topValue;
     }
 
-    template<typename T>
-    size_t RmaTreiberCentralStack<T>::sizeImpl()
+    // Сумма приблизительных счётчиков всех голов, для единственной головы - одно чтение.
+    template<typename T, typename BackoffPolicy>
+    size_t RmaTreiberCentralStack<T, BackoffPolicy>::sizeImpl()
     {
-        return 0;
+        size_t size{0};
+        for (size_t headIdx = 0; headIdx < m_innerStack.getHeadsNum(); ++headIdx)
+            size += m_innerStack.getApproximateSize(headIdx);
+        return size;
     }
 
-    template<typename T>
-    bool RmaTreiberCentralStack<T>::isEmptyImpl()
+    template<typename T, typename BackoffPolicy>
+    bool RmaTreiberCentralStack<T, BackoffPolicy>::isEmptyImpl()
     {
+        for (size_t headIdx = 0; headIdx < m_innerStack.getHeadsNum(); ++headIdx)
+        {
+            if (!m_innerStack.isEmpty(headIdx))
+                return false;
+        }
         return true;
     }
 
-    template<typename T>
-    void RmaTreiberCentralStack<T>::initRemoteAccessMemory(MPI_Comm comm, MPI_Info info)
+    template<typename T, typename BackoffPolicy>
+    void RmaTreiberCentralStack<T, BackoffPolicy>::initRemoteAccessMemory(MPI_Comm comm, MPI_Info info,
+                                                                           PayloadPlacement payloadPlacement)
     {
+        if constexpr (IsPayloadInline)
+            return;
+        if (payloadPlacement == PayloadPlacement::Producer)
+        {
+            m_pProducerPayloadArena = std::make_unique<ref_counting::PayloadArena>(comm, info, sizeof(T),
+                                                                                  m_innerStack.getEpochMode(), m_logger,
+                                                                                  &m_innerStack.getOperationCounters());
+            return;
+        }
+
         {
             auto mpiStatus = MPI_Win_create_dynamic(info, comm, &m_userDataWin);
             if (mpiStatus != MPI_SUCCESS)
                 throw custom_mpi::MpiException("failed to create RMA window for head", __FILE__, __func__, __LINE__, mpiStatus);
         }
+        ref_counting::beginWinEpoch(m_userDataWin, m_innerStack.getEpochMode());
+
+        m_pUserDataArena = std::make_unique<ref_counting::SegmentedArena>(
+                comm,
+                m_userDataWin,
+                m_innerStack.getEpochMode(),
+                true,
+                ref_counting::InnerStack::HEAD_RANK,
+                sizeof(T),
+                m_innerStack.getSegmentCapacity(),
+                m_innerStack.getElemsUpLimit(),
+                m_logger
+        );
 
+        // Сегменты узлов выделяет HEAD_RANK, и сегмент данных выделяется вместе с каждым из них.
         if (m_rank == ref_counting::InnerStack::HEAD_RANK)
         {
-            m_logger->trace("started to initialize user data array");
-            auto elemsUpLimit = m_innerStack.getElemsUpLimit();
-            constexpr auto elemSize = sizeof(T);
-            {
-                auto mpiStatus = MPI_Alloc_mem(elemSize * elemsUpLimit, MPI_INFO_NULL,
-                                               &m_pUserDataArr);
-                if (mpiStatus != MPI_SUCCESS)
-                    throw custom_mpi::MpiException(
-                            "failed to allocate RMA memory",
-                            __FILE__,
-                            __func__,
-                            __LINE__,
-                            mpiStatus
-                    );
-            }
-            std::fill_n(m_pUserDataArr, elemsUpLimit, T());
-            m_logger->trace("initialized user data array");
+            if (m_innerStack.getElemsUpLimit() > 0)
             {
-                auto mpiStatus = MPI_Win_attach(m_userDataWin, m_pUserDataArr, elemSize * elemsUpLimit);
-                if (mpiStatus != MPI_SUCCESS)
-                    throw custom_mpi::MpiException("failed to attach RMA window", __FILE__, __func__, __LINE__, mpiStatus);
+                m_pUserDataArena->grow();
+                initUserDataSegment(*m_pUserDataArena, 0);
             }
-            m_logger->trace("attached user data RMA window");
-            MPI_Get_address(m_pUserDataArr, &m_userDataBaseAddress);
+            m_innerStack.setSegmentGrowthCallback([pUserDataArena = m_pUserDataArena.get()](size_t segmentIdx) {
+                pUserDataArena->grow();
+                initUserDataSegment(*pUserDataArena, segmentIdx);
+            });
         }
-        m_logger->trace("started to broadcast user data base address");
-        auto mpiStatus = MPI_Bcast(&m_userDataBaseAddress, 1, MPI_AINT, ref_counting::InnerStack::HEAD_RANK, comm);
-        if (mpiStatus != MPI_SUCCESS)
-            throw custom_mpi::MpiException("failed to broadcast head address", __FILE__, __func__ , __LINE__, mpiStatus);
-        m_logger->trace("broadcasted user data base address");
     }
 
-    template<typename T>
-    RmaTreiberCentralStack<T> RmaTreiberCentralStack<T>::create(MPI_Comm comm, MPI_Info info,
+    template<typename T, typename BackoffPolicy>
+    void RmaTreiberCentralStack<T, BackoffPolicy>::initUserDataSegment(ref_counting::SegmentedArena &rUserDataArena, size_t segmentIdx)
+    {
+        auto pUserDataSegment = reinterpret_cast<T*>(rUserDataArena.getLocalSegment(segmentIdx));
+        std::fill_n(pUserDataSegment, rUserDataArena.getSegmentElemsNum(segmentIdx), T());
+    }
+
+    template<typename T, typename BackoffPolicy>
+    RmaTreiberCentralStack<T, BackoffPolicy> RmaTreiberCentralStack<T, BackoffPolicy>::create(MPI_Comm comm, MPI_Info info,
                                                                                       const std::chrono::nanoseconds &t_rBackoffMinDelay,
                                                                                       const std::chrono::nanoseconds &t_rBackoffMaxDelay,
                                                                                       int elemsUpLimit,
-                                                                                      std::shared_ptr<spdlog::sinks::sink> loggerSink) {
+                                                                                      std::shared_ptr<spdlog::sinks::sink> loggerSink,
+                                                                                      size_t segmentCapacity,
+                                                                                      ref_counting::ReclamationScheme reclamationScheme,
+                                                                                      size_t eliminationSlotsPerRank,
+                                                                                      FlatCombiningMode flatCombiningMode,
+                                                                                      size_t shardSize,
+                                                                                      ref_counting::EpochMode epochMode,
+                                                                                      bool requestPipelining,
+                                                                                      PayloadPlacement payloadPlacement) {
         auto pInnerStackLogger = std::make_shared<spdlog::logger>("InnerStack", loggerSink);
         spdlog::register_logger(pInnerStackLogger);
         pInnerStackLogger->set_level(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
@@ -247,7 +957,15 @@ namespace rma_stack
                 info,
                 true,
                 elemsUpLimit,
-                std::move(pInnerStackLogger)
+                std::move(pInnerStackLogger),
+                segmentCapacity,
+                reclamationScheme,
+                IsPayloadInline
+                    ? sizeof(T)
+                    : payloadPlacement == PayloadPlacement::Producer ? sizeof(ref_counting::PayloadRef) : 0,
+                shardSize,
+                epochMode,
+                requestPipelining
         );
 
         auto pOuterStackLogger = std::make_shared<spdlog::logger>("RmaTreiberCentralStack", loggerSink);
@@ -255,12 +973,15 @@ namespace rma_stack
         pOuterStackLogger->set_level(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
         pOuterStackLogger->flush_on(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
         
-        RmaTreiberCentralStack<T> stack(
+        RmaTreiberCentralStack<T, BackoffPolicy> stack(
                 comm,
                 info,
                 t_rBackoffMinDelay,
                 t_rBackoffMaxDelay,
                 std::move(innerStack),
+                eliminationSlotsPerRank,
+                flatCombiningMode,
+                payloadPlacement,
                 std::move(pOuterStackLogger)
         );
 
@@ -273,31 +994,39 @@ namespace rma_stack
 
 namespace stack_interface
 {
-    template<typename T>
-    struct IStack_traits<rma_stack::RmaTreiberCentralStack < T>>
+    template<typename T, typename BackoffPolicy>
+    struct IStack_traits<rma_stack::RmaTreiberCentralStack<T, BackoffPolicy>>
     {
-        friend class IStack<rma_stack::RmaTreiberCentralStack < T>>;
-        friend class rma_stack::RmaTreiberCentralStack<T>;
+        friend class IStack<rma_stack::RmaTreiberCentralStack<T, BackoffPolicy>>;
+        friend class rma_stack::RmaTreiberCentralStack<T, BackoffPolicy>;
         typedef T ValueType;
 
     private:
-        static void pushImpl(rma_stack::RmaTreiberCentralStack<T>& stack, const T &value)
+        static void pushImpl(rma_stack::RmaTreiberCentralStack<T, BackoffPolicy>& stack, const T &value)
         {
             stack.pushImpl(value);
         }
-        static void popImpl(rma_stack::RmaTreiberCentralStack<T>& stack, ValueType &rValue, const ValueType &rDefaultValue)
+        static void popImpl(rma_stack::RmaTreiberCentralStack<T, BackoffPolicy>& stack, ValueType &rValue, const ValueType &rDefaultValue)
         {
             stack.popImpl(rValue, rDefaultValue);
         }
-        static ValueType& topImpl(rma_stack::RmaTreiberCentralStack<T>& stack)
+        static size_t pushBulkImpl(rma_stack::RmaTreiberCentralStack<T, BackoffPolicy>& stack, const T *pValues, size_t valuesNum)
+        {
+            return stack.pushBulkImpl(pValues, valuesNum);
+        }
+        static size_t popBulkImpl(rma_stack::RmaTreiberCentralStack<T, BackoffPolicy>& stack, size_t valuesNum, ValueType *pValues)
+        {
+            return stack.popBulkImpl(valuesNum, pValues);
+        }
+        static ValueType& topImpl(rma_stack::RmaTreiberCentralStack<T, BackoffPolicy>& stack)
         {
             return stack.topImpl();
         }
-        static size_t sizeImpl(rma_stack::RmaTreiberCentralStack<T>& stack)
+        static size_t sizeImpl(rma_stack::RmaTreiberCentralStack<T, BackoffPolicy>& stack)
         {
             return stack.sizeImpl();
         }
-        static bool isEmptyImpl(rma_stack::RmaTreiberCentralStack<T>& stack)
+        static bool isEmptyImpl(rma_stack::RmaTreiberCentralStack<T, BackoffPolicy>& stack)
         {
             return stack.isEmptyImpl();
         }
@@ -0,0 +1,422 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#ifndef SOURCES_THREADSAFESTACK_H
+#define SOURCES_THREADSAFESTACK_H
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <mpi.h>
+#include <spdlog/spdlog.h>
+
+#include "IStack.h"
+
+namespace rma_stack
+{
+    template<typename StackImpl>
+    class ThreadSafeStack;
+}
+
+namespace stack_interface
+{
+    template<typename StackImpl>
+    struct IStack_traits<rma_stack::ThreadSafeStack<StackImpl>>;
+}
+
+namespace rma_stack
+{
+    /*
+     * Потокобезопасный фасад внешнего стека для нескольких потоков одного
+     * процесса (MPI+threads). Внешние стеки рассчитаны на один вызывающий
+     * поток на процесс, поэтому к ним обращается только комбинирующий поток.
+     *
+     * Поток публикует запрос в общем для потоков процесса стеке запросов
+     * (LIFO) и пытается захватить блокировку комбинирующего потока.
+     * Захвативший её поток забирает все опубликованные запросы, исключает
+     * пары PUSH и POP внутри пакета без обращения к памяти других процессов
+     * и передаёт внешнему стеку только излишек: оставшиеся значения PUSH
+     * одной операцией pushBulk, оставшиеся POP - одной операцией popBulk.
+     * Остальные потоки ждут завершения своего запроса. Все запросы пакета
+     * выполняются одновременно, поэтому любое их сочетание в пары допустимо.
+     * Если внешний стек бросает исключение, то незавершённые запросы пакета
+     * завершаются с этим исключением, и его бросают все их потоки.
+     *
+     * top возвращает копию вершины, так как ссылка на значение внешнего
+     * стека после снятия блокировки может измениться другим потоком.
+     *
+     * Так как MPI вызывается только комбинирующим потоком и под
+     * блокировкой, фасаду достаточно MPI_THREAD_SERIALIZED, но приложение
+     * обычно инициализирует MPI с MPI_THREAD_MULTIPLE, чтобы остальные
+     * потоки тоже могли вызывать MPI.
+     */
+    template<typename StackImpl>
+    class ThreadSafeStack : public stack_interface::IStack<ThreadSafeStack<StackImpl>>
+    {
+        friend class stack_interface::IStack_traits<ThreadSafeStack<StackImpl>>;
+    public:
+        typedef typename StackImpl::ValueType ValueType;
+
+        ThreadSafeStack(stack_interface::IStack<StackImpl> &t_rStack, std::shared_ptr<spdlog::sinks::sink> loggerSink);
+
+        ThreadSafeStack(ThreadSafeStack&) = delete;
+        ThreadSafeStack(ThreadSafeStack&&) = delete;
+        ThreadSafeStack& operator=(ThreadSafeStack&) = delete;
+        ThreadSafeStack& operator=(ThreadSafeStack&&) = delete;
+        ~ThreadSafeStack() = default;
+
+        /*
+         * Счётчики операций. Читать их следует, когда потоки не выполняют
+         * операций, например после их завершения.
+         */
+        // Кол-во операций, исключённых в парах внутри процесса.
+        [[nodiscard]] size_t getEliminatedOpsNum() const;
+        // Кол-во операций, переданных внешнему стеку.
+        [[nodiscard]] size_t getForwardedOpsNum() const;
+        // Кол-во пакетов, обработанных комбинирующими потоками.
+        [[nodiscard]] size_t getCombiningRoundsNum() const;
+        void resetCounters();
+        // Передаёт внешнему стеку обслуживание запросов роста пула узлов, если он его поддерживает.
+        template<typename Impl = StackImpl>
+        auto serviceGrowRequests() -> decltype(std::declval<Impl&>().serviceGrowRequests());
+
+    private:
+        struct Request
+        {
+            bool isPush{false};
+            const ValueType *pPushValue{nullptr};
+            ValueType *pPopValue{nullptr};
+            const ValueType *pDefaultValue{nullptr};
+            // Исключение внешнего стека, с которым завершён запрос.
+            std::exception_ptr exception;
+            std::atomic<bool> completed{false};
+        };
+
+        // public stack interface begin
+        void pushImpl(const ValueType &rValue);
+        void popImpl(ValueType &rValue, const ValueType &rDefaultValue);
+        size_t pushBulkImpl(const ValueType *pValues, size_t valuesNum);
+        size_t popBulkImpl(size_t valuesNum, ValueType *pValues);
+        ValueType topImpl();
+        size_t sizeImpl();
+        bool isEmptyImpl();
+        // public stack interface end
+
+        void execute(Request &rRequest);
+        // Выполняются под блокировкой комбинирующего потока.
+        void combine();
+        void forwardBatch();
+
+    private:
+        stack_interface::IStack<StackImpl> &m_rStack;
+
+        std::mutex m_requestsMutex;
+        std::vector<Request*> m_requests;
+
+        std::mutex m_combinerMutex;
+        // Буферы комбинирующего потока, защищены m_combinerMutex.
+        std::vector<Request*> m_batch;
+        std::vector<Request*> m_pushRequests;
+        std::vector<Request*> m_popRequests;
+        std::vector<ValueType> m_values;
+
+        size_t m_eliminatedOpsNum{0};
+        size_t m_forwardedOpsNum{0};
+        size_t m_combiningRoundsNum{0};
+
+        std::shared_ptr<spdlog::logger> m_logger;
+    };
+
+    template<typename StackImpl>
+    ThreadSafeStack<StackImpl>::ThreadSafeStack(stack_interface::IStack<StackImpl> &t_rStack,
+                                                std::shared_ptr<spdlog::sinks::sink> loggerSink)
+    :
+    m_rStack(t_rStack),
+    m_logger(std::make_shared<spdlog::logger>("ThreadSafeStack", std::move(loggerSink)))
+    {
+        m_logger->set_level(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
+        m_logger->flush_on(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
+
+        int threadSupport{MPI_THREAD_SINGLE};
+        MPI_Query_thread(&threadSupport);
+        if (threadSupport < MPI_THREAD_SERIALIZED)
+        {
+            throw std::invalid_argument("MPI must be initialized by 'MPI_Init_thread' "
+                                        "with 'MPI_THREAD_SERIALIZED' or higher thread support");
+        }
+    }
+
+    template<typename StackImpl>
+    size_t ThreadSafeStack<StackImpl>::getEliminatedOpsNum() const
+    {
+        return m_eliminatedOpsNum;
+    }
+
+    template<typename StackImpl>
+    size_t ThreadSafeStack<StackImpl>::getForwardedOpsNum() const
+    {
+        return m_forwardedOpsNum;
+    }
+
+    template<typename StackImpl>
+    size_t ThreadSafeStack<StackImpl>::getCombiningRoundsNum() const
+    {
+        return m_combiningRoundsNum;
+    }
+
+    template<typename StackImpl>
+    void ThreadSafeStack<StackImpl>::resetCounters()
+    {
+        std::lock_guard<std::mutex> lock(m_combinerMutex);
+        m_eliminatedOpsNum = 0;
+        m_forwardedOpsNum = 0;
+        m_combiningRoundsNum = 0;
+    }
+
+    template<typename StackImpl>
+    template<typename Impl>
+    auto ThreadSafeStack<StackImpl>::serviceGrowRequests() -> decltype(std::declval<Impl&>().serviceGrowRequests())
+    {
+        std::lock_guard<std::mutex> lock(m_combinerMutex);
+        return static_cast<Impl&>(m_rStack).serviceGrowRequests();
+    }
+
+    template<typename StackImpl>
+    void ThreadSafeStack<StackImpl>::pushImpl(const ValueType &rValue)
+    {
+        Request request;
+        request.isPush = true;
+        request.pPushValue = &rValue;
+        execute(request);
+    }
+
+    template<typename StackImpl>
+    void ThreadSafeStack<StackImpl>::popImpl(ValueType &rValue, const ValueType &rDefaultValue)
+    {
+        Request request;
+        request.pPopValue = &rValue;
+        request.pDefaultValue = &rDefaultValue;
+        execute(request);
+    }
+
+    template<typename StackImpl>
+    size_t ThreadSafeStack<StackImpl>::pushBulkImpl(const ValueType *pValues, size_t valuesNum)
+    {
+        std::lock_guard<std::mutex> lock(m_combinerMutex);
+        m_forwardedOpsNum += valuesNum;
+        return m_rStack.pushBulk(pValues, valuesNum);
+    }
+
+    template<typename StackImpl>
+    size_t ThreadSafeStack<StackImpl>::popBulkImpl(size_t valuesNum, ValueType *pValues)
+    {
+        std::lock_guard<std::mutex> lock(m_combinerMutex);
+        m_forwardedOpsNum += valuesNum;
+        return m_rStack.popBulk(valuesNum, pValues);
+    }
+
+    template<typename StackImpl>
+    typename ThreadSafeStack<StackImpl>::ValueType ThreadSafeStack<StackImpl>::topImpl()
+    {
+        std::lock_guard<std::mutex> lock(m_combinerMutex);
+        return m_rStack.top();
+    }
+
+    template<typename StackImpl>
+    size_t ThreadSafeStack<StackImpl>::sizeImpl()
+    {
+        std::lock_guard<std::mutex> lock(m_combinerMutex);
+        return m_rStack.size();
+    }
+
+    template<typename StackImpl>
+    bool ThreadSafeStack<StackImpl>::isEmptyImpl()
+    {
+        std::lock_guard<std::mutex> lock(m_combinerMutex);
+        return m_rStack.isEmpty();
+    }
+
+    template<typename StackImpl>
+    void ThreadSafeStack<StackImpl>::execute(Request &rRequest)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_requestsMutex);
+            m_requests.push_back(&rRequest);
+        }
+
+        /*
+         * Запрос опубликован до попытки захвата, поэтому комбинирующий
+         * поток, захвативший блокировку позже, обязательно его заберёт.
+         */
+        while (!rRequest.completed.load(std::memory_order_acquire))
+        {
+            std::unique_lock<std::mutex> lock(m_combinerMutex, std::try_to_lock);
+            if (lock.owns_lock())
+            {
+                if (!rRequest.completed.load(std::memory_order_acquire))
+                {
+                    combine();
+                }
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        if (rRequest.exception)
+        {
+            std::rethrow_exception(rRequest.exception);
+        }
+    }
+
+    template<typename StackImpl>
+    void ThreadSafeStack<StackImpl>::combine()
+    {
+        m_batch.clear();
+        {
+            std::lock_guard<std::mutex> lock(m_requestsMutex);
+            m_batch.swap(m_requests);
+        }
+        if (m_batch.empty())
+        {
+            return;
+        }
+        ++m_combiningRoundsNum;
+
+        m_pushRequests.clear();
+        m_popRequests.clear();
+        for (auto pRequest: m_batch)
+        {
+            if (pRequest->isPush)
+            {
+                m_pushRequests.push_back(pRequest);
+            }
+            else
+            {
+                m_popRequests.push_back(pRequest);
+            }
+        }
+
+        try
+        {
+            forwardBatch();
+        }
+        catch (...)
+        {
+            const auto exception = std::current_exception();
+            for (auto pRequest: m_batch)
+            {
+                if (!pRequest->completed.load(std::memory_order_relaxed))
+                {
+                    pRequest->exception = exception;
+                    pRequest->completed.store(true, std::memory_order_release);
+                }
+            }
+            throw;
+        }
+
+        SPDLOG_LOGGER_DEBUG(m_logger, "combined {} requests, {} push, {} pop forwarded", m_batch.size(),
+                            m_pushRequests.size(), m_popRequests.size());
+    }
+
+    template<typename StackImpl>
+    void ThreadSafeStack<StackImpl>::forwardBatch()
+    {
+        // Исключение: POP получает значение последнего опубликованного PUSH.
+        while (!m_pushRequests.empty() && !m_popRequests.empty())
+        {
+            auto pPushRequest = m_pushRequests.back();
+            auto pPopRequest = m_popRequests.back();
+            m_pushRequests.pop_back();
+            m_popRequests.pop_back();
+
+            *pPopRequest->pPopValue = *pPushRequest->pPushValue;
+            pPushRequest->completed.store(true, std::memory_order_release);
+            pPopRequest->completed.store(true, std::memory_order_release);
+            m_eliminatedOpsNum += 2;
+        }
+
+        if (!m_pushRequests.empty())
+        {
+            m_values.clear();
+            for (auto pRequest: m_pushRequests)
+            {
+                m_values.push_back(*pRequest->pPushValue);
+            }
+            const size_t pushedNum = m_rStack.pushBulk(m_values.data(), m_values.size());
+            m_forwardedOpsNum += m_values.size();
+            if (pushedNum < m_values.size())
+            {
+                SPDLOG_LOGGER_WARN(m_logger, "combined push lost {} of {} values", m_values.size() - pushedNum,
+                                   m_values.size());
+            }
+            for (auto pRequest: m_pushRequests)
+            {
+                pRequest->completed.store(true, std::memory_order_release);
+            }
+        }
+
+        if (!m_popRequests.empty())
+        {
+            m_values.resize(m_popRequests.size());
+            const size_t poppedNum = m_rStack.popBulk(m_values.size(), m_values.data());
+            m_forwardedOpsNum += m_popRequests.size();
+            for (size_t i = 0; i < m_popRequests.size(); ++i)
+            {
+                auto pRequest = m_popRequests[i];
+                *pRequest->pPopValue = i < poppedNum ? m_values[i] : *pRequest->pDefaultValue;
+                pRequest->completed.store(true, std::memory_order_release);
+            }
+        }
+    }
+} // rma_stack
+
+namespace stack_interface
+{
+    template<typename StackImpl>
+    struct IStack_traits<rma_stack::ThreadSafeStack<StackImpl>>
+    {
+        friend class IStack<rma_stack::ThreadSafeStack<StackImpl>>;
+        friend class rma_stack::ThreadSafeStack<StackImpl>;
+        typedef typename IStack_traits<StackImpl>::ValueType ValueType;
+
+    private:
+        static void pushImpl(rma_stack::ThreadSafeStack<StackImpl>& stack, const ValueType &value)
+        {
+            stack.pushImpl(value);
+        }
+        static void popImpl(rma_stack::ThreadSafeStack<StackImpl>& stack, ValueType &rValue, const ValueType &rDefaultValue)
+        {
+            stack.popImpl(rValue, rDefaultValue);
+        }
+        static size_t pushBulkImpl(rma_stack::ThreadSafeStack<StackImpl>& stack, const ValueType *pValues, size_t valuesNum)
+        {
+            return stack.pushBulkImpl(pValues, valuesNum);
+        }
+        static size_t popBulkImpl(rma_stack::ThreadSafeStack<StackImpl>& stack, size_t valuesNum, ValueType *pValues)
+        {
+            return stack.popBulkImpl(valuesNum, pValues);
+        }
+        static ValueType topImpl(rma_stack::ThreadSafeStack<StackImpl>& stack)
+        {
+            return stack.topImpl();
+        }
+        static size_t sizeImpl(rma_stack::ThreadSafeStack<StackImpl>& stack)
+        {
+            return stack.sizeImpl();
+        }
+        static bool isEmptyImpl(rma_stack::ThreadSafeStack<StackImpl>& stack)
+        {
+            return stack.isEmptyImpl();
+        }
+    };
+}
+
+#endif //SOURCES_THREADSAFESTACK_H
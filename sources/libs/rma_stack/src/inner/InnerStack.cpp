@@ -2,7 +2,12 @@
 // Created by denis on 20.04.23.
 //
 
-#include <random>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
 #include "inner/InnerStack.h"
 #include "MpiException.h"
 
@@ -10,402 +15,168 @@ namespace rma_stack::ref_counting
 {
     namespace custom_mpi = custom_mpi_extensions;
 
-    void InnerStack::push(const std::function<void(GlobalAddress)> &putDataCallback,
-                          const std::function<void()> &backoffCallback)
+    CountedNodePtr InnerStack::fetchHead(const Head &rHead)
     {
-        m_logger->trace("started 'push'");
-
-        auto nodeAddress = acquireNode(m_centralized ? HEAD_RANK : m_rank);
-        if (isGlobalAddressDummy(nodeAddress))
-        {
-            putDataCallback(nodeAddress);
-            m_logger->trace("failed to find free node in 'push'");
-            return;
-        }
-        {
-            const auto r = nodeAddress.rank;
-            const auto o = nodeAddress.offset;
-            m_logger->trace("acquired free node (rank - {}, offset - {}) in 'push'", r, o);
-        }
-
-        putDataCallback(nodeAddress);
-        m_logger->trace("put data in 'push'");
-
-        CountedNodePtr resHeadCountedNodePtr;
-
-        // Получение текущей головы списка.
-        MPI_Win_lock(MPI_LOCK_SHARED, HEAD_RANK, MPI_MODE_NOCHECK, m_headWin);
-        MPI_Fetch_and_op(nullptr,
-                         &resHeadCountedNodePtr,
-                         MPI_UINT64_T,
-                         HEAD_RANK,
-                         m_headAddress,
-                         MPI_NO_OP,
-                         m_headWin
+        CountedNodePtr headCountedNodePtr;
+        rmaFetchAndOp(nullptr,
+                      &headCountedNodePtr,
+                      MPI_UINT64_T,
+                      rHead.rank,
+                      rHead.address,
+                      MPI_NO_OP,
+                      m_headWin,
+                      m_pCounters.get()
         );
-        MPI_Win_flush(HEAD_RANK, m_headWin);
-
-        m_logger->trace("fetched head (rank - {}, offset - {})", resHeadCountedNodePtr.getRank(), resHeadCountedNodePtr.getOffset());
-
-        m_logger->trace("started new head pushing in 'push'");
-
-        CountedNodePtr newCountedNodePtr;
-        newCountedNodePtr.setRank(nodeAddress.rank);
-        newCountedNodePtr.setOffset(nodeAddress.offset);
-        newCountedNodePtr.incExternalCounter();
-
-        CountedNodePtr oldHeadCountedNodePtr;
-        CountedNodePtr countedNodePtrNext;
-
-        constexpr auto nodeSize                     = sizeof(Node);
-        const auto countedNodePtrNextDisplacement   = static_cast<MPI_Aint>(nodeSize * nodeAddress.offset) + 8;
-        const MPI_Aint countedNodePtrNextOffset     = MPI_Aint_add(m_pBaseNodeArrAddresses[nodeAddress.rank], countedNodePtrNextDisplacement);
-
-        /*
-         * Пока не удастся заменить текущую голову списка операцией на новый узел
-         * операцией CAS, перезаписывать глобальный указатель на следующий узел
-         * нового узла текущей головой списка.
-         */
-        MPI_Win_lock(MPI_LOCK_SHARED, nodeAddress.rank, MPI_MODE_NOCHECK, m_nodesWin);
-        do
-        {
-            countedNodePtrNext = resHeadCountedNodePtr;
-            MPI_Put(&countedNodePtrNext,
-                    1,
-                    MPI_UINT64_T,
-                    nodeAddress.rank,
-                    countedNodePtrNextOffset,
-                    1,
-                    MPI_UINT64_T,
-                    m_nodesWin
-            );
-            MPI_Win_flush(nodeAddress.rank, m_nodesWin);
-
-            oldHeadCountedNodePtr = resHeadCountedNodePtr;
-
-            MPI_Compare_and_swap(&newCountedNodePtr,
-                                 &oldHeadCountedNodePtr,
-                                 &resHeadCountedNodePtr,
-                                 MPI_UINT64_T,
-                                 HEAD_RANK,
-                                 m_headAddress,
-                                 m_headWin
-            );
-            MPI_Win_flush(HEAD_RANK, m_headWin);
-
-            if (resHeadCountedNodePtr != oldHeadCountedNodePtr)
-            {
-                m_logger->trace("started to execute backoff callback");
-                backoffCallback();
-                m_logger->trace("executed backoff callback");
-            }
-        }
-        while (resHeadCountedNodePtr != oldHeadCountedNodePtr);
-
-        MPI_Win_unlock(HEAD_RANK, m_headWin);
-        MPI_Win_unlock(nodeAddress.rank, m_nodesWin);
-
-        m_logger->trace("finished 'push'");
+        rmaFlush(rHead.rank, m_headWin, m_pCounters.get());
+        return headCountedNodePtr;
     }
 
-    GlobalAddress InnerStack::acquireNode(int rank) const
+    void InnerStack::addHeadSize(const Head &rHead, int64_t sizeIncrease)
     {
-        m_logger->trace("started 'acquireNode'");
-        GlobalAddress nodeGlobalAddress = {0, DummyRank, 0};
-
-        if (!isValidRank(rank))
-        {
-            m_logger->trace("finished 'acquireNode'");
-            return nodeGlobalAddress;
-        }
-
-        std::random_device rd;
-        std::mt19937 mt(rd());
-
-        std::uniform_int_distribution<int> dist(0, static_cast<int>(m_elemsUpLimit - 1));
+        // Счётчик приблизительный, поэтому ждать применения операции у владельца головы не нужно.
+        rmaAccumulate(&sizeIncrease,
+                      1,
+                      MPI_INT64_T,
+                      rHead.rank,
+                      rHead.sizeAddress,
+                      MPI_SUM,
+                      m_headWin,
+                      m_pCounters.get()
+        );
+        rmaFlushLocal(rHead.rank, m_headWin, m_pCounters.get());
+    }
 
-        MPI_Win_lock(MPI_LOCK_SHARED, rank, MPI_MODE_NOCHECK, m_nodesWin);
+    MPI_Request InnerStack::startHeadFetch(const Head &rHead, CountedNodePtr &rHeadCountedNodePtr)
+    {
+        MPI_Request headRequest{MPI_REQUEST_NULL};
+        rmaRgetAccumulate(nullptr,
+                          &rHeadCountedNodePtr,
+                          1,
+                          MPI_UINT64_T,
+                          rHead.rank,
+                          rHead.address,
+                          MPI_NO_OP,
+                          m_headWin,
+                          &headRequest,
+                          m_pCounters.get()
+        );
+        return headRequest;
+    }
 
-        /* Поиск свободного адреса работает слишком медленно,
-         * если искать его без случайного выбора, поэтому сначала
-         * производится несколько попыток угадать, какой адрес не
-         * занят. Если угадать не удалось, тогда сканируется весь
-         * массив адресов.
-         */
-        bool foundFreeNodeRandomly{false};
-        const auto randomTriesNumber = static_cast<MPI_Aint>(std::floor((double)m_elemsUpLimit * 0.05));
-        for (MPI_Aint i = 0; i < randomTriesNumber; ++i)
+    void InnerStack::fetchCountedNodePtrNext(GlobalAddress nodeAddress, MPI_Aint countedNodePtrNextOffset,
+                                             CountedNodePtr &rCountedNodePtrNext, uint64_t *pInlinePayloadWords,
+                                             MPI_Request &rDataRequest)
+    {
+        const auto nodesWin = m_nodePool.getWin();
+        if (rDataRequest != MPI_REQUEST_NULL)
         {
-            const auto idx = static_cast<MPI_Aint>(dist(mt));
-            const auto nodeDisplacement = idx * static_cast<MPI_Aint>(sizeof(Node));
-            const MPI_Aint nodeOffset = MPI_Aint_add(m_pBaseNodeArrAddresses[rank], nodeDisplacement);
-
-            uint32_t newAcquiredField{1};
-            uint32_t oldAcquiredField{0};
-            uint32_t resAcquiredField{0};
-
-            MPI_Compare_and_swap(&newAcquiredField,
-                                 &oldAcquiredField,
-                                 &resAcquiredField,
-                                 MPI_UINT32_T,
-                                 rank,
-                                 nodeOffset,
-                                 m_nodesWin
+            // Ссылка читается запросом, и оба запроса завершаются одним ожиданием.
+            uint64_t nodeTail[1 + MaxInlinePayloadWordsNum]{};
+            const auto nodeTailWordsNum = pInlinePayloadWords
+                    ? static_cast<int>(1 + getInlinePayloadWordsNum(m_nodePool.getInlinePayloadSize()))
+                    : 1;
+            MPI_Request requests[2] = {MPI_REQUEST_NULL, rDataRequest};
+            rmaRgetAccumulate(nullptr,
+                              nodeTail,
+                              nodeTailWordsNum,
+                              MPI_UINT64_T,
+                              nodeAddress.rank,
+                              countedNodePtrNextOffset,
+                              MPI_NO_OP,
+                              nodesWin,
+                              &requests[0],
+                              m_pCounters.get()
             );
-            MPI_Win_flush(rank, m_nodesWin);
+            MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
+            rDataRequest = MPI_REQUEST_NULL;
 
-            m_logger->trace("resAcquiredField = {} of (rank - {}, offset - {}) in 'acquireNode'",
-                            resAcquiredField,
-                            rank,
-                            i
-            );
-            assert(resAcquiredField == 0 || resAcquiredField == 1);
-            if (!resAcquiredField)
-            {
-                nodeGlobalAddress.rank = rank;
-                nodeGlobalAddress.offset = idx;
-                foundFreeNodeRandomly = true;
-                break;
-            }
+            std::memcpy(&rCountedNodePtrNext, nodeTail, sizeof(CountedNodePtr));
+            if (pInlinePayloadWords)
+                std::copy_n(nodeTail + 1, nodeTailWordsNum - 1, pInlinePayloadWords);
+            return;
         }
-        if (!foundFreeNodeRandomly)
+        if (!pInlinePayloadWords)
         {
-            for (MPI_Aint i = 0; i < static_cast<MPI_Aint>(m_elemsUpLimit); ++i)
-            {
-                constexpr auto nodeSize = static_cast<MPI_Aint>(sizeof(Node));
-                const auto nodeDisplacement = i * nodeSize;
-                const MPI_Aint nodeOffset = MPI_Aint_add(m_pBaseNodeArrAddresses[rank], nodeDisplacement);
-
-                uint32_t newAcquiredField{1};
-                uint32_t oldAcquiredField{0};
-                uint32_t resAcquiredField{0};
-
-                MPI_Compare_and_swap(&newAcquiredField,
-                                     &oldAcquiredField,
-                                     &resAcquiredField,
-                                     MPI_UINT32_T,
-                                     rank,
-                                     nodeOffset,
-                                     m_nodesWin
-                );
-                MPI_Win_flush(rank, m_nodesWin);
-
-                m_logger->trace("resAcquiredField = {} of (rank - {}, offset - {}) in 'acquireNode'",
-                                resAcquiredField,
-                                rank,
-                                i
-                );
-                assert(resAcquiredField == 0 || resAcquiredField == 1);
-                if (!resAcquiredField)
-                {
-                    nodeGlobalAddress.rank = rank;
-                    nodeGlobalAddress.offset = i;
-                    break;
-                }
-            }
+            rmaFetchAndOp(nullptr,
+                          &rCountedNodePtrNext,
+                          MPI_UINT64_T,
+                          nodeAddress.rank,
+                          countedNodePtrNextOffset,
+                          MPI_NO_OP,
+                          nodesWin,
+                          m_pCounters.get()
+            );
+            rmaFlush(nodeAddress.rank, nodesWin, m_pCounters.get());
+            return;
         }
 
-        MPI_Win_unlock(rank, m_nodesWin);
+        // Ссылка и данные читаются одной атомарной операцией над соседними 64-битными словами.
+        uint64_t nodeTail[1 + MaxInlinePayloadWordsNum]{};
+        const auto nodeTailWordsNum = static_cast<int>(1 + getInlinePayloadWordsNum(m_nodePool.getInlinePayloadSize()));
+        rmaGetAccumulate(nullptr,
+                         nodeTail,
+                         nodeTailWordsNum,
+                         MPI_UINT64_T,
+                         nodeAddress.rank,
+                         countedNodePtrNextOffset,
+                         MPI_NO_OP,
+                         nodesWin,
+                         m_pCounters.get()
+        );
+        rmaFlush(nodeAddress.rank, nodesWin, m_pCounters.get());
 
-        m_logger->trace("finished 'acquireNode'");
-        return nodeGlobalAddress;
+        std::memcpy(&rCountedNodePtrNext, nodeTail, sizeof(CountedNodePtr));
+        std::copy_n(nodeTail + 1, nodeTailWordsNum - 1, pInlinePayloadWords);
     }
 
-    void InnerStack::releaseNode(GlobalAddress nodeAddress) const
+    void InnerStack::addNodeInternalCount(GlobalAddress nodeAddress, MPI_Aint nodeOffset, int32_t countIncrease)
     {
-        constexpr auto nodeSize = sizeof(Node);
-        const auto nodeDisplacement = static_cast<MPI_Aint>(nodeAddress.offset * nodeSize);
-        const MPI_Aint nodeOffset = MPI_Aint_add(m_pBaseNodeArrAddresses[nodeAddress.rank],
-                                                 nodeDisplacement
-        );
-        int32_t acquiredField{1};
-        int32_t acquiredField1{acquiredField};
-        {
-            const auto r = nodeAddress.rank;
-            const auto o = nodeAddress.offset;
-            m_logger->trace("started to release node (rank - {}, offset - {})", r, o);
-        }
-        const MPI_Aint countedNodePtrOffset = nodeOffset + 8;
-        CountedNodePtr dummyCountedNodePtr;
-        MPI_Put(&dummyCountedNodePtr,
-            1,
-            MPI_UINT64_T,
-            nodeAddress.rank,
-            countedNodePtrOffset,
-            1,
-            MPI_UINT64_T,
-            m_nodesWin
-        );
-        MPI_Fetch_and_op(&acquiredField,
-                         &acquiredField1,
-                         MPI_UINT32_T,
-                         nodeAddress.rank,
-                         nodeOffset,
-                         MPI_REPLACE,
-                         m_nodesWin
+        const auto nodesWin              = m_nodePool.getWin();
+        const auto internalCounterOffset = MPI_Aint_add(nodeOffset, sizeof(int32_t));
+        int32_t resInternalCount{0};
+        rmaFetchAndOp(&countIncrease,
+                      &resInternalCount,
+                      MPI_INT32_T,
+                      nodeAddress.rank,
+                      internalCounterOffset,
+                      MPI_SUM,
+                      nodesWin,
+                      m_pCounters.get()
         );
-        MPI_Win_flush(nodeAddress.rank, m_nodesWin);
-        {
-            const auto r = nodeAddress.rank;
-            const auto o = nodeAddress.offset;
-            m_logger->trace("released node (rank - {}, offset - {})", r, o);
-        }
+        rmaFlush(nodeAddress.rank, nodesWin, m_pCounters.get());
+
+        if (resInternalCount == -countIncrease)
+            m_nodePool.releaseNode(nodeAddress);
     }
 
-    void InnerStack::pop(const std::function<void(GlobalAddress)> &getDataCallback,
-                         const std::function<void()> &backoffCallback)
+    void InnerStack::startNodeVersionIncrease(GlobalAddress nodeAddress)
     {
-        m_logger->trace("started 'pop'");
-
-        CountedNodePtr oldHeadCountedNodePtr;
-
-        // Чтение текущей головы односвязного списка.
-        MPI_Win_lock(MPI_LOCK_SHARED, HEAD_RANK, MPI_MODE_NOCHECK, m_headWin);
-        MPI_Fetch_and_op(nullptr,
-                         &oldHeadCountedNodePtr,
-                         MPI_UINT64_T,
-                         HEAD_RANK,
-                         m_headAddress,
-                         MPI_NO_OP,
-                         m_headWin
+        const uint32_t versionIncrease{1};
+        rmaAccumulate(&versionIncrease,
+                      1,
+                      MPI_UINT32_T,
+                      nodeAddress.rank,
+                      m_nodePool.getNodeAddress(nodeAddress),
+                      MPI_SUM,
+                      m_nodePool.getWin(),
+                      m_pCounters.get()
         );
-        MPI_Win_flush(HEAD_RANK, m_headWin);
-
-        {
-            const auto r = oldHeadCountedNodePtr.getRank();
-            const auto o = oldHeadCountedNodePtr.getOffset();
-            const auto e = oldHeadCountedNodePtr.getExternalCounter();
-            m_logger->trace("fetched head (rank - {}, offset - {}, ext_cnt - {}) before loop in 'pop'", r, o, e);
-        }
-        for (;;)
-        {
-            // Увеличение кол-во внешних ссылок на голову на 1.
-            increaseHeadCount(oldHeadCountedNodePtr);
-            {
-                const auto r = oldHeadCountedNodePtr.getRank();
-                const auto o = oldHeadCountedNodePtr.getOffset();
-                const auto e = oldHeadCountedNodePtr.getExternalCounter();
-                m_logger->trace("head (rank - {}, offset - {}, ext_cnt - {})) after increaseHeadCount in 'pop'", r, o, e);
-            }
-            GlobalAddress nodeAddress = {
-                    oldHeadCountedNodePtr.getOffset(),
-                    oldHeadCountedNodePtr.getRank(),
-                    0
-            };
-            if (isGlobalAddressDummy(nodeAddress))
-            {
-                /*
-                 * Если глобальный указатель указывает на NULL, то стек пуст,
-                 * и нужно сообщить об этом пользователю, а затем завершить POP.
-                 */
-                getDataCallback(nodeAddress);
-                break;
-            }
-
-            /*
-             * Получение указателя на следующий за головой списка узел
-             * с последующей заменой головы на этот узел операцией CAS.
-             */
-            CountedNodePtr countedNodePtrNext;
-
-            const auto nodeDisplacement             = static_cast<MPI_Aint>(nodeAddress.offset * sizeof(Node) + sizeof(CountedNodePtr));
-            const MPI_Aint countedNodePtrNextOffset = MPI_Aint_add(m_pBaseNodeArrAddresses[nodeAddress.rank], nodeDisplacement);
-
-            MPI_Win_lock(MPI_LOCK_SHARED, nodeAddress.rank, MPI_MODE_NOCHECK, m_nodesWin);
-            MPI_Fetch_and_op(nullptr,
-                             &countedNodePtrNext,
-                             MPI_UINT64_T,
-                             nodeAddress.rank,
-                             countedNodePtrNextOffset,
-                             MPI_NO_OP,
-                             m_nodesWin
-            );
-            MPI_Win_flush(nodeAddress.rank, m_nodesWin);
-
-            {
-                const auto r = countedNodePtrNext.getRank();
-                const auto o = countedNodePtrNext.getOffset();
-                const auto e = countedNodePtrNext.getExternalCounter();
-                m_logger->trace("ptr->next (rank - {}, offset - {}, ext_cnt - {})) in 'pop'", r, o, e);
-            }
-
-            CountedNodePtr resHeadCountedNodePtr;
-
-            MPI_Compare_and_swap(&countedNodePtrNext,
-                                 &oldHeadCountedNodePtr,
-                                 &resHeadCountedNodePtr,
-                                 MPI_UINT64_T,
-                                 HEAD_RANK,
-                                 m_headAddress,
-                                 m_headWin
-            );
-            MPI_Win_flush(HEAD_RANK, m_headWin);
-
-            bool popComplete{false};
-            if (resHeadCountedNodePtr == oldHeadCountedNodePtr)
-            {
-                getDataCallback(nodeAddress);
-
-                const auto internalCounterDisplacement  = static_cast<MPI_Aint>(nodeAddress.offset * sizeof(Node) + sizeof(int32_t));
-                const auto internalCounterOffset        = MPI_Aint_add(m_pBaseNodeArrAddresses[nodeAddress.rank],
-                                                                       internalCounterDisplacement
-                );
-
-                const auto externalCount    = static_cast<int32_t>(oldHeadCountedNodePtr.getExternalCounter());
-                const int32_t countIncrease = externalCount - 2;
-                int32_t resInternalCount{0};
-                // Атомарное уменьшение внутреннего счётчика на кол-во внешних ссылок минус 2.
-                MPI_Fetch_and_op(
-                        &countIncrease,
-                        &resInternalCount,
-                        MPI_INT32_T,
-                        nodeAddress.rank,
-                        internalCounterOffset,
-                        MPI_SUM,
-                        m_nodesWin
-                );
-                MPI_Win_flush(nodeAddress.rank, m_nodesWin);
-
-                if (resInternalCount == -countIncrease)
-                    releaseNode(nodeAddress);
-
-                popComplete = true;
-            }
-            else
-            {
-                const auto internalCounterDisplacement  = static_cast<MPI_Aint>(nodeAddress.offset * sizeof(Node) + sizeof(int32_t));
-                const auto internalCounterOffset        = MPI_Aint_add(m_pBaseNodeArrAddresses[nodeAddress.rank],
-                                                                       internalCounterDisplacement
-                );
-                const int64_t countIncrease{-1};
-                int64_t resInternalCount{0};
-                // Атомарное уменьшение внутреннего счётчика на 1.
-                MPI_Fetch_and_op(
-                        &countIncrease,
-                        &resInternalCount,
-                        MPI_INT32_T,
-                        nodeAddress.rank,
-                        internalCounterOffset,
-                        MPI_SUM,
-                        m_nodesWin
-                );
-                MPI_Win_flush(nodeAddress.rank, m_nodesWin);
-
-                if (resInternalCount == 1)
-                    releaseNode(nodeAddress);
-            }
-            MPI_Win_unlock(nodeAddress.rank, m_nodesWin);
-
-            if (popComplete)
-                break;
-
-            m_logger->trace("started to execute backoff callback");
-            backoffCallback();
-            m_logger->trace("executed backoff callback");
-        }
-        MPI_Win_unlock(HEAD_RANK, m_headWin);
+    }
 
-        m_logger->trace("finished 'pop'");
+    uint32_t InnerStack::fetchNodeVersion(GlobalAddress nodeAddress)
+    {
+        uint32_t nodeVersion{0};
+        rmaFetchAndOp(nullptr,
+                      &nodeVersion,
+                      MPI_UINT32_T,
+                      nodeAddress.rank,
+                      m_nodePool.getNodeAddress(nodeAddress),
+                      MPI_NO_OP,
+                      m_nodePool.getWin(),
+                      m_pCounters.get()
+        );
+        rmaFlush(nodeAddress.rank, m_nodePool.getWin(), m_pCounters.get());
+        return nodeVersion;
     }
 
     /*
@@ -414,7 +185,7 @@ namespace rma_stack::ref_counting
      * процесса, чтобы другие процессы не освободили память под голову
      * до того, как к ней обратится текущий процесс.
      */
-    void InnerStack::increaseHeadCount(CountedNodePtr &oldHeadCountedNodePtr)
+    void InnerStack::increaseHeadCount(const Head &rHead, CountedNodePtr &oldHeadCountedNodePtr)
     {
         CountedNodePtr newCountedNodePtr;
         CountedNodePtr resCountedNodePtr = oldHeadCountedNodePtr;
@@ -423,17 +194,25 @@ namespace rma_stack::ref_counting
         do
         {
             newCountedNodePtr = oldHeadCountedNodePtr = resCountedNodePtr;
-            newCountedNodePtr.incExternalCounter();
-
-            MPI_Compare_and_swap(&newCountedNodePtr,
-                                 &oldHeadCountedNodePtr,
-                                 &resCountedNodePtr,
-                                 MPI_UINT64_T,
-                                 HEAD_RANK,
-                                 m_headAddress,
-                                 m_headWin
+            if (!newCountedNodePtr.incExternalCounter())
+            {
+                // Эпоха доступа к голове открыта в 'pop', и её нужно закрыть перед выходом.
+                unlockHead(rHead);
+                throw std::overflow_error("the external counter of the head exceeds the counter bits of the layout");
+            }
+
+            rmaCompareAndSwap(&newCountedNodePtr,
+                              &oldHeadCountedNodePtr,
+                              &resCountedNodePtr,
+                              MPI_UINT64_T,
+                              rHead.rank,
+                              rHead.address,
+                              m_headWin,
+                              m_pCounters.get()
             );
-            MPI_Win_flush(HEAD_RANK, m_headWin);
+            rmaFlush(rHead.rank, m_headWin, m_pCounters.get());
+            countHeadCas(&OperationCounters::headCountCasAttempts, &OperationCounters::headCountCasFailures,
+                         oldHeadCountedNodePtr, resCountedNodePtr);
 
             m_logger->trace("executed CAS in 'increaseHeadCount'");
             m_logger->trace("oldCountedNodePtr is (rank - {}, offset - {}, ext_cnt - {})",
@@ -455,10 +234,17 @@ namespace rma_stack::ref_counting
     }
 
     InnerStack::InnerStack(MPI_Comm comm, MPI_Info info, bool t_centralized, size_t t_elemsUpLimit,
-                           std::shared_ptr<spdlog::logger> t_logger)
+                           std::shared_ptr<spdlog::logger> t_logger, size_t t_segmentCapacity,
+                           ReclamationScheme t_reclamationScheme, size_t t_inlinePayloadSize,
+                           size_t t_shardSize, EpochMode t_epochMode, bool t_requestPipelining)
     :
-    m_elemsUpLimit(t_elemsUpLimit),
     m_centralized(t_centralized),
+    m_shardSize(t_shardSize),
+    m_epochMode(t_epochMode),
+    m_requestPipelining(t_requestPipelining),
+    m_pCounters(std::make_unique<OperationCounters>()),
+    m_nodePool(comm, info, t_centralized, HEAD_RANK, t_elemsUpLimit, t_segmentCapacity, t_inlinePayloadSize,
+               t_epochMode, *m_pCounters, t_logger),
     m_logger(std::move(t_logger))
     {
         m_logger->trace("getting rank");
@@ -469,130 +255,64 @@ namespace rma_stack::ref_counting
         }
         m_logger->trace("got rank {}", m_rank);
 
+        int procNum{0};
+        MPI_Comm_size(comm, &procNum);
+        if (!isValidRank<Layout>(procNum - 1))
+            throw std::invalid_argument("the number of processes exceeds the rank bits of the layout");
+        // Группа из всех процессов равносильна единственной голове.
+        if (m_shardSize >= static_cast<size_t>(procNum))
+            m_shardSize = 0;
+
         initRemoteAccessMemory(comm, info);
+        m_pNodeReclaimer = std::make_unique<NodeReclaimer>(comm, m_headWin, HEAD_RANK, t_reclamationScheme,
+                                                           *m_pCounters, m_logger);
+        std::vector<int> headRanks;
+        for (const auto &rHead : m_heads)
+            headRanks.push_back(rHead.rank);
+        m_pWaiterTable = std::make_unique<WaiterTable>(comm, m_headWin, m_epochMode, std::move(headRanks),
+                                                       *m_pCounters, m_logger);
+        m_pCounters->rmaTargets.resize(procNum);
         MPI_Barrier(comm);
         m_logger->trace("finished InnerStack construction");
     }
 
-    void InnerStack::release()
+    void InnerStack::reclaimRetiredNodes()
     {
-        MPI_Free_mem(m_pNodesArr);
-        m_pNodesArr = nullptr;
-        m_logger->trace("freed up node arr RMA memory");
+        m_pNodeReclaimer->reclaim(m_nodePool);
+    }
 
-        MPI_Win_free(&m_nodesWin);
-        m_logger->trace("freed up node win RMA memory");
+    void InnerStack::release()
+    {
+        m_pNodeReclaimer->release();
+        m_pWaiterTable->release();
+        m_nodePool.release();
 
-        MPI_Free_mem(m_pHeadCountedNodePtr);
-        m_pHeadCountedNodePtr = nullptr;
+        MPI_Free_mem(m_pHeadCell);
+        m_pHeadCell = nullptr;
         m_logger->trace("freed up head pointer RMA memory");
 
+        endWinEpoch(m_headWin, m_epochMode);
         MPI_Win_free(&m_headWin);
         m_logger->trace("freed up head win RMA memory");
     }
 
     void InnerStack::initRemoteAccessMemory(MPI_Comm comm, MPI_Info info)
     {
-        {
-            auto mpiStatus = MPI_Win_create_dynamic(info, comm, &m_nodesWin);
-            if (mpiStatus != MPI_SUCCESS)
-                throw custom_mpi::MpiException("failed to create RMA window for nodes", __FILE__, __func__, __LINE__, mpiStatus);
-        }
         {
             auto mpiStatus = MPI_Win_create_dynamic(info, comm, &m_headWin);
             if (mpiStatus != MPI_SUCCESS)
                 throw custom_mpi::MpiException("failed to create RMA window for head", __FILE__, __func__, __LINE__, mpiStatus);
         }
+        beginWinEpoch(m_headWin, m_epochMode);
 
-        const auto nodesSize = static_cast<MPI_Aint>(sizeof(Node) * m_elemsUpLimit);
-
-        if (m_centralized)
-        {
-            m_pBaseNodeArrAddresses = std::make_unique<MPI_Aint[]>(1);
-
-            if (m_rank == HEAD_RANK)
-            {
-                m_logger->trace("started to initialize node array");
-                {
-                    auto mpiStatus = MPI_Alloc_mem(nodesSize, MPI_INFO_NULL,
-                                                   &m_pNodesArr);
-                    if (mpiStatus != MPI_SUCCESS)
-                        throw custom_mpi::MpiException(
-                                "failed to allocate RMA memory",
-                                __FILE__,
-                                __func__,
-                                __LINE__,
-                                mpiStatus
-                        );
-                }
-
-                std::fill_n(m_pNodesArr, m_elemsUpLimit, Node());
-                m_logger->trace("initialized node array");
-                {
-                    auto mpiStatus = MPI_Win_attach(m_nodesWin, (void*)m_pNodesArr, nodesSize);
-                    if (mpiStatus != MPI_SUCCESS) {
-                        throw custom_mpi::MpiException("failed to attach RMA window", __FILE__, __func__, __LINE__, mpiStatus);
-                    }
-                }
-                m_logger->trace("attach nodes RMA window");
-                MPI_Get_address(m_pNodesArr, (MPI_Aint*)m_pBaseNodeArrAddresses.get());
-            }
-
-            m_logger->trace("started to broadcast node array addresses");
-            auto mpiStatus = MPI_Bcast(m_pBaseNodeArrAddresses.get(), 1, MPI_AINT, HEAD_RANK, comm);
-            if (mpiStatus != MPI_SUCCESS)
-                throw custom_mpi::MpiException("failed to broadcast node array address", __FILE__, __func__ , __LINE__, mpiStatus);
-            m_logger->trace("broadcasted node array addresses");
-        }
-        else
-        {
-            m_logger->trace("started to initialize node array");
-
-            {
-                auto mpiStatus = MPI_Alloc_mem(nodesSize, MPI_INFO_NULL,
-                                               &m_pNodesArr);
-                if (mpiStatus != MPI_SUCCESS)
-                    throw custom_mpi::MpiException(
-                            "failed to allocate RMA memory",
-                            __FILE__,
-                            __func__,
-                            __LINE__,
-                            mpiStatus
-                    );
-            }
-
-            std::fill_n(m_pNodesArr, m_elemsUpLimit, Node());
-            m_logger->trace("initialized node array");
-            {
-                auto mpiStatus = MPI_Win_attach(m_nodesWin, (void*)m_pNodesArr, nodesSize);
-                if (mpiStatus != MPI_SUCCESS)
-                    throw custom_mpi::MpiException("failed to attach RMA window", __FILE__, __func__, __LINE__, mpiStatus);
-            }
-
-            m_logger->trace("started to broadcast node array addresses");
-            int procNum{0};
-            MPI_Comm_size(comm, &procNum);
-            m_pBaseNodeArrAddresses = std::make_unique<MPI_Aint[]>(procNum);
-            MPI_Get_address(m_pNodesArr, (MPI_Aint*)&m_pBaseNodeArrAddresses[m_rank]);
-
-            for (int i = 0; i < procNum; ++i)
-            {
-                auto mpiStatus = MPI_Bcast(&m_pBaseNodeArrAddresses[i], 1, MPI_AINT, i, comm);
-                if (mpiStatus != MPI_SUCCESS)
-                    throw custom_mpi::MpiException("failed to broadcast node array base address", __FILE__, __func__ , __LINE__, mpiStatus);
-                m_logger->trace("m_pNodeArrAddresses[{}] = {}", i, m_pBaseNodeArrAddresses[i]);
-            }
-
-            m_logger->trace("broadcasted node array addresses");
-        }
-
-        if (m_rank == HEAD_RANK)
+        // Голову хранит HEAD_RANK или, если стек разбит на группы, первый процесс каждой группы.
+        MPI_Aint headAddress{(MPI_Aint)MPI_BOTTOM};
+        if (isHeadOwner(m_rank))
         {
             m_logger->trace("started to initialize head");
 
             {
-                auto mpiStatus = MPI_Alloc_mem(sizeof(CountedNodePtr), MPI_INFO_NULL,
-                                               &m_pHeadCountedNodePtr);
+                auto mpiStatus = MPI_Alloc_mem(sizeof(HeadCell), MPI_INFO_NULL, &m_pHeadCell);
                 if (mpiStatus != MPI_SUCCESS)
                     throw custom_mpi::MpiException(
                             "failed to allocate RMA memory",
@@ -602,51 +322,254 @@ namespace rma_stack::ref_counting
                             mpiStatus
                     );
             }
-            *m_pHeadCountedNodePtr = CountedNodePtr();
+            *m_pHeadCell = HeadCell();
             m_logger->trace("initialized head");
             {
-                auto mpiStatus = MPI_Win_attach(m_headWin, (void*)m_pHeadCountedNodePtr, 1);
+                auto mpiStatus = MPI_Win_attach(m_headWin, (void*)m_pHeadCell, sizeof(HeadCell));
                 if (mpiStatus != MPI_SUCCESS)
                     throw custom_mpi::MpiException("failed to attach RMA window", __FILE__, __func__, __LINE__, mpiStatus);
             }
             m_logger->trace("attached nodes RMA window");
-            MPI_Get_address(m_pHeadCountedNodePtr, &m_headAddress);
+            MPI_Get_address(&m_pHeadCell->countedNodePtr, &headAddress);
         }
 
+        int procNum{0};
+        MPI_Comm_size(comm, &procNum);
+        auto pHeadAddresses = std::make_unique<MPI_Aint[]>(procNum);
         {
-            m_logger->trace("started to broadcast head address");
-            auto mpiStatus = MPI_Bcast(&m_headAddress, 1, MPI_AINT, HEAD_RANK, comm);
+            m_logger->trace("started to gather head addresses");
+            auto mpiStatus = MPI_Allgather(&headAddress, 1, MPI_AINT, pHeadAddresses.get(), 1, MPI_AINT, comm);
             if (mpiStatus != MPI_SUCCESS)
-                throw custom_mpi::MpiException("failed to broadcast head address", __FILE__, __func__ , __LINE__, mpiStatus);
-            m_logger->trace("broadcasted head address");
+                throw custom_mpi::MpiException("failed to gather head addresses", __FILE__, __func__ , __LINE__, mpiStatus);
+            m_logger->trace("gathered head addresses");
+        }
+
+        for (int rank = 0; rank < procNum; ++rank)
+        {
+            if (isHeadOwner(rank))
+                m_heads.push_back({rank, pHeadAddresses[rank], MPI_Aint_add(pHeadAddresses[rank], offsetof(HeadCell, size))});
+        }
+        m_localHeadIdx = m_shardSize == 0 ? 0 : m_rank / m_shardSize;
+    }
+
+    bool InnerStack::isHeadOwner(int rank) const
+    {
+        return m_shardSize == 0 ? rank == HEAD_RANK : rank % m_shardSize == 0;
+    }
+
+    void InnerStack::lockHead(const Head &rHead)
+    {
+        lockWinTarget(rHead.rank, m_headWin, m_epochMode);
+        if (m_pNodeReclaimer->getScheme() == ReclamationScheme::HazardPointers && rHead.rank != HEAD_RANK)
+            lockWinTarget(HEAD_RANK, m_headWin, m_epochMode);
+    }
+
+    void InnerStack::unlockHead(const Head &rHead)
+    {
+        if (m_pNodeReclaimer->getScheme() == ReclamationScheme::HazardPointers && rHead.rank != HEAD_RANK)
+        {
+            unlockWinTargetLocal(HEAD_RANK, m_headWin, m_epochMode, m_pCounters.get());
         }
+        unlockWinTargetLocal(rHead.rank, m_headWin, m_epochMode, m_pCounters.get());
+    }
+
+    size_t InnerStack::getHeadsNum() const
+    {
+        return m_heads.size();
+    }
+
+    size_t InnerStack::getLocalHeadIdx() const
+    {
+        return m_localHeadIdx;
+    }
+
+    bool InnerStack::topInline(void *pPayload, size_t headIdx, NodeStamp *pNodeStamp)
+    {
+        return peekNode(nullptr, pPayload, headIdx, pNodeStamp);
+    }
+
+    size_t InnerStack::getApproximateSize(size_t headIdx)
+    {
+        const auto &rHead = m_heads.at(headIdx);
+        int64_t size{0};
+        lockWinTarget(rHead.rank, m_headWin, m_epochMode);
+        rmaFetchAndOp(nullptr, &size, MPI_INT64_T, rHead.rank, rHead.sizeAddress, MPI_NO_OP, m_headWin, m_pCounters.get());
+        rmaFlush(rHead.rank, m_headWin, m_pCounters.get());
+        unlockWinTargetLocal(rHead.rank, m_headWin, m_epochMode, m_pCounters.get());
+        // Уменьшение после POP может быть применено раньше увеличения после встречного PUSH.
+        return size > 0 ? static_cast<size_t>(size) : 0;
+    }
+
+    bool InnerStack::isEmpty(size_t headIdx)
+    {
+        const auto &rHead = m_heads.at(headIdx);
+        lockWinTarget(rHead.rank, m_headWin, m_epochMode);
+        const auto headCountedNodePtr = fetchHead(rHead);
+        unlockWinTargetLocal(rHead.rank, m_headWin, m_epochMode, m_pCounters.get());
+        return headCountedNodePtr.isDummy();
+    }
+
+    WaiterTable &InnerStack::getWaiterTable()
+    {
+        return *m_pWaiterTable;
     }
 
     size_t InnerStack::getElemsUpLimit() const
     {
-        return m_elemsUpLimit;
+        return m_nodePool.getElemsUpLimit();
+    }
+
+    ReclamationScheme InnerStack::getReclamationScheme() const
+    {
+        return m_pNodeReclaimer->getScheme();
+    }
+
+    EpochMode InnerStack::getEpochMode() const
+    {
+        return m_epochMode;
+    }
+
+    bool InnerStack::isRequestPipeliningEnabled() const
+    {
+        return m_requestPipelining;
+    }
+
+    void InnerStack::setPhaseTimingEnabled(bool phaseTimingEnabled)
+    {
+        m_phaseTimingEnabled = phaseTimingEnabled;
+    }
+
+    const PopPhaseTimes &InnerStack::getPopPhaseTimes() const
+    {
+        return m_popPhaseTimes;
+    }
+
+    const PushPhaseTimes &InnerStack::getPushPhaseTimes() const
+    {
+        return m_pushPhaseTimes;
+    }
+
+    void InnerStack::resetPhaseTimes()
+    {
+        m_popPhaseTimes = PopPhaseTimes();
+        m_pushPhaseTimes = PushPhaseTimes();
+    }
+
+    OperationCounters &InnerStack::getOperationCounters()
+    {
+        return *m_pCounters;
+    }
+
+    const OperationCounters &InnerStack::getOperationCounters() const
+    {
+        return *m_pCounters;
+    }
+
+    void InnerStack::resetOperationCounters()
+    {
+        m_pCounters->reset();
+    }
+
+    void InnerStack::countHeadCas(uint64_t OperationCounters::*pAttempts, uint64_t OperationCounters::*pFailures,
+                                  CountedNodePtr oldHeadCountedNodePtr,
+                                  CountedNodePtr resHeadCountedNodePtr)
+    {
+        ++(m_pCounters.get()->*pAttempts);
+        if (resHeadCountedNodePtr != oldHeadCountedNodePtr)
+            ++(m_pCounters.get()->*pFailures);
+    }
+
+    void InnerStack::startPopPhases()
+    {
+        if (m_phaseTimingEnabled)
+            m_popPhaseBeginSec = MPI_Wtime();
+    }
+
+    void InnerStack::markPopPhase(double PopPhaseTimes::*pPhase)
+    {
+        if (!m_phaseTimingEnabled)
+            return;
+
+        const double nowSec = MPI_Wtime();
+        m_popPhaseTimes.*pPhase += nowSec - m_popPhaseBeginSec;
+        m_popPhaseBeginSec = nowSec;
+    }
+
+    void InnerStack::finishPopPhases()
+    {
+        if (m_phaseTimingEnabled)
+            ++m_popPhaseTimes.popsNum;
+    }
+
+    void InnerStack::startPushPhases()
+    {
+        if (m_phaseTimingEnabled)
+            m_pushPhaseBeginSec = MPI_Wtime();
+    }
+
+    void InnerStack::markPushPhase(double PushPhaseTimes::*pPhase)
+    {
+        if (!m_phaseTimingEnabled)
+            return;
+
+        const double nowSec = MPI_Wtime();
+        m_pushPhaseTimes.*pPhase += nowSec - m_pushPhaseBeginSec;
+        m_pushPhaseBeginSec = nowSec;
+    }
+
+    void InnerStack::finishPushPhases()
+    {
+        if (m_phaseTimingEnabled)
+            ++m_pushPhaseTimes.pushesNum;
+    }
+
+    size_t InnerStack::getReclamationMemoryOverhead() const
+    {
+        return m_pNodeReclaimer->getMetadataSize() + m_pNodeReclaimer->getRetiredNodesNum() * m_nodePool.getNodeSize();
+    }
+
+    size_t InnerStack::getRetiredNodesNum() const
+    {
+        return m_pNodeReclaimer->getRetiredNodesNum();
+    }
+
+    size_t InnerStack::getSegmentCapacity() const
+    {
+        return m_nodePool.getSegmentCapacity();
+    }
+
+    void InnerStack::setSegmentGrowthCallback(std::function<void(size_t)> segmentGrowthCallback)
+    {
+        m_nodePool.setSegmentGrowthCallback(std::move(segmentGrowthCallback));
+    }
+
+    bool InnerStack::serviceGrowRequests()
+    {
+        return m_nodePool.serviceGrowRequests();
     }
 
-    void InnerStack::printStack()
+    void InnerStack::printStack(size_t headIdx)
     {
+        const auto nodesWin = m_nodePool.getWin();
+        const auto &rHead = m_heads.at(headIdx);
         CountedNodePtr slider;
-        MPI_Win_lock(MPI_LOCK_SHARED, HEAD_RANK, MPI_MODE_NOCHECK, m_headWin);
-        MPI_Fetch_and_op(nullptr, &slider, MPI_UINT64_T, HEAD_RANK, m_headAddress, MPI_NO_OP, m_headWin);
-        MPI_Win_flush(HEAD_RANK, m_headWin);
-        MPI_Win_unlock(HEAD_RANK, m_headWin);
+        lockWinTarget(rHead.rank, m_headWin, m_epochMode);
+        rmaFetchAndOp(nullptr, &slider, MPI_UINT64_T, rHead.rank, rHead.address, MPI_NO_OP, m_headWin, m_pCounters.get());
+        rmaFlush(rHead.rank, m_headWin, m_pCounters.get());
+        unlockWinTargetLocal(rHead.rank, m_headWin, m_epochMode, m_pCounters.get());
 
         while (slider.getRank() < DummyRank)
         {
             m_logger->info("(rank - {}, offset - {})", slider.getRank(), slider.getOffset());
 
             int nextRank            = static_cast<int>(slider.getRank());
-            auto nextDisplacement   = static_cast<MPI_Aint>(slider.getOffset() * sizeof(Node)) + 8;
-            auto nextOffset = MPI_Aint_add(m_pBaseNodeArrAddresses[nextRank], nextDisplacement);
+            GlobalAddress nextAddress = {slider.getOffset(), slider.getRank(), 0};
+            auto nextOffset = MPI_Aint_add(m_nodePool.getNodeAddress(nextAddress), 8);
 
-            MPI_Win_lock(MPI_LOCK_SHARED, nextRank, MPI_MODE_NOCHECK, m_nodesWin);
-            MPI_Get(&slider, 1, MPI_UINT64_T, nextRank, nextOffset, 1, MPI_UINT64_T, m_nodesWin);
-            MPI_Win_flush(nextRank, m_nodesWin);
-            MPI_Win_unlock(nextRank, m_nodesWin);
+            lockWinTarget(nextRank, nodesWin, m_epochMode);
+            rmaGet(&slider, 1, MPI_UINT64_T, nextRank, nextOffset, nodesWin, m_pCounters.get());
+            rmaFlush(nextRank, nodesWin, m_pCounters.get());
+            unlockWinTargetLocal(nextRank, nodesWin, m_epochMode, m_pCounters.get());
         }
     }
 } // ref_counting
\ No newline at end of file
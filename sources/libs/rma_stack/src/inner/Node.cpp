@@ -11,8 +11,7 @@ namespace rma_stack::ref_counting
 {
     Node::Node()
     :
-    m_acquired(0),
-    m_reserved(0),
+    m_version(0),
     m_internalCounter(0),
     m_countedNodePtrNext()
     {
@@ -0,0 +1,924 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include "inner/NodePool.h"
+#include "inner/RmaOperations.h"
+#include "inner/WinEpoch.h"
+#include "MpiException.h"
+
+namespace rma_stack::ref_counting
+{
+    namespace custom_mpi = custom_mpi_extensions;
+
+    namespace
+    {
+        bool operator==(const FreeNodeListHead& lhs, const FreeNodeListHead& rhs)
+        {
+            return lhs.offset == rhs.offset && lhs.tag == rhs.tag;
+        }
+
+        bool operator!=(const FreeNodeListHead& lhs, const FreeNodeListHead& rhs)
+        {
+            return !(lhs == rhs);
+        }
+    }
+
+    NodePool::NodePool(MPI_Comm comm, MPI_Info info, bool t_centralized, int t_headRank, size_t t_elemsUpLimit,
+                       size_t t_segmentCapacity, size_t t_inlinePayloadSize, EpochMode t_epochMode,
+                       OperationCounters &t_rCounters, std::shared_ptr<spdlog::logger> t_logger)
+    :
+    m_elemsUpLimit(t_elemsUpLimit),
+    m_segmentCapacity(t_segmentCapacity),
+    m_inlinePayloadSize(t_inlinePayloadSize),
+    m_nodeSize(sizeof(Node) + getInlinePayloadWordsNum(t_inlinePayloadSize) * sizeof(uint64_t)),
+    m_headRank(t_headRank),
+    m_centralized(t_centralized),
+    m_epochMode(t_epochMode),
+    m_rCounters(t_rCounters),
+    m_logger(std::move(t_logger))
+    {
+        // Смещение DummyOffset зарезервировано под конец списка свободных узлов.
+        if (m_elemsUpLimit > DummyOffset)
+            throw std::invalid_argument("the node pool size exceeds the offset bits of the layout");
+        if (m_inlinePayloadSize > MaxInlinePayloadSize)
+            throw std::invalid_argument("the inline payload does not fit in the node");
+
+        {
+            auto mpiStatus = MPI_Comm_rank(comm, &m_rank);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to get rank", __FILE__, __func__, __LINE__, mpiStatus);
+        }
+
+        initRemoteAccessMemory(comm, info);
+    }
+
+    GlobalAddress NodePool::acquireNode(int rank)
+    {
+        m_logger->trace("started 'acquireNode'");
+        GlobalAddress nodeGlobalAddress = {0, DummyRank, 0};
+
+        if (!isValidRank(rank))
+        {
+            m_logger->trace("finished 'acquireNode'");
+            return nodeGlobalAddress;
+        }
+
+        if (m_centralized && m_rank != m_headRank)
+        {
+            nodeGlobalAddress = acquireNodeWithGrowRequests(rank);
+        }
+        else
+        {
+            serviceGrowRequests();
+
+            lockWinTarget(rank, m_nodesWin, m_epochMode);
+            nodeGlobalAddress = m_centralized ? acquireNodeFromBitmap(rank) : acquireNodeFromFreeList(rank);
+            // Узлы, освобождённые другими процессами, забираются только когда свои закончились.
+            if (isGlobalAddressDummy(nodeGlobalAddress) && !m_centralized && rank == m_rank && drainRemoteFreeRing())
+                nodeGlobalAddress = acquireNodeFromFreeList(rank);
+            unlockWinTarget(rank, m_nodesWin, m_epochMode, &m_rCounters);
+
+            // Пул может вырасти только по запросу его владельца.
+            if (isGlobalAddressDummy(nodeGlobalAddress) && rank == m_rank && grow())
+            {
+                lockWinTarget(rank, m_nodesWin, m_epochMode);
+                nodeGlobalAddress = m_centralized ? acquireNodeFromBitmap(rank) : acquireNodeFromFreeList(rank);
+                unlockWinTarget(rank, m_nodesWin, m_epochMode, &m_rCounters);
+            }
+        }
+
+        if (isGlobalAddressDummy(nodeGlobalAddress))
+            m_logger->trace("node pool of rank {} is exhausted", rank);
+
+        m_logger->trace("finished 'acquireNode'");
+        return nodeGlobalAddress;
+    }
+
+    GlobalAddress NodePool::acquireNodeWithGrowRequests(int rank)
+    {
+        auto delay = GrowRequestMinDelay;
+        for (size_t attemptIdx = 0;; ++attemptIdx)
+        {
+            lockWinTarget(rank, m_nodesWin, m_epochMode);
+            const auto nodeGlobalAddress = acquireNodeFromBitmap(rank);
+            const bool growthRequested = isGlobalAddressDummy(nodeGlobalAddress) && attemptIdx < GrowRequestRetriesNum
+                                         && requestGrowth(rank);
+            unlockWinTarget(rank, m_nodesWin, m_epochMode, &m_rCounters);
+            if (!growthRequested)
+                return nodeGlobalAddress;
+
+            // HEAD_RANK обслуживает запросы только в своих операциях и вызовах serviceGrowRequests, поэтому ожидание растёт.
+            std::this_thread::sleep_for(delay);
+            delay = std::min(delay * 2, GrowRequestMaxDelay);
+        }
+    }
+
+    bool NodePool::requestGrowth(int rank)
+    {
+        const auto nodesNum = static_cast<size_t>(fetchHeaderCounters(rank).nodesNum);
+        // Пул вырос уже после неудачного резервирования, поэтому выделение повторяется без запроса.
+        if (nodesNum > m_knownNodesNum)
+        {
+            updateKnownNodesNum(nodesNum);
+            return true;
+        }
+        if (nodesNum >= m_elemsUpLimit)
+            return false;
+
+        const int64_t requestsIncrease{1};
+        rmaAccumulate(&requestsIncrease,
+                      1,
+                      MPI_INT64_T,
+                      rank,
+                      getGrowRequestsCountAddress(rank),
+                      MPI_SUM,
+                      m_nodesWin,
+                      &m_rCounters
+        );
+        rmaFlush(rank, m_nodesWin, &m_rCounters);
+        m_logger->trace("requested growth of node pool of {} nodes", m_knownNodesNum);
+        return true;
+    }
+
+    bool NodePool::serviceGrowRequests()
+    {
+        if (!m_centralized || m_rank != m_headRank)
+            return false;
+
+        lockWinTarget(m_rank, m_nodesWin, m_epochMode);
+        const auto headerCounters = fetchHeaderCounters(m_rank);
+
+        // Запрос устарел, если после него освободились узлы.
+        const bool growthNeeded = headerCounters.growRequestsCount > 0 && headerCounters.freeNodesCount <= 0;
+        if (headerCounters.growRequestsCount > 0 && !growthNeeded)
+        {
+            const int64_t noRequests{0};
+            rmaAccumulate(&noRequests,
+                          1,
+                          MPI_INT64_T,
+                          m_rank,
+                          getGrowRequestsCountAddress(m_rank),
+                          MPI_REPLACE,
+                          m_nodesWin,
+                          &m_rCounters
+            );
+            rmaFlush(m_rank, m_nodesWin, &m_rCounters);
+        }
+        unlockWinTarget(m_rank, m_nodesWin, m_epochMode, &m_rCounters);
+
+        return growthNeeded && grow();
+    }
+
+    NodePool::HeaderCounters NodePool::fetchHeaderCounters(int rank)
+    {
+        HeaderCounters headerCounters{};
+        rmaGetAccumulate(nullptr,
+                         &headerCounters,
+                         3,
+                         MPI_INT64_T,
+                         rank,
+                         getFreeNodesCountAddress(rank),
+                         MPI_NO_OP,
+                         m_nodesWin,
+                         &m_rCounters
+        );
+        rmaFlush(rank, m_nodesWin, &m_rCounters);
+        return headerCounters;
+    }
+
+    GlobalAddress NodePool::acquireNodeFromFreeList(int rank)
+    {
+        GlobalAddress nodeGlobalAddress = {0, DummyRank, 0};
+
+        const auto freeNodeListHeadAddress = getFreeNodeListHeadAddress(rank);
+        FreeNodeListHead oldHead{DummyOffset, 0};
+        FreeNodeListHead resHead{DummyOffset, 0};
+
+        rmaFetchAndOp(nullptr,
+                      &resHead,
+                      MPI_UINT64_T,
+                      rank,
+                      freeNodeListHeadAddress,
+                      MPI_NO_OP,
+                      m_nodesWin,
+                      &m_rCounters
+        );
+        rmaFlush(rank, m_nodesWin, &m_rCounters);
+
+        /*
+         * Снятие вершины со стека свободных узлов. Если CAS не удался,
+         * то в resHead уже находится актуальная вершина, и повторное
+         * чтение головы не требуется.
+         */
+        while (resHead.offset != DummyOffset)
+        {
+            oldHead = resHead;
+
+            const GlobalAddress candidateAddress = {oldHead.offset, static_cast<uint64_t>(rank), 0};
+            const MPI_Aint freeLinkAddress = MPI_Aint_add(getNodeAddress(candidateAddress), sizeof(CountedNodePtr));
+
+            CountedNodePtr freeLink;
+            ++m_rCounters.acquireScanProbes;
+            rmaFetchAndOp(nullptr,
+                          &freeLink,
+                          MPI_UINT64_T,
+                          rank,
+                          freeLinkAddress,
+                          MPI_NO_OP,
+                          m_nodesWin,
+                          &m_rCounters
+            );
+            rmaFlush(rank, m_nodesWin, &m_rCounters);
+
+            FreeNodeListHead newHead{freeLink.isDummy() ? DummyOffset : freeLink.getOffset(), oldHead.tag + 1u};
+            ++m_rCounters.acquireClaimProbes;
+            rmaCompareAndSwap(&newHead,
+                              &oldHead,
+                              &resHead,
+                              MPI_UINT64_T,
+                              rank,
+                              freeNodeListHeadAddress,
+                              m_nodesWin,
+                              &m_rCounters
+            );
+            rmaFlush(rank, m_nodesWin, &m_rCounters);
+
+            if (resHead == oldHead)
+            {
+                nodeGlobalAddress = candidateAddress;
+                break;
+            }
+        }
+
+        return nodeGlobalAddress;
+    }
+
+    GlobalAddress NodePool::acquireNodeFromBitmap(int rank)
+    {
+        GlobalAddress nodeGlobalAddress = {0, DummyRank, 0};
+
+        /*
+         * Сначала резервируется один свободный узел уменьшением счётчика.
+         * Если резерв получен, то в карте гарантированно есть нулевой бит
+         * для текущего процесса, иначе пул заполнен, и резерв возвращается.
+         */
+        const auto freeNodesCountAddress = getFreeNodesCountAddress(rank);
+        const int64_t countDecrease{-1};
+        int64_t resFreeNodesCount{0};
+        rmaFetchAndOp(&countDecrease,
+                      &resFreeNodesCount,
+                      MPI_INT64_T,
+                      rank,
+                      freeNodesCountAddress,
+                      MPI_SUM,
+                      m_nodesWin,
+                      &m_rCounters
+        );
+        rmaFlush(rank, m_nodesWin, &m_rCounters);
+
+        if (resFreeNodesCount <= 0)
+        {
+            const int64_t countIncrease{1};
+            rmaAccumulate(&countIncrease,
+                          1,
+                          MPI_INT64_T,
+                          rank,
+                          freeNodesCountAddress,
+                          MPI_SUM,
+                          m_nodesWin,
+                          &m_rCounters
+            );
+            rmaFlush(rank, m_nodesWin, &m_rCounters);
+            return nodeGlobalAddress;
+        }
+
+        /*
+         * Свободный бит выбирается по последнему известному значению слова,
+         * поэтому в большинстве случаев узел захватывается единственной
+         * операцией MPI_BOR. Если бит уже занят, то результат операции
+         * содержит актуальное значение слова, и выбор повторяется.
+         */
+        auto wordsNum = getKnownOccupancyWordsNum();
+        auto wordIdx = m_occupancyHintWordIdx % wordsNum;
+        auto word = m_cachedOccupancyWord;
+        size_t scannedWordsNum{0};
+        for (;;)
+        {
+            if (~word == 0)
+            {
+                /*
+                 * Если все известные слова заняты, то зарезервированный узел
+                 * находится в сегменте, о котором процесс ещё не знает, и
+                 * поиск продолжается с первого слова нового сегмента. Счётчик
+                 * свободных узлов увеличивается раньше кол-ва узлов, поэтому
+                 * кол-во узлов может понадобиться перечитать.
+                 */
+                if (++scannedWordsNum >= wordsNum)
+                {
+                    const auto knownNodesNum = m_knownNodesNum;
+                    updateKnownNodesNum(static_cast<size_t>(fetchHeaderCounters(rank).nodesNum));
+                    if (m_knownNodesNum == knownNodesNum)
+                        std::this_thread::sleep_for(GrowRequestMinDelay);
+                    wordsNum = getKnownOccupancyWordsNum();
+                    wordIdx = (m_occupancyHintWordIdx + wordsNum - 1) % wordsNum;
+                    scannedWordsNum = 0;
+                }
+                wordIdx = (wordIdx + 1) % wordsNum;
+                ++m_rCounters.acquireScanProbes;
+                rmaFetchAndOp(nullptr,
+                              &word,
+                              MPI_UINT64_T,
+                              rank,
+                              getOccupancyWordAddress(rank, wordIdx),
+                              MPI_NO_OP,
+                              m_nodesWin,
+                              &m_rCounters
+                );
+                rmaFlush(rank, m_nodesWin, &m_rCounters);
+                continue;
+            }
+
+            const auto bitIdx = static_cast<uint64_t>(__builtin_ctzll(~word));
+            const uint64_t bitMask = 1ul << bitIdx;
+            uint64_t resWord{0};
+            ++m_rCounters.acquireClaimProbes;
+            rmaFetchAndOp(&bitMask,
+                          &resWord,
+                          MPI_UINT64_T,
+                          rank,
+                          getOccupancyWordAddress(rank, wordIdx),
+                          MPI_BOR,
+                          m_nodesWin,
+                          &m_rCounters
+            );
+            rmaFlush(rank, m_nodesWin, &m_rCounters);
+
+            word = resWord | bitMask;
+            if (!(resWord & bitMask))
+            {
+                nodeGlobalAddress.rank = rank;
+                nodeGlobalAddress.offset = wordIdx * OccupancyWordBitsNum + bitIdx;
+                break;
+            }
+        }
+        m_occupancyHintWordIdx = wordIdx;
+        m_cachedOccupancyWord = word;
+
+        return nodeGlobalAddress;
+    }
+
+    void NodePool::releaseNode(GlobalAddress nodeAddress)
+    {
+        {
+            const auto r = nodeAddress.rank;
+            const auto o = nodeAddress.offset;
+            m_logger->trace("started to release node (rank - {}, offset - {})", r, o);
+        }
+        ++m_rCounters.releaseNodeCalls;
+
+        if (m_centralized)
+            releaseNodeToBitmap(nodeAddress);
+        else if (static_cast<int>(nodeAddress.rank) == m_rank || !releaseNodeToRemoteFreeRing(nodeAddress))
+            releaseNodeToFreeList(nodeAddress);
+
+        {
+            const auto r = nodeAddress.rank;
+            const auto o = nodeAddress.offset;
+            m_logger->trace("released node (rank - {}, offset - {})", r, o);
+        }
+    }
+
+    void NodePool::releaseNodeToBitmap(GlobalAddress nodeAddress)
+    {
+        const auto rank = static_cast<int>(nodeAddress.rank);
+        const auto wordIdx = static_cast<size_t>(nodeAddress.offset / OccupancyWordBitsNum);
+        const uint64_t clearMask = ~(1ul << (nodeAddress.offset % OccupancyWordBitsNum));
+        const int64_t countIncrease{1};
+
+        // Счётчик увеличивается после сброса бита, чтобы резерв не опережал карту.
+        rmaAccumulate(&clearMask,
+                      1,
+                      MPI_UINT64_T,
+                      rank,
+                      getOccupancyWordAddress(rank, wordIdx),
+                      MPI_BAND,
+                      m_nodesWin,
+                      &m_rCounters
+        );
+        rmaFlush(rank, m_nodesWin, &m_rCounters);
+        rmaAccumulate(&countIncrease,
+                      1,
+                      MPI_INT64_T,
+                      rank,
+                      getFreeNodesCountAddress(rank),
+                      MPI_SUM,
+                      m_nodesWin,
+                      &m_rCounters
+        );
+        rmaFlush(rank, m_nodesWin, &m_rCounters);
+    }
+
+    void NodePool::releaseNodeToFreeList(GlobalAddress nodeAddress)
+    {
+        pushChainToFreeList(static_cast<int>(nodeAddress.rank), nodeAddress.offset, nodeAddress.offset);
+    }
+
+    bool NodePool::releaseNodeToRemoteFreeRing(GlobalAddress nodeAddress)
+    {
+        const auto rank = static_cast<int>(nodeAddress.rank);
+        auto& rCursor = m_pRemoteFreeRingCursors[rank];
+
+        const uint64_t emptySlot{0};
+        const uint64_t occupiedSlot = nodeAddress.offset + 1;
+        for (size_t i = 0; i < RemoteFreeRingProbesNum; ++i)
+        {
+            uint64_t resSlot{0};
+            rmaCompareAndSwap(&occupiedSlot,
+                              &emptySlot,
+                              &resSlot,
+                              MPI_UINT64_T,
+                              rank,
+                              getRemoteFreeSlotAddress(rank, rCursor),
+                              m_nodesWin,
+                              &m_rCounters
+            );
+            rmaFlush(rank, m_nodesWin, &m_rCounters);
+            rCursor = (rCursor + 1) % RemoteFreeRingSlotsNum;
+
+            if (resSlot == emptySlot)
+                return true;
+        }
+        return false;
+    }
+
+    bool NodePool::drainRemoteFreeRing()
+    {
+        rmaGetAccumulate(nullptr,
+                         m_pRemoteFreeSlots.get(),
+                         RemoteFreeRingSlotsNum,
+                         MPI_UINT64_T,
+                         m_rank,
+                         getRemoteFreeSlotAddress(m_rank, 0),
+                         MPI_NO_OP,
+                         m_nodesWin,
+                         &m_rCounters
+        );
+        rmaFlush(m_rank, m_nodesWin, &m_rCounters);
+
+        /*
+         * Занятую ячейку может очистить только владелец кольца, поэтому
+         * прочитанные значения остаются актуальными до их очистки. Узлы
+         * связываются в цепочку, которая добавляется в стек свободных
+         * узлов одной операцией CAS.
+         */
+        const uint64_t emptySlot{0};
+        uint64_t firstOffset{DummyOffset};
+        uint64_t lastOffset{DummyOffset};
+        size_t drainedNodesNum{0};
+        for (size_t i = 0; i < RemoteFreeRingSlotsNum; ++i)
+        {
+            if (m_pRemoteFreeSlots[i] == emptySlot)
+                continue;
+
+            rmaAccumulate(&emptySlot,
+                          1,
+                          MPI_UINT64_T,
+                          m_rank,
+                          getRemoteFreeSlotAddress(m_rank, i),
+                          MPI_REPLACE,
+                          m_nodesWin,
+                          &m_rCounters
+            );
+
+            const auto offset = m_pRemoteFreeSlots[i] - 1;
+            if (lastOffset == DummyOffset)
+            {
+                lastOffset = offset;
+            }
+            else
+            {
+                auto& rFreeLink = m_pRemoteFreeLinks[i];
+                rFreeLink.setRank(m_rank);
+                rFreeLink.setOffset(firstOffset);
+
+                const GlobalAddress nodeAddress = {offset, static_cast<uint64_t>(m_rank), 0};
+                rmaPut(&rFreeLink,
+                       1,
+                       MPI_UINT64_T,
+                       m_rank,
+                       MPI_Aint_add(getNodeAddress(nodeAddress), sizeof(CountedNodePtr)),
+                       m_nodesWin,
+                       &m_rCounters
+                );
+            }
+            firstOffset = offset;
+            ++drainedNodesNum;
+        }
+
+        if (drainedNodesNum == 0)
+            return false;
+
+        rmaFlush(m_rank, m_nodesWin, &m_rCounters);
+        pushChainToFreeList(m_rank, firstOffset, lastOffset);
+        m_logger->trace("drained {} remotely freed nodes", drainedNodesNum);
+        return true;
+    }
+
+    void NodePool::pushChainToFreeList(int rank, uint64_t firstOffset, uint64_t lastOffset)
+    {
+        const auto freeNodeListHeadAddress = getFreeNodeListHeadAddress(rank);
+        const GlobalAddress lastNodeAddress = {lastOffset, static_cast<uint64_t>(rank), 0};
+        const MPI_Aint freeLinkAddress = MPI_Aint_add(getNodeAddress(lastNodeAddress), sizeof(CountedNodePtr));
+
+        FreeNodeListHead oldHead{DummyOffset, 0};
+        FreeNodeListHead resHead{DummyOffset, 0};
+        rmaFetchAndOp(nullptr,
+                      &resHead,
+                      MPI_UINT64_T,
+                      rank,
+                      freeNodeListHeadAddress,
+                      MPI_NO_OP,
+                      m_nodesWin,
+                      &m_rCounters
+        );
+        rmaFlush(rank, m_nodesWin, &m_rCounters);
+
+        // Добавление цепочки узлов на вершину стека свободных узлов.
+        do
+        {
+            oldHead = resHead;
+
+            CountedNodePtr freeLink;
+            if (oldHead.offset != DummyOffset)
+            {
+                freeLink.setRank(rank);
+                freeLink.setOffset(oldHead.offset);
+            }
+            rmaPut(&freeLink,
+                   1,
+                   MPI_UINT64_T,
+                   rank,
+                   freeLinkAddress,
+                   m_nodesWin,
+                   &m_rCounters
+            );
+            rmaFlush(rank, m_nodesWin, &m_rCounters);
+
+            FreeNodeListHead newHead{firstOffset, oldHead.tag + 1u};
+            rmaCompareAndSwap(&newHead,
+                              &oldHead,
+                              &resHead,
+                              MPI_UINT64_T,
+                              rank,
+                              freeNodeListHeadAddress,
+                              m_nodesWin,
+                              &m_rCounters
+            );
+            rmaFlush(rank, m_nodesWin, &m_rCounters);
+        }
+        while (resHead != oldHead);
+    }
+
+    bool NodePool::grow()
+    {
+        auto pSegment = m_pNodesArena->grow();
+        if (!pSegment)
+            return false;
+
+        const auto segmentIdx = m_pNodesArena->getSegmentsNum() - 1;
+        initSegmentNodes(pSegment, segmentIdx);
+
+        if (m_segmentGrowthCallback)
+            m_segmentGrowthCallback(segmentIdx);
+
+        lockWinTarget(m_rank, m_nodesWin, m_epochMode);
+        if (m_centralized)
+            publishSegmentToBitmap(segmentIdx);
+        else
+            publishSegmentToFreeList(segmentIdx);
+        unlockWinTarget(m_rank, m_nodesWin, m_epochMode, &m_rCounters);
+
+        m_logger->trace("grew node pool to {} segments", segmentIdx + 1);
+        return true;
+    }
+
+    void NodePool::initSegmentNodes(std::byte *pSegment, size_t segmentIdx)
+    {
+        const auto firstNodeIdx = segmentIdx * m_segmentCapacity;
+        const auto segmentNodesNum = m_pNodesArena->getSegmentElemsNum(segmentIdx);
+
+        // Узлы сегмента свободны, а в децентрализованном режиме ещё и связаны по порядку до публикации.
+        std::fill_n(pSegment, segmentNodesNum * m_nodeSize, std::byte{0});
+        for (size_t i = 0; i < segmentNodesNum; ++i)
+        {
+            auto pNode = new (pSegment + i * m_nodeSize) Node();
+            if (m_centralized || i + 1 == segmentNodesNum)
+                continue;
+
+            CountedNodePtr freeLink;
+            freeLink.setRank(m_rank);
+            freeLink.setOffset(firstNodeIdx + i + 1);
+            pNode->setCountedNodePtrNext(freeLink);
+        }
+    }
+
+    void NodePool::publishSegmentToFreeList(size_t segmentIdx)
+    {
+        // Цепочка узлов сегмента добавляется на вершину стека свободных узлов целиком.
+        const auto firstNodeIdx = segmentIdx * m_segmentCapacity;
+        const auto lastNodeIdx = firstNodeIdx + m_pNodesArena->getSegmentElemsNum(segmentIdx) - 1;
+        pushChainToFreeList(m_rank, firstNodeIdx, lastNodeIdx);
+    }
+
+    void NodePool::publishSegmentToBitmap(size_t segmentIdx)
+    {
+        const auto firstNodeIdx = segmentIdx * m_segmentCapacity;
+        const auto segmentNodesNum = m_pNodesArena->getSegmentElemsNum(segmentIdx);
+        const auto lastNodeIdx = firstNodeIdx + segmentNodesNum - 1;
+
+        // Другие процессы захватывают биты тех же слов, поэтому биты сегмента сбрасываются операциями MPI_BAND.
+        for (auto wordIdx = firstNodeIdx / OccupancyWordBitsNum; wordIdx <= lastNodeIdx / OccupancyWordBitsNum; ++wordIdx)
+        {
+            const auto wordFirstNodeIdx = wordIdx * OccupancyWordBitsNum;
+            uint64_t clearMask{~0ul};
+            for (auto nodeIdx = std::max(firstNodeIdx, wordFirstNodeIdx);
+                 nodeIdx <= std::min(lastNodeIdx, wordFirstNodeIdx + OccupancyWordBitsNum - 1);
+                 ++nodeIdx)
+                clearMask &= ~(1ul << (nodeIdx - wordFirstNodeIdx));
+
+            rmaAccumulate(&clearMask,
+                          1,
+                          MPI_UINT64_T,
+                          m_rank,
+                          getOccupancyWordAddress(m_rank, wordIdx),
+                          MPI_BAND,
+                          m_nodesWin,
+                          &m_rCounters
+            );
+        }
+        rmaFlush(m_rank, m_nodesWin, &m_rCounters);
+
+        /*
+         * Кол-во узлов пула увеличивается после счётчика свободных узлов:
+         * процесс, который увидел новое кол-во узлов, повторяет
+         * резервирование и уже не примет пул за заполненный. Процесс,
+         * который зарезервировал узел нового сегмента раньше, перечитывает
+         * кол-во узлов, пока не найдёт его бит.
+         */
+        const auto nodesIncrease = static_cast<int64_t>(segmentNodesNum);
+        const int64_t noRequests{0};
+        rmaAccumulate(&nodesIncrease,
+                      1,
+                      MPI_INT64_T,
+                      m_rank,
+                      getFreeNodesCountAddress(m_rank),
+                      MPI_SUM,
+                      m_nodesWin,
+                      &m_rCounters
+        );
+        rmaAccumulate(&noRequests,
+                      1,
+                      MPI_INT64_T,
+                      m_rank,
+                      getGrowRequestsCountAddress(m_rank),
+                      MPI_REPLACE,
+                      m_nodesWin,
+                      &m_rCounters
+        );
+        rmaFlush(m_rank, m_nodesWin, &m_rCounters);
+        rmaAccumulate(&nodesIncrease,
+                      1,
+                      MPI_INT64_T,
+                      m_rank,
+                      MPI_Aint_add(m_pHeaderAddresses[0], offsetof(NodePoolHeader, nodesNum)),
+                      MPI_SUM,
+                      m_nodesWin,
+                      &m_rCounters
+        );
+        rmaFlush(m_rank, m_nodesWin, &m_rCounters);
+        m_knownNodesNum = firstNodeIdx + segmentNodesNum;
+    }
+
+    MPI_Aint NodePool::getNodeAddress(GlobalAddress nodeAddress) const
+    {
+        return m_pNodesArena->getElemAddress(nodeAddress);
+    }
+
+    size_t NodePool::getNodeSize() const
+    {
+        return m_nodeSize;
+    }
+
+    size_t NodePool::getInlinePayloadSize() const
+    {
+        return m_inlinePayloadSize;
+    }
+
+    MPI_Aint NodePool::getFreeNodeListHeadAddress(int rank) const
+    {
+        return m_pHeaderAddresses[getOwnerIdx(rank)];
+    }
+
+    MPI_Aint NodePool::getFreeNodesCountAddress(int rank) const
+    {
+        return MPI_Aint_add(m_pHeaderAddresses[getOwnerIdx(rank)], offsetof(NodePoolHeader, freeNodesCount));
+    }
+
+    MPI_Aint NodePool::getGrowRequestsCountAddress(int rank) const
+    {
+        return MPI_Aint_add(m_pHeaderAddresses[getOwnerIdx(rank)], offsetof(NodePoolHeader, growRequestsCount));
+    }
+
+    MPI_Aint NodePool::getOccupancyWordAddress(int rank, size_t wordIdx) const
+    {
+        const auto wordDisplacement = static_cast<MPI_Aint>(sizeof(NodePoolHeader) + wordIdx * sizeof(uint64_t));
+        return MPI_Aint_add(m_pHeaderAddresses[getOwnerIdx(rank)], wordDisplacement);
+    }
+
+    MPI_Aint NodePool::getRemoteFreeSlotAddress(int rank, size_t slotIdx) const
+    {
+        const auto slotDisplacement = static_cast<MPI_Aint>(sizeof(NodePoolHeader) + slotIdx * sizeof(uint64_t));
+        return MPI_Aint_add(m_pHeaderAddresses[getOwnerIdx(rank)], slotDisplacement);
+    }
+
+    size_t NodePool::getOccupancyWordsNum() const
+    {
+        return (m_elemsUpLimit + OccupancyWordBitsNum - 1) / OccupancyWordBitsNum;
+    }
+
+    void NodePool::updateKnownNodesNum(size_t nodesNum)
+    {
+        if (nodesNum <= m_knownNodesNum)
+            return;
+
+        // Свободные узлы появились только в новых сегментах, поэтому поиск начинается с них.
+        m_occupancyHintWordIdx = m_knownNodesNum / OccupancyWordBitsNum;
+        m_cachedOccupancyWord = 0;
+        m_knownNodesNum = nodesNum;
+    }
+
+    size_t NodePool::getKnownOccupancyWordsNum() const
+    {
+        return std::max<size_t>((m_knownNodesNum + OccupancyWordBitsNum - 1) / OccupancyWordBitsNum, 1);
+    }
+
+    bool NodePool::isOwner() const
+    {
+        return !m_centralized || m_rank == m_headRank;
+    }
+
+    int NodePool::getOwnerIdx(int rank) const
+    {
+        return m_centralized ? 0 : rank;
+    }
+
+    MPI_Win NodePool::getWin() const
+    {
+        return m_nodesWin;
+    }
+
+    EpochMode NodePool::getEpochMode() const
+    {
+        return m_epochMode;
+    }
+
+    size_t NodePool::getElemsUpLimit() const
+    {
+        return m_elemsUpLimit;
+    }
+
+    size_t NodePool::getSegmentCapacity() const
+    {
+        return m_segmentCapacity;
+    }
+
+    void NodePool::setSegmentGrowthCallback(std::function<void(size_t)> t_segmentGrowthCallback)
+    {
+        m_segmentGrowthCallback = std::move(t_segmentGrowthCallback);
+    }
+
+    void NodePool::release()
+    {
+        m_pNodesArena->release();
+        if (m_pHeader)
+        {
+            MPI_Win_detach(m_nodesWin, m_pHeader);
+            MPI_Free_mem(m_pHeader);
+            m_pHeader = nullptr;
+        }
+        m_logger->trace("freed up node arr RMA memory");
+
+        endWinEpoch(m_nodesWin, m_epochMode);
+        MPI_Win_free(&m_nodesWin);
+        m_logger->trace("freed up node win RMA memory");
+    }
+
+    void NodePool::initRemoteAccessMemory(MPI_Comm comm, MPI_Info info)
+    {
+        {
+            auto mpiStatus = MPI_Win_create_dynamic(info, comm, &m_nodesWin);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to create RMA window for nodes", __FILE__, __func__, __LINE__, mpiStatus);
+        }
+        beginWinEpoch(m_nodesWin, m_epochMode);
+
+        int procNum{0};
+        MPI_Comm_size(comm, &procNum);
+        const int ownersNum = m_centralized ? 1 : procNum;
+        m_pHeaderAddresses = std::make_unique<MPI_Aint[]>(ownersNum);
+
+        // Пул выделяется по одному сегменту, остальные сегменты - по мере необходимости.
+        const auto initialNodesNum = std::min(m_segmentCapacity, m_elemsUpLimit);
+        m_knownNodesNum = initialNodesNum;
+        MPI_Aint headerAddress{(MPI_Aint)MPI_BOTTOM};
+        if (isOwner())
+        {
+            m_logger->trace("started to initialize node pool header");
+
+            const auto occupancyWordsNum = m_centralized ? getOccupancyWordsNum() : 0;
+            const auto remoteFreeSlotsNum = m_centralized ? 0 : RemoteFreeRingSlotsNum;
+            const auto headerTailWordsNum = occupancyWordsNum + remoteFreeSlotsNum;
+            const auto headerSize = static_cast<MPI_Aint>(sizeof(NodePoolHeader) + headerTailWordsNum * sizeof(uint64_t));
+            {
+                auto mpiStatus = MPI_Alloc_mem(headerSize, MPI_INFO_NULL, &m_pHeader);
+                if (mpiStatus != MPI_SUCCESS)
+                    throw custom_mpi::MpiException(
+                            "failed to allocate RMA memory",
+                            __FILE__,
+                            __func__,
+                            __LINE__,
+                            mpiStatus
+                    );
+            }
+
+            m_pHeader->freeNodeListHead = {initialNodesNum > 0 ? 0 : DummyOffset, 0};
+            m_pHeader->freeNodesCount = static_cast<int64_t>(initialNodesNum);
+            m_pHeader->growRequestsCount = 0;
+            m_pHeader->nodesNum = static_cast<int64_t>(initialNodesNum);
+
+            // Биты узлов за пределами пула помечаются занятыми.
+            auto pOccupancyWords = reinterpret_cast<uint64_t*>(m_pHeader + 1);
+            std::fill_n(pOccupancyWords, occupancyWordsNum, ~0ul);
+            for (size_t i = 0; i < initialNodesNum && m_centralized; ++i)
+                pOccupancyWords[i / OccupancyWordBitsNum] &= ~(1ul << (i % OccupancyWordBitsNum));
+
+            auto pRemoteFreeSlots = pOccupancyWords + occupancyWordsNum;
+            std::fill_n(pRemoteFreeSlots, remoteFreeSlotsNum, 0);
+            m_logger->trace("initialized node pool header");
+
+            {
+                auto mpiStatus = MPI_Win_attach(m_nodesWin, (void*)m_pHeader, headerSize);
+                if (mpiStatus != MPI_SUCCESS)
+                    throw custom_mpi::MpiException("failed to attach RMA window", __FILE__, __func__, __LINE__, mpiStatus);
+            }
+            m_logger->trace("attached node pool header to RMA window");
+
+            MPI_Get_address(m_pHeader, &headerAddress);
+        }
+
+        m_logger->trace("started to broadcast node pool header addresses");
+        if (m_centralized)
+        {
+            auto mpiStatus = MPI_Bcast(&headerAddress, 1, MPI_AINT, m_headRank, comm);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to broadcast node pool header address", __FILE__, __func__ , __LINE__, mpiStatus);
+            m_pHeaderAddresses[0] = headerAddress;
+        }
+        else
+        {
+            auto mpiStatus = MPI_Allgather(&headerAddress, 1, MPI_AINT, m_pHeaderAddresses.get(), 1, MPI_AINT, comm);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to gather node pool header addresses", __FILE__, __func__ , __LINE__, mpiStatus);
+        }
+        m_logger->trace("broadcasted node pool header addresses");
+
+        m_pNodesArena = std::make_unique<SegmentedArena>(comm, m_nodesWin, m_epochMode, m_centralized, m_headRank,
+                                                         m_nodeSize, m_segmentCapacity, m_elemsUpLimit, m_logger);
+        if (isOwner() && initialNodesNum > 0)
+        {
+            initSegmentNodes(m_pNodesArena->grow(), 0);
+            m_logger->trace("initialized first node segment");
+        }
+
+        if (m_centralized)
+        {
+            // Процессы начинают поиск свободных узлов с разных слов битовой карты.
+            m_occupancyHintWordIdx = static_cast<size_t>(m_rank) * getKnownOccupancyWordsNum() / procNum;
+        }
+        else
+        {
+            // Процессы начинают запись в кольца других процессов с разных ячеек.
+            m_pRemoteFreeRingCursors = std::make_unique<size_t[]>(procNum);
+            std::fill_n(m_pRemoteFreeRingCursors.get(), procNum, static_cast<size_t>(m_rank) * RemoteFreeRingSlotsNum / procNum);
+            m_pRemoteFreeSlots = std::make_unique<uint64_t[]>(RemoteFreeRingSlotsNum);
+            m_pRemoteFreeLinks = std::make_unique<CountedNodePtr[]>(RemoteFreeRingSlotsNum);
+        }
+    }
+} // ref_counting
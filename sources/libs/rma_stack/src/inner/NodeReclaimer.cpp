@@ -0,0 +1,215 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include <algorithm>
+
+#include "inner/NodeReclaimer.h"
+#include "inner/RmaOperations.h"
+#include "inner/WinEpoch.h"
+#include "MpiException.h"
+
+namespace rma_stack::ref_counting
+{
+    namespace custom_mpi = custom_mpi_extensions;
+
+    namespace
+    {
+        bool isNodeLess(GlobalAddress lhs, GlobalAddress rhs)
+        {
+            return lhs.rank < rhs.rank || (lhs.rank == rhs.rank && lhs.offset < rhs.offset);
+        }
+    }
+
+    std::string_view getReclamationSchemeName(ReclamationScheme scheme)
+    {
+        switch (scheme)
+        {
+            case ReclamationScheme::RefCounting:
+                return "ref counting";
+            case ReclamationScheme::HazardPointers:
+                return "hazard pointers";
+            case ReclamationScheme::Epochs:
+                return "epochs";
+        }
+        return "unknown";
+    }
+
+    NodeReclaimer::NodeReclaimer(MPI_Comm comm, MPI_Win t_headWin, int t_headRank, ReclamationScheme t_scheme,
+                                 OperationCounters &t_rCounters, std::shared_ptr<spdlog::logger> t_logger)
+    :
+    m_comm(comm),
+    m_headWin(t_headWin),
+    m_headRank(t_headRank),
+    m_scheme(t_scheme),
+    m_rCounters(t_rCounters),
+    m_logger(std::move(t_logger))
+    {
+        MPI_Comm_rank(comm, &m_rank);
+        MPI_Comm_size(comm, &m_procNum);
+
+        if (m_scheme != ReclamationScheme::HazardPointers)
+            return;
+
+        if (m_rank == m_headRank)
+        {
+            m_logger->trace("started to initialize hazard pointers");
+            const auto hazardsSize = static_cast<MPI_Aint>(sizeof(GlobalAddress) * m_procNum);
+            {
+                auto mpiStatus = MPI_Alloc_mem(hazardsSize, MPI_INFO_NULL, &m_pHazards);
+                if (mpiStatus != MPI_SUCCESS)
+                    throw custom_mpi::MpiException(
+                            "failed to allocate RMA memory",
+                            __FILE__,
+                            __func__,
+                            __LINE__,
+                            mpiStatus
+                    );
+            }
+            std::fill_n(m_pHazards, m_procNum, GlobalAddress{0, DummyRank, 0});
+            {
+                auto mpiStatus = MPI_Win_attach(m_headWin, m_pHazards, hazardsSize);
+                if (mpiStatus != MPI_SUCCESS)
+                    throw custom_mpi::MpiException("failed to attach RMA window", __FILE__, __func__, __LINE__, mpiStatus);
+            }
+            MPI_Get_address(m_pHazards, &m_hazardsAddress);
+            m_logger->trace("initialized hazard pointers");
+        }
+
+        {
+            auto mpiStatus = MPI_Bcast(&m_hazardsAddress, 1, MPI_AINT, m_headRank, comm);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to broadcast hazard pointers address", __FILE__, __func__ , __LINE__, mpiStatus);
+        }
+        m_pHazardsSnapshot = std::make_unique<GlobalAddress[]>(m_procNum);
+        m_retiredNodes.reserve(HazardScanFactor * m_procNum);
+    }
+
+    void NodeReclaimer::protect(GlobalAddress nodeAddress)
+    {
+        if (m_scheme != ReclamationScheme::HazardPointers)
+            return;
+
+        rmaAccumulate(&nodeAddress,
+                      1,
+                      MPI_UINT64_T,
+                      m_headRank,
+                      getHazardAddress(m_rank),
+                      MPI_REPLACE,
+                      m_headWin,
+                      &m_rCounters
+        );
+        rmaFlush(m_headRank, m_headWin, &m_rCounters);
+    }
+
+    void NodeReclaimer::clear()
+    {
+        protect(GlobalAddress{0, DummyRank, 0});
+    }
+
+    void NodeReclaimer::retire(GlobalAddress nodeAddress, NodePool &rNodePool)
+    {
+        m_retiredNodes.push_back(nodeAddress);
+        if (m_scheme == ReclamationScheme::HazardPointers && m_retiredNodes.size() >= HazardScanFactor * m_procNum)
+            scanHazards(rNodePool);
+    }
+
+    void NodeReclaimer::reclaim(NodePool &rNodePool)
+    {
+        // После барьера ни один процесс не держит ссылок на узлы, снятые до него.
+        MPI_Barrier(m_comm);
+        if (m_scheme == ReclamationScheme::RefCounting)
+            return;
+
+        releaseNodes(m_retiredNodes, rNodePool);
+        m_logger->trace("reclaimed {} retired nodes", m_retiredNodes.size());
+        m_retiredNodes.clear();
+
+        // Второй барьер гарантирует, что после выхода из функции освобождены узлы всех процессов.
+        MPI_Barrier(m_comm);
+    }
+
+    void NodeReclaimer::scanHazards(NodePool &rNodePool)
+    {
+        rmaGetAccumulate(nullptr,
+                         m_pHazardsSnapshot.get(),
+                         m_procNum,
+                         MPI_UINT64_T,
+                         m_headRank,
+                         m_hazardsAddress,
+                         MPI_NO_OP,
+                         m_headWin,
+                         &m_rCounters
+        );
+        rmaFlush(m_headRank, m_headWin, &m_rCounters);
+
+        auto pHazardsBegin = m_pHazardsSnapshot.get();
+        auto pHazardsEnd = pHazardsBegin + m_procNum;
+        std::sort(pHazardsBegin, pHazardsEnd, isNodeLess);
+
+        // Узлы, которые защищены хотя бы одним процессом, остаются отложенными.
+        const auto itProtectedBegin = std::partition(m_retiredNodes.begin(), m_retiredNodes.end(),
+                                                     [pHazardsBegin, pHazardsEnd](GlobalAddress nodeAddress) {
+            return !std::binary_search(pHazardsBegin, pHazardsEnd, nodeAddress, isNodeLess);
+        });
+        std::vector<GlobalAddress> unprotectedNodes(m_retiredNodes.begin(), itProtectedBegin);
+        m_retiredNodes.erase(m_retiredNodes.begin(), itProtectedBegin);
+
+        releaseNodes(unprotectedNodes, rNodePool);
+        m_logger->trace("released {} retired nodes after hazard scan", unprotectedNodes.size());
+    }
+
+    void NodeReclaimer::releaseNodes(const std::vector<GlobalAddress> &rNodeAddresses, NodePool &rNodePool)
+    {
+        // Узлы одного владельца освобождаются в одной эпохе доступа.
+        auto nodeAddresses = rNodeAddresses;
+        std::sort(nodeAddresses.begin(), nodeAddresses.end(), isNodeLess);
+
+        const auto nodesWin = rNodePool.getWin();
+        const auto epochMode = rNodePool.getEpochMode();
+        for (auto it = nodeAddresses.begin(); it != nodeAddresses.end();)
+        {
+            const auto rank = static_cast<int>(it->rank);
+            lockWinTarget(rank, nodesWin, epochMode);
+            for (; it != nodeAddresses.end() && static_cast<int>(it->rank) == rank; ++it)
+                rNodePool.releaseNode(*it);
+            unlockWinTarget(rank, nodesWin, epochMode, &m_rCounters);
+        }
+    }
+
+    ReclamationScheme NodeReclaimer::getScheme() const
+    {
+        return m_scheme;
+    }
+
+    size_t NodeReclaimer::getRetiredNodesNum() const
+    {
+        return m_retiredNodes.size();
+    }
+
+    size_t NodeReclaimer::getMetadataSize() const
+    {
+        if (m_scheme != ReclamationScheme::HazardPointers)
+            return 0;
+
+        const size_t hazardsSize = m_rank == m_headRank ? sizeof(GlobalAddress) * m_procNum : 0;
+        return hazardsSize + sizeof(GlobalAddress) * m_procNum;
+    }
+
+    MPI_Aint NodeReclaimer::getHazardAddress(int rank) const
+    {
+        return MPI_Aint_add(m_hazardsAddress, static_cast<MPI_Aint>(sizeof(GlobalAddress) * rank));
+    }
+
+    void NodeReclaimer::release()
+    {
+        if (m_pHazards)
+        {
+            MPI_Win_detach(m_headWin, m_pHazards);
+            MPI_Free_mem(m_pHazards);
+            m_pHazards = nullptr;
+            m_logger->trace("freed up hazard pointers RMA memory");
+        }
+        m_retiredNodes.clear();
+    }
+} // ref_counting
@@ -0,0 +1,123 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include "inner/OperationCounters.h"
+
+namespace rma_stack::ref_counting
+{
+    namespace
+    {
+        // Результат записывается в буфер процесса root, буферы остальных процессов не меняются.
+        void reduceInPlace(void *pBuffer, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+        {
+            int rank{-1};
+            MPI_Comm_rank(comm, &rank);
+            if (rank == root)
+                MPI_Reduce(MPI_IN_PLACE, pBuffer, count, datatype, op, root, comm);
+            else
+                MPI_Reduce(pBuffer, nullptr, count, datatype, op, root, comm);
+        }
+    }
+
+    void OperationCounters::reset()
+    {
+        // Размер сохраняется, чтобы не перераспределять память под счётчики RMA во время замера.
+        auto targetsNum = rmaTargets.size();
+        *this = OperationCounters();
+        rmaTargets.resize(targetsNum);
+    }
+
+    void OperationCounters::reduce(MPI_Comm comm, int root)
+    {
+        uint64_t counts[] = {
+                pushCasAttempts, pushCasFailures,
+                popCasAttempts, popCasFailures,
+                headCountCasAttempts, headCountCasFailures,
+                acquireClaimProbes, acquireScanProbes,
+                releaseNodeCalls, backoffCalls
+        };
+        constexpr int CountsNum = sizeof(counts) / sizeof(counts[0]);
+        reduceInPlace(counts, CountsNum, MPI_UINT64_T, MPI_SUM, root, comm);
+        double reducedBackoffSec = backoffSec;
+        reduceInPlace(&reducedBackoffSec, 1, MPI_DOUBLE, MPI_SUM, root, comm);
+
+        // У всех процессов rmaTargets имеет размер коммуникатора стека.
+        constexpr size_t RmaTargetFieldsNum = 3;
+        std::vector<uint64_t> rmaCounts(rmaTargets.size() * RmaTargetFieldsNum, 0);
+        for (size_t i = 0; i < rmaTargets.size(); ++i)
+        {
+            rmaCounts[i * RmaTargetFieldsNum]     = rmaTargets[i].opsNum;
+            rmaCounts[i * RmaTargetFieldsNum + 1] = rmaTargets[i].bytesNum;
+            rmaCounts[i * RmaTargetFieldsNum + 2] = rmaTargets[i].flushesNum;
+        }
+        reduceInPlace(rmaCounts.data(), static_cast<int>(rmaCounts.size()), MPI_UINT64_T, MPI_SUM, root, comm);
+
+        int rank{-1};
+        MPI_Comm_rank(comm, &rank);
+        if (rank != root)
+            return;
+
+        pushCasAttempts      = counts[0];
+        pushCasFailures      = counts[1];
+        popCasAttempts       = counts[2];
+        popCasFailures       = counts[3];
+        headCountCasAttempts = counts[4];
+        headCountCasFailures = counts[5];
+        acquireClaimProbes   = counts[6];
+        acquireScanProbes    = counts[7];
+        releaseNodeCalls     = counts[8];
+        backoffCalls         = counts[9];
+        backoffSec           = reducedBackoffSec;
+        for (size_t i = 0; i < rmaTargets.size(); ++i)
+        {
+            rmaTargets[i].opsNum     = rmaCounts[i * RmaTargetFieldsNum];
+            rmaTargets[i].bytesNum   = rmaCounts[i * RmaTargetFieldsNum + 1];
+            rmaTargets[i].flushesNum = rmaCounts[i * RmaTargetFieldsNum + 2];
+        }
+    }
+
+    RmaTargetCounters OperationCounters::getRmaTotal() const
+    {
+        RmaTargetCounters total;
+        for (const auto &rTargetCounters: rmaTargets)
+        {
+            total.opsNum     += rTargetCounters.opsNum;
+            total.bytesNum   += rTargetCounters.bytesNum;
+            total.flushesNum += rTargetCounters.flushesNum;
+        }
+        return total;
+    }
+
+    void reducePhaseTimes(PopPhaseTimes &rPhaseTimes, MPI_Comm comm, int root)
+    {
+        double times[] = {
+                rPhaseTimes.headRead, rPhaseTimes.nextRead, rPhaseTimes.headCas,
+                rPhaseTimes.dataRead, rPhaseTimes.nodeRelease, rPhaseTimes.backoff
+        };
+        auto popsNum = static_cast<uint64_t>(rPhaseTimes.popsNum);
+        reduceInPlace(times, sizeof(times) / sizeof(times[0]), MPI_DOUBLE, MPI_SUM, root, comm);
+        reduceInPlace(&popsNum, 1, MPI_UINT64_T, MPI_SUM, root, comm);
+
+        int rank{-1};
+        MPI_Comm_rank(comm, &rank);
+        if (rank == root)
+            rPhaseTimes = {times[0], times[1], times[2], times[3], times[4], times[5], static_cast<size_t>(popsNum)};
+    }
+
+    void reducePhaseTimes(PushPhaseTimes &rPhaseTimes, MPI_Comm comm, int root)
+    {
+        double times[] = {
+                rPhaseTimes.nodeAcquire, rPhaseTimes.dataPut, rPhaseTimes.linkCas,
+                rPhaseTimes.backoff, rPhaseTimes.finish
+        };
+        auto pushesNum = static_cast<uint64_t>(rPhaseTimes.pushesNum);
+        reduceInPlace(times, sizeof(times) / sizeof(times[0]), MPI_DOUBLE, MPI_SUM, root, comm);
+        reduceInPlace(&pushesNum, 1, MPI_UINT64_T, MPI_SUM, root, comm);
+
+        int rank{-1};
+        MPI_Comm_rank(comm, &rank);
+        if (rank == root)
+            rPhaseTimes = {times[0], times[1], times[2], times[3], times[4], static_cast<size_t>(pushesNum)};
+    }
+} // ref_counting
@@ -0,0 +1,300 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+#include "inner/PayloadArena.h"
+#include "inner/RmaOperations.h"
+#include "inner/WinEpoch.h"
+#include "MpiException.h"
+
+namespace rma_stack::ref_counting
+{
+    namespace custom_mpi = custom_mpi_extensions;
+
+    PayloadArena::PayloadArena(MPI_Comm comm, MPI_Info info, size_t t_maxPayloadSize, EpochMode t_epochMode,
+                               std::shared_ptr<spdlog::logger> t_logger, OperationCounters *t_pCounters)
+    :
+    m_maxPayloadSize(t_maxPayloadSize),
+    m_epochMode(t_epochMode),
+    m_pCounters(t_pCounters),
+    m_logger(std::move(t_logger))
+    {
+        // Данные читаются одной операцией MPI_Get, а размер хранится в ссылке 32 битами.
+        if (m_maxPayloadSize == 0 || m_maxPayloadSize > static_cast<size_t>(INT_MAX))
+            throw std::invalid_argument("the max payload size is out of bounds");
+
+        MPI_Comm_rank(comm, &m_rank);
+        m_sizeClassesNum = getSizeClassIdx(m_maxPayloadSize) + 1;
+        m_freeBlocks.resize(m_sizeClassesNum);
+        m_chunksNums.resize(m_sizeClassesNum, 0);
+
+        {
+            auto mpiStatus = MPI_Win_create_dynamic(info, comm, &m_win);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to create RMA window for payloads", __FILE__, __func__, __LINE__, mpiStatus);
+        }
+        beginWinEpoch(m_win, m_epochMode);
+
+        const auto headsSize = static_cast<MPI_Aint>(sizeof(uint64_t) * m_sizeClassesNum);
+        {
+            auto mpiStatus = MPI_Alloc_mem(headsSize, MPI_INFO_NULL, &m_pRemoteFreeListHeads);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException(
+                        "failed to allocate RMA memory",
+                        __FILE__,
+                        __func__,
+                        __LINE__,
+                        mpiStatus
+                );
+        }
+        std::fill_n(m_pRemoteFreeListHeads, m_sizeClassesNum, 0);
+        {
+            auto mpiStatus = MPI_Win_attach(m_win, m_pRemoteFreeListHeads, headsSize);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to attach RMA window", __FILE__, __func__, __LINE__, mpiStatus);
+        }
+
+        int procNum{0};
+        MPI_Comm_size(comm, &procNum);
+        MPI_Aint headsAddress{(MPI_Aint)MPI_BOTTOM};
+        MPI_Get_address(m_pRemoteFreeListHeads, &headsAddress);
+        m_pRemoteFreeListHeadsAddresses = std::make_unique<MPI_Aint[]>(procNum);
+        {
+            auto mpiStatus = MPI_Allgather(&headsAddress, 1, MPI_AINT,
+                                           m_pRemoteFreeListHeadsAddresses.get(), 1, MPI_AINT, comm);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to gather payload free list addresses", __FILE__, __func__ , __LINE__, mpiStatus);
+        }
+        m_logger->trace("initialized payload arena of {} size classes", m_sizeClassesNum);
+    }
+
+    PayloadRef PayloadArena::allocate(size_t size)
+    {
+        if (size > m_maxPayloadSize)
+            throw std::overflow_error("the payload size exceeds the max payload size");
+
+        const auto sizeClassIdx = getSizeClassIdx(size);
+        auto &rFreeBlocks = m_freeBlocks[sizeClassIdx];
+        if (rFreeBlocks.empty() && !drainRemoteFreeList(sizeClassIdx))
+            grow(sizeClassIdx);
+
+        const auto blockAddress = rFreeBlocks.back();
+        rFreeBlocks.pop_back();
+        return PayloadRef{static_cast<uint64_t>(blockAddress), static_cast<uint32_t>(m_rank), static_cast<uint32_t>(size)};
+    }
+
+    std::byte *PayloadArena::getLocalBlock(const PayloadRef &rPayloadRef) const
+    {
+        const auto blockAddress = static_cast<MPI_Aint>(rPayloadRef.address);
+        auto itChunk = m_chunks.upper_bound(blockAddress);
+        if (static_cast<int>(rPayloadRef.rank) != m_rank || itChunk == m_chunks.begin())
+            throw std::invalid_argument("the payload block does not belong to the current process");
+
+        --itChunk;
+        return itChunk->second + MPI_Aint_diff(blockAddress, itChunk->first);
+    }
+
+    void PayloadArena::publishLocalBlocks()
+    {
+        lockWinTarget(m_rank, m_win, m_epochMode);
+        MPI_Win_sync(m_win);
+        unlockWinTargetLocal(m_rank, m_win, m_epochMode, m_pCounters);
+    }
+
+    void PayloadArena::read(const PayloadRef &rPayloadRef, std::byte *pBuffer)
+    {
+        const auto rank = static_cast<int>(rPayloadRef.rank);
+        if (rank == m_rank)
+        {
+            std::memcpy(pBuffer, getLocalBlock(rPayloadRef), rPayloadRef.size);
+            return;
+        }
+
+        lockWinTarget(rank, m_win, m_epochMode);
+        rmaGet(pBuffer,
+               static_cast<int>(rPayloadRef.size),
+               MPI_UNSIGNED_CHAR,
+               rank,
+               static_cast<MPI_Aint>(rPayloadRef.address),
+               m_win,
+               m_pCounters
+        );
+        unlockWinTargetLocal(rank, m_win, m_epochMode, m_pCounters);
+    }
+
+    void PayloadArena::deallocate(const PayloadRef &rPayloadRef)
+    {
+        const auto sizeClassIdx = getSizeClassIdx(rPayloadRef.size);
+        const auto rank = static_cast<int>(rPayloadRef.rank);
+        if (rank == m_rank)
+        {
+            m_freeBlocks[sizeClassIdx].push_back(static_cast<MPI_Aint>(rPayloadRef.address));
+            return;
+        }
+
+        const auto headAddress = getRemoteFreeListHeadAddress(rank, sizeClassIdx);
+        uint64_t resHead{0};
+        uint64_t oldHead{0};
+
+        lockWinTarget(rank, m_win, m_epochMode);
+        rmaFetchAndOp(nullptr, &resHead, MPI_UINT64_T, rank, headAddress, MPI_NO_OP, m_win, m_pCounters);
+        rmaFlush(rank, m_win, m_pCounters);
+        // Ссылка должна быть записана в блок до того, как CAS сделает его доступным владельцу.
+        do
+        {
+            oldHead = resHead;
+            rmaPut(&oldHead,
+                   1,
+                   MPI_UINT64_T,
+                   rank,
+                   static_cast<MPI_Aint>(rPayloadRef.address),
+                   m_win,
+                   m_pCounters
+            );
+            rmaFlush(rank, m_win, m_pCounters);
+
+            rmaCompareAndSwap(&rPayloadRef.address,
+                              &oldHead,
+                              &resHead,
+                              MPI_UINT64_T,
+                              rank,
+                              headAddress,
+                              m_win,
+                              m_pCounters
+            );
+            rmaFlush(rank, m_win, m_pCounters);
+        }
+        while (resHead != oldHead);
+        unlockWinTargetLocal(rank, m_win, m_epochMode, m_pCounters);
+    }
+
+    bool PayloadArena::drainRemoteFreeList(size_t sizeClassIdx)
+    {
+        const uint64_t emptyHead{0};
+        uint64_t blockAddress{0};
+
+        lockWinTarget(m_rank, m_win, m_epochMode);
+        rmaFetchAndOp(&emptyHead,
+                      &blockAddress,
+                      MPI_UINT64_T,
+                      m_rank,
+                      getRemoteFreeListHeadAddress(m_rank, sizeClassIdx),
+                      MPI_REPLACE,
+                      m_win,
+                      m_pCounters
+        );
+        rmaFlush(m_rank, m_win, m_pCounters);
+
+        // Ссылки записаны другими процессами, поэтому они читаются операциями RMA.
+        auto &rFreeBlocks = m_freeBlocks[sizeClassIdx];
+        const auto freeBlocksNum = rFreeBlocks.size();
+        while (blockAddress != 0)
+        {
+            rFreeBlocks.push_back(static_cast<MPI_Aint>(blockAddress));
+            rmaGet(&blockAddress, 1, MPI_UINT64_T, m_rank, static_cast<MPI_Aint>(blockAddress), m_win, m_pCounters);
+            rmaFlush(m_rank, m_win, m_pCounters);
+        }
+        unlockWinTargetLocal(m_rank, m_win, m_epochMode, m_pCounters);
+
+        if (rFreeBlocks.size() > freeBlocksNum)
+            m_logger->trace("took {} remotely freed blocks of size class {}", rFreeBlocks.size() - freeBlocksNum, sizeClassIdx);
+        return rFreeBlocks.size() > freeBlocksNum;
+    }
+
+    void PayloadArena::grow(size_t sizeClassIdx)
+    {
+        const auto blockSize = getBlockSize(sizeClassIdx);
+        const auto chunkSize = std::max(blockSize, std::min(PayloadChunkSize << m_chunksNums[sizeClassIdx],
+                                                             PayloadChunkSizeUpLimit));
+        const auto blocksNum = chunkSize / blockSize;
+
+        std::byte* pChunk{nullptr};
+        {
+            auto mpiStatus = MPI_Alloc_mem(static_cast<MPI_Aint>(chunkSize), MPI_INFO_NULL, &pChunk);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException(
+                        "failed to allocate RMA memory",
+                        __FILE__,
+                        __func__,
+                        __LINE__,
+                        mpiStatus
+                );
+        }
+        {
+            auto mpiStatus = MPI_Win_attach(m_win, pChunk, static_cast<MPI_Aint>(chunkSize));
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to attach RMA window", __FILE__, __func__, __LINE__, mpiStatus);
+        }
+
+        MPI_Aint chunkAddress{(MPI_Aint)MPI_BOTTOM};
+        MPI_Get_address(pChunk, &chunkAddress);
+        m_chunks.emplace(chunkAddress, pChunk);
+        ++m_chunksNums[sizeClassIdx];
+        m_allocatedSize += chunkSize;
+
+        // Блоки выдаются в порядке возрастания адресов.
+        auto &rFreeBlocks = m_freeBlocks[sizeClassIdx];
+        for (size_t i = blocksNum; i > 0; --i)
+            rFreeBlocks.push_back(MPI_Aint_add(chunkAddress, static_cast<MPI_Aint>((i - 1) * blockSize)));
+
+        m_logger->trace("attached payload chunk of {} blocks of {} bytes", blocksNum, blockSize);
+    }
+
+    size_t PayloadArena::getSizeClassIdx(size_t size) const
+    {
+        size_t sizeClassIdx{0};
+        while (getBlockSize(sizeClassIdx) < size)
+            ++sizeClassIdx;
+        return sizeClassIdx;
+    }
+
+    size_t PayloadArena::getBlockSize(size_t sizeClassIdx)
+    {
+        return MinPayloadBlockSize << sizeClassIdx;
+    }
+
+    MPI_Aint PayloadArena::getRemoteFreeListHeadAddress(int rank, size_t sizeClassIdx) const
+    {
+        return MPI_Aint_add(m_pRemoteFreeListHeadsAddresses[rank], static_cast<MPI_Aint>(sizeof(uint64_t) * sizeClassIdx));
+    }
+
+    size_t PayloadArena::getMaxPayloadSize() const
+    {
+        return m_maxPayloadSize;
+    }
+
+    size_t PayloadArena::getAllocatedSize() const
+    {
+        return m_allocatedSize;
+    }
+
+    MPI_Win PayloadArena::getWin() const
+    {
+        return m_win;
+    }
+
+    void PayloadArena::release()
+    {
+        endWinEpoch(m_win, m_epochMode);
+        for (auto [chunkAddress, pChunk]: m_chunks)
+        {
+            MPI_Win_detach(m_win, pChunk);
+            MPI_Free_mem(pChunk);
+        }
+        m_chunks.clear();
+        m_freeBlocks.clear();
+
+        MPI_Win_detach(m_win, m_pRemoteFreeListHeads);
+        MPI_Free_mem(m_pRemoteFreeListHeads);
+        m_pRemoteFreeListHeads = nullptr;
+        m_logger->trace("freed up payload arena RMA memory");
+
+        MPI_Win_free(&m_win);
+        m_logger->trace("freed up payload win RMA memory");
+    }
+} // ref_counting
@@ -0,0 +1,204 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include <stdexcept>
+
+#include "inner/SegmentedArena.h"
+#include "inner/WinEpoch.h"
+#include "MpiException.h"
+
+namespace rma_stack::ref_counting
+{
+    namespace custom_mpi = custom_mpi_extensions;
+
+    SegmentedArena::SegmentedArena(MPI_Comm comm, MPI_Win t_win, EpochMode t_epochMode, bool t_centralized,
+                                   int t_headRank, size_t t_elemSize, size_t t_segmentCapacity, size_t t_elemsUpLimit,
+                                   std::shared_ptr<spdlog::logger> t_logger)
+    :
+    m_win(t_win),
+    m_epochMode(t_epochMode),
+    m_headRank(t_headRank),
+    m_centralized(t_centralized),
+    m_elemSize(t_elemSize),
+    m_segmentCapacity(t_segmentCapacity),
+    m_elemsUpLimit(t_elemsUpLimit),
+    m_logger(std::move(t_logger))
+    {
+        if (m_segmentCapacity == 0)
+            throw std::invalid_argument("the segment capacity must be positive");
+
+        MPI_Comm_rank(comm, &m_rank);
+        m_maxSegmentsNum = (m_elemsUpLimit + m_segmentCapacity - 1) / m_segmentCapacity;
+
+        int procNum{0};
+        MPI_Comm_size(comm, &procNum);
+        const int ownersNum = m_centralized ? 1 : procNum;
+        m_pSegmentTableAddresses = std::make_unique<MPI_Aint[]>(ownersNum);
+        m_pSegmentBaseCache = std::make_unique<MPI_Aint[]>(ownersNum * m_maxSegmentsNum);
+        m_pLocalSegments = std::make_unique<std::byte*[]>(m_maxSegmentsNum);
+
+        MPI_Aint segmentTableAddress{(MPI_Aint)MPI_BOTTOM};
+        if (!m_centralized || m_rank == m_headRank)
+        {
+            const auto segmentTableSize = static_cast<MPI_Aint>(sizeof(MPI_Aint) * std::max<size_t>(m_maxSegmentsNum, 1));
+            {
+                auto mpiStatus = MPI_Alloc_mem(segmentTableSize, MPI_INFO_NULL, &m_pSegmentTable);
+                if (mpiStatus != MPI_SUCCESS)
+                    throw custom_mpi::MpiException(
+                            "failed to allocate RMA memory",
+                            __FILE__,
+                            __func__,
+                            __LINE__,
+                            mpiStatus
+                    );
+            }
+            std::fill_n(m_pSegmentTable, std::max<size_t>(m_maxSegmentsNum, 1), 0);
+            {
+                auto mpiStatus = MPI_Win_attach(m_win, m_pSegmentTable, segmentTableSize);
+                if (mpiStatus != MPI_SUCCESS)
+                    throw custom_mpi::MpiException("failed to attach RMA window", __FILE__, __func__, __LINE__, mpiStatus);
+            }
+            MPI_Get_address(m_pSegmentTable, &segmentTableAddress);
+        }
+
+        if (m_centralized)
+        {
+            auto mpiStatus = MPI_Bcast(&segmentTableAddress, 1, MPI_AINT, m_headRank, comm);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to broadcast segment table address", __FILE__, __func__ , __LINE__, mpiStatus);
+            m_pSegmentTableAddresses[0] = segmentTableAddress;
+        }
+        else
+        {
+            auto mpiStatus = MPI_Allgather(&segmentTableAddress, 1, MPI_AINT,
+                                           m_pSegmentTableAddresses.get(), 1, MPI_AINT, comm);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to gather segment table addresses", __FILE__, __func__ , __LINE__, mpiStatus);
+        }
+    }
+
+    std::byte *SegmentedArena::grow()
+    {
+        if (m_segmentsNum >= m_maxSegmentsNum)
+            return nullptr;
+
+        const auto segmentIdx = m_segmentsNum;
+        const auto segmentSize = static_cast<MPI_Aint>(m_elemSize * getSegmentElemsNum(segmentIdx));
+        std::byte* pSegment{nullptr};
+        {
+            auto mpiStatus = MPI_Alloc_mem(segmentSize, MPI_INFO_NULL, &pSegment);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException(
+                        "failed to allocate RMA memory",
+                        __FILE__,
+                        __func__,
+                        __LINE__,
+                        mpiStatus
+                );
+        }
+        {
+            auto mpiStatus = MPI_Win_attach(m_win, pSegment, segmentSize);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to attach RMA window", __FILE__, __func__, __LINE__, mpiStatus);
+        }
+
+        MPI_Aint segmentAddress{(MPI_Aint)MPI_BOTTOM};
+        MPI_Get_address(pSegment, &segmentAddress);
+
+        // Публикация адреса сегмента для остальных процессов.
+        MPI_Aint segmentTableEntryAddress{(MPI_Aint)MPI_BOTTOM};
+        MPI_Get_address(m_pSegmentTable + segmentIdx, &segmentTableEntryAddress);
+        lockWinTarget(m_rank, m_win, m_epochMode);
+        MPI_Accumulate(&segmentAddress,
+                       1,
+                       MPI_AINT,
+                       m_rank,
+                       segmentTableEntryAddress,
+                       1,
+                       MPI_AINT,
+                       MPI_REPLACE,
+                       m_win
+        );
+        MPI_Win_flush(m_rank, m_win);
+        unlockWinTargetLocal(m_rank, m_win, m_epochMode);
+
+        m_pLocalSegments[segmentIdx] = pSegment;
+        m_pSegmentBaseCache[getOwnerIdx(m_rank) * m_maxSegmentsNum + segmentIdx] = segmentAddress;
+        ++m_segmentsNum;
+
+        m_logger->trace("attached segment {} of {} elements", segmentIdx, getSegmentElemsNum(segmentIdx));
+        return pSegment;
+    }
+
+    MPI_Aint SegmentedArena::getElemAddress(GlobalAddress elemAddress) const
+    {
+        const auto rank = static_cast<int>(elemAddress.rank);
+        const auto segmentIdx = static_cast<size_t>(elemAddress.offset / m_segmentCapacity);
+        const auto elemIdx = static_cast<size_t>(elemAddress.offset % m_segmentCapacity);
+
+        auto& rSegmentBase = m_pSegmentBaseCache[getOwnerIdx(rank) * m_maxSegmentsNum + segmentIdx];
+        if (!rSegmentBase)
+        {
+            const auto displacement = static_cast<MPI_Aint>(segmentIdx * sizeof(MPI_Aint));
+            const auto segmentTableEntryAddress = MPI_Aint_add(m_pSegmentTableAddresses[getOwnerIdx(rank)], displacement);
+
+            lockWinTarget(rank, m_win, m_epochMode);
+            MPI_Get(&rSegmentBase, 1, MPI_AINT, rank, segmentTableEntryAddress, 1, MPI_AINT, m_win);
+            MPI_Win_flush(rank, m_win);
+            unlockWinTargetLocal(rank, m_win, m_epochMode);
+            m_logger->trace("fetched base address of segment {} of rank {}", segmentIdx, rank);
+        }
+
+        return MPI_Aint_add(rSegmentBase, static_cast<MPI_Aint>(elemIdx * m_elemSize));
+    }
+
+    std::byte *SegmentedArena::getLocalSegment(size_t segmentIdx) const
+    {
+        return segmentIdx < m_segmentsNum ? m_pLocalSegments[segmentIdx] : nullptr;
+    }
+
+    size_t SegmentedArena::getSegmentsNum() const
+    {
+        return m_segmentsNum;
+    }
+
+    size_t SegmentedArena::getSegmentCapacity() const
+    {
+        return m_segmentCapacity;
+    }
+
+    size_t SegmentedArena::getMaxSegmentsNum() const
+    {
+        return m_maxSegmentsNum;
+    }
+
+    size_t SegmentedArena::getSegmentElemsNum(size_t segmentIdx) const
+    {
+        return std::min(m_segmentCapacity, m_elemsUpLimit - segmentIdx * m_segmentCapacity);
+    }
+
+    void SegmentedArena::release()
+    {
+        for (size_t i = 0; i < m_segmentsNum; ++i)
+        {
+            MPI_Win_detach(m_win, m_pLocalSegments[i]);
+            MPI_Free_mem(m_pLocalSegments[i]);
+            m_pLocalSegments[i] = nullptr;
+        }
+        m_segmentsNum = 0;
+
+        if (m_pSegmentTable)
+        {
+            MPI_Win_detach(m_win, m_pSegmentTable);
+            MPI_Free_mem(m_pSegmentTable);
+            m_pSegmentTable = nullptr;
+        }
+        m_logger->trace("freed up segmented arena RMA memory");
+    }
+
+    int SegmentedArena::getOwnerIdx(int rank) const
+    {
+        return m_centralized ? 0 : rank;
+    }
+} // ref_counting
@@ -0,0 +1,212 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include <algorithm>
+
+#include "inner/WaiterTable.h"
+#include "inner/RmaOperations.h"
+#include "inner/WinEpoch.h"
+#include "MpiException.h"
+
+namespace rma_stack::ref_counting
+{
+    namespace custom_mpi = custom_mpi_extensions;
+
+    namespace
+    {
+        constexpr size_t WaiterBitsPerWord = 64;
+    }
+
+    WaiterTable::WaiterTable(MPI_Comm comm, MPI_Win t_headWin, EpochMode t_epochMode, std::vector<int> t_headRanks,
+                             OperationCounters &t_rCounters, std::shared_ptr<spdlog::logger> t_logger)
+    :
+    m_headWin(t_headWin),
+    m_epochMode(t_epochMode),
+    m_headRanks(std::move(t_headRanks)),
+    m_rCounters(t_rCounters),
+    m_logger(std::move(t_logger))
+    {
+        MPI_Comm_rank(comm, &m_rank);
+        MPI_Comm_size(comm, &m_procNum);
+
+        m_waitersWordsNum = (m_procNum + WaiterBitsPerWord - 1) / WaiterBitsPerWord;
+        m_waitersSnapshot.resize(m_waitersWordsNum);
+
+        m_logger->trace("started to initialize waiter table");
+        const bool headOwner = std::find(m_headRanks.begin(), m_headRanks.end(), m_rank) != m_headRanks.end();
+        const size_t wordsNum = 1 + (headOwner ? m_waitersWordsNum : 0);
+        const auto memorySize = static_cast<MPI_Aint>(sizeof(uint64_t) * wordsNum);
+        {
+            auto mpiStatus = MPI_Alloc_mem(memorySize, MPI_INFO_NULL, &m_pMemory);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException(
+                        "failed to allocate RMA memory",
+                        __FILE__,
+                        __func__,
+                        __LINE__,
+                        mpiStatus
+                );
+        }
+        std::fill_n(m_pMemory, wordsNum, 0);
+        {
+            auto mpiStatus = MPI_Win_attach(m_headWin, m_pMemory, memorySize);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to attach RMA window", __FILE__, __func__, __LINE__, mpiStatus);
+        }
+
+        MPI_Aint memoryAddress{(MPI_Aint)MPI_BOTTOM};
+        MPI_Get_address(m_pMemory, &memoryAddress);
+        m_pMemoryAddresses = std::make_unique<MPI_Aint[]>(m_procNum);
+        {
+            auto mpiStatus = MPI_Allgather(&memoryAddress, 1, MPI_AINT, m_pMemoryAddresses.get(), 1, MPI_AINT, comm);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to gather waiter table addresses", __FILE__, __func__ , __LINE__, mpiStatus);
+        }
+        m_logger->trace("initialized waiter table");
+    }
+
+    void WaiterTable::registerWaiter()
+    {
+        updateWaiterBit(MPI_BOR);
+    }
+
+    void WaiterTable::unregisterWaiter()
+    {
+        updateWaiterBit(MPI_BAND);
+    }
+
+    void WaiterTable::updateWaiterBit(MPI_Op op)
+    {
+        const size_t wordIdx = m_rank / WaiterBitsPerWord;
+        const uint64_t bit   = uint64_t{1} << (m_rank % WaiterBitsPerWord);
+        const uint64_t mask  = op == MPI_BAND ? ~bit : bit;
+        for (const auto headRank : m_headRanks)
+        {
+            lockWinTarget(headRank, m_headWin, m_epochMode);
+            rmaAccumulate(&mask,
+                          1,
+                          MPI_UINT64_T,
+                          headRank,
+                          getWaitersWordAddress(headRank, wordIdx),
+                          op,
+                          m_headWin,
+                          &m_rCounters
+            );
+            // Снятая регистрация может стать видна позже: лишнее уведомление лишь повторит проверку стека.
+            if (op == MPI_BAND)
+                unlockWinTargetLocal(headRank, m_headWin, m_epochMode, &m_rCounters);
+            else
+                unlockWinTarget(headRank, m_headWin, m_epochMode, &m_rCounters);
+        }
+    }
+
+    void WaiterTable::resetNotification()
+    {
+        // Флаг изменяется атомарной операцией, так как его одновременно может установить PUSH.
+        const uint64_t notified{0};
+        lockWinTarget(m_rank, m_headWin, m_epochMode);
+        rmaAccumulate(&notified,
+                      1,
+                      MPI_UINT64_T,
+                      m_rank,
+                      m_pMemoryAddresses[m_rank],
+                      MPI_REPLACE,
+                      m_headWin,
+                      &m_rCounters
+        );
+        unlockWinTarget(m_rank, m_headWin, m_epochMode, &m_rCounters);
+    }
+
+    bool WaiterTable::isNotified()
+    {
+        /*
+         * Флаг читается операцией RMA над собственной памятью, а не
+         * обычным чтением: она атомарна относительно записи PUSH и
+         * продвигает MPI, без чего запись может не примениться.
+         */
+        uint64_t notified{0};
+        lockWinTarget(m_rank, m_headWin, m_epochMode);
+        rmaFetchAndOp(nullptr,
+                      &notified,
+                      MPI_UINT64_T,
+                      m_rank,
+                      m_pMemoryAddresses[m_rank],
+                      MPI_NO_OP,
+                      m_headWin,
+                      &m_rCounters
+        );
+        unlockWinTarget(m_rank, m_headWin, m_epochMode, &m_rCounters);
+        return notified != 0;
+    }
+
+    size_t WaiterTable::notifyWaiters(size_t headIdx)
+    {
+        const auto headRank = m_headRanks.at(headIdx);
+        const auto waitersWordsNum = static_cast<int>(m_waitersWordsNum);
+        lockWinTarget(headRank, m_headWin, m_epochMode);
+        rmaGetAccumulate(nullptr,
+                         m_waitersSnapshot.data(),
+                         waitersWordsNum,
+                         MPI_UINT64_T,
+                         headRank,
+                         getWaitersWordAddress(headRank, 0),
+                         MPI_NO_OP,
+                         m_headWin,
+                         &m_rCounters
+        );
+        unlockWinTargetLocal(headRank, m_headWin, m_epochMode, &m_rCounters);
+
+        const uint64_t notified{1};
+        size_t notifiedNum{0};
+        for (size_t wordIdx = 0; wordIdx < m_waitersWordsNum; ++wordIdx)
+        {
+            for (auto word = m_waitersSnapshot[wordIdx]; word != 0; word &= word - 1)
+            {
+                const auto rank = static_cast<int>(wordIdx * WaiterBitsPerWord + __builtin_ctzll(word));
+                lockWinTarget(rank, m_headWin, m_epochMode);
+                rmaAccumulate(&notified,
+                              1,
+                              MPI_UINT64_T,
+                              rank,
+                              m_pMemoryAddresses[rank],
+                              MPI_REPLACE,
+                              m_headWin,
+                              &m_rCounters
+                );
+                unlockWinTarget(rank, m_headWin, m_epochMode, &m_rCounters);
+                ++notifiedNum;
+            }
+        }
+        if (notifiedNum > 0)
+            m_logger->trace("notified {} waiters of head {}", notifiedNum, headIdx);
+        m_sentNotificationsNum += notifiedNum;
+        return notifiedNum;
+    }
+
+    size_t WaiterTable::getSentNotificationsNum() const
+    {
+        return m_sentNotificationsNum;
+    }
+
+    void WaiterTable::resetCounters()
+    {
+        m_sentNotificationsNum = 0;
+    }
+
+    MPI_Aint WaiterTable::getWaitersWordAddress(int headRank, size_t wordIdx) const
+    {
+        return MPI_Aint_add(m_pMemoryAddresses[headRank], static_cast<MPI_Aint>(sizeof(uint64_t) * (1 + wordIdx)));
+    }
+
+    void WaiterTable::release()
+    {
+        if (m_pMemory)
+        {
+            MPI_Win_detach(m_headWin, m_pMemory);
+            MPI_Free_mem(m_pMemory);
+            m_pMemory = nullptr;
+            m_logger->trace("freed up waiter table RMA memory");
+        }
+    }
+} // ref_counting
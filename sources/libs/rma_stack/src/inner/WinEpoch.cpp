@@ -0,0 +1,80 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include "inner/WinEpoch.h"
+#include "MpiException.h"
+
+namespace rma_stack::ref_counting
+{
+    namespace custom_mpi = custom_mpi_extensions;
+
+    std::string_view getEpochModeName(EpochMode mode)
+    {
+        switch (mode)
+        {
+            case EpochMode::PerOperation:
+                return "per operation";
+            case EpochMode::Persistent:
+                return "persistent";
+        }
+        return "unknown";
+    }
+
+    void beginWinEpoch(MPI_Win win, EpochMode mode)
+    {
+        if (mode != EpochMode::Persistent)
+            return;
+
+        auto mpiStatus = MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+        if (mpiStatus != MPI_SUCCESS)
+            throw custom_mpi::MpiException("failed to open persistent access epoch", __FILE__, __func__, __LINE__, mpiStatus);
+    }
+
+    void endWinEpoch(MPI_Win win, EpochMode mode)
+    {
+        if (mode != EpochMode::Persistent)
+            return;
+
+        auto mpiStatus = MPI_Win_unlock_all(win);
+        if (mpiStatus != MPI_SUCCESS)
+            throw custom_mpi::MpiException("failed to close persistent access epoch", __FILE__, __func__, __LINE__, mpiStatus);
+    }
+
+    void lockWinTarget(int rank, MPI_Win win, EpochMode mode)
+    {
+        if (mode != EpochMode::Persistent)
+            MPI_Win_lock(MPI_LOCK_SHARED, rank, MPI_MODE_NOCHECK, win);
+    }
+
+    void unlockWinTarget(int rank, MPI_Win win, EpochMode mode, OperationCounters *pCounters)
+    {
+        if (mode == EpochMode::Persistent)
+            MPI_Win_flush(rank, win);
+        else
+            MPI_Win_unlock(rank, win);
+        if (pCounters)
+            countRmaFlush(*pCounters, rank);
+    }
+
+    void unlockWinTargetLocal(int rank, MPI_Win win, EpochMode mode, OperationCounters *pCounters)
+    {
+        if (mode == EpochMode::Persistent)
+            MPI_Win_flush_local(rank, win);
+        else
+            MPI_Win_unlock(rank, win);
+        if (pCounters)
+            countRmaFlush(*pCounters, rank);
+    }
+
+    void unlockWinTargetDeferred(int rank, MPI_Win win, EpochMode mode, OperationCounters *pCounters)
+    {
+        // При постоянной эпохе операции завершит ожидание запросов, поэтому учитывать нечего.
+        if (mode == EpochMode::Persistent)
+            return;
+
+        MPI_Win_unlock(rank, win);
+        if (pCounters)
+            countRmaFlush(*pCounters, rank);
+    }
+} // ref_counting
@@ -0,0 +1,402 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "outer/AsyncOperationEngine.h"
+#include "inner/RmaOperations.h"
+
+namespace rma_stack
+{
+    AsyncOperation::AsyncOperation(AsyncOperationEngine *t_pEngine, std::shared_ptr<AsyncOperationResult> t_pResult)
+    :
+    m_pEngine(t_pEngine),
+    m_pResult(std::move(t_pResult))
+    {
+    }
+
+    bool AsyncOperation::test()
+    {
+        if (!m_pResult)
+            return true;
+        if (!m_pResult->completed)
+            m_pEngine->progress();
+        return m_pResult->completed;
+    }
+
+    void AsyncOperation::wait()
+    {
+        while (!test())
+        {
+        }
+    }
+
+    bool AsyncOperation::isCompleted() const
+    {
+        return !m_pResult || m_pResult->completed;
+    }
+
+    bool AsyncOperation::isSucceeded() const
+    {
+        return m_pResult && m_pResult->succeeded;
+    }
+
+    AsyncOperationEngine::AsyncOperationEngine(ref_counting::InnerStack &t_rInnerStack,
+                                               AsyncBackoffCallbacks t_backoffCallbacks,
+                                               std::shared_ptr<spdlog::logger> t_logger)
+    :
+    m_rInnerStack(t_rInnerStack),
+    m_rHead(t_rInnerStack.m_heads.at(t_rInnerStack.getLocalHeadIdx())),
+    m_nodesWin(t_rInnerStack.m_nodePool.getWin()),
+    m_inlinePayloadSize(t_rInnerStack.m_nodePool.getInlinePayloadSize()),
+    m_rCounters(t_rInnerStack.getOperationCounters()),
+    m_backoffCallbacks(std::move(t_backoffCallbacks)),
+    m_logger(std::move(t_logger))
+    {
+        if (m_rInnerStack.getReclamationScheme() != ref_counting::ReclamationScheme::RefCounting)
+            throw std::invalid_argument("asynchronous operations require the reference counting scheme");
+        if (m_rInnerStack.getEpochMode() != ref_counting::EpochMode::Persistent)
+            throw std::invalid_argument("asynchronous operations require persistent access epochs");
+    }
+
+    AsyncOperation AsyncOperationEngine::startPush(const void *pPayload)
+    {
+        auto pOperation = std::make_unique<Operation>();
+        AsyncOperation asyncOperation(this, pOperation->pResult);
+
+        pOperation->nodeAddress = m_rInnerStack.m_nodePool.acquireNode(
+                m_rInnerStack.m_centralized ? ref_counting::InnerStack::HEAD_RANK : m_rInnerStack.m_rank
+        );
+        if (ref_counting::isGlobalAddressDummy(pOperation->nodeAddress))
+        {
+            m_logger->trace("failed to find free node in 'startPush'");
+            complete(*pOperation, false);
+            return asyncOperation;
+        }
+
+        pOperation->newHeadCountedNodePtr.setRank(pOperation->nodeAddress.rank);
+        pOperation->newHeadCountedNodePtr.setOffset(pOperation->nodeAddress.offset);
+        pOperation->newHeadCountedNodePtr.incExternalCounter();
+
+        // Данные, которые хранятся в узле, записываются вместе с первой ссылкой на следующий узел.
+        if (m_inlinePayloadSize > 0)
+        {
+            std::memcpy(pOperation->nodeTail + 1, pPayload, m_inlinePayloadSize);
+            pOperation->nodeTailWordsNum += static_cast<int>(ref_counting::getInlinePayloadWordsNum(m_inlinePayloadSize));
+        }
+
+        pOperation->step = Step::PushFetchHead;
+        advance(*pOperation);
+        m_operations.push_back(std::move(pOperation));
+        return asyncOperation;
+    }
+
+    AsyncOperation AsyncOperationEngine::startPop(void *pPayload, const void *pDefaultPayload)
+    {
+        auto pOperation = std::make_unique<Operation>();
+        AsyncOperation asyncOperation(this, pOperation->pResult);
+
+        pOperation->pPayload = pPayload;
+        std::memcpy(pOperation->defaultPayloadWords, pDefaultPayload, m_inlinePayloadSize);
+        pOperation->nodeTailWordsNum += static_cast<int>(ref_counting::getInlinePayloadWordsNum(m_inlinePayloadSize));
+
+        pOperation->step = Step::PopFetchHead;
+        advance(*pOperation);
+        m_operations.push_back(std::move(pOperation));
+        return asyncOperation;
+    }
+
+    size_t AsyncOperationEngine::progress()
+    {
+        for (auto &rpOperation: m_operations)
+        {
+            if (!rpOperation->pResult->completed)
+                advance(*rpOperation);
+        }
+        m_operations.erase(std::remove_if(m_operations.begin(), m_operations.end(),
+                                          [](const std::unique_ptr<Operation> &rpOperation) {
+                                              return rpOperation->pResult->completed;
+                                          }),
+                           m_operations.end());
+        return m_operations.size();
+    }
+
+    void AsyncOperationEngine::waitAll()
+    {
+        while (progress() > 0)
+        {
+        }
+    }
+
+    size_t AsyncOperationEngine::getPendingOperationsNum() const
+    {
+        return m_operations.size();
+    }
+
+    bool AsyncOperationEngine::advance(Operation &rOperation)
+    {
+        for (;;)
+        {
+            if (rOperation.request != MPI_REQUEST_NULL)
+            {
+                int requestCompleted{0};
+                MPI_Test(&rOperation.request, &requestCompleted, MPI_STATUS_IGNORE);
+                if (!requestCompleted)
+                    return false;
+            }
+            if (std::chrono::steady_clock::now() < rOperation.resumeTime)
+                return false;
+
+            const bool isPush = rOperation.step == Step::PushFetchHead
+                                || rOperation.step == Step::PushLink
+                                || rOperation.step == Step::PushIncreaseNodeVersion
+                                || rOperation.step == Step::PushSwapHead;
+            const bool completed = isPush ? advancePush(rOperation) : advancePop(rOperation);
+            if (completed)
+                return true;
+        }
+    }
+
+    /*
+     * Каждый шаг либо запускает запрос и выбирает следующий шаг, либо
+     * выполняет CAS и сразу переходит к следующему шагу.
+     */
+    bool AsyncOperationEngine::advancePush(Operation &rOperation)
+    {
+        switch (rOperation.step)
+        {
+            case Step::PushFetchHead:
+            {
+                rOperation.request = m_rInnerStack.startHeadFetch(m_rHead, rOperation.resHeadCountedNodePtr);
+                rOperation.step = Step::PushLink;
+                return false;
+            }
+            case Step::PushLink:
+            {
+                std::memcpy(rOperation.nodeTail, &rOperation.resHeadCountedNodePtr, sizeof(ref_counting::CountedNodePtr));
+                ref_counting::rmaRgetAccumulate(rOperation.nodeTail,
+                                                rOperation.resNodeTail,
+                                                rOperation.nodeTailWordsNum,
+                                                MPI_UINT64_T,
+                                                rOperation.nodeAddress.rank,
+                                                getCountedNodePtrNextOffset(rOperation.nodeAddress),
+                                                MPI_REPLACE,
+                                                m_nodesWin,
+                                                &rOperation.request,
+                                                &m_rCounters
+                );
+                rOperation.nodeTailWordsNum = 1;
+                rOperation.step = rOperation.nodeVersionIncreased ? Step::PushSwapHead : Step::PushIncreaseNodeVersion;
+                return false;
+            }
+            case Step::PushIncreaseNodeVersion:
+            {
+                ref_counting::rmaRgetAccumulate(&rOperation.versionIncrease,
+                                                &rOperation.resNodeVersion,
+                                                1,
+                                                MPI_UINT32_T,
+                                                rOperation.nodeAddress.rank,
+                                                m_rInnerStack.m_nodePool.getNodeAddress(rOperation.nodeAddress),
+                                                MPI_SUM,
+                                                m_nodesWin,
+                                                &rOperation.request,
+                                                &m_rCounters
+                );
+                rOperation.nodeVersionIncreased = true;
+                rOperation.step = Step::PushSwapHead;
+                return false;
+            }
+            case Step::PushSwapHead:
+            {
+                rOperation.oldHeadCountedNodePtr = rOperation.resHeadCountedNodePtr;
+                swapHead(rOperation, rOperation.newHeadCountedNodePtr);
+                m_rInnerStack.countHeadCas(&ref_counting::OperationCounters::pushCasAttempts,
+                                           &ref_counting::OperationCounters::pushCasFailures,
+                                           rOperation.oldHeadCountedNodePtr, rOperation.resHeadCountedNodePtr);
+                if (rOperation.resHeadCountedNodePtr == rOperation.oldHeadCountedNodePtr)
+                {
+                    m_rInnerStack.addHeadSize(m_rHead, 1);
+                    if (rOperation.oldHeadCountedNodePtr.isDummy())
+                        m_rInnerStack.m_pWaiterTable->notifyWaiters(m_rInnerStack.getLocalHeadIdx());
+                    complete(rOperation, true);
+                    return true;
+                }
+                // Текущая голова уже прочитана CAS, поэтому после задержки ссылка сразу перезаписывается.
+                rOperation.step = Step::PushLink;
+                postpone(rOperation);
+                return false;
+            }
+            default:
+                throw std::logic_error("unexpected step of asynchronous push");
+        }
+    }
+
+    bool AsyncOperationEngine::advancePop(Operation &rOperation)
+    {
+        switch (rOperation.step)
+        {
+            case Step::PopFetchHead:
+            {
+                rOperation.request = m_rInnerStack.startHeadFetch(m_rHead, rOperation.oldHeadCountedNodePtr);
+                rOperation.step = Step::PopIncreaseHeadCount;
+                return false;
+            }
+            case Step::PopIncreaseHeadCount:
+            {
+                auto &rOldHeadCountedNodePtr = rOperation.oldHeadCountedNodePtr;
+                if (rOldHeadCountedNodePtr.isDummy() || !ref_counting::isValidRank(rOldHeadCountedNodePtr.getRank()))
+                {
+                    std::memcpy(rOperation.pPayload, rOperation.defaultPayloadWords, m_inlinePayloadSize);
+                    complete(rOperation, false);
+                    return true;
+                }
+
+                // Увеличение кол-ва внешних ссылок на голову на 1, см. InnerStack::increaseHeadCount.
+                auto newCountedNodePtr = rOldHeadCountedNodePtr;
+                if (!newCountedNodePtr.incExternalCounter())
+                    throw std::overflow_error("the external counter of the head exceeds the counter bits of the layout");
+                swapHead(rOperation, newCountedNodePtr);
+                m_rInnerStack.countHeadCas(&ref_counting::OperationCounters::headCountCasAttempts,
+                                           &ref_counting::OperationCounters::headCountCasFailures,
+                                           rOldHeadCountedNodePtr, rOperation.resHeadCountedNodePtr);
+                if (rOperation.resHeadCountedNodePtr != rOldHeadCountedNodePtr)
+                {
+                    rOldHeadCountedNodePtr = rOperation.resHeadCountedNodePtr;
+                    return false;
+                }
+                rOldHeadCountedNodePtr = newCountedNodePtr;
+                rOperation.nodeAddress = {rOldHeadCountedNodePtr.getOffset(), rOldHeadCountedNodePtr.getRank(), 0};
+
+                startNodeTailFetch(rOperation);
+                rOperation.step = Step::PopSwapHead;
+                return false;
+            }
+            case Step::PopSwapHead:
+            {
+                ref_counting::CountedNodePtr countedNodePtrNext;
+                std::memcpy(&countedNodePtrNext, rOperation.resNodeTail, sizeof(ref_counting::CountedNodePtr));
+                /*
+                 * Если другие операции лишь увеличили внешний счётчик вершины,
+                 * то ссылка этой операции уже учтена в нём, и CAS повторяется
+                 * с новым значением, см. InnerStack::popBulk. Иначе при многих
+                 * операциях в полёте они бы бесконечно мешали друг другу,
+                 * наращивая счётчик.
+                 */
+                for (;;)
+                {
+                    swapHead(rOperation, countedNodePtrNext);
+                    const auto &rResHeadCountedNodePtr = rOperation.resHeadCountedNodePtr;
+                    auto &rOldHeadCountedNodePtr = rOperation.oldHeadCountedNodePtr;
+                    m_rInnerStack.countHeadCas(&ref_counting::OperationCounters::popCasAttempts,
+                                               &ref_counting::OperationCounters::popCasFailures,
+                                               rOldHeadCountedNodePtr, rResHeadCountedNodePtr);
+                    if (rResHeadCountedNodePtr.getRank() != rOldHeadCountedNodePtr.getRank()
+                        || rResHeadCountedNodePtr.getOffset() != rOldHeadCountedNodePtr.getOffset()
+                        || rResHeadCountedNodePtr.getExternalCounter() == rOldHeadCountedNodePtr.getExternalCounter())
+                        break;
+                    rOldHeadCountedNodePtr = rResHeadCountedNodePtr;
+                }
+
+                rOperation.popped = rOperation.resHeadCountedNodePtr == rOperation.oldHeadCountedNodePtr;
+                if (rOperation.popped)
+                {
+                    m_rInnerStack.addHeadSize(m_rHead, -1);
+                    std::memcpy(rOperation.pPayload, rOperation.resNodeTail + 1, m_inlinePayloadSize);
+                    // Уменьшение внутреннего счётчика на кол-во внешних ссылок минус 2.
+                    const auto externalCount = static_cast<int32_t>(rOperation.oldHeadCountedNodePtr.getExternalCounter());
+                    rOperation.countIncrease = externalCount - 2;
+                }
+                else
+                {
+                    rOperation.countIncrease = -1;
+                }
+
+                const auto nodeOffset = m_rInnerStack.m_nodePool.getNodeAddress(rOperation.nodeAddress);
+                ref_counting::rmaRgetAccumulate(&rOperation.countIncrease,
+                                                &rOperation.resInternalCount,
+                                                1,
+                                                MPI_INT32_T,
+                                                rOperation.nodeAddress.rank,
+                                                MPI_Aint_add(nodeOffset, sizeof(int32_t)),
+                                                MPI_SUM,
+                                                m_nodesWin,
+                                                &rOperation.request,
+                                                &m_rCounters
+                );
+                rOperation.step = Step::PopReleaseNode;
+                return false;
+            }
+            case Step::PopReleaseNode:
+            {
+                if (rOperation.resInternalCount == -rOperation.countIncrease)
+                    m_rInnerStack.m_nodePool.releaseNode(rOperation.nodeAddress);
+                if (rOperation.popped)
+                {
+                    complete(rOperation, true);
+                    return true;
+                }
+                // Внешний счётчик увеличивается заново от текущей головы, которую прочитала CAS.
+                rOperation.oldHeadCountedNodePtr = rOperation.resHeadCountedNodePtr;
+                rOperation.step = Step::PopIncreaseHeadCount;
+                postpone(rOperation);
+                return false;
+            }
+            default:
+                throw std::logic_error("unexpected step of asynchronous pop");
+        }
+    }
+
+    void AsyncOperationEngine::complete(Operation &rOperation, bool succeeded)
+    {
+        rOperation.pResult->succeeded = succeeded;
+        rOperation.pResult->completed = true;
+        m_backoffCallbacks.onOperationCompleted(rOperation.casFailuresNum);
+    }
+
+    void AsyncOperationEngine::postpone(Operation &rOperation)
+    {
+        // Задержка не занимает процесс, поэтому в счётчиках учитывается её назначенная длительность.
+        const auto delay = m_backoffCallbacks.nextDelay();
+        ++rOperation.casFailuresNum;
+        ++m_rCounters.backoffCalls;
+        m_rCounters.backoffSec += std::chrono::duration<double>(delay).count();
+        rOperation.resumeTime = std::chrono::steady_clock::now() + delay;
+    }
+
+    void AsyncOperationEngine::swapHead(Operation &rOperation, ref_counting::CountedNodePtr &rNewCountedNodePtr)
+    {
+        ref_counting::rmaCompareAndSwap(&rNewCountedNodePtr,
+                                        &rOperation.oldHeadCountedNodePtr,
+                                        &rOperation.resHeadCountedNodePtr,
+                                        MPI_UINT64_T,
+                                        m_rHead.rank,
+                                        m_rHead.address,
+                                        m_rInnerStack.m_headWin,
+                                        &m_rCounters
+        );
+        ref_counting::rmaFlushLocal(m_rHead.rank, m_rInnerStack.m_headWin, &m_rCounters);
+    }
+
+    void AsyncOperationEngine::startNodeTailFetch(Operation &rOperation)
+    {
+        ref_counting::rmaRgetAccumulate(nullptr,
+                                        rOperation.resNodeTail,
+                                        rOperation.nodeTailWordsNum,
+                                        MPI_UINT64_T,
+                                        rOperation.nodeAddress.rank,
+                                        getCountedNodePtrNextOffset(rOperation.nodeAddress),
+                                        MPI_NO_OP,
+                                        m_nodesWin,
+                                        &rOperation.request,
+                                        &m_rCounters
+        );
+    }
+
+    MPI_Aint AsyncOperationEngine::getCountedNodePtrNextOffset(ref_counting::GlobalAddress nodeAddress) const
+    {
+        return MPI_Aint_add(m_rInnerStack.m_nodePool.getNodeAddress(nodeAddress), sizeof(ref_counting::CountedNodePtr));
+    }
+} // rma_stack
@@ -0,0 +1,174 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+#include "include/outer/BackoffPolicies.h"
+
+namespace rma_stack
+{
+    namespace
+    {
+        constexpr size_t SpinCalibrationIterationsNum = 20'000;
+
+        inline void cpuRelax()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#elif defined(__aarch64__)
+            asm volatile("yield" ::: "memory");
+#else
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+        }
+
+        void spinIterations(size_t iterationsNum)
+        {
+            for (size_t i = 0; i < iterationsNum; ++i)
+            {
+                cpuRelax();
+            }
+        }
+
+        double getSpinIterationsPerNs()
+        {
+            static const double spinIterationsPerNs = [] () {
+                const auto tBegin = std::chrono::steady_clock::now();
+                spinIterations(SpinCalibrationIterationsNum);
+                const auto elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - tBegin).count();
+                return static_cast<double>(SpinCalibrationIterationsNum) / std::max<long>(elapsedNs, 1);
+            }();
+            return spinIterationsPerNs;
+        }
+
+        void validateDelays(const std::chrono::nanoseconds &rMinDelayNs, const std::chrono::nanoseconds &rMaxDelayNs)
+        {
+            const auto upperBoundDelayNs = std::chrono::nanoseconds(std::numeric_limits<int>::max());
+
+            if (rMinDelayNs > upperBoundDelayNs)
+                throw std::invalid_argument("the min delay is out of bounds");
+
+            if (rMaxDelayNs > upperBoundDelayNs)
+                throw std::invalid_argument("the max delay is out of bounds");
+
+            if (rMinDelayNs > rMaxDelayNs)
+                throw std::invalid_argument("the max delay is lower than min delay");
+        }
+
+        std::chrono::nanoseconds randomDelay(std::mt19937 &rRandomEngine, const std::chrono::nanoseconds &rLimitDelayNs)
+        {
+            using Rep = std::chrono::nanoseconds::rep;
+            return std::chrono::nanoseconds(std::uniform_int_distribution<Rep>(0, rLimitDelayNs.count())(rRandomEngine));
+        }
+    }
+
+    void spinFor(const std::chrono::nanoseconds &delay)
+    {
+        if (delay.count() <= 0)
+            return;
+        spinIterations(static_cast<size_t>(delay.count() * getSpinIterationsPerNs()));
+    }
+
+    SpinBackoff::SpinBackoff(const std::chrono::nanoseconds &t_rMinDelayNs, const std::chrono::nanoseconds &t_rMaxDelayNs)
+    :
+    m_minDelayNs(t_rMinDelayNs),
+    m_maxDelayNs(t_rMaxDelayNs),
+    m_limitDelayNs(t_rMinDelayNs),
+    m_randomEngine(std::chrono::steady_clock::now().time_since_epoch().count())
+    {
+        validateDelays(t_rMinDelayNs, t_rMaxDelayNs);
+        // Калибровка выполняется при создании стека, а не при первой неудачной CAS.
+        getSpinIterationsPerNs();
+    }
+
+    void SpinBackoff::backoff()
+    {
+        spinFor(nextDelay());
+    }
+
+    std::chrono::nanoseconds SpinBackoff::nextDelay()
+    {
+        const auto delayNs = randomDelay(m_randomEngine, m_limitDelayNs);
+        m_limitDelayNs = std::min(m_maxDelayNs, std::max(2 * m_limitDelayNs, std::chrono::nanoseconds(1)));
+        return delayNs;
+    }
+
+    void SpinBackoff::onOperationCompleted(size_t)
+    {
+        m_limitDelayNs = std::max(m_minDelayNs, m_limitDelayNs / 2);
+    }
+
+    SpinYieldBackoff::SpinYieldBackoff(const std::chrono::nanoseconds &t_rMinDelayNs,
+                                       const std::chrono::nanoseconds &t_rMaxDelayNs)
+    :
+    SpinBackoff(t_rMinDelayNs, t_rMaxDelayNs)
+    {
+    }
+
+    void SpinYieldBackoff::backoff()
+    {
+        const auto delayNs = nextDelay();
+        if (delayNs <= SpinYieldThreshold)
+        {
+            spinFor(delayNs);
+            return;
+        }
+
+        const auto deadline = std::chrono::steady_clock::now() + delayNs;
+        while (std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    AdaptiveBackoff::AdaptiveBackoff(const std::chrono::nanoseconds &t_rMinDelayNs,
+                                     const std::chrono::nanoseconds &t_rMaxDelayNs)
+    :
+    m_minDelayNs(t_rMinDelayNs),
+    m_maxDelayNs(t_rMaxDelayNs),
+    m_windowNs(t_rMinDelayNs),
+    m_randomEngine(std::chrono::steady_clock::now().time_since_epoch().count())
+    {
+        validateDelays(t_rMinDelayNs, t_rMaxDelayNs);
+        getSpinIterationsPerNs();
+    }
+
+    void AdaptiveBackoff::backoff()
+    {
+        spinFor(nextDelay());
+    }
+
+    std::chrono::nanoseconds AdaptiveBackoff::nextDelay()
+    {
+        return randomDelay(m_randomEngine, m_windowNs);
+    }
+
+    void AdaptiveBackoff::onOperationCompleted(size_t casFailuresNum)
+    {
+        m_casFailureRate += AdaptiveBackoffSmoothingFactor * (static_cast<double>(casFailuresNum) - m_casFailureRate);
+        if (m_casFailureRate > AdaptiveBackoffHighFailureRate)
+        {
+            m_windowNs = std::min(m_maxDelayNs, std::max(2 * m_windowNs, std::chrono::nanoseconds(1)));
+        }
+        else if (m_casFailureRate < AdaptiveBackoffLowFailureRate)
+        {
+            m_windowNs = std::max(m_minDelayNs, m_windowNs / 2);
+        }
+    }
+
+    double AdaptiveBackoff::getCasFailureRate() const
+    {
+        return m_casFailureRate;
+    }
+
+    std::chrono::nanoseconds AdaptiveBackoff::getWindow() const
+    {
+        return m_windowNs;
+    }
+} // rma_stack
@@ -0,0 +1,245 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include <algorithm>
+
+#include "outer/EliminationArray.h"
+#include "outer/BackoffPolicies.h"
+#include "MpiException.h"
+
+namespace rma_stack
+{
+    namespace custom_mpi = custom_mpi_extensions;
+
+    EliminationArray::EliminationArray(MPI_Comm comm, MPI_Info info, size_t t_payloadSize, size_t t_slotsPerRank,
+                                       ref_counting::EpochMode t_epochMode, std::shared_ptr<spdlog::logger> t_logger)
+    :
+    m_payloadSize(t_payloadSize),
+    m_slotsPerRank(t_slotsPerRank),
+    m_epochMode(t_epochMode),
+    m_slotSize(sizeof(EliminationSlotState) + (t_payloadSize + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t)),
+    m_logger(std::move(t_logger))
+    {
+        {
+            auto mpiStatus = MPI_Comm_rank(comm, &m_rank);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to get rank", __FILE__, __func__, __LINE__, mpiStatus);
+        }
+        MPI_Comm_size(comm, &m_procNum);
+        m_randomEngine.seed(std::chrono::steady_clock::now().time_since_epoch().count() + m_rank);
+
+        if (isEnabled())
+        {
+            initRemoteAccessMemory(comm, info);
+            ref_counting::beginWinEpoch(m_win, m_epochMode);
+        }
+    }
+
+    bool EliminationArray::tryPush(const void *pPayload, const std::chrono::nanoseconds &delay)
+    {
+        int rank{-1};
+        MPI_Aint slotAddress{(MPI_Aint)MPI_BOTTOM};
+        chooseSlot(rank, slotAddress);
+
+        ref_counting::lockWinTarget(rank, m_win, m_epochMode);
+        const auto slotState = fetchSlotState(rank, slotAddress);
+        const EliminationSlotState busyState{Busy, slotState.stamp};
+        if (slotState.state != Empty || !compareAndSwapSlotState(rank, slotAddress, slotState, busyState))
+        {
+            // Ячейка занята, и процесс просто выжидает задержку.
+            ref_counting::unlockWinTargetLocal(rank, m_win, m_epochMode);
+            spinFor(delay);
+            return false;
+        }
+
+        // Ячейка принадлежит текущему процессу, пока он не опубликует предложение.
+        MPI_Put(pPayload,
+                static_cast<int>(m_payloadSize),
+                MPI_UNSIGNED_CHAR,
+                rank,
+                MPI_Aint_add(slotAddress, sizeof(EliminationSlotState)),
+                static_cast<int>(m_payloadSize),
+                MPI_UNSIGNED_CHAR,
+                m_win
+        );
+        MPI_Win_flush(rank, m_win);
+
+        const EliminationSlotState waitingState{Waiting, slotState.stamp};
+        replaceSlotState(rank, slotAddress, waitingState);
+        ref_counting::unlockWinTargetLocal(rank, m_win, m_epochMode);
+
+        spinFor(delay);
+
+        // Если отозвать предложение не удалось, то его уже забрал POP, и ячейку освободит он.
+        ref_counting::lockWinTarget(rank, m_win, m_epochMode);
+        const EliminationSlotState emptyState{Empty, slotState.stamp + 1u};
+        const bool withdrawn = compareAndSwapSlotState(rank, slotAddress, waitingState, emptyState);
+        ref_counting::unlockWinTargetLocal(rank, m_win, m_epochMode);
+
+        if (withdrawn)
+            return false;
+
+        ++m_eliminatedOpsNum;
+        m_logger->trace("push was eliminated in slot of rank {}", rank);
+        return true;
+    }
+
+    bool EliminationArray::tryPop(void *pPayload)
+    {
+        int rank{-1};
+        MPI_Aint slotAddress{(MPI_Aint)MPI_BOTTOM};
+        chooseSlot(rank, slotAddress);
+
+        ref_counting::lockWinTarget(rank, m_win, m_epochMode);
+        const auto slotState = fetchSlotState(rank, slotAddress);
+        const EliminationSlotState takenState{Taken, slotState.stamp};
+        if (slotState.state != Waiting || !compareAndSwapSlotState(rank, slotAddress, slotState, takenState))
+        {
+            ref_counting::unlockWinTargetLocal(rank, m_win, m_epochMode);
+            return false;
+        }
+
+        MPI_Get(pPayload,
+                static_cast<int>(m_payloadSize),
+                MPI_UNSIGNED_CHAR,
+                rank,
+                MPI_Aint_add(slotAddress, sizeof(EliminationSlotState)),
+                static_cast<int>(m_payloadSize),
+                MPI_UNSIGNED_CHAR,
+                m_win
+        );
+        MPI_Win_flush(rank, m_win);
+
+        const EliminationSlotState emptyState{Empty, slotState.stamp + 1u};
+        replaceSlotState(rank, slotAddress, emptyState);
+        ref_counting::unlockWinTargetLocal(rank, m_win, m_epochMode);
+
+        ++m_eliminatedOpsNum;
+        m_logger->trace("pop was eliminated in slot of rank {}", rank);
+        return true;
+    }
+
+    void EliminationArray::chooseSlot(int &rRank, MPI_Aint &rSlotAddress)
+    {
+        const auto slotsNum = static_cast<size_t>(m_procNum) * m_slotsPerRank;
+        const auto slotIdx = std::uniform_int_distribution<size_t>(0, slotsNum - 1)(m_randomEngine);
+
+        rRank = static_cast<int>(slotIdx / m_slotsPerRank);
+        rSlotAddress = MPI_Aint_add(m_pSlotsAddresses[rRank], static_cast<MPI_Aint>((slotIdx % m_slotsPerRank) * m_slotSize));
+    }
+
+    EliminationSlotState EliminationArray::fetchSlotState(int rank, MPI_Aint slotAddress)
+    {
+        EliminationSlotState slotState{Empty, 0};
+        MPI_Fetch_and_op(nullptr,
+                         &slotState,
+                         MPI_UINT64_T,
+                         rank,
+                         slotAddress,
+                         MPI_NO_OP,
+                         m_win
+        );
+        MPI_Win_flush(rank, m_win);
+        return slotState;
+    }
+
+    bool EliminationArray::compareAndSwapSlotState(int rank, MPI_Aint slotAddress, EliminationSlotState oldState,
+                                                   EliminationSlotState newState)
+    {
+        EliminationSlotState resState{Empty, 0};
+        MPI_Compare_and_swap(&newState,
+                             &oldState,
+                             &resState,
+                             MPI_UINT64_T,
+                             rank,
+                             slotAddress,
+                             m_win
+        );
+        MPI_Win_flush(rank, m_win);
+        return resState.state == oldState.state && resState.stamp == oldState.stamp;
+    }
+
+    void EliminationArray::replaceSlotState(int rank, MPI_Aint slotAddress, EliminationSlotState newState)
+    {
+        MPI_Accumulate(&newState,
+                       1,
+                       MPI_UINT64_T,
+                       rank,
+                       slotAddress,
+                       1,
+                       MPI_UINT64_T,
+                       MPI_REPLACE,
+                       m_win
+        );
+        MPI_Win_flush(rank, m_win);
+    }
+
+    bool EliminationArray::isEnabled() const
+    {
+        return m_slotsPerRank > 0;
+    }
+
+    size_t EliminationArray::getEliminatedOpsNum() const
+    {
+        return m_eliminatedOpsNum;
+    }
+
+    void EliminationArray::release()
+    {
+        if (!isEnabled())
+            return;
+
+        ref_counting::endWinEpoch(m_win, m_epochMode);
+        if (m_pSlots)
+        {
+            MPI_Win_detach(m_win, m_pSlots);
+            MPI_Free_mem(m_pSlots);
+            m_pSlots = nullptr;
+            m_logger->trace("freed up elimination slots RMA memory");
+        }
+
+        MPI_Win_free(&m_win);
+        m_logger->trace("freed up elimination win RMA memory");
+    }
+
+    void EliminationArray::initRemoteAccessMemory(MPI_Comm comm, MPI_Info info)
+    {
+        {
+            auto mpiStatus = MPI_Win_create_dynamic(info, comm, &m_win);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to create RMA window for elimination slots", __FILE__, __func__, __LINE__, mpiStatus);
+        }
+
+        m_logger->trace("started to initialize elimination slots");
+        const auto slotsSize = static_cast<MPI_Aint>(m_slotsPerRank * m_slotSize);
+        {
+            auto mpiStatus = MPI_Alloc_mem(slotsSize, MPI_INFO_NULL, &m_pSlots);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException(
+                        "failed to allocate RMA memory",
+                        __FILE__,
+                        __func__,
+                        __LINE__,
+                        mpiStatus
+                );
+        }
+        // Все ячейки пусты, метки равны нулю.
+        std::fill_n(m_pSlots, m_slotsPerRank * m_slotSize / sizeof(uint64_t), 0);
+        {
+            auto mpiStatus = MPI_Win_attach(m_win, m_pSlots, slotsSize);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to attach RMA window", __FILE__, __func__, __LINE__, mpiStatus);
+        }
+        m_logger->trace("initialized elimination slots");
+
+        MPI_Aint slotsAddress{(MPI_Aint)MPI_BOTTOM};
+        MPI_Get_address(m_pSlots, &slotsAddress);
+        m_pSlotsAddresses = std::make_unique<MPI_Aint[]>(m_procNum);
+        {
+            auto mpiStatus = MPI_Allgather(&slotsAddress, 1, MPI_AINT, m_pSlotsAddresses.get(), 1, MPI_AINT, comm);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to gather elimination slots addresses", __FILE__, __func__ , __LINE__, mpiStatus);
+        }
+    }
+} // rma_stack
@@ -2,14 +2,17 @@
 // Created by denis on 19.02.23.
 //
 
-#include <thread>
+#include <limits>
+#include <stdexcept>
 
 #include "include/outer/ExponentialBackoff.h"
+#include "include/outer/BackoffPolicies.h"
 
 namespace rma_stack
 {
     ExponentialBackoff::ExponentialBackoff(const std::chrono::nanoseconds &t_rMinDelayNs, const std::chrono::nanoseconds &t_rMaxDelayNs)
     :
+    m_minDelayNs(t_rMinDelayNs),
     m_maxDelayNs(t_rMaxDelayNs),
     m_limitDelayInt(0),
     m_randomEngine(std::chrono::steady_clock::now().time_since_epoch().count())
@@ -30,6 +33,11 @@ namespace rma_stack
     }
 
     void ExponentialBackoff::backoff()
+    {
+        spinFor(nextDelay());
+    }
+
+    std::chrono::nanoseconds ExponentialBackoff::nextDelay()
     {
         const auto delayInt = std::uniform_int_distribution<int>(0, m_limitDelayInt)(m_randomEngine);
         const auto delayNs = std::chrono::nanoseconds (delayInt);
@@ -47,6 +55,11 @@ namespace rma_stack
             m_limitDelayInt = std::min(maxDelayInt, static_cast<int>(limitDelayLong));
         }
 
-        std::this_thread::sleep_for(delayNs);
+        return delayNs;
+    }
+
+    void ExponentialBackoff::onOperationCompleted(size_t)
+    {
+        m_limitDelayInt = static_cast<int>(m_minDelayNs.count());
     }
 } // rma_stack
\ No newline at end of file
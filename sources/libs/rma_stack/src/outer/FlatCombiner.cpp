@@ -0,0 +1,413 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include "outer/FlatCombiner.h"
+#include "MpiException.h"
+
+namespace rma_stack
+{
+    namespace custom_mpi = custom_mpi_extensions;
+
+    std::string_view getFlatCombiningModeName(FlatCombiningMode mode)
+    {
+        switch (mode)
+        {
+            case FlatCombiningMode::Disabled:
+                return "disabled";
+            case FlatCombiningMode::Adaptive:
+                return "adaptive";
+            case FlatCombiningMode::Always:
+                return "always";
+        }
+        return "unknown";
+    }
+
+    FlatCombiner::FlatCombiner(MPI_Comm comm, MPI_Info info, int t_headRank, size_t t_payloadSize,
+                               FlatCombiningMode t_mode,
+                               ref_counting::EpochMode t_epochMode, std::shared_ptr<spdlog::logger> t_logger)
+    :
+    m_headRank(t_headRank),
+    m_payloadSize(t_payloadSize),
+    m_payloadWordsNum((t_payloadSize + sizeof(uint64_t) - 1) / sizeof(uint64_t)),
+    m_mode(t_mode),
+    m_epochMode(t_epochMode),
+    m_combining(t_mode == FlatCombiningMode::Always),
+    m_logger(std::move(t_logger))
+    {
+        {
+            auto mpiStatus = MPI_Comm_rank(comm, &m_rank);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to get rank", __FILE__, __func__, __LINE__, mpiStatus);
+        }
+        MPI_Comm_size(comm, &m_procNum);
+
+        if (m_mode != FlatCombiningMode::Disabled)
+        {
+            initRemoteAccessMemory(comm, info);
+            ref_counting::beginWinEpoch(m_win, m_epochMode);
+        }
+    }
+
+    bool FlatCombiner::shouldCombine()
+    {
+        if (!m_combining)
+            return false;
+        if (m_mode == FlatCombiningMode::Always)
+            return true;
+
+        // Редкие прямые операции позволяют заметить, что конкуренция спала.
+        if (++m_opsSinceProbe < FlatCombiningProbePeriod)
+            return true;
+        m_opsSinceProbe = 0;
+        return false;
+    }
+
+    void FlatCombiner::registerCasFailures(size_t casFailuresNum)
+    {
+        if (m_mode != FlatCombiningMode::Adaptive)
+            return;
+
+        // Экспоненциальное скользящее среднее с гистерезисом, чтобы режим не переключался на каждой операции.
+        m_casFailuresRate += (static_cast<double>(casFailuresNum) - m_casFailuresRate) / 8;
+        if (!m_combining && m_casFailuresRate >= FlatCombiningCasFailuresThreshold)
+        {
+            m_combining = true;
+            m_logger->trace("switched to flat combining, cas failures rate {}", m_casFailuresRate);
+        }
+        else if (m_combining && m_casFailuresRate < FlatCombiningCasFailuresThreshold / 2)
+        {
+            m_combining = false;
+            m_logger->trace("switched to direct operations, cas failures rate {}", m_casFailuresRate);
+        }
+    }
+
+    bool FlatCombiner::push(const void *pPayload, const FlatCombiningCallbacks &rCallbacks)
+    {
+        return execute(PendingPush, const_cast<void*>(pPayload), rCallbacks);
+    }
+
+    bool FlatCombiner::pop(void *pPayload, const FlatCombiningCallbacks &rCallbacks)
+    {
+        return execute(PendingPop, pPayload, rCallbacks);
+    }
+
+    bool FlatCombiner::execute(RequestState request, void *pPayload, const FlatCombiningCallbacks &rCallbacks)
+    {
+        m_logger->trace("started to execute combined request {}", static_cast<uint64_t>(request));
+        ref_counting::lockWinTarget(m_headRank, m_win, m_epochMode);
+        // Данные PUSH записываются до публикации запроса.
+        if (request == PendingPush)
+        {
+            std::memcpy(m_requestPayload.data(), pPayload, m_payloadSize);
+            MPI_Accumulate(m_requestPayload.data(),
+                           static_cast<int>(m_payloadWordsNum),
+                           MPI_UINT64_T,
+                           m_headRank,
+                           getPayloadAddress(m_rank),
+                           static_cast<int>(m_payloadWordsNum),
+                           MPI_UINT64_T,
+                           MPI_REPLACE,
+                           m_win
+            );
+            MPI_Win_flush(m_headRank, m_win);
+        }
+        const uint64_t pendingState{request};
+        MPI_Accumulate(&pendingState,
+                       1,
+                       MPI_UINT64_T,
+                       m_headRank,
+                       getRequestStateAddress(m_rank),
+                       1,
+                       MPI_UINT64_T,
+                       MPI_REPLACE,
+                       m_win
+        );
+        MPI_Win_flush(m_headRank, m_win);
+
+        // Запрос выполнит процесс, захвативший блокировку, возможно, текущий.
+        uint64_t requestState{pendingState};
+        for (;;)
+        {
+            tryCombine(rCallbacks);
+            requestState = fetchRequestState();
+            if (requestState == Done || requestState == Failed)
+                break;
+            rCallbacks.backoff();
+        }
+
+        if (request == PendingPop && requestState == Done)
+        {
+            MPI_Get_accumulate(nullptr,
+                               0,
+                               MPI_UINT64_T,
+                               m_requestPayload.data(),
+                               static_cast<int>(m_payloadWordsNum),
+                               MPI_UINT64_T,
+                               m_headRank,
+                               getPayloadAddress(m_rank),
+                               static_cast<int>(m_payloadWordsNum),
+                               MPI_UINT64_T,
+                               MPI_NO_OP,
+                               m_win
+            );
+            MPI_Win_flush(m_headRank, m_win);
+            std::memcpy(pPayload, m_requestPayload.data(), m_payloadSize);
+        }
+        ref_counting::unlockWinTargetLocal(m_headRank, m_win, m_epochMode);
+
+        ++m_combinedOpsNum;
+        m_logger->trace("finished to execute combined request {}", static_cast<uint64_t>(request));
+        return requestState == Done;
+    }
+
+    bool FlatCombiner::tryCombine(const FlatCombiningCallbacks &rCallbacks)
+    {
+        const uint64_t unlocked{0};
+        const auto locked = static_cast<uint64_t>(m_rank) + 1;
+        uint64_t resLock{0};
+        MPI_Compare_and_swap(&locked,
+                             &unlocked,
+                             &resLock,
+                             MPI_UINT64_T,
+                             m_headRank,
+                             m_combinerMemoryAddress,
+                             m_win
+        );
+        MPI_Win_flush(m_headRank, m_win);
+        if (resLock != unlocked)
+            return false;
+
+        combine(rCallbacks);
+
+        MPI_Accumulate(&unlocked,
+                       1,
+                       MPI_UINT64_T,
+                       m_headRank,
+                       m_combinerMemoryAddress,
+                       1,
+                       MPI_UINT64_T,
+                       MPI_REPLACE,
+                       m_win
+        );
+        MPI_Win_flush(m_headRank, m_win);
+        return true;
+    }
+
+    void FlatCombiner::combine(const FlatCombiningCallbacks &rCallbacks)
+    {
+        /*
+         * Данные читаются после состояний: процесс записывает данные до
+         * публикации запроса и не изменяет их, пока запрос не выполнен,
+         * поэтому данные всех прочитанных запросов уже актуальны.
+         */
+        MPI_Get_accumulate(nullptr,
+                           0,
+                           MPI_UINT64_T,
+                           m_requestStates.data(),
+                           m_procNum,
+                           MPI_UINT64_T,
+                           m_headRank,
+                           getRequestStateAddress(0),
+                           m_procNum,
+                           MPI_UINT64_T,
+                           MPI_NO_OP,
+                           m_win
+        );
+        MPI_Win_flush(m_headRank, m_win);
+        const auto payloadsWordsNum = static_cast<int>(m_procNum * m_payloadWordsNum);
+        MPI_Get_accumulate(nullptr,
+                           0,
+                           MPI_UINT64_T,
+                           m_payloads.data(),
+                           payloadsWordsNum,
+                           MPI_UINT64_T,
+                           m_headRank,
+                           getPayloadAddress(0),
+                           payloadsWordsNum,
+                           MPI_UINT64_T,
+                           MPI_NO_OP,
+                           m_win
+        );
+        MPI_Win_flush(m_headRank, m_win);
+
+        std::vector<int> pushRanks;
+        std::vector<int> popRanks;
+        for (int rank = 0; rank < m_procNum; ++rank)
+        {
+            if (m_requestStates[rank] == PendingPush)
+                pushRanks.push_back(rank);
+            else if (m_requestStates[rank] == PendingPop)
+                popRanks.push_back(rank);
+        }
+        if (pushRanks.empty() && popRanks.empty())
+            return;
+        // Состояния остальных ячеек могли измениться после чтения, поэтому записываются только состояния пакета.
+        std::vector<int> combinedRanks(pushRanks);
+        combinedRanks.insert(combinedRanks.end(), popRanks.begin(), popRanks.end());
+
+        // Пары PUSH и POP выполняются без обращения к стеку: данные PUSH сразу передаются POP.
+        const auto pairsNum = std::min(pushRanks.size(), popRanks.size());
+        for (size_t i = 0; i < pairsNum; ++i)
+        {
+            const auto pushRank = pushRanks[pushRanks.size() - 1 - i];
+            const auto popRank = popRanks[popRanks.size() - 1 - i];
+            std::copy_n(m_payloads.begin() + pushRank * m_payloadWordsNum, m_payloadWordsNum,
+                        m_payloads.begin() + popRank * m_payloadWordsNum);
+            m_requestStates[pushRank] = Done;
+            m_requestStates[popRank] = Done;
+        }
+        std::vector<int> donePopRanks(popRanks.end() - static_cast<long>(pairsNum), popRanks.end());
+        pushRanks.resize(pushRanks.size() - pairsNum);
+        popRanks.resize(popRanks.size() - pairsNum);
+
+        for (const auto rank : pushRanks)
+        {
+            const bool pushed = rCallbacks.push(m_payloads.data() + rank * m_payloadWordsNum);
+            m_requestStates[rank] = pushed ? Done : Failed;
+        }
+        for (const auto rank : popRanks)
+        {
+            const bool popped = rCallbacks.pop(m_payloads.data() + rank * m_payloadWordsNum);
+            m_requestStates[rank] = popped ? Done : Failed;
+            if (popped)
+                donePopRanks.push_back(rank);
+        }
+
+        // Сначала записываются данные POP, затем состояния всех выполненных запросов.
+        for (const auto rank : donePopRanks)
+        {
+            MPI_Accumulate(m_payloads.data() + rank * m_payloadWordsNum,
+                           static_cast<int>(m_payloadWordsNum),
+                           MPI_UINT64_T,
+                           m_headRank,
+                           getPayloadAddress(rank),
+                           static_cast<int>(m_payloadWordsNum),
+                           MPI_UINT64_T,
+                           MPI_REPLACE,
+                           m_win
+            );
+        }
+        MPI_Win_flush(m_headRank, m_win);
+
+        for (const auto rank : combinedRanks)
+        {
+            MPI_Accumulate(&m_requestStates[rank],
+                           1,
+                           MPI_UINT64_T,
+                           m_headRank,
+                           getRequestStateAddress(rank),
+                           1,
+                           MPI_UINT64_T,
+                           MPI_REPLACE,
+                           m_win
+            );
+        }
+        MPI_Win_flush(m_headRank, m_win);
+        m_logger->trace("combined {} requests, {} push/pop pairs eliminated", combinedRanks.size(), pairsNum);
+    }
+
+    uint64_t FlatCombiner::fetchRequestState()
+    {
+        uint64_t requestState{Empty};
+        MPI_Fetch_and_op(nullptr,
+                         &requestState,
+                         MPI_UINT64_T,
+                         m_headRank,
+                         getRequestStateAddress(m_rank),
+                         MPI_NO_OP,
+                         m_win
+        );
+        MPI_Win_flush(m_headRank, m_win);
+        return requestState;
+    }
+
+    MPI_Aint FlatCombiner::getRequestStateAddress(int rank) const
+    {
+        // Сразу за блокировкой располагаются состояния запросов, затем данные.
+        return MPI_Aint_add(m_combinerMemoryAddress, static_cast<MPI_Aint>((1 + rank) * sizeof(uint64_t)));
+    }
+
+    MPI_Aint FlatCombiner::getPayloadAddress(int rank) const
+    {
+        const auto payloadWordIdx = 1 + m_procNum + rank * m_payloadWordsNum;
+        return MPI_Aint_add(m_combinerMemoryAddress, static_cast<MPI_Aint>(payloadWordIdx * sizeof(uint64_t)));
+    }
+
+    FlatCombiningMode FlatCombiner::getMode() const
+    {
+        return m_mode;
+    }
+
+    size_t FlatCombiner::getCombinedOpsNum() const
+    {
+        return m_combinedOpsNum;
+    }
+
+    void FlatCombiner::release()
+    {
+        if (m_mode == FlatCombiningMode::Disabled)
+            return;
+
+        ref_counting::endWinEpoch(m_win, m_epochMode);
+        if (m_pCombinerMemory)
+        {
+            MPI_Win_detach(m_win, m_pCombinerMemory);
+            MPI_Free_mem(m_pCombinerMemory);
+            m_pCombinerMemory = nullptr;
+            m_logger->trace("freed up flat combining RMA memory");
+        }
+
+        MPI_Win_free(&m_win);
+        m_logger->trace("freed up flat combining win RMA memory");
+    }
+
+    void FlatCombiner::initRemoteAccessMemory(MPI_Comm comm, MPI_Info info)
+    {
+        {
+            auto mpiStatus = MPI_Win_create_dynamic(info, comm, &m_win);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to create RMA window for flat combining", __FILE__, __func__, __LINE__, mpiStatus);
+        }
+
+        if (m_rank == m_headRank)
+        {
+            m_logger->trace("started to initialize flat combining memory");
+            const auto wordsNum = 1 + m_procNum + m_procNum * m_payloadWordsNum;
+            const auto memorySize = static_cast<MPI_Aint>(wordsNum * sizeof(uint64_t));
+            {
+                auto mpiStatus = MPI_Alloc_mem(memorySize, MPI_INFO_NULL, &m_pCombinerMemory);
+                if (mpiStatus != MPI_SUCCESS)
+                    throw custom_mpi::MpiException(
+                            "failed to allocate RMA memory",
+                            __FILE__,
+                            __func__,
+                            __LINE__,
+                            mpiStatus
+                    );
+            }
+            // Блокировка свободна, запросов нет.
+            std::fill_n(m_pCombinerMemory, wordsNum, 0);
+            {
+                auto mpiStatus = MPI_Win_attach(m_win, m_pCombinerMemory, memorySize);
+                if (mpiStatus != MPI_SUCCESS)
+                    throw custom_mpi::MpiException("failed to attach RMA window", __FILE__, __func__, __LINE__, mpiStatus);
+            }
+            MPI_Get_address(m_pCombinerMemory, &m_combinerMemoryAddress);
+            m_logger->trace("initialized flat combining memory");
+        }
+
+        {
+            auto mpiStatus = MPI_Bcast(&m_combinerMemoryAddress, 1, MPI_AINT, m_headRank, comm);
+            if (mpiStatus != MPI_SUCCESS)
+                throw custom_mpi::MpiException("failed to broadcast flat combining memory address", __FILE__, __func__ , __LINE__, mpiStatus);
+        }
+
+        m_requestPayload.resize(m_payloadWordsNum);
+        m_requestStates.resize(m_procNum);
+        m_payloads.resize(m_procNum * m_payloadWordsNum);
+    }
+} // rma_stack
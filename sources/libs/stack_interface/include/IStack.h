@@ -5,6 +5,7 @@
 #ifndef SOURCES_ISTACK_H
 #define SOURCES_ISTACK_H
 
+#include <cstddef>
 
 namespace stack_interface
 {
@@ -26,7 +27,22 @@ namespace stack_interface
         {
             StackTraitsImpl::popImpl(impl(), rValue, rDefaultValue);
         }
-        ValueType& top()
+        /*
+         * Пакетные операции. pushBulk добавляет значения по порядку,
+         * так что вершиной становится последнее из них, popBulk снимает
+         * до valuesNum значений, начиная с вершины. Обе возвращают
+         * кол-во добавленных/снятых значений.
+         */
+        size_t pushBulk(const ValueType *pValues, size_t valuesNum)
+        {
+            return StackTraitsImpl::pushBulkImpl(impl(), pValues, valuesNum);
+        }
+        size_t popBulk(size_t valuesNum, ValueType *pValues)
+        {
+            return StackTraitsImpl::popBulkImpl(impl(), valuesNum, pValues);
+        }
+        // Возвращает то же, что и topImpl реализации: ссылку или копию значения.
+        decltype(auto) top()
         {
             return StackTraitsImpl::topImpl(impl());
         }
@@ -26,4 +26,4 @@ fi
 
 mkdir $1
 cd $1 || exit
-mpiexec -np "$1" ../../../rma_treiber_central_stack_random_operation_benchmark_app
\ No newline at end of file
+mpiexec -np "$1" ../../../stack_benchmark_app --stack=central --mix=random "${@:2}"
\ No newline at end of file
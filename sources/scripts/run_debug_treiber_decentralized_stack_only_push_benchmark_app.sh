@@ -26,4 +26,4 @@ fi
 
 mkdir $1
 cd $1 || exit
-mpiexec -np "$1" ../../../rma_treiber_decentralized_stack_only_push_benchmark_app
\ No newline at end of file
+mpiexec -np "$1" ../../../stack_benchmark_app --stack=decentralized --mix=push --warm-up=0 "${@:2}"
\ No newline at end of file
@@ -0,0 +1,32 @@
+#PBS -l walltime=00:10:00
+#PBS -l select=$($1):ncpus=1:mpiprocs=1:mem=1000m,place=free
+
+# usage: run_release_stack_benchmark_app.sh PROC_NUM STACK TASK [OPTIONS...], e.g.
+# run_release_stack_benchmark_app.sh 4 central epoch-mode --epoch-mode=per-operation
+
+echo "procNum: $1, stack: $2, task: $3"
+cd ../install-release/bin/ || exit
+
+if [ ! -d "$2" ]
+then
+  mkdir "$2"
+fi
+
+cd "$2" || exit
+
+if [ ! -d "$3" ]
+then
+  mkdir "$3"
+fi
+
+cd "$3" || exit
+
+if [ -d $1 ]
+then
+  echo "cannot run the mpiexec because the directory $1 already exists"
+  exit 1
+fi
+
+mkdir $1
+cd $1 || exit
+mpiexec -np "$1" ../../../stack_benchmark_app --stack="$2" --task="$3" "${@:4}"
@@ -0,0 +1,124 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include <sstream>
+
+#include "include/benchmark_measurement.h"
+#include "include/logging.h"
+
+BenchmarkTaskContext makeBenchmarkTaskContext(MPI_Comm comm, const BenchmarkOptions &rOptions, int repetitionIdx,
+                                              std::shared_ptr<spdlog::sinks::sink> loggerSink)
+{
+    auto pLogger = std::make_shared<spdlog::logger>(producerConsumerBenchmarkLoggerName.data(), std::move(loggerSink));
+    pLogger->set_level(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
+    pLogger->flush_on(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
+
+    int procNum{0};
+    MPI_Comm_size(comm, &procNum);
+    int rank{-1};
+    MPI_Comm_rank(comm, &rank);
+    return BenchmarkTaskContext{comm, rOptions, repetitionIdx, procNum, rank, getRankOpsNum(rOptions, procNum),
+                                std::move(pLogger)};
+}
+
+namespace benchmark_measurement_detail
+{
+    void logMeasurement(const BenchmarkTaskContext &rContext, const OpsPhase &rPhase,
+                        const RankBenchmarkResult &rResult, double maxElapsedSec, int warmUpNum)
+    {
+        const auto &rOptions = rContext.rOptions;
+        SPDLOG_LOGGER_INFO(rContext.pLogger, "procs {}, rank {}, elapsed (sec) {}, total (sec) {}",
+                           rContext.procNum, rContext.rank, rResult.elapsedSec, maxElapsedSec);
+        SPDLOG_LOGGER_INFO(rContext.pLogger, "stack {}, task {}, phase {}, threads {}, weak scaling {}, repetition {}",
+                           rOptions.stackName, getBenchmarkTaskName(rOptions.task), rPhase.name, rPhase.threadsNum,
+                           rOptions.weakScaling, rContext.repetitionIdx);
+        SPDLOG_LOGGER_INFO(rContext.pLogger, "total ops {}, ops {}",
+                           static_cast<long long>(rPhase.opsNum) * rContext.procNum, rPhase.opsNum);
+        SPDLOG_LOGGER_INFO(rContext.pLogger, "push count {}, pop count {}, empty pop count {}, query count {}, warm up {}",
+                           rResult.pushCount, rResult.popCount, rResult.emptyPopCount, rResult.queryCount, warmUpNum);
+    }
+
+    void reportMeasurement(const BenchmarkTaskContext &rContext, const OpsPhase &rPhase,
+                           const RankBenchmarkResult &rResult, ThreadOps &rOps, uint64_t warmUpSamplesNum,
+                           rma_stack::ref_counting::OperationCounters &rCounters, bool countersAvailable,
+                           rma_stack::ref_counting::PushPhaseTimes &rPushPhaseTimes,
+                           rma_stack::ref_counting::PopPhaseTimes &rPopPhaseTimes)
+    {
+        const auto &rOptions = rContext.rOptions;
+        const auto &pLogger  = rContext.pLogger;
+
+        rOps.pushHistogram.reduce(rContext.comm, 0);
+        rOps.popHistogram.reduce(rContext.comm, 0);
+        rOps.throughputSampler.reduce(rContext.comm, 0);
+        uint64_t totalWarmUpSamplesNum{0};
+        MPI_Reduce(&warmUpSamplesNum, &totalWarmUpSamplesNum, 1, MPI_UINT64_T, MPI_MAX, 0, rContext.comm);
+        rCounters.reduce(rContext.comm, 0);
+        rma_stack::ref_counting::reducePhaseTimes(rPushPhaseTimes, rContext.comm, 0);
+        rma_stack::ref_counting::reducePhaseTimes(rPopPhaseTimes, rContext.comm, 0);
+        if (rContext.rank == 0)
+        {
+            for (const auto &[operationName, pHistogram]: {std::pair{"push", &rOps.pushHistogram},
+                                                            std::pair{"pop", &rOps.popHistogram}})
+            {
+                SPDLOG_LOGGER_INFO(pLogger, "{} latency (nsec) p50 {}, p90 {}, p99 {}, p99.9 {}, max {}, count {}",
+                                   operationName,
+                                   pHistogram->getValueAtPercentile(50),
+                                   pHistogram->getValueAtPercentile(90),
+                                   pHistogram->getValueAtPercentile(99),
+                                   pHistogram->getValueAtPercentile(99.9),
+                                   pHistogram->getMaxValue(),
+                                   pHistogram->getCount());
+            }
+            std::ostringstream samples;
+            for (const auto sample: rOps.throughputSampler.getSamples())
+                samples << ' ' << sample;
+            SPDLOG_LOGGER_INFO(pLogger, "throughput samples (ops per {} usec, first {} with warm up):{}",
+                               std::chrono::duration_cast<std::chrono::microseconds>(
+                                       rOps.throughputSampler.getInterval()).count(),
+                               totalWarmUpSamplesNum, samples.str());
+
+            if (countersAvailable)
+            {
+                SPDLOG_LOGGER_INFO(pLogger, "head cas attempts/failures: push {}/{}, pop {}/{}, head count {}/{}",
+                                   rCounters.pushCasAttempts, rCounters.pushCasFailures,
+                                   rCounters.popCasAttempts, rCounters.popCasFailures,
+                                   rCounters.headCountCasAttempts, rCounters.headCountCasFailures);
+                SPDLOG_LOGGER_INFO(pLogger, "node acquire claim probes {}, scan probes {}, release node calls {}, "
+                                            "backoff calls {}, backoff (sec) {}",
+                                   rCounters.acquireClaimProbes, rCounters.acquireScanProbes,
+                                   rCounters.releaseNodeCalls, rCounters.backoffCalls, rCounters.backoffSec);
+                const auto rmaTotal = rCounters.getRmaTotal();
+                std::ostringstream rmaTargets;
+                for (const auto &rTargetCounters: rCounters.rmaTargets)
+                    rmaTargets << ' ' << rTargetCounters.opsNum << '/' << rTargetCounters.bytesNum << '/'
+                               << rTargetCounters.flushesNum;
+                SPDLOG_LOGGER_INFO(pLogger, "rma ops {}, bytes {}, flushes {}, by target rank (ops/bytes/flushes):{}",
+                                   rmaTotal.opsNum, rmaTotal.bytesNum, rmaTotal.flushesNum, rmaTargets.str());
+            }
+
+            if (countersAvailable && rOptions.phaseTiming)
+            {
+                const double usecPerPush = 1e6 / static_cast<double>(std::max<size_t>(rPushPhaseTimes.pushesNum, 1));
+                const double usecPerPop = 1e6 / static_cast<double>(std::max<size_t>(rPopPhaseTimes.popsNum, 1));
+                SPDLOG_LOGGER_INFO(pLogger, "push phases (usec): node acquire {}, data put {}, link and cas {}, "
+                                            "backoff {}, finish {}",
+                                   rPushPhaseTimes.nodeAcquire * usecPerPush, rPushPhaseTimes.dataPut * usecPerPush,
+                                   rPushPhaseTimes.linkCas * usecPerPush, rPushPhaseTimes.backoff * usecPerPush,
+                                   rPushPhaseTimes.finish * usecPerPush);
+                SPDLOG_LOGGER_INFO(pLogger, "pop phases (usec): head read {}, next read {}, head cas {}, data read {}, "
+                                            "node release {}, backoff {}",
+                                   rPopPhaseTimes.headRead * usecPerPop, rPopPhaseTimes.nextRead * usecPerPop,
+                                   rPopPhaseTimes.headCas * usecPerPop, rPopPhaseTimes.dataRead * usecPerPop,
+                                   rPopPhaseTimes.nodeRelease * usecPerPop, rPopPhaseTimes.backoff * usecPerPop);
+            }
+        }
+        if (!rOptions.resultsPath.empty())
+        {
+            writeBenchmarkRecord(rContext.comm, rOptions, rContext.repetitionIdx, rPhase.name, rResult,
+                                 BenchmarkMeasurements{rOps.pushHistogram, rOps.popHistogram, rOps.throughputSampler,
+                                                       totalWarmUpSamplesNum, rCounters, rPushPhaseTimes,
+                                                       rPopPhaseTimes});
+        }
+    }
+}
@@ -0,0 +1,360 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "include/benchmark_options.h"
+
+namespace
+{
+    template<typename Number>
+    Number parseNumber(std::string_view name, const std::string &value)
+    {
+        std::istringstream iss(value);
+        Number number{};
+        iss >> number;
+        if (iss.fail() || !iss.eof())
+            throw std::invalid_argument("invalid value of the option '" + std::string(name) + "': " + value);
+        return number;
+    }
+
+    int parsePositiveInt(std::string_view name, const std::string &value)
+    {
+        const auto number = parseNumber<long long>(name, value);
+        if (number <= 0 || number > std::numeric_limits<int>::max())
+            throw std::invalid_argument("the option '" + std::string(name) + "' is out of bounds: " + value);
+        return static_cast<int>(number);
+    }
+
+    size_t parseCount(std::string_view name, const std::string &value)
+    {
+        const auto number = parseNumber<long long>(name, value);
+        if (number < 0 || number > std::numeric_limits<int>::max())
+            throw std::invalid_argument("the option '" + std::string(name) + "' is out of bounds: " + value);
+        return static_cast<size_t>(number);
+    }
+
+    double parseRatio(std::string_view name, const std::string &value)
+    {
+        const auto ratio = parseNumber<double>(name, value);
+        if (ratio < 0 || ratio > 1)
+            throw std::invalid_argument("the option '" + std::string(name) + "' must be in [0, 1]: " + value);
+        return ratio;
+    }
+
+    std::chrono::nanoseconds parseNanoseconds(std::string_view name, const std::string &value)
+    {
+        const auto nanoseconds = parseNumber<long long>(name, value);
+        if (nanoseconds < 0)
+            throw std::invalid_argument("the option '" + std::string(name) + "' must not be negative: " + value);
+        return std::chrono::nanoseconds(nanoseconds);
+    }
+
+    bool parseSwitch(std::string_view name, const std::string &value)
+    {
+        if (value == "on")
+            return true;
+        if (value == "off")
+            return false;
+        throw std::invalid_argument("the option '" + std::string(name) + "' must be 'on' or 'off': " + value);
+    }
+
+    rma_stack::FlatCombiningMode parseFlatCombiningMode(const std::string &value)
+    {
+        if (value == "disabled")
+            return rma_stack::FlatCombiningMode::Disabled;
+        if (value == "adaptive")
+            return rma_stack::FlatCombiningMode::Adaptive;
+        if (value == "always")
+            return rma_stack::FlatCombiningMode::Always;
+        throw std::invalid_argument("unknown flat combining mode: " + value);
+    }
+
+    rma_stack::ref_counting::ReclamationScheme parseReclamationScheme(const std::string &value)
+    {
+        if (value == "ref-counting")
+            return rma_stack::ref_counting::ReclamationScheme::RefCounting;
+        if (value == "hazard-pointers")
+            return rma_stack::ref_counting::ReclamationScheme::HazardPointers;
+        if (value == "epochs")
+            return rma_stack::ref_counting::ReclamationScheme::Epochs;
+        throw std::invalid_argument("unknown reclamation scheme: " + value);
+    }
+
+    rma_stack::ref_counting::EpochMode parseEpochMode(const std::string &value)
+    {
+        if (value == "per-operation")
+            return rma_stack::ref_counting::EpochMode::PerOperation;
+        if (value == "persistent")
+            return rma_stack::ref_counting::EpochMode::Persistent;
+        throw std::invalid_argument("unknown epoch mode: " + value);
+    }
+
+    rma_stack::PayloadPlacement parsePayloadPlacement(const std::string &value)
+    {
+        if (value == "head-rank")
+            return rma_stack::PayloadPlacement::HeadRank;
+        if (value == "producer")
+            return rma_stack::PayloadPlacement::Producer;
+        throw std::invalid_argument("unknown payload placement: " + value);
+    }
+
+    size_t parsePayloadSize(std::string_view name, const std::string &value)
+    {
+        const auto payloadSize = parseCount(name, value);
+        if (std::find(std::begin(PayloadSizes), std::end(PayloadSizes), payloadSize) == std::end(PayloadSizes))
+            throw std::invalid_argument("unsupported payload size: " + value);
+        return payloadSize;
+    }
+
+    // Имена задач в параметре --task.
+    constexpr std::pair<BenchmarkTask, std::string_view> BenchmarkTaskNames[] = {
+            {BenchmarkTask::Operations,              "operations"},
+            {BenchmarkTask::PushFillLevel,           "push-fill-level"},
+            {BenchmarkTask::PopReclamation,          "pop-reclamation"},
+            {BenchmarkTask::BulkBatchSize,           "bulk-batch-size"},
+            {BenchmarkTask::RelaxedLifo,             "relaxed-lifo"},
+            {BenchmarkTask::EpochMode,               "epoch-mode"},
+            {BenchmarkTask::RmaPipelining,           "rma-pipelining"},
+            {BenchmarkTask::AsyncOverlap,            "async-overlap"},
+            {BenchmarkTask::ThreadedRandomOperation, "threaded-random-operation"},
+            {BenchmarkTask::Query,                   "query"},
+            {BenchmarkTask::PopWait,                 "pop-wait"},
+            {BenchmarkTask::VariablePayload,         "variable-payload"},
+            {BenchmarkTask::PayloadPlacement,        "payload-placement"},
+            {BenchmarkTask::CallbackOverhead,        "callback-overhead"}
+    };
+
+    BenchmarkTask parseBenchmarkTask(const std::string &value)
+    {
+        for (const auto &[task, name]: BenchmarkTaskNames)
+        {
+            if (name == value)
+                return task;
+        }
+        throw std::invalid_argument("unknown task: " + value);
+    }
+
+    OperationMix parseOperationMix(const std::string &value)
+    {
+        if (value == "random")
+            return OperationMix::Random;
+        if (value == "push")
+            return OperationMix::OnlyPush;
+        if (value == "pop")
+            return OperationMix::OnlyPop;
+        throw std::invalid_argument("unknown operation mix: " + value);
+    }
+}
+
+std::string_view getOperationMixName(OperationMix mix)
+{
+    switch (mix)
+    {
+        case OperationMix::Random:
+            return "random";
+        case OperationMix::OnlyPush:
+            return "push";
+        case OperationMix::OnlyPop:
+            return "pop";
+    }
+    return "unknown";
+}
+
+std::string_view getBenchmarkTaskName(BenchmarkTask task)
+{
+    for (const auto &[knownTask, name]: BenchmarkTaskNames)
+    {
+        if (knownTask == task)
+            return name;
+    }
+    return "unknown";
+}
+
+BenchmarkOptions parseBenchmarkOptions(int argc, char *argv[])
+{
+    BenchmarkOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument(argv[i]);
+        const auto separatorPos = argument.find('=');
+        if (argument.rfind("--", 0) != 0 || separatorPos == std::string::npos)
+            throw std::invalid_argument("expected an option of the form --name=value: " + argument);
+
+        const auto name  = argument.substr(2, separatorPos - 2);
+        const auto value = argument.substr(separatorPos + 1);
+        if (name == "stack")
+        {
+            options.stackName = value;
+        }
+        else if (name == "task")
+        {
+            options.task = parseBenchmarkTask(value);
+        }
+        else if (name == "mix")
+        {
+            options.operationMix = parseOperationMix(value);
+        }
+        else if (name == "push-ratio")
+        {
+            options.pushRatio = parseRatio(name, value);
+        }
+        else if (name == "total-ops")
+        {
+            options.opsNum = parsePositiveInt(name, value);
+            options.weakScaling = false;
+        }
+        else if (name == "rank-ops")
+        {
+            options.opsNum = parsePositiveInt(name, value);
+            options.weakScaling = true;
+        }
+        else if (name == "warm-up")
+        {
+            options.warmUpRatio = parseRatio(name, value);
+        }
+        else if (name == "workload-ns")
+        {
+            options.workload = parseNanoseconds(name, value);
+        }
+        else if (name == "elems-up-limit")
+        {
+            options.elemsUpLimit = parsePositiveInt(name, value);
+        }
+        else if (name == "backoff-min-ns")
+        {
+            options.backoffMinDelay = parseNanoseconds(name, value);
+        }
+        else if (name == "backoff-max-ns")
+        {
+            options.backoffMaxDelay = parseNanoseconds(name, value);
+        }
+        else if (name == "repetitions")
+        {
+            options.repetitionsNum = parsePositiveInt(name, value);
+        }
+        else if (name == "results")
+        {
+            if (value.empty())
+                throw std::invalid_argument("the results path is empty");
+            options.resultsPath = value;
+        }
+        else if (name == "sample-interval-us")
+        {
+            options.throughputSampleInterval = std::chrono::microseconds(parsePositiveInt(name, value));
+        }
+        else if (name == "elimination-slots")
+        {
+            options.eliminationSlotsPerRank = parseCount(name, value);
+        }
+        else if (name == "flat-combining")
+        {
+            options.flatCombiningMode = parseFlatCombiningMode(value);
+        }
+        else if (name == "phase-timing")
+        {
+            options.phaseTiming = parseSwitch(name, value);
+        }
+        else if (name == "reclamation")
+        {
+            options.reclamationScheme = parseReclamationScheme(value);
+        }
+        else if (name == "epoch-mode")
+        {
+            options.epochMode = parseEpochMode(value);
+        }
+        else if (name == "pipelining")
+        {
+            options.requestPipelining = parseSwitch(name, value);
+        }
+        else if (name == "shard-size")
+        {
+            options.shardSize = parseCount(name, value);
+        }
+        else if (name == "payload-placement")
+        {
+            options.payloadPlacement = parsePayloadPlacement(value);
+        }
+        else if (name == "payload-size")
+        {
+            options.payloadSize = parsePayloadSize(name, value);
+        }
+        else if (name == "bulk-size")
+        {
+            options.bulkSize = parseCount(name, value);
+        }
+        else if (name == "pop-wait")
+        {
+            options.popWait = parseSwitch(name, value);
+        }
+        else if (name == "threads")
+        {
+            options.threadsNum = parsePositiveInt(name, value);
+        }
+        else
+        {
+            throw std::invalid_argument("unknown option: " + argument);
+        }
+    }
+    if (options.backoffMinDelay > options.backoffMaxDelay)
+        throw std::invalid_argument("the min backoff delay exceeds the max backoff delay");
+    return options;
+}
+
+std::string getBenchmarkOptionsUsage()
+{
+    return "options:\n"
+           "  --stack=NAME             stack variant\n"
+           "  --task=NAME              task, operations by default: operations, push-fill-level,\n"
+           "                           pop-reclamation, bulk-batch-size, relaxed-lifo, epoch-mode,\n"
+           "                           rma-pipelining, async-overlap, threaded-random-operation, query,\n"
+           "                           pop-wait, variable-payload, payload-placement (central only),\n"
+           "                           callback-overhead (inner only)\n"
+           "  --mix=random|push|pop    operation mix of the operations task\n"
+           "  --push-ratio=R           share of pushes of random ops, 0.5 by default\n"
+           "  --total-ops=N            ops of all ranks split between them (strong scaling), 15000 by default\n"
+           "  --rank-ops=N             ops of each rank (weak scaling)\n"
+           "  --warm-up=R              share of rank ops run before the first measurement of a task: pushes\n"
+           "                           for random ops, push-pop pairs otherwise, 0.1 by default\n"
+           "  --workload-ns=T          emulated application work after each op, 1000 by default\n"
+           "                           (not applied to query)\n"
+           "  --elems-up-limit=N       elements limit of the whole stack, 30000 by default\n"
+           "  --backoff-min-ns=T       min backoff delay, 1 by default\n"
+           "  --backoff-max-ns=T       max backoff delay, 100 by default\n"
+           "  --repetitions=N          measurement repetitions, 1 by default\n"
+           "  --sample-interval-us=T   interval of throughput samples, 10000 by default\n"
+           "  --results=PATH           JSON Lines file rank 0 appends a record of each measurement to,\n"
+           "                           only rank 0 writes logs then\n"
+           "  --elimination-slots=N    elimination array slots per rank, 0 (disabled) by default\n"
+           "  --flat-combining=disabled|adaptive|always\n"
+           "                           flat combining mode, disabled by default\n"
+           "  --phase-timing=on|off    time the phases of push and pop, off by default,\n"
+           "                           always on for rma-pipelining\n"
+           "  --reclamation=ref-counting|hazard-pointers|epochs\n"
+           "                           node reclamation scheme, ref-counting by default\n"
+           "  --epoch-mode=per-operation|persistent\n"
+           "                           RMA access epochs, persistent by default\n"
+           "  --pipelining=on|off      pipeline RMA requests, on by default\n"
+           "  --shard-size=N           shard size of the relaxed stack, 0 (strict) by default\n"
+           "  --payload-placement=head-rank|producer\n"
+           "                           placement of out-of-node payloads (central only), head-rank by default\n"
+           "  --payload-size=64|1024|16384\n"
+           "                           payload bytes of the payload-placement task, 64 by default\n"
+           "  --bulk-size=N            batch size of the bulk-batch-size task, 0 (single ops) by default\n"
+           "  --pop-wait=on|off        pop-wait task waits with popWait instead of polling, off by default\n"
+           "  --threads=N              threads per rank of the threaded-random-operation task, 1 by default\n";
+}
+
+int getRankOpsNum(const BenchmarkOptions &rOptions, int procNum)
+{
+    if (rOptions.weakScaling)
+        return rOptions.opsNum;
+    return static_cast<int>(std::ceil(static_cast<double>(rOptions.opsNum) / procNum));
+}
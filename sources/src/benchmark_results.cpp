@@ -0,0 +1,446 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "include/benchmark_results.h"
+
+namespace
+{
+    constexpr double Percentiles[] = {50, 90, 99, 99.9};
+
+    /*
+     * Запись одного объекта JSON в строку. Запятые между элементами
+     * расставляются автоматически, вложенность проверяется вызывающим кодом.
+     */
+    class JsonWriter
+    {
+    public:
+        JsonWriter()
+        {
+            m_oss << std::setprecision(std::numeric_limits<double>::max_digits10);
+        }
+
+        JsonWriter& beginObject(std::string_view key = {})
+        {
+            writeKey(key);
+            m_oss << '{';
+            m_firstElement = true;
+            return *this;
+        }
+        JsonWriter& endObject()
+        {
+            m_oss << '}';
+            m_firstElement = false;
+            return *this;
+        }
+        JsonWriter& beginArray(std::string_view key = {})
+        {
+            writeKey(key);
+            m_oss << '[';
+            m_firstElement = true;
+            return *this;
+        }
+        JsonWriter& endArray()
+        {
+            m_oss << ']';
+            m_firstElement = false;
+            return *this;
+        }
+
+        JsonWriter& value(std::string_view key, std::string_view value)
+        {
+            writeKey(key);
+            writeString(value);
+            return *this;
+        }
+        JsonWriter& value(std::string_view key, const char *value)
+        {
+            return this->value(key, std::string_view(value));
+        }
+        JsonWriter& value(std::string_view key, bool value)
+        {
+            writeKey(key);
+            m_oss << (value ? "true" : "false");
+            return *this;
+        }
+        JsonWriter& value(std::string_view key, double value)
+        {
+            writeKey(key);
+            // В JSON нет бесконечности и NaN.
+            if (std::isfinite(value))
+                m_oss << value;
+            else
+                m_oss << "null";
+            return *this;
+        }
+        template<typename Integer,
+                typename = std::enable_if_t<std::is_integral_v<Integer> && !std::is_same_v<Integer, bool>>>
+        JsonWriter& value(std::string_view key, Integer value)
+        {
+            writeKey(key);
+            m_oss << value;
+            return *this;
+        }
+
+        [[nodiscard]] std::string str() const
+        {
+            return m_oss.str();
+        }
+
+    private:
+        // Пустой ключ - элемент массива.
+        void writeKey(std::string_view key)
+        {
+            if (!m_firstElement)
+                m_oss << ',';
+            m_firstElement = false;
+            if (!key.empty())
+            {
+                writeString(key);
+                m_oss << ':';
+            }
+        }
+
+        void writeString(std::string_view value)
+        {
+            m_oss << '"';
+            for (const char c: value)
+            {
+                switch (c)
+                {
+                    case '"':
+                        m_oss << "\\\"";
+                        break;
+                    case '\\':
+                        m_oss << "\\\\";
+                        break;
+                    case '\n':
+                        m_oss << "\\n";
+                        break;
+                    case '\t':
+                        m_oss << "\\t";
+                        break;
+                    default:
+                        if (static_cast<unsigned char>(c) < 0x20)
+                        {
+                            char escaped[sizeof("\\u0000")];
+                            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                            m_oss << escaped;
+                        }
+                        else
+                        {
+                            m_oss << c;
+                        }
+                }
+            }
+            m_oss << '"';
+        }
+
+    private:
+        std::ostringstream m_oss;
+        bool m_firstElement{true};
+    };
+
+    std::string getUtcTimestamp()
+    {
+        // Размер буфера задаётся по образцу результата, а не по строке формата.
+        constexpr auto timestampBufferSize{sizeof("YYYY-MM-DDTHH:MM:SSZ")};
+        char timestampBuff[timestampBufferSize]{0};
+        tm tmBuffer{};
+        const std::time_t utcTime = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        if (std::strftime(timestampBuff, timestampBufferSize, "%Y-%m-%dT%H:%M:%SZ",
+                          gmtime_r(&utcTime, &tmBuffer)) == 0)
+        {
+            throw std::runtime_error("failed to format the UTC timestamp");
+        }
+        return timestampBuff;
+    }
+
+    // Кол-во различных узлов, на которых запущены процессы, у процесса 0.
+    int getNodesNum(MPI_Comm comm, int rank, int procNum)
+    {
+        char processorName[MPI_MAX_PROCESSOR_NAME]{};
+        int processorNameLength{0};
+        MPI_Get_processor_name(processorName, &processorNameLength);
+
+        std::vector<char> processorNames(rank == 0 ? static_cast<size_t>(procNum) * MPI_MAX_PROCESSOR_NAME : 0);
+        MPI_Gather(processorName, MPI_MAX_PROCESSOR_NAME, MPI_CHAR,
+                   processorNames.data(), MPI_MAX_PROCESSOR_NAME, MPI_CHAR, 0, comm);
+        if (rank != 0)
+            return 0;
+
+        std::set<std::string> uniqueProcessorNames;
+        for (int i = 0; i < procNum; ++i)
+            uniqueProcessorNames.emplace(processorNames.data() + static_cast<size_t>(i) * MPI_MAX_PROCESSOR_NAME);
+        return static_cast<int>(uniqueProcessorNames.size());
+    }
+
+    void writeHistogram(JsonWriter &rWriter, std::string_view key, const LatencyHistogram &rHistogram)
+    {
+        rWriter.beginObject(key)
+                .value("count", rHistogram.getCount())
+                .value("max_ns", rHistogram.getMaxValue());
+        rWriter.beginObject("percentiles_ns");
+        for (const auto percentile: Percentiles)
+        {
+            std::ostringstream percentileKey;
+            percentileKey << 'p' << percentile;
+            rWriter.value(percentileKey.str(), rHistogram.getValueAtPercentile(percentile));
+        }
+        rWriter.endObject();
+        // Корзина задаётся наибольшим значением, так как нижняя граница следует из предыдущей корзины.
+        rWriter.beginArray("buckets");
+        for (const auto &[upperValue, count]: rHistogram.getNonEmptyBuckets())
+            rWriter.beginArray().value({}, upperValue).value({}, count).endArray();
+        rWriter.endArray();
+        rWriter.endObject();
+    }
+
+    void writeCasCounters(JsonWriter &rWriter, std::string_view key, uint64_t attempts, uint64_t failures)
+    {
+        rWriter.beginObject(key)
+                .value("attempts", attempts)
+                .value("failures", failures)
+                .endObject();
+    }
+
+    void writeCounters(JsonWriter &rWriter, const rma_stack::ref_counting::OperationCounters &rCounters)
+    {
+        rWriter.beginObject("counters");
+        rWriter.beginObject("head_cas");
+        writeCasCounters(rWriter, "push", rCounters.pushCasAttempts, rCounters.pushCasFailures);
+        writeCasCounters(rWriter, "pop", rCounters.popCasAttempts, rCounters.popCasFailures);
+        writeCasCounters(rWriter, "head_count", rCounters.headCountCasAttempts, rCounters.headCountCasFailures);
+        rWriter.endObject();
+        rWriter.beginObject("node_acquire")
+                .value("claim_probes", rCounters.acquireClaimProbes)
+                .value("scan_probes", rCounters.acquireScanProbes)
+                .endObject();
+        rWriter.value("release_node_calls", rCounters.releaseNodeCalls);
+        rWriter.beginObject("backoff")
+                .value("calls", rCounters.backoffCalls)
+                .value("sec", rCounters.backoffSec)
+                .endObject();
+
+        // Счётчики RMA сложены по целевому процессу и хранятся столбцами, как результаты процессов.
+        const auto rmaTotal = rCounters.getRmaTotal();
+        rWriter.beginObject("rma")
+                .value("ops", rmaTotal.opsNum)
+                .value("bytes", rmaTotal.bytesNum)
+                .value("flushes", rmaTotal.flushesNum);
+        rWriter.beginObject("targets");
+        rWriter.beginArray("ops");
+        for (const auto &rTargetCounters: rCounters.rmaTargets)
+            rWriter.value({}, rTargetCounters.opsNum);
+        rWriter.endArray();
+        rWriter.beginArray("bytes");
+        for (const auto &rTargetCounters: rCounters.rmaTargets)
+            rWriter.value({}, rTargetCounters.bytesNum);
+        rWriter.endArray();
+        rWriter.beginArray("flushes");
+        for (const auto &rTargetCounters: rCounters.rmaTargets)
+            rWriter.value({}, rTargetCounters.flushesNum);
+        rWriter.endArray();
+        rWriter.endObject();
+        rWriter.endObject();
+        rWriter.endObject();
+    }
+
+    // Суммарное время этапов всех процессов в секундах.
+    void writePhaseTimes(JsonWriter &rWriter, const rma_stack::ref_counting::PushPhaseTimes &rPushPhaseTimes,
+                         const rma_stack::ref_counting::PopPhaseTimes &rPopPhaseTimes)
+    {
+        rWriter.beginObject("phases_sec");
+        rWriter.beginObject("push")
+                .value("count", rPushPhaseTimes.pushesNum)
+                .value("node_acquire", rPushPhaseTimes.nodeAcquire)
+                .value("data_put", rPushPhaseTimes.dataPut)
+                .value("link_cas", rPushPhaseTimes.linkCas)
+                .value("backoff", rPushPhaseTimes.backoff)
+                .value("finish", rPushPhaseTimes.finish)
+                .endObject();
+        rWriter.beginObject("pop")
+                .value("count", rPopPhaseTimes.popsNum)
+                .value("head_read", rPopPhaseTimes.headRead)
+                .value("next_read", rPopPhaseTimes.nextRead)
+                .value("head_cas", rPopPhaseTimes.headCas)
+                .value("data_read", rPopPhaseTimes.dataRead)
+                .value("node_release", rPopPhaseTimes.nodeRelease)
+                .value("backoff", rPopPhaseTimes.backoff)
+                .endObject();
+        rWriter.endObject();
+    }
+}
+
+void writeBenchmarkRecord(MPI_Comm comm, const BenchmarkOptions &rOptions, int repetitionIdx, std::string_view phaseName,
+                          const RankBenchmarkResult &rRankResult, const BenchmarkMeasurements &rMeasurements)
+{
+    int rank{-1};
+    MPI_Comm_rank(comm, &rank);
+    int procNum{0};
+    MPI_Comm_size(comm, &procNum);
+
+    // Счётчики передаются как double: они точно представимы до 2^53.
+    constexpr int RankResultFieldsNum = 5;
+    const double rankResult[RankResultFieldsNum] = {
+            rRankResult.elapsedSec,
+            static_cast<double>(rRankResult.pushCount),
+            static_cast<double>(rRankResult.popCount),
+            static_cast<double>(rRankResult.emptyPopCount),
+            static_cast<double>(rRankResult.queryCount)
+    };
+    std::vector<double> rankResults(rank == 0 ? static_cast<size_t>(procNum) * RankResultFieldsNum : 0);
+    MPI_Gather(rankResult, RankResultFieldsNum, MPI_DOUBLE, rankResults.data(), RankResultFieldsNum, MPI_DOUBLE, 0, comm);
+    const int nodesNum = getNodesNum(comm, rank, procNum);
+    if (rank != 0)
+        return;
+
+    const auto getRankField = [&rankResults](int rankIdx, int fieldIdx) {
+        return rankResults[static_cast<size_t>(rankIdx) * RankResultFieldsNum + fieldIdx];
+    };
+    double maxElapsedSec{0};
+    double minElapsedSec{std::numeric_limits<double>::max()};
+    double sumElapsedSec{0};
+    uint64_t totalPushCount{0};
+    uint64_t totalPopCount{0};
+    uint64_t totalEmptyPopCount{0};
+    uint64_t totalQueryCount{0};
+    for (int i = 0; i < procNum; ++i)
+    {
+        maxElapsedSec = std::max(maxElapsedSec, getRankField(i, 0));
+        minElapsedSec = std::min(minElapsedSec, getRankField(i, 0));
+        sumElapsedSec += getRankField(i, 0);
+        totalPushCount += static_cast<uint64_t>(getRankField(i, 1));
+        totalPopCount += static_cast<uint64_t>(getRankField(i, 2));
+        totalEmptyPopCount += static_cast<uint64_t>(getRankField(i, 3));
+        totalQueryCount += static_cast<uint64_t>(getRankField(i, 4));
+    }
+    const auto totalOpsNum = totalPushCount + totalPopCount + totalQueryCount;
+
+    char mpiLibraryVersion[MPI_MAX_LIBRARY_VERSION_STRING]{};
+    int mpiLibraryVersionLength{0};
+    MPI_Get_library_version(mpiLibraryVersion, &mpiLibraryVersionLength);
+    // Берётся только первая строка, остальные обычно содержат подробности сборки. Длина может учитывать '\0'.
+    const std::string_view mpiLibraryVersionView(mpiLibraryVersion);
+
+    JsonWriter writer;
+    writer.beginObject()
+            .value("benchmark", "stack_benchmark")
+            .value("task", getBenchmarkTaskName(rOptions.task))
+            .value("phase", phaseName)
+            .value("timestamp", getUtcTimestamp())
+            .value("repetition", repetitionIdx);
+
+    writer.beginObject("parameters")
+            .value("stack", rOptions.stackName)
+            .value("mix", getOperationMixName(rOptions.operationMix))
+            .value("push_ratio", rOptions.pushRatio)
+            .value("ops", rOptions.opsNum)
+            .value("weak_scaling", rOptions.weakScaling)
+            .value("rank_ops", getRankOpsNum(rOptions, procNum))
+            .value("warm_up", rOptions.warmUpRatio)
+            .value("workload_ns", rOptions.workload.count())
+            .value("elems_up_limit", rOptions.elemsUpLimit)
+            .value("backoff_min_ns", rOptions.backoffMinDelay.count())
+            .value("backoff_max_ns", rOptions.backoffMaxDelay.count())
+            .value("repetitions", rOptions.repetitionsNum)
+            .value("sample_interval_ns", rOptions.throughputSampleInterval.count())
+            .value("elimination_slots", rOptions.eliminationSlotsPerRank)
+            .value("flat_combining", rma_stack::getFlatCombiningModeName(rOptions.flatCombiningMode))
+            .value("reclamation", rma_stack::ref_counting::getReclamationSchemeName(rOptions.reclamationScheme))
+            .value("epoch_mode", rma_stack::ref_counting::getEpochModeName(rOptions.epochMode))
+            .value("pipelining", rOptions.requestPipelining)
+            .value("shard_size", rOptions.shardSize)
+            .value("payload_placement", rma_stack::getPayloadPlacementName(rOptions.payloadPlacement))
+            .value("payload_size", rOptions.payloadSize)
+            .value("bulk_size", rOptions.bulkSize)
+            .value("pop_wait", rOptions.popWait)
+            .value("threads", rOptions.threadsNum)
+            .value("phase_timing", rOptions.phaseTiming)
+            .endObject();
+
+    writer.beginObject("environment")
+            .value("procs", procNum)
+            .value("nodes", nodesNum)
+            .value("mpi_library", mpiLibraryVersionView.substr(0, mpiLibraryVersionView.find('\n')))
+#ifdef __VERSION__
+            .value("compiler", __VERSION__)
+#endif
+#ifdef NDEBUG
+            .value("assertions", false)
+#else
+            .value("assertions", true)
+#endif
+            .endObject();
+
+    writer.beginObject("summary")
+            .value("total_ops", totalOpsNum)
+            .value("push_count", totalPushCount)
+            .value("pop_count", totalPopCount)
+            .value("empty_pop_count", totalEmptyPopCount)
+            .value("query_count", totalQueryCount)
+            .value("max_elapsed_sec", maxElapsedSec)
+            .value("min_elapsed_sec", minElapsedSec)
+            .value("mean_elapsed_sec", sumElapsedSec / procNum)
+            .value("throughput_ops_per_sec", maxElapsedSec > 0 ? totalOpsNum / maxElapsedSec : 0.0)
+            .endObject();
+
+    // Результаты процессов хранятся столбцами, чтобы запись для тысяч процессов оставалась компактной.
+    writer.beginObject("ranks");
+    const char* rankFieldNames[RankResultFieldsNum] = {"elapsed_sec", "push_count", "pop_count", "empty_pop_count",
+                                                      "query_count"};
+    for (int fieldIdx = 0; fieldIdx < RankResultFieldsNum; ++fieldIdx)
+    {
+        writer.beginArray(rankFieldNames[fieldIdx]);
+        for (int i = 0; i < procNum; ++i)
+        {
+            if (fieldIdx == 0)
+                writer.value({}, getRankField(i, fieldIdx));
+            else
+                writer.value({}, static_cast<uint64_t>(getRankField(i, fieldIdx)));
+        }
+        writer.endArray();
+    }
+    writer.endObject();
+
+    writer.beginObject("latency");
+    writeHistogram(writer, "push", rMeasurements.rPushHistogram);
+    writeHistogram(writer, "pop", rMeasurements.rPopHistogram);
+    writer.endObject();
+
+    writer.beginObject("throughput_samples")
+            .value("interval_ns", rMeasurements.rThroughputSampler.getInterval().count())
+            .value("warm_up_samples", rMeasurements.warmUpSamplesNum);
+    writer.beginArray("ops");
+    for (const auto sample: rMeasurements.rThroughputSampler.getSamples())
+        writer.value({}, sample);
+    writer.endArray();
+    writer.endObject();
+
+    writeCounters(writer, rMeasurements.rCounters);
+    if (rOptions.phaseTiming)
+        writePhaseTimes(writer, rMeasurements.rPushPhaseTimes, rMeasurements.rPopPhaseTimes);
+
+    writer.endObject();
+
+    std::ofstream resultsFile(rOptions.resultsPath, std::ios::app);
+    if (!resultsFile)
+        throw std::runtime_error("failed to open the results file: " + rOptions.resultsPath);
+    resultsFile << writer.str() << '\n';
+}
@@ -0,0 +1,178 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include "include/latency_histogram.h"
+
+namespace
+{
+    constexpr size_t HalfSubBucketsNum = LatencyHistogram::SubBucketsNum / 2;
+    constexpr size_t MagnitudesNum = 64 - LatencyHistogram::SubBucketBitsNum;
+    constexpr size_t BucketsNum = LatencyHistogram::SubBucketsNum + MagnitudesNum * HalfSubBucketsNum;
+
+    // Результат записывается в буфер процесса root, буферы остальных процессов не меняются.
+    void reduceInPlace(void *pBuffer, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm)
+    {
+        int rank{-1};
+        MPI_Comm_rank(comm, &rank);
+        if (rank == root)
+            MPI_Reduce(MPI_IN_PLACE, pBuffer, count, datatype, op, root, comm);
+        else
+            MPI_Reduce(pBuffer, nullptr, count, datatype, op, root, comm);
+    }
+}
+
+LatencyHistogram::LatencyHistogram()
+:
+m_counts(BucketsNum, 0)
+{}
+
+void LatencyHistogram::record(std::chrono::nanoseconds latency)
+{
+    const auto value = static_cast<uint64_t>(std::max<std::chrono::nanoseconds::rep>(latency.count(), 0));
+    ++m_counts[getBucketIdx(value)];
+    ++m_count;
+    m_maxValue = std::max(m_maxValue, value);
+}
+
+void LatencyHistogram::reset()
+{
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    m_count = 0;
+    m_maxValue = 0;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &rOther)
+{
+    for (size_t bucketIdx = 0; bucketIdx < m_counts.size(); ++bucketIdx)
+        m_counts[bucketIdx] += rOther.m_counts[bucketIdx];
+    m_count += rOther.m_count;
+    m_maxValue = std::max(m_maxValue, rOther.m_maxValue);
+}
+
+void LatencyHistogram::reduce(MPI_Comm comm, int root)
+{
+    reduceInPlace(m_counts.data(), static_cast<int>(m_counts.size()), MPI_UINT64_T, MPI_SUM, root, comm);
+    reduceInPlace(&m_count, 1, MPI_UINT64_T, MPI_SUM, root, comm);
+    reduceInPlace(&m_maxValue, 1, MPI_UINT64_T, MPI_MAX, root, comm);
+}
+
+uint64_t LatencyHistogram::getValueAtPercentile(double percentile) const
+{
+    if (m_count == 0)
+        return 0;
+
+    const auto countAtPercentile = std::max<uint64_t>(
+            1,
+            static_cast<uint64_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * static_cast<double>(m_count)))
+    );
+    uint64_t count{0};
+    for (size_t bucketIdx = 0; bucketIdx < m_counts.size(); ++bucketIdx)
+    {
+        count += m_counts[bucketIdx];
+        if (count >= countAtPercentile)
+            return std::min(getBucketUpperValue(bucketIdx), m_maxValue);
+    }
+    return m_maxValue;
+}
+
+uint64_t LatencyHistogram::getMaxValue() const
+{
+    return m_maxValue;
+}
+
+uint64_t LatencyHistogram::getCount() const
+{
+    return m_count;
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> LatencyHistogram::getNonEmptyBuckets() const
+{
+    std::vector<std::pair<uint64_t, uint64_t>> buckets;
+    for (size_t bucketIdx = 0; bucketIdx < m_counts.size(); ++bucketIdx)
+    {
+        if (m_counts[bucketIdx] > 0)
+            buckets.emplace_back(getBucketUpperValue(bucketIdx), m_counts[bucketIdx]);
+    }
+    return buckets;
+}
+
+size_t LatencyHistogram::getBucketIdx(uint64_t value)
+{
+    if (value < SubBucketsNum)
+        return value;
+
+    // Старшие SubBucketBitsNum бит значения, первый из которых всегда равен 1.
+    const auto msbIdx = static_cast<size_t>(63 - __builtin_clzll(value));
+    const auto shift  = msbIdx - (SubBucketBitsNum - 1);
+    const auto subBucketIdx = static_cast<size_t>(value >> shift) - HalfSubBucketsNum;
+    return SubBucketsNum + (msbIdx - SubBucketBitsNum) * HalfSubBucketsNum + subBucketIdx;
+}
+
+uint64_t LatencyHistogram::getBucketUpperValue(size_t bucketIdx)
+{
+    if (bucketIdx < SubBucketsNum)
+        return bucketIdx;
+
+    const auto magnitudeIdx = (bucketIdx - SubBucketsNum) / HalfSubBucketsNum;
+    const auto subBucketIdx = (bucketIdx - SubBucketsNum) % HalfSubBucketsNum;
+    const auto shift = magnitudeIdx + 1;
+    const auto lowerValue = static_cast<uint64_t>(HalfSubBucketsNum + subBucketIdx) << shift;
+    return lowerValue + ((uint64_t{1} << shift) - 1);
+}
+
+ThroughputSampler::ThroughputSampler(std::chrono::nanoseconds t_interval)
+:
+m_interval(std::max(t_interval, std::chrono::nanoseconds(1)))
+{}
+
+void ThroughputSampler::start()
+{
+    m_samples.clear();
+    m_startTime = std::chrono::steady_clock::now();
+}
+
+void ThroughputSampler::record(std::chrono::steady_clock::time_point completionTime)
+{
+    const auto sampleIdx = static_cast<size_t>(std::max<std::chrono::nanoseconds::rep>(
+            (completionTime - m_startTime) / m_interval, 0));
+    if (sampleIdx >= m_samples.size())
+        m_samples.resize(sampleIdx + 1, 0);
+    ++m_samples[sampleIdx];
+}
+
+void ThroughputSampler::merge(const ThroughputSampler &rOther)
+{
+    if (rOther.m_samples.size() > m_samples.size())
+        m_samples.resize(rOther.m_samples.size(), 0);
+    for (size_t sampleIdx = 0; sampleIdx < rOther.m_samples.size(); ++sampleIdx)
+        m_samples[sampleIdx] += rOther.m_samples[sampleIdx];
+}
+
+void ThroughputSampler::reduce(MPI_Comm comm, int root)
+{
+    // Процессы могли работать разное кол-во интервалов, поэтому отсчёты дополняются нулями до наибольшего.
+    auto samplesNum = static_cast<uint64_t>(m_samples.size());
+    MPI_Allreduce(MPI_IN_PLACE, &samplesNum, 1, MPI_UINT64_T, MPI_MAX, comm);
+    auto samples = m_samples;
+    samples.resize(samplesNum, 0);
+    reduceInPlace(samples.data(), static_cast<int>(samplesNum), MPI_UINT64_T, MPI_SUM, root, comm);
+
+    int rank{-1};
+    MPI_Comm_rank(comm, &rank);
+    if (rank == root)
+        m_samples = std::move(samples);
+}
+
+std::chrono::nanoseconds ThroughputSampler::getInterval() const
+{
+    return m_interval;
+}
+
+const std::vector<uint64_t> &ThroughputSampler::getSamples() const
+{
+    return m_samples;
+}
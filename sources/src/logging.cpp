@@ -4,17 +4,21 @@
 
 #include <sstream>
 #include <chrono>
+#include <stdexcept>
 #include "include/logging.h"
 
 std::string getLoggingFilename(int rank, std::string_view info)
 {
-    constexpr auto timestampBufferSize{sizeof("%Y-%m-%d-%H-%M-%S")};
+    constexpr auto timestampBufferSize{sizeof("YYYY-MM-DD-HH-MM-SS")};
     char timestampBuff[timestampBufferSize]{0};
     tm tmBuffer{};
 
     const auto currentTime = std::chrono::system_clock::now();
     const std::time_t utcTime = std::chrono::system_clock::to_time_t(currentTime);
-    std::strftime(timestampBuff, timestampBufferSize, "%Y-%m-%d-%H-%M-%S", gmtime_r(&utcTime, &tmBuffer));
+    if (std::strftime(timestampBuff, timestampBufferSize, "%Y-%m-%d-%H-%M-%S", gmtime_r(&utcTime, &tmBuffer)) == 0)
+    {
+        throw std::runtime_error("failed to format the logging filename timestamp");
+    }
 
     std::ostringstream oss;
     oss << "Rank_"
@@ -0,0 +1,41 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include <map>
+#include <stdexcept>
+
+#include "include/stack_benchmark_registry.h"
+
+namespace
+{
+    // Реестр создаётся при первом обращении, так как регистрация выполняется при инициализации глобальных объектов.
+    std::map<std::string, StackBenchmarkRunner, std::less<>>& getStackBenchmarks()
+    {
+        static std::map<std::string, StackBenchmarkRunner, std::less<>> stackBenchmarks;
+        return stackBenchmarks;
+    }
+}
+
+void registerStackBenchmark(std::string name, StackBenchmarkRunner runner)
+{
+    auto &rStackBenchmarks = getStackBenchmarks();
+    if (rStackBenchmarks.count(name) > 0)
+        throw std::invalid_argument("the stack variant is already registered: " + name);
+    rStackBenchmarks.emplace(std::move(name), std::move(runner));
+}
+
+const StackBenchmarkRunner *findStackBenchmark(std::string_view name)
+{
+    const auto &rStackBenchmarks = getStackBenchmarks();
+    const auto itStackBenchmark = rStackBenchmarks.find(name);
+    return itStackBenchmark != rStackBenchmarks.end() ? &itStackBenchmark->second : nullptr;
+}
+
+std::vector<std::string> getStackBenchmarkNames()
+{
+    std::vector<std::string> names;
+    for (const auto &[name, runner]: getStackBenchmarks())
+        names.push_back(name);
+    return names;
+}
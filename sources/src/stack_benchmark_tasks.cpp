@@ -0,0 +1,111 @@
+//
+// Created by denis on 17.10.26.
+//
+
+#include <ctime>
+#include <functional>
+#include <iterator>
+
+#include "include/stack_tasks.h"
+
+void runInnerStackCallbackOverheadBenchmarkTask(rma_stack::ref_counting::InnerStack &stack, MPI_Comm comm,
+                                                const BenchmarkOptions &rOptions, int repetitionIdx,
+                                                std::shared_ptr<spdlog::sinks::sink> loggerSink)
+{
+    SPDLOG_INFO("started 'runInnerStackCallbackOverheadBenchmarkTask'");
+
+    const auto context = makeBenchmarkTaskContext(comm, rOptions, repetitionIdx, std::move(loggerSink));
+    const int opsNum = context.opsNum;
+
+    // Колбэки захватывают несколько ссылок, как колбэки внешних стеков.
+    size_t pushedNum{0};
+    size_t poppedNum{0};
+    size_t backoffsNum{0};
+    rma_stack::ref_counting::GlobalAddress lastAddress{0, rma_stack::ref_counting::DummyRank, 0};
+    const auto putDataCallback = [&pushedNum, &lastAddress](rma_stack::ref_counting::GlobalAddress dataAddress) {
+        lastAddress = dataAddress;
+        ++pushedNum;
+    };
+    const auto getDataCallback = [&poppedNum, &lastAddress](rma_stack::ref_counting::GlobalAddress dataAddress) {
+        lastAddress = dataAddress;
+        poppedNum += rma_stack::ref_counting::isGlobalAddressDummy(dataAddress) ? 0 : 1;
+    };
+    const auto backoffCallback = [&backoffsNum]() {
+        ++backoffsNum;
+        return false;
+    };
+
+    const std::string_view callbackKindNames[] = {"template", "std::function"};
+    for (size_t callbackKindIdx = 0; callbackKindIdx < std::size(callbackKindNames); ++callbackKindIdx)
+    {
+        const bool typeErased = callbackKindIdx == 1;
+
+        /*
+         * Счётчики сбрасываются, а процессорное время берётся на первой и последней операции
+         * замера, чтобы не учитывать прогрев и барьеры.
+         */
+        std::clock_t cpuBeginTicks{0};
+        std::clock_t cpuEndTicks{0};
+        const auto callbackOp = [&](int i) {
+            if (i == 0)
+            {
+                pushedNum = 0;
+                poppedNum = 0;
+                backoffsNum = 0;
+                cpuBeginTicks = std::clock();
+            }
+            MeasuredOp measuredOp{MeasuredOp::Push};
+            if (i < opsNum)
+            {
+                if (typeErased)
+                    stack.push(std::function<void(rma_stack::ref_counting::GlobalAddress)>(putDataCallback),
+                               std::function<bool()>(backoffCallback));
+                else
+                    stack.push(putDataCallback, backoffCallback);
+            }
+            else
+            {
+                const auto poppedBeforeNum = poppedNum;
+                if (typeErased)
+                    stack.pop(std::function<void(rma_stack::ref_counting::GlobalAddress)>(getDataCallback),
+                              std::function<bool()>(backoffCallback));
+                else
+                    stack.pop(getDataCallback, backoffCallback);
+                measuredOp = poppedNum == poppedBeforeNum ? MeasuredOp::EmptyPop : MeasuredOp::Pop;
+            }
+            if (i + 1 == 2 * opsNum)
+                cpuEndTicks = std::clock();
+            return measuredOp;
+        };
+
+        const OpsPhase phase{callbackKindNames[callbackKindIdx], 2 * opsNum};
+        const auto measurement = callbackKindIdx == 0
+                ? measureStackOps(stack, context, phase,
+                                  [&](int) {
+                                      stack.push(putDataCallback, backoffCallback);
+                                      stack.pop(getDataCallback, backoffCallback);
+                                  },
+                                  callbackOp)
+                : measureStackOps(stack, context, phase, NoWarmUp, callbackOp);
+
+        const double localOpsNum = std::max(2.0 * opsNum, 1.0);
+        const double cpuElapsedSec = static_cast<double>(cpuEndTicks - cpuBeginTicks) / CLOCKS_PER_SEC;
+        SPDLOG_LOGGER_INFO(context.pLogger, "procs {}, rank {}, callbacks {}, latency (nsec) {}, cpu time (nsec) {}",
+                           context.procNum, context.rank, callbackKindNames[callbackKindIdx],
+                           measurement.result.elapsedSec / localOpsNum * 1e9, cpuElapsedSec / localOpsNum * 1e9);
+        SPDLOG_LOGGER_INFO(context.pLogger, "pushed {}, popped {}, backoffs {}, total (sec) {}",
+                           pushedNum, poppedNum, backoffsNum, measurement.maxElapsedSec);
+
+        // Значения, которые не удалось снять из-за чужих операций, не переходят в следующий замер.
+        stackBarrier(stack, comm);
+        do
+        {
+            lastAddress = {0, rma_stack::ref_counting::DummyRank, 0};
+            stack.pop(getDataCallback, backoffCallback);
+        }
+        while (!rma_stack::ref_counting::isGlobalAddressDummy(lastAddress));
+        stackBarrier(stack, comm);
+    }
+
+    SPDLOG_INFO("finished 'runInnerStackCallbackOverheadBenchmarkTask'");
+}
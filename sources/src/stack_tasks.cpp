@@ -24,6 +24,7 @@ void runInnerStackSimplePushPopTask(rma_stack::ref_counting::InnerStack &stack,
         },
             [&backoff] () {
             backoff.backoff();
+            return false;
             }
         );
         const auto r = pushedAddress.rank;
@@ -39,9 +40,9 @@ void runInnerStackSimplePushPopTask(rma_stack::ref_counting::InnerStack &stack,
 
         stack.pop([&dataAddress](const rma_stack::ref_counting::GlobalAddress &t_dataAddress) {
             dataAddress = t_dataAddress;
-        },[](){});
+        },[](){ return false; });
         const auto r = dataAddress.rank;
         const auto o = dataAddress.offset;
         spdlog::debug("received address by 'pop' ({}, {})", r, o);
     }
-}
\ No newline at end of file
+}